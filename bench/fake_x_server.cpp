@@ -0,0 +1,667 @@
+#include <algorithm>              // max
+#include <array>
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>                // move
+#include <vector>
+
+#include <cassert>
+#include <cerrno>                 // errno, EAGAIN, EINTR
+#include <cstdint>
+#include <cstdio>                 // stderr
+#include <cstdlib>                // EXIT_FAILURE, EXIT_SUCCESS, strtod, strtol
+#include <cstring>                // strerror
+
+#include <getopt.h>               // getopt
+#include <poll.h>                 // poll, pollfd, POLLIN, POLLOUT
+#include <signal.h>               // sigaction, SIGINT, SIGTERM, SIGPIPE
+#include <sys/socket.h>           // socket, bind, listen, accept4, recv, send
+#include <sys/stat.h>             // mkdir
+#include <sys/un.h>               // sockaddr_un
+#include <time.h>                 // clock_gettime
+#include <unistd.h>               // close, unlink, gethostname
+
+#include <fmt/format.h>
+
+#include <protocol/atoms.hpp>
+#include <protocol/connection_setup.hpp>
+#include <protocol/errors.hpp>
+#include <protocol/events.hpp>
+#include <protocol/requests.hpp>
+
+#include "wire.hpp"
+
+/**
+ * @file fake_x_server.cpp
+ * @brief Stand-in X server for benchmarking `xtracepp` without a display:
+ *   accepts any connection setup, answers every reply-bearing core request
+ *   with a well-formed canned reply, answers extension opcodes with `Request`
+ *   errors, and optionally streams events to each client at a fixed rate.
+ */
+
+/** @brief Whether SIGINT or SIGTERM was received. */
+static std::atomic_bool stop_requested {};
+
+/**
+ * @brief Signal handler for `SIGINT` and `SIGTERM`.
+ * @param sig number of signal intercepted
+ */
+static void handleStopSignal( [[maybe_unused]] int sig ) {
+    stop_requested.store( true );
+}
+
+/**
+ * @brief Reads monotonic clock.
+ * @return monotonic time in nanoseconds
+ */
+static uint64_t nowNs() {
+    ::timespec ts {};
+    ::clock_gettime( CLOCK_MONOTONIC, &ts );
+    return uint64_t( ts.tv_sec ) * 1'000'000'000 + uint64_t( ts.tv_nsec );
+}
+
+/**
+ * @brief Size in bytes of canned reply to each core opcode, or 0 if opcode
+ *   has no reply.
+ */
+static const std::array< uint32_t, 128 > reply_sizes { [](){
+    namespace req = protocol::requests;
+    namespace oc = req::opcodes;
+    std::array< uint32_t, 128 > sizes {};
+    sizes[ oc::GETWINDOWATTRIBUTES ]    = sizeof( req::GetWindowAttributes::Reply::Encoding );
+    sizes[ oc::GETGEOMETRY ]            = sizeof( req::GetGeometry::Reply::Encoding );
+    sizes[ oc::QUERYTREE ]              = sizeof( req::QueryTree::Reply::Encoding );
+    sizes[ oc::INTERNATOM ]             = sizeof( req::InternAtom::Reply::Encoding );
+    sizes[ oc::GETATOMNAME ]            = sizeof( req::GetAtomName::Reply::Encoding );
+    sizes[ oc::GETPROPERTY ]            = sizeof( req::GetProperty::Reply::Encoding );
+    sizes[ oc::LISTPROPERTIES ]         = sizeof( req::ListProperties::Reply::Encoding );
+    sizes[ oc::GETSELECTIONOWNER ]      = sizeof( req::GetSelectionOwner::Reply::Encoding );
+    sizes[ oc::GRABPOINTER ]            = sizeof( req::GrabPointer::Reply::Encoding );
+    sizes[ oc::GRABKEYBOARD ]           = sizeof( req::GrabKeyboard::Reply::Encoding );
+    sizes[ oc::QUERYPOINTER ]           = sizeof( req::QueryPointer::Reply::Encoding );
+    sizes[ oc::GETMOTIONEVENTS ]        = sizeof( req::GetMotionEvents::Reply::Encoding );
+    sizes[ oc::TRANSLATECOORDINATES ]   = sizeof( req::TranslateCoordinates::Reply::Encoding );
+    sizes[ oc::GETINPUTFOCUS ]          = sizeof( req::GetInputFocus::Reply::Encoding );
+    sizes[ oc::QUERYKEYMAP ]            = sizeof( req::QueryKeymap::Reply::Encoding );
+    sizes[ oc::QUERYFONT ]              = sizeof( req::QueryFont::Reply::Encoding );
+    sizes[ oc::QUERYTEXTEXTENTS ]       = sizeof( req::QueryTextExtents::Reply::Encoding );
+    sizes[ oc::LISTFONTS ]              = sizeof( req::ListFonts::Reply::Encoding );
+    sizes[ oc::LISTFONTSWITHINFO ]      = sizeof( req::ListFontsWithInfo::Reply::Encoding );
+    sizes[ oc::GETFONTPATH ]            = sizeof( req::GetFontPath::Reply::Encoding );
+    sizes[ oc::GETIMAGE ]               = sizeof( req::GetImage::Reply::Encoding );
+    sizes[ oc::LISTINSTALLEDCOLORMAPS ] = sizeof( req::ListInstalledColormaps::Reply::Encoding );
+    sizes[ oc::ALLOCCOLOR ]             = sizeof( req::AllocColor::Reply::Encoding );
+    sizes[ oc::ALLOCNAMEDCOLOR ]        = sizeof( req::AllocNamedColor::Reply::Encoding );
+    sizes[ oc::ALLOCCOLORCELLS ]        = sizeof( req::AllocColorCells::Reply::Encoding );
+    sizes[ oc::ALLOCCOLORPLANES ]       = sizeof( req::AllocColorPlanes::Reply::Encoding );
+    sizes[ oc::QUERYCOLORS ]            = sizeof( req::QueryColors::Reply::Encoding );
+    sizes[ oc::LOOKUPCOLOR ]            = sizeof( req::LookupColor::Reply::Encoding );
+    sizes[ oc::QUERYBESTSIZE ]          = sizeof( req::QueryBestSize::Reply::Encoding );
+    sizes[ oc::QUERYEXTENSION ]         = sizeof( req::QueryExtension::Reply::Encoding );
+    sizes[ oc::LISTEXTENSIONS ]         = sizeof( req::ListExtensions::Reply::Encoding );
+    sizes[ oc::GETKEYBOARDMAPPING ]     = sizeof( req::GetKeyboardMapping::Reply::Encoding );
+    sizes[ oc::GETKEYBOARDCONTROL ]     = sizeof( req::GetKeyboardControl::Reply::Encoding );
+    sizes[ oc::GETPOINTERCONTROL ]      = sizeof( req::GetPointerControl::Reply::Encoding );
+    sizes[ oc::GETSCREENSAVER ]         = sizeof( req::GetScreenSaver::Reply::Encoding );
+    sizes[ oc::LISTHOSTS ]              = sizeof( req::ListHosts::Reply::Encoding );
+    sizes[ oc::SETPOINTERMAPPING ]      = sizeof( req::SetPointerMapping::Reply::Encoding );
+    sizes[ oc::GETPOINTERMAPPING ]      = sizeof( req::GetPointerMapping::Reply::Encoding );
+    sizes[ oc::SETMODIFIERMAPPING ]     = sizeof( req::SetModifierMapping::Reply::Encoding );
+    sizes[ oc::GETMODIFIERMAPPING ]     = sizeof( req::GetModifierMapping::Reply::Encoding );
+    return sizes;
+}() };
+
+/** @brief Root window of only screen. */
+static constexpr uint32_t ROOT_WINDOW       { 0x000003ff };
+/** @brief Default colormap of only screen. */
+static constexpr uint32_t DEFAULT_COLORMAP  { 0x00000020 };
+/** @brief Visual of root window. */
+static constexpr uint32_t ROOT_VISUAL       { 0x00000021 };
+/** @brief Bits of resource ID mask given to each client. */
+static constexpr uint32_t RESOURCE_ID_BITS  { 21 };
+/** @brief Lowest atom assigned by InternAtom, after predefined atoms. */
+static constexpr uint32_t FIRST_ATOM        { 69 };
+/** @brief Output buffered past which client requests are not read. */
+static constexpr size_t   MAX_PENDING_OUTPUT { 4 * 1024 * 1024 };
+
+/**
+ * @brief Connection state of one client.
+ */
+struct Client {
+    /** @brief Client socket. */
+    int      fd {};
+    /** @brief Index of client among those accepted, for resource IDs. */
+    uint32_t index {};
+    /** @brief Whether connection setup has been answered. */
+    bool     open {};
+    /** @brief Whether client encodes integers most significant byte first. */
+    bool     msb_first {};
+    /** @brief Sequence number of last request received. */
+    uint16_t sequence {};
+    /** @brief Bytes received but not yet processed. */
+    std::vector< uint8_t > input;
+    /** @brief Bytes queued for sending. */
+    std::vector< uint8_t > output;
+    /** @brief Bytes of `output` already sent. */
+    size_t   output_sent {};
+    /** @brief Time at which event stream started. */
+    uint64_t events_start_ns {};
+    /** @brief Events sent. */
+    uint64_t events_sent {};
+};
+
+/**
+ * @brief Options and shared state of stand-in server.
+ */
+struct Server {
+    /** @brief Events to send to each client per second. */
+    double   event_rate {};
+    /** @brief Event codes to cycle through. */
+    std::vector< uint8_t > event_codes { protocol::events::codes::MOTIONNOTIFY };
+    /** @brief Atoms assigned by InternAtom, by name. */
+    std::unordered_map< std::string, uint32_t > atoms;
+    /** @brief Names of predefined and assigned atoms, indexed by atom. */
+    std::vector< std::string > atom_names {
+        protocol::atoms::predefined::strings.begin(),
+        protocol::atoms::predefined::strings.end() };
+    /** @brief Clients accepted. */
+    uint32_t clients_accepted {};
+};
+
+/**
+ * @brief Queues connection setup acceptance describing a single 24-bit
+ *   TrueColor screen.
+ * @param client client to answer
+ */
+static void acceptSetup( Client* client ) {
+    assert( client != nullptr );
+    static constexpr std::string_view VENDOR { "xtracepp benchmark server" };
+    wire::Writer out { client->output, client->msb_first };
+    const size_t start { out.size() };
+    // Acceptance::Header
+    out.put8( protocol::connection_setup::InitResponse::SUCCESS );
+    out.zeros( 1 );
+    out.put16( 11 );  // protocol-major-version
+    out.put16( 0 );   // protocol-minor-version
+    out.put16( 0 );   // following_aligned_units, set below
+    // Acceptance::Encoding
+    out.put32( 1 );   // release-number
+    // resource IDs must fit in 29 bits
+    out.put32( ( client->index & 0xff ) << RESOURCE_ID_BITS );
+    out.put32( ( 1 << RESOURCE_ID_BITS ) - 1 );
+    out.put32( 0 );   // motion-buffer-size
+    out.put16( uint16_t( VENDOR.size() ) );
+    out.put16( UINT16_MAX );  // maximum-request-length
+    out.put8( 1 );    // roots
+    out.put8( 1 );    // pixmap-formats
+    out.put8( 0 );    // image-byte-order LSBFirst
+    out.put8( 0 );    // bitmap-format-bit-order LeastSignificant
+    out.put8( 32 );   // bitmap-format-scanline-unit
+    out.put8( 32 );   // bitmap-format-scanline-pad
+    out.put8( 8 );    // min-keycode
+    out.put8( 255 );  // max-keycode
+    out.zeros( 4 );
+    out.putPadded( VENDOR );
+    // FORMAT
+    out.put8( 24 );   // depth
+    out.put8( 32 );   // bits-per-pixel
+    out.put8( 32 );   // scanline-pad
+    out.zeros( 5 );
+    // SCREEN::Header
+    out.put32( ROOT_WINDOW );
+    out.put32( DEFAULT_COLORMAP );
+    out.put32( 0x00ffffff );  // white-pixel
+    out.put32( 0x00000000 );  // black-pixel
+    out.put32( 0 );           // current-input-masks
+    out.put16( 1920 );        // width-in-pixels
+    out.put16( 1080 );        // height-in-pixels
+    out.put16( 508 );         // width-in-millimeters
+    out.put16( 285 );         // height-in-millimeters
+    out.put16( 1 );           // min-installed-maps
+    out.put16( 1 );           // max-installed-maps
+    out.put32( ROOT_VISUAL );
+    out.put8( 0 );            // backing-stores Never
+    out.put8( 0 );            // save-unders
+    out.put8( 24 );           // root-depth
+    out.put8( 1 );            // allowed-depths
+    // DEPTH::Header
+    out.put8( 24 );           // depth
+    out.zeros( 1 );
+    out.put16( 1 );           // visuals
+    out.zeros( 4 );
+    // VISUALTYPE
+    out.put32( ROOT_VISUAL );
+    out.put8( 4 );            // class TrueColor
+    out.put8( 8 );            // bits-per-rgb-value
+    out.put16( 256 );         // colormap-entries
+    out.put32( 0x00ff0000 );  // red-mask
+    out.put32( 0x0000ff00 );  // green-mask
+    out.put32( 0x000000ff );  // blue-mask
+    out.zeros( 4 );
+    static constexpr size_t HEADER_SZ {
+        sizeof( protocol::connection_setup::Acceptance::Header ) };
+    out.set16( start + 6,
+               uint16_t( ( out.size() - start - HEADER_SZ ) / wire::ALIGN ) );
+    client->open = true;
+}
+
+/**
+ * @brief Assigns next atom to name.
+ * @param server server state
+ * @param name atom name, not yet assigned
+ * @return atom assigned
+ */
+static uint32_t internAtom( Server* server, const std::string& name ) {
+    assert( server != nullptr );
+    const uint32_t atom { uint32_t( server->atom_names.size() ) };
+    assert( atom == FIRST_ATOM + server->atoms.size() );
+    server->atoms.emplace( name, atom );
+    server->atom_names.emplace_back( name );
+    return atom;
+}
+
+/**
+ * @brief Queues canned reply, all zeros past the header except where a zero
+ *   would not be a valid value.
+ * @param server server state
+ * @param client client to answer
+ * @param request request encoding
+ */
+static void reply( Server* server, Client* client, const uint8_t* request ) {
+    assert( server != nullptr );
+    assert( client != nullptr );
+    assert( request != nullptr );
+    namespace oc = protocol::requests::opcodes;
+    const uint8_t opcode { request[ 0 ] };
+    const uint32_t sz { reply_sizes[ opcode ] };
+    assert( sz >= protocol::requests::Reply::DEFAULT_ENCODING_SZ );
+    wire::Writer out { client->output, client->msb_first };
+    const size_t start { out.size() };
+    out.put8( protocol::requests::Reply::REPLY );
+    out.put8( opcode == oc::GETGEOMETRY ? 24 : 0 );  // depth
+    out.put16( client->sequence );
+    out.put32( ( sz - protocol::requests::Reply::DEFAULT_ENCODING_SZ ) /
+               wire::ALIGN );
+    out.zeros( sz - 8 );
+    switch ( opcode ) {
+    case oc::GETWINDOWATTRIBUTES:
+        out.set32( start + 8, ROOT_VISUAL );
+        out.set16( start + 12, 1 );  // class InputOutput
+        break;
+    case oc::GETGEOMETRY:
+        out.set32( start + 8, ROOT_WINDOW );
+        break;
+    case oc::INTERNATOM: {
+        const std::string name {
+            reinterpret_cast< const char* >( request ) + 8,
+            wire::get16( request + 4, client->msb_first ) };
+        const bool only_if_exists ( request[ 1 ] );
+        if ( const auto it { server->atoms.find( name ) };
+             it != server->atoms.end() ) {
+            out.set32( start + 8, it->second );
+        } else if ( !only_if_exists ) {
+            const uint32_t atom { internAtom( server, name ) };
+            out.set32( start + 8, atom );
+        }
+    }   break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Queues `Request` error for opcode without canned reply.
+ * @param client client to answer
+ * @param request request encoding
+ */
+static void requestError( Client* client, const uint8_t* request ) {
+    assert( client != nullptr );
+    assert( request != nullptr );
+    wire::Writer out { client->output, client->msb_first };
+    out.put8( protocol::errors::Error::ERROR );
+    out.put8( protocol::errors::codes::REQUEST );
+    out.put16( client->sequence );
+    out.put32( 0 );           // bad value
+    out.put16( 0 );           // minor opcode
+    out.put8( request[ 0 ] ); // major opcode
+    out.zeros( protocol::errors::Error::ENCODING_SZ - 11 );
+}
+
+/**
+ * @brief Queues GetAtomName reply with atom's name, or `Atom` error if atom
+ *   is not predefined or assigned, as ends `xtracepp --prefetchatoms`.
+ * @param server server state
+ * @param client client to answer
+ * @param request request encoding
+ */
+static void atomName( const Server& server, Client* client,
+                      const uint8_t* request ) {
+    assert( client != nullptr );
+    assert( request != nullptr );
+    wire::Writer out { client->output, client->msb_first };
+    const uint32_t atom { wire::get32( request + 4, client->msb_first ) };
+    if ( atom == 0 || atom >= server.atom_names.size() ) {
+        out.put8( protocol::errors::Error::ERROR );
+        out.put8( protocol::errors::codes::ATOM );
+        out.put16( client->sequence );
+        out.put32( atom );        // bad value
+        out.put16( 0 );           // minor opcode
+        out.put8( request[ 0 ] ); // major opcode
+        out.zeros( protocol::errors::Error::ENCODING_SZ - 11 );
+        return;
+    }
+    const std::string& name { server.atom_names[ atom ] };
+    out.put8( protocol::requests::Reply::REPLY );
+    out.zeros( 1 );
+    out.put16( client->sequence );
+    out.put32( uint32_t( wire::pad( name.size() ) / wire::ALIGN ) );
+    out.put16( uint16_t( name.size() ) );
+    out.zeros( protocol::requests::Reply::DEFAULT_ENCODING_SZ - 10 );
+    out.putPadded( name );
+}
+
+/**
+ * @brief Answers all complete messages in client input.
+ * @param server server state
+ * @param client client to answer
+ * @return whether connection should remain open
+ */
+static bool processInput( Server* server, Client* client ) {
+    assert( server != nullptr );
+    assert( client != nullptr );
+    std::vector< uint8_t >& input { client->input };
+    size_t pos {};
+    while ( pos < input.size() ) {
+        const uint8_t* data { input.data() + pos };
+        const size_t avail { input.size() - pos };
+        if ( !client->open ) {
+            using protocol::connection_setup::Initiation;
+            if ( avail < sizeof( Initiation::Header ) )
+                break;
+            if ( data[ 0 ] != Initiation::MSBFIRST &&
+                 data[ 0 ] != Initiation::LSBFIRST ) {
+                return false;
+            }
+            client->msb_first = ( data[ 0 ] == Initiation::MSBFIRST );
+            const size_t sz { sizeof( Initiation::Header ) +
+                wire::pad( wire::get16( data + 6, client->msb_first ) ) +
+                wire::pad( wire::get16( data + 8, client->msb_first ) ) };
+            if ( avail < sz )
+                break;
+            // any authorization is accepted
+            acceptSetup( client );
+            pos += sz;
+            continue;
+        }
+        if ( avail < 4 )
+            break;
+        const size_t sz { wire::get16( data + 2, client->msb_first ) * wire::ALIGN };
+        // BIG-REQUESTS is not advertised, so zero length is malformed
+        if ( sz == 0 )
+            return false;
+        if ( avail < sz )
+            break;
+        ++client->sequence;
+        if ( data[ 0 ] == protocol::requests::opcodes::GETATOMNAME )
+            atomName( *server, client, data );
+        else if ( data[ 0 ] < reply_sizes.size() && reply_sizes[ data[ 0 ] ] != 0 )
+            reply( server, client, data );
+        else if ( data[ 0 ] < protocol::requests::opcodes::MIN ||
+                  data[ 0 ] > protocol::requests::opcodes::MAX )
+            requestError( client, data );
+        pos += sz;
+    }
+    input.erase( input.begin(), input.begin() + std::ptrdiff_t( pos ) );
+    return true;
+}
+
+/**
+ * @brief Queues events owed to client by event rate.
+ * @param server server state
+ * @param client client to send events
+ * @param now_ns current monotonic time
+ */
+static void queueEvents( const Server& server, Client* client,
+                         const uint64_t now_ns ) {
+    assert( client != nullptr );
+    if ( !client->open || server.event_rate <= 0 )
+        return;
+    if ( client->events_start_ns == 0 )
+        client->events_start_ns = now_ns;
+    const uint64_t owed {
+        uint64_t( double( now_ns - client->events_start_ns ) / 1e9 *
+                  server.event_rate ) };
+    wire::Writer out { client->output, client->msb_first };
+    for ( ; client->events_sent < owed &&
+              client->output.size() < MAX_PENDING_OUTPUT;
+          ++client->events_sent ) {
+        const uint8_t code { server.event_codes[
+                client->events_sent % server.event_codes.size() ] };
+        const size_t start { out.size() };
+        out.put8( code );
+        out.put8( 0 );
+        out.put16( client->sequence );
+        out.zeros( protocol::events::Event::ENCODING_SZ - 4 );
+        // fields common to input events: time, root, event, same-screen
+        if ( code >= protocol::events::codes::KEYPRESS &&
+             code <= protocol::events::codes::MOTIONNOTIFY ) {
+            out.set32( start + 4, uint32_t( now_ns / 1'000'000 ) );
+            out.set32( start + 8, ROOT_WINDOW );
+            out.set32( start + 12, ROOT_WINDOW );
+            out.set16( start + 24, uint16_t( client->events_sent % 1920 ) );
+            out.set16( start + 26, uint16_t( client->events_sent % 1080 ) );
+            client->output[ start + 30 ] = 1;
+        }
+    }
+    // events not sent due to backpressure are dropped rather than bunched
+    client->events_sent = std::max( client->events_sent, owed );
+}
+
+/**
+ * @brief Sends as much queued output as socket accepts.
+ * @param client client to send to
+ * @return whether connection should remain open
+ */
+static bool flushOutput( Client* client ) {
+    assert( client != nullptr );
+    while ( client->output_sent < client->output.size() ) {
+        const ::ssize_t ret {
+            ::send( client->fd, client->output.data() + client->output_sent,
+                    client->output.size() - client->output_sent,
+                    MSG_DONTWAIT | MSG_NOSIGNAL ) };
+        if ( ret == -1 ) {
+            if ( errno == EINTR )
+                continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        client->output_sent += size_t( ret );
+    }
+    client->output.clear();
+    client->output_sent = 0;
+    return true;
+}
+
+/**
+ * @brief Writes `xauth(1)` file with MIT-MAGIC-COOKIE-1 entry for display,
+ *   for `xtracepp` to copy; cookie is not checked by this server.
+ * @param path file path
+ * @param display display number
+ * @return whether file was written
+ */
+static bool writeXauth( const char* path, const int display ) {
+    assert( path != nullptr );
+    char hostname[ 256 ] {};
+    if ( ::gethostname( hostname, sizeof( hostname ) - 1 ) != 0 )
+        return false;
+    std::vector< uint8_t > entry;
+    wire::Writer out { entry, true };  // always MSB first
+    static constexpr uint16_t FAMILY_LOCAL { 256 };
+    static constexpr std::string_view AUTH_NAME { "MIT-MAGIC-COOKIE-1" };
+    static constexpr size_t COOKIE_SZ { 16 };
+    const std::string display_str { fmt::format( "{}", display ) };
+    out.put16( FAMILY_LOCAL );
+    out.put16( uint16_t( std::string_view( hostname ).size() ) );
+    entry.insert( entry.end(), hostname, hostname + std::string_view( hostname ).size() );
+    out.put16( uint16_t( display_str.size() ) );
+    entry.insert( entry.end(), display_str.begin(), display_str.end() );
+    out.put16( uint16_t( AUTH_NAME.size() ) );
+    entry.insert( entry.end(), AUTH_NAME.begin(), AUTH_NAME.end() );
+    out.put16( COOKIE_SZ );
+    for ( size_t i {}; i < COOKIE_SZ; ++i )
+        out.put8( uint8_t( nowNs() >> ( i % 8 ) ) );
+    ::FILE* fs { ::fopen( path, "wb" ) };
+    if ( fs == nullptr )
+        return false;
+    const bool written {
+        ::fwrite( entry.data(), 1, entry.size(), fs ) == entry.size() };
+    return ::fclose( fs ) == 0 && written;
+}
+
+int main( const int argc, char* const* argv ) {
+    assert( argc >= 1 );
+    const char* process_name { argv[ 0 ] };
+    static constexpr std::string_view USAGE {
+        "usage: {} [-d display] [-a xauth_path] [-r events_per_sec] "
+        "[-e code[,code...]] [-A atoms]\n"
+        "  -d  display number to serve, default 97\n"
+        "  -a  write xauth file with entry for display (for xtracepp)\n"
+        "  -r  events sent to each client per second, default 0\n"
+        "  -e  core event codes to cycle through, default 6 (MotionNotify)\n"
+        "  -A  atoms to intern on startup, as a desktop session would have\n"
+        "      (for timing xtracepp --prefetchatoms), default 0" };
+    Server server;
+    int display { 97 };
+    const char* xauth_path {};
+    long startup_atoms {};
+    for ( int c; ( c = ::getopt( argc, argv, "d:a:r:e:A:h" ) ) != -1; ) {
+        switch ( c ) {
+        case 'd':
+            display = int( std::strtol( optarg, nullptr, 10 ) );
+            break;
+        case 'a':
+            xauth_path = optarg;
+            break;
+        case 'r':
+            server.event_rate = std::strtod( optarg, nullptr );
+            break;
+        case 'e': {
+            server.event_codes.clear();
+            for ( char* code { optarg }; *code != '\0'; ) {
+                char* end {};
+                const long val { std::strtol( code, &end, 10 ) };
+                if ( end == code || val < protocol::events::codes::MIN ||
+                     val > protocol::events::codes::MAX ) {
+                    fmt::println( ::stderr, "{}: invalid core event code list {:?}",
+                                  process_name, optarg );
+                    return EXIT_FAILURE;
+                }
+                server.event_codes.push_back( uint8_t( val ) );
+                code = ( *end == ',' ) ? end + 1 : end;
+            }
+        }   break;
+        case 'A':
+            startup_atoms = std::strtol( optarg, nullptr, 10 );
+            break;
+        default:
+            fmt::println( ::stderr, USAGE, process_name );
+            return c == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if ( server.event_codes.empty() ) {
+        fmt::println( ::stderr, USAGE, process_name );
+        return EXIT_FAILURE;
+    }
+    for ( long i {}; i < startup_atoms; ++i )
+        internAtom( &server, fmt::format( "_XTRACEPP_BENCH_ATOM_{}", i ) );
+    if ( xauth_path != nullptr && !writeXauth( xauth_path, display ) ) {
+        fmt::println( ::stderr, "{}: could not write xauth file {:?}: {}",
+                      process_name, xauth_path, std::strerror( errno ) );
+        return EXIT_FAILURE;
+    }
+
+    struct ::sigaction act {};
+    act.sa_handler = &handleStopSignal;
+    ::sigaction( SIGINT, &act, nullptr );
+    ::sigaction( SIGTERM, &act, nullptr );
+
+    const std::string path { wire::socketPath( display ) };
+    ::mkdir( "/tmp/.X11-unix", 01777 );
+    ::unlink( path.c_str() );
+    const int listen_fd { ::socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 ) };
+    ::sockaddr_un addr {};
+    addr.sun_family = AF_UNIX;
+    path.copy( addr.sun_path, sizeof( addr.sun_path ) - 1 );
+    if ( listen_fd < 0 ||
+         ::bind( listen_fd, reinterpret_cast< ::sockaddr* >( &addr ),
+                 sizeof( addr ) ) != 0 ||
+         ::listen( listen_fd, SOMAXCONN ) != 0 ) {
+        fmt::println( ::stderr, "{}: could not listen on {:?}: {}",
+                      process_name, path, std::strerror( errno ) );
+        return EXIT_FAILURE;
+    }
+    fmt::println( ::stderr, "{}: serving display :{}", process_name, display );
+
+    std::vector< Client > clients;
+    std::vector< ::pollfd > pfds;
+    while ( !stop_requested.load() ) {
+        pfds.clear();
+        pfds.push_back( { listen_fd, POLLIN, 0 } );
+        for ( const Client& client : clients ) {
+            pfds.push_back( { client.fd, short(
+                ( client.output.size() < MAX_PENDING_OUTPUT ? POLLIN : 0 ) |
+                ( client.output_sent < client.output.size() ? POLLOUT : 0 ) ), 0 } );
+        }
+        const int timeout_ms { server.event_rate > 0 ? 1 : -1 };
+        if ( ::poll( pfds.data(), nfds_t( pfds.size() ), timeout_ms ) == -1 ) {
+            if ( errno == EINTR )
+                continue;
+            fmt::println( ::stderr, "{}: poll: {}", process_name,
+                          std::strerror( errno ) );
+            break;
+        }
+        const uint64_t now_ns { nowNs() };
+        std::vector< Client > still_open;
+        for ( size_t i {}; i < clients.size(); ++i ) {
+            Client& client { clients[ i ] };
+            const short revents { pfds[ i + 1 ].revents };
+            bool open { ( revents & ( POLLERR | POLLNVAL ) ) == 0 };
+            if ( open && ( revents & ( POLLIN | POLLHUP ) ) ) {
+                uint8_t buf[ 64 * 1024 ];
+                const ::ssize_t ret { ::recv( client.fd, buf, sizeof( buf ),
+                                              MSG_DONTWAIT ) };
+                if ( ret > 0 ) {
+                    client.input.insert( client.input.end(), buf, buf + ret );
+                    open = processInput( &server, &client );
+                } else if ( ret == 0 || ( errno != EAGAIN && errno != EINTR ) ) {
+                    open = false;
+                }
+            }
+            if ( open ) {
+                queueEvents( server, &client, now_ns );
+                open = flushOutput( &client );
+            }
+            if ( open )
+                still_open.emplace_back( std::move( client ) );
+            else
+                ::close( client.fd );
+        }
+        clients = std::move( still_open );
+        if ( pfds[ 0 ].revents & POLLIN ) {
+            const int fd { ::accept4( listen_fd, nullptr, nullptr,
+                                      SOCK_CLOEXEC | SOCK_NONBLOCK ) };
+            if ( fd >= 0 ) {
+                Client client;
+                client.fd = fd;
+                client.index = ++server.clients_accepted;
+                clients.emplace_back( std::move( client ) );
+            }
+        }
+    }
+    for ( const Client& client : clients )
+        ::close( client.fd );
+    ::close( listen_fd );
+    ::unlink( path.c_str() );
+    return EXIT_SUCCESS;
+}
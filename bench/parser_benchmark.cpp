@@ -0,0 +1,1405 @@
+#include <algorithm>              // sort, min
+#include <array>
+#include <fstream>
+#include <functional>             // function
+#include <map>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <tuple>                  // tie
+#include <vector>
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>                 // stderr
+#include <cstdlib>                // EXIT_FAILURE, EXIT_SUCCESS, strtol, strtod
+
+#include <getopt.h>               // getopt
+
+#include <fmt/format.h>
+
+#include <Connection.hpp>
+#include <Settings.hpp>
+#include <X11ProtocolParser.hpp>
+#include <monotonic.hpp>
+#include <protocol/atoms.hpp>
+#include <protocol/common_types.hpp>
+#include <protocol/connection_setup.hpp>
+#include <protocol/errors.hpp>
+#include <protocol/events.hpp>
+#include <protocol/requests.hpp>
+
+#include "wire.hpp"
+
+/**
+ * @file parser_benchmark.cpp
+ * @brief Times each core request, reply, event and error parsing function of
+ *   [X11ProtocolParser](#X11ProtocolParser) in isolation, plus the
+ *   out-of-line `_parseListMember` specializations, on representative
+ *   encodings in both byte orders and with every combination of `--verbose`
+ *   and `--multiline`; writes results as CSV, and optionally compares them
+ *   to a previous results file to flag regressions.
+ */
+
+namespace oc = protocol::requests::opcodes;
+namespace rq = protocol::requests;
+
+/** @brief Root window used in encodings. */
+static constexpr uint32_t ROOT_WINDOW  { 0x000003ff };
+/** @brief Client window used in encodings. */
+static constexpr uint32_t WINDOW       { 0x00200001 };
+/** @brief Client graphics context used in encodings. */
+static constexpr uint32_t GC           { 0x00200002 };
+/** @brief Client font used in encodings. */
+static constexpr uint32_t FONT         { 0x00200003 };
+/** @brief Default colormap used in encodings. */
+static constexpr uint32_t COLORMAP     { 0x00000020 };
+/** @brief Root visual used in encodings. */
+static constexpr uint32_t VISUAL       { 0x00000021 };
+/** @brief Sequence number of all encodings. */
+static constexpr uint16_t SEQUENCE     { 1 };
+/** @brief Atom name interned by InternAtom encodings. */
+static constexpr std::string_view ATOM_NAME      { "_NET_WM_NAME" };
+/** @brief Extension name queried by QueryExtension encodings. */
+static constexpr std::string_view EXTENSION_NAME { "MIT-SHM" };
+
+/**
+ * @brief Size in bytes of fixed encoding of each core request, or 0 if not
+ *   a core opcode.
+ */
+static const std::array< uint32_t, 128 > request_sizes { [](){
+    std::array< uint32_t, 128 > sizes {};
+    sizes[ oc::CREATEWINDOW ]             = rq::CreateWindow::BASE_ENCODING_SZ;
+    sizes[ oc::CHANGEWINDOWATTRIBUTES ]   = rq::ChangeWindowAttributes::BASE_ENCODING_SZ;
+    sizes[ oc::GETWINDOWATTRIBUTES ]      = rq::GetWindowAttributes::BASE_ENCODING_SZ;
+    sizes[ oc::DESTROYWINDOW ]            = rq::DestroyWindow::BASE_ENCODING_SZ;
+    sizes[ oc::DESTROYSUBWINDOWS ]        = rq::DestroySubwindows::BASE_ENCODING_SZ;
+    sizes[ oc::CHANGESAVESET ]            = rq::ChangeSaveSet::BASE_ENCODING_SZ;
+    sizes[ oc::REPARENTWINDOW ]           = rq::ReparentWindow::BASE_ENCODING_SZ;
+    sizes[ oc::MAPWINDOW ]                = rq::MapWindow::BASE_ENCODING_SZ;
+    sizes[ oc::MAPSUBWINDOWS ]            = rq::MapSubwindows::BASE_ENCODING_SZ;
+    sizes[ oc::UNMAPWINDOW ]              = rq::UnmapWindow::BASE_ENCODING_SZ;
+    sizes[ oc::UNMAPSUBWINDOWS ]          = rq::UnmapSubwindows::BASE_ENCODING_SZ;
+    sizes[ oc::CONFIGUREWINDOW ]          = rq::ConfigureWindow::BASE_ENCODING_SZ;
+    sizes[ oc::CIRCULATEWINDOW ]          = rq::CirculateWindow::BASE_ENCODING_SZ;
+    sizes[ oc::GETGEOMETRY ]              = rq::GetGeometry::BASE_ENCODING_SZ;
+    sizes[ oc::QUERYTREE ]                = rq::QueryTree::BASE_ENCODING_SZ;
+    sizes[ oc::INTERNATOM ]               = rq::InternAtom::BASE_ENCODING_SZ;
+    sizes[ oc::GETATOMNAME ]              = rq::GetAtomName::BASE_ENCODING_SZ;
+    sizes[ oc::CHANGEPROPERTY ]           = rq::ChangeProperty::BASE_ENCODING_SZ;
+    sizes[ oc::DELETEPROPERTY ]           = rq::DeleteProperty::BASE_ENCODING_SZ;
+    sizes[ oc::GETPROPERTY ]              = rq::GetProperty::BASE_ENCODING_SZ;
+    sizes[ oc::LISTPROPERTIES ]           = rq::ListProperties::BASE_ENCODING_SZ;
+    sizes[ oc::SETSELECTIONOWNER ]        = rq::SetSelectionOwner::BASE_ENCODING_SZ;
+    sizes[ oc::GETSELECTIONOWNER ]        = rq::GetSelectionOwner::BASE_ENCODING_SZ;
+    sizes[ oc::CONVERTSELECTION ]         = rq::ConvertSelection::BASE_ENCODING_SZ;
+    sizes[ oc::SENDEVENT ]                = rq::SendEvent::BASE_ENCODING_SZ;
+    sizes[ oc::GRABPOINTER ]              = rq::GrabPointer::BASE_ENCODING_SZ;
+    sizes[ oc::UNGRABPOINTER ]            = rq::UngrabPointer::BASE_ENCODING_SZ;
+    sizes[ oc::GRABBUTTON ]               = rq::GrabButton::BASE_ENCODING_SZ;
+    sizes[ oc::UNGRABBUTTON ]             = rq::UngrabButton::BASE_ENCODING_SZ;
+    sizes[ oc::CHANGEACTIVEPOINTERGRAB ]  = rq::ChangeActivePointerGrab::BASE_ENCODING_SZ;
+    sizes[ oc::GRABKEYBOARD ]             = rq::GrabKeyboard::BASE_ENCODING_SZ;
+    sizes[ oc::UNGRABKEYBOARD ]           = rq::UngrabKeyboard::BASE_ENCODING_SZ;
+    sizes[ oc::GRABKEY ]                  = rq::GrabKey::BASE_ENCODING_SZ;
+    sizes[ oc::UNGRABKEY ]                = rq::UngrabKey::BASE_ENCODING_SZ;
+    sizes[ oc::ALLOWEVENTS ]              = rq::AllowEvents::BASE_ENCODING_SZ;
+    sizes[ oc::GRABSERVER ]               = rq::GrabServer::BASE_ENCODING_SZ;
+    sizes[ oc::UNGRABSERVER ]             = rq::UngrabServer::BASE_ENCODING_SZ;
+    sizes[ oc::QUERYPOINTER ]             = rq::QueryPointer::BASE_ENCODING_SZ;
+    sizes[ oc::GETMOTIONEVENTS ]          = rq::GetMotionEvents::BASE_ENCODING_SZ;
+    sizes[ oc::TRANSLATECOORDINATES ]     = rq::TranslateCoordinates::BASE_ENCODING_SZ;
+    sizes[ oc::WARPPOINTER ]              = rq::WarpPointer::BASE_ENCODING_SZ;
+    sizes[ oc::SETINPUTFOCUS ]            = rq::SetInputFocus::BASE_ENCODING_SZ;
+    sizes[ oc::GETINPUTFOCUS ]            = rq::GetInputFocus::BASE_ENCODING_SZ;
+    sizes[ oc::QUERYKEYMAP ]              = rq::QueryKeymap::BASE_ENCODING_SZ;
+    sizes[ oc::OPENFONT ]                 = rq::OpenFont::BASE_ENCODING_SZ;
+    sizes[ oc::CLOSEFONT ]                = rq::CloseFont::BASE_ENCODING_SZ;
+    sizes[ oc::QUERYFONT ]                = rq::QueryFont::BASE_ENCODING_SZ;
+    sizes[ oc::QUERYTEXTEXTENTS ]         = rq::QueryTextExtents::BASE_ENCODING_SZ;
+    sizes[ oc::LISTFONTS ]                = rq::ListFonts::BASE_ENCODING_SZ;
+    sizes[ oc::LISTFONTSWITHINFO ]        = rq::ListFontsWithInfo::BASE_ENCODING_SZ;
+    sizes[ oc::SETFONTPATH ]              = rq::SetFontPath::BASE_ENCODING_SZ;
+    sizes[ oc::GETFONTPATH ]              = rq::GetFontPath::BASE_ENCODING_SZ;
+    sizes[ oc::CREATEPIXMAP ]             = rq::CreatePixmap::BASE_ENCODING_SZ;
+    sizes[ oc::FREEPIXMAP ]               = rq::FreePixmap::BASE_ENCODING_SZ;
+    sizes[ oc::CREATEGC ]                 = rq::CreateGC::BASE_ENCODING_SZ;
+    sizes[ oc::CHANGEGC ]                 = rq::ChangeGC::BASE_ENCODING_SZ;
+    sizes[ oc::COPYGC ]                   = rq::CopyGC::BASE_ENCODING_SZ;
+    sizes[ oc::SETDASHES ]                = rq::SetDashes::BASE_ENCODING_SZ;
+    sizes[ oc::SETCLIPRECTANGLES ]        = rq::SetClipRectangles::BASE_ENCODING_SZ;
+    sizes[ oc::FREEGC ]                   = rq::FreeGC::BASE_ENCODING_SZ;
+    sizes[ oc::CLEARAREA ]                = rq::ClearArea::BASE_ENCODING_SZ;
+    sizes[ oc::COPYAREA ]                 = rq::CopyArea::BASE_ENCODING_SZ;
+    sizes[ oc::COPYPLANE ]                = rq::CopyPlane::BASE_ENCODING_SZ;
+    sizes[ oc::POLYPOINT ]                = rq::PolyPoint::BASE_ENCODING_SZ;
+    sizes[ oc::POLYLINE ]                 = rq::PolyLine::BASE_ENCODING_SZ;
+    sizes[ oc::POLYSEGMENT ]              = rq::PolySegment::BASE_ENCODING_SZ;
+    sizes[ oc::POLYRECTANGLE ]            = rq::PolyRectangle::BASE_ENCODING_SZ;
+    sizes[ oc::POLYARC ]                  = rq::PolyArc::BASE_ENCODING_SZ;
+    sizes[ oc::FILLPOLY ]                 = rq::FillPoly::BASE_ENCODING_SZ;
+    sizes[ oc::POLYFILLRECTANGLE ]        = rq::PolyFillRectangle::BASE_ENCODING_SZ;
+    sizes[ oc::POLYFILLARC ]              = rq::PolyFillArc::BASE_ENCODING_SZ;
+    sizes[ oc::PUTIMAGE ]                 = rq::PutImage::BASE_ENCODING_SZ;
+    sizes[ oc::GETIMAGE ]                 = rq::GetImage::BASE_ENCODING_SZ;
+    sizes[ oc::POLYTEXT8 ]                = rq::PolyText8::BASE_ENCODING_SZ;
+    sizes[ oc::POLYTEXT16 ]               = rq::PolyText16::BASE_ENCODING_SZ;
+    sizes[ oc::IMAGETEXT8 ]               = rq::ImageText8::BASE_ENCODING_SZ;
+    sizes[ oc::IMAGETEXT16 ]              = rq::ImageText16::BASE_ENCODING_SZ;
+    sizes[ oc::CREATECOLORMAP ]           = rq::CreateColormap::BASE_ENCODING_SZ;
+    sizes[ oc::FREECOLORMAP ]             = rq::FreeColormap::BASE_ENCODING_SZ;
+    sizes[ oc::COPYCOLORMAPANDFREE ]      = rq::CopyColormapAndFree::BASE_ENCODING_SZ;
+    sizes[ oc::INSTALLCOLORMAP ]          = rq::InstallColormap::BASE_ENCODING_SZ;
+    sizes[ oc::UNINSTALLCOLORMAP ]        = rq::UninstallColormap::BASE_ENCODING_SZ;
+    sizes[ oc::LISTINSTALLEDCOLORMAPS ]   = rq::ListInstalledColormaps::BASE_ENCODING_SZ;
+    sizes[ oc::ALLOCCOLOR ]               = rq::AllocColor::BASE_ENCODING_SZ;
+    sizes[ oc::ALLOCNAMEDCOLOR ]          = rq::AllocNamedColor::BASE_ENCODING_SZ;
+    sizes[ oc::ALLOCCOLORCELLS ]          = rq::AllocColorCells::BASE_ENCODING_SZ;
+    sizes[ oc::ALLOCCOLORPLANES ]         = rq::AllocColorPlanes::BASE_ENCODING_SZ;
+    sizes[ oc::FREECOLORS ]               = rq::FreeColors::BASE_ENCODING_SZ;
+    sizes[ oc::STORECOLORS ]              = rq::StoreColors::BASE_ENCODING_SZ;
+    sizes[ oc::STORENAMEDCOLOR ]          = rq::StoreNamedColor::BASE_ENCODING_SZ;
+    sizes[ oc::QUERYCOLORS ]              = rq::QueryColors::BASE_ENCODING_SZ;
+    sizes[ oc::LOOKUPCOLOR ]              = rq::LookupColor::BASE_ENCODING_SZ;
+    sizes[ oc::CREATECURSOR ]             = rq::CreateCursor::BASE_ENCODING_SZ;
+    sizes[ oc::CREATEGLYPHCURSOR ]        = rq::CreateGlyphCursor::BASE_ENCODING_SZ;
+    sizes[ oc::FREECURSOR ]               = rq::FreeCursor::BASE_ENCODING_SZ;
+    sizes[ oc::RECOLORCURSOR ]            = rq::RecolorCursor::BASE_ENCODING_SZ;
+    sizes[ oc::QUERYBESTSIZE ]            = rq::QueryBestSize::BASE_ENCODING_SZ;
+    sizes[ oc::QUERYEXTENSION ]           = rq::QueryExtension::BASE_ENCODING_SZ;
+    sizes[ oc::LISTEXTENSIONS ]           = rq::ListExtensions::BASE_ENCODING_SZ;
+    sizes[ oc::CHANGEKEYBOARDMAPPING ]    = rq::ChangeKeyboardMapping::BASE_ENCODING_SZ;
+    sizes[ oc::GETKEYBOARDMAPPING ]       = rq::GetKeyboardMapping::BASE_ENCODING_SZ;
+    sizes[ oc::CHANGEKEYBOARDCONTROL ]    = rq::ChangeKeyboardControl::BASE_ENCODING_SZ;
+    sizes[ oc::GETKEYBOARDCONTROL ]       = rq::GetKeyboardControl::BASE_ENCODING_SZ;
+    sizes[ oc::BELL ]                     = rq::Bell::BASE_ENCODING_SZ;
+    sizes[ oc::CHANGEPOINTERCONTROL ]     = rq::ChangePointerControl::BASE_ENCODING_SZ;
+    sizes[ oc::GETPOINTERCONTROL ]        = rq::GetPointerControl::BASE_ENCODING_SZ;
+    sizes[ oc::SETSCREENSAVER ]           = rq::SetScreenSaver::BASE_ENCODING_SZ;
+    sizes[ oc::GETSCREENSAVER ]           = rq::GetScreenSaver::BASE_ENCODING_SZ;
+    sizes[ oc::CHANGEHOSTS ]              = rq::ChangeHosts::BASE_ENCODING_SZ;
+    sizes[ oc::LISTHOSTS ]                = rq::ListHosts::BASE_ENCODING_SZ;
+    sizes[ oc::SETACCESSCONTROL ]         = rq::SetAccessControl::BASE_ENCODING_SZ;
+    sizes[ oc::SETCLOSEDOWNMODE ]         = rq::SetCloseDownMode::BASE_ENCODING_SZ;
+    sizes[ oc::KILLCLIENT ]               = rq::KillClient::BASE_ENCODING_SZ;
+    sizes[ oc::ROTATEPROPERTIES ]         = rq::RotateProperties::BASE_ENCODING_SZ;
+    sizes[ oc::FORCESCREENSAVER ]         = rq::ForceScreenSaver::BASE_ENCODING_SZ;
+    sizes[ oc::SETPOINTERMAPPING ]        = rq::SetPointerMapping::BASE_ENCODING_SZ;
+    sizes[ oc::GETPOINTERMAPPING ]        = rq::GetPointerMapping::BASE_ENCODING_SZ;
+    sizes[ oc::SETMODIFIERMAPPING ]       = rq::SetModifierMapping::BASE_ENCODING_SZ;
+    sizes[ oc::GETMODIFIERMAPPING ]       = rq::GetModifierMapping::BASE_ENCODING_SZ;
+    sizes[ oc::NOOPERATION ]              = rq::NoOperation::BASE_ENCODING_SZ;
+    return sizes;
+}() };
+
+/**
+ * @brief Size in bytes of fixed encoding of reply to each core opcode, or 0
+ *   if opcode has no reply.
+ */
+static const std::array< uint32_t, 128 > reply_sizes { [](){
+    std::array< uint32_t, 128 > sizes {};
+    sizes[ oc::GETWINDOWATTRIBUTES ]    = sizeof( rq::GetWindowAttributes::Reply::Encoding );
+    sizes[ oc::GETGEOMETRY ]            = sizeof( rq::GetGeometry::Reply::Encoding );
+    sizes[ oc::QUERYTREE ]              = sizeof( rq::QueryTree::Reply::Encoding );
+    sizes[ oc::INTERNATOM ]             = sizeof( rq::InternAtom::Reply::Encoding );
+    sizes[ oc::GETATOMNAME ]            = sizeof( rq::GetAtomName::Reply::Encoding );
+    sizes[ oc::GETPROPERTY ]            = sizeof( rq::GetProperty::Reply::Encoding );
+    sizes[ oc::LISTPROPERTIES ]         = sizeof( rq::ListProperties::Reply::Encoding );
+    sizes[ oc::GETSELECTIONOWNER ]      = sizeof( rq::GetSelectionOwner::Reply::Encoding );
+    sizes[ oc::GRABPOINTER ]            = sizeof( rq::GrabPointer::Reply::Encoding );
+    sizes[ oc::GRABKEYBOARD ]           = sizeof( rq::GrabKeyboard::Reply::Encoding );
+    sizes[ oc::QUERYPOINTER ]           = sizeof( rq::QueryPointer::Reply::Encoding );
+    sizes[ oc::GETMOTIONEVENTS ]        = sizeof( rq::GetMotionEvents::Reply::Encoding );
+    sizes[ oc::TRANSLATECOORDINATES ]   = sizeof( rq::TranslateCoordinates::Reply::Encoding );
+    sizes[ oc::GETINPUTFOCUS ]          = sizeof( rq::GetInputFocus::Reply::Encoding );
+    sizes[ oc::QUERYKEYMAP ]            = sizeof( rq::QueryKeymap::Reply::Encoding );
+    sizes[ oc::QUERYFONT ]              = sizeof( rq::QueryFont::Reply::Encoding );
+    sizes[ oc::QUERYTEXTEXTENTS ]       = sizeof( rq::QueryTextExtents::Reply::Encoding );
+    sizes[ oc::LISTFONTS ]              = sizeof( rq::ListFonts::Reply::Encoding );
+    sizes[ oc::LISTFONTSWITHINFO ]      = sizeof( rq::ListFontsWithInfo::Reply::Encoding );
+    sizes[ oc::GETFONTPATH ]            = sizeof( rq::GetFontPath::Reply::Encoding );
+    sizes[ oc::GETIMAGE ]               = sizeof( rq::GetImage::Reply::Encoding );
+    sizes[ oc::LISTINSTALLEDCOLORMAPS ] = sizeof( rq::ListInstalledColormaps::Reply::Encoding );
+    sizes[ oc::ALLOCCOLOR ]             = sizeof( rq::AllocColor::Reply::Encoding );
+    sizes[ oc::ALLOCNAMEDCOLOR ]        = sizeof( rq::AllocNamedColor::Reply::Encoding );
+    sizes[ oc::ALLOCCOLORCELLS ]        = sizeof( rq::AllocColorCells::Reply::Encoding );
+    sizes[ oc::ALLOCCOLORPLANES ]       = sizeof( rq::AllocColorPlanes::Reply::Encoding );
+    sizes[ oc::QUERYCOLORS ]            = sizeof( rq::QueryColors::Reply::Encoding );
+    sizes[ oc::LOOKUPCOLOR ]            = sizeof( rq::LookupColor::Reply::Encoding );
+    sizes[ oc::QUERYBESTSIZE ]          = sizeof( rq::QueryBestSize::Reply::Encoding );
+    sizes[ oc::QUERYEXTENSION ]         = sizeof( rq::QueryExtension::Reply::Encoding );
+    sizes[ oc::LISTEXTENSIONS ]         = sizeof( rq::ListExtensions::Reply::Encoding );
+    sizes[ oc::GETKEYBOARDMAPPING ]     = sizeof( rq::GetKeyboardMapping::Reply::Encoding );
+    sizes[ oc::GETKEYBOARDCONTROL ]     = sizeof( rq::GetKeyboardControl::Reply::Encoding );
+    sizes[ oc::GETPOINTERCONTROL ]      = sizeof( rq::GetPointerControl::Reply::Encoding );
+    sizes[ oc::GETSCREENSAVER ]         = sizeof( rq::GetScreenSaver::Reply::Encoding );
+    sizes[ oc::LISTHOSTS ]              = sizeof( rq::ListHosts::Reply::Encoding );
+    sizes[ oc::SETPOINTERMAPPING ]      = sizeof( rq::SetPointerMapping::Reply::Encoding );
+    sizes[ oc::GETPOINTERMAPPING ]      = sizeof( rq::GetPointerMapping::Reply::Encoding );
+    sizes[ oc::SETMODIFIERMAPPING ]     = sizeof( rq::SetModifierMapping::Reply::Encoding );
+    sizes[ oc::GETMODIFIERMAPPING ]     = sizeof( rq::GetModifierMapping::Reply::Encoding );
+    return sizes;
+}() };
+
+/**
+ * @brief Appends `STR`s (length byte followed by chars), without padding.
+ * @param out writer
+ * @param strs strings to append
+ * @return bytes appended
+ */
+static size_t putSTRs( wire::Writer& out,
+                       const std::vector< std::string_view >& strs ) {
+    const size_t start { out.size() };
+    for ( const std::string_view str : strs ) {
+        out.put8( uint8_t( str.size() ) );
+        for ( const char c : str )
+            out.put8( uint8_t( c ) );
+    }
+    return out.size() - start;
+}
+
+/**
+ * @brief Appends zero bytes to alignment.
+ * @param out writer
+ */
+static void align( wire::Writer& out ) {
+    out.zeros( wire::pad( out.size() ) - out.size() );
+}
+
+/**
+ * @brief Appends event encoding, with fields common to input events set.
+ * @param out writer
+ * @param code event code
+ */
+static void putEvent( wire::Writer& out, const uint8_t code ) {
+    namespace ev = protocol::events;
+    const size_t start { out.size() };
+    out.put8( code );
+    out.put8( 0 );
+    out.put16( code == ev::codes::KEYMAPNOTIFY ? 0 : SEQUENCE );
+    out.zeros( ev::Event::ENCODING_SZ - 4 );
+    switch ( code ) {
+    case ev::codes::KEYPRESS:
+    case ev::codes::KEYRELEASE:
+    case ev::codes::BUTTONPRESS:
+    case ev::codes::BUTTONRELEASE:
+    case ev::codes::MOTIONNOTIFY:
+        out.set32( start + 4, 0x01234567 );  // time
+        out.set32( start + 8, ROOT_WINDOW );
+        out.set32( start + 12, WINDOW );
+        out.set16( start + 20, 320 );         // root-x
+        out.set16( start + 22, 240 );         // root-y
+        out.set16( start + 24, 20 );          // event-x
+        out.set16( start + 26, 40 );          // event-y
+        out.set16( start + 28, 0x0101 );      // state: Shift, Button1
+        out.set16( start + 30, 0x0001 );      // same-screen
+        break;
+    case ev::codes::EXPOSE:
+        out.set32( start + 4, WINDOW );
+        out.set16( start + 12, 640 );         // width
+        out.set16( start + 14, 480 );         // height
+        break;
+    case ev::codes::CONFIGURENOTIFY:
+        out.set32( start + 4, WINDOW );       // event
+        out.set32( start + 8, WINDOW );       // window
+        out.set16( start + 20, 640 );         // width
+        out.set16( start + 22, 480 );         // height
+        break;
+    case ev::codes::PROPERTYNOTIFY:
+        out.set32( start + 4, WINDOW );
+        out.set32( start + 8, 39 );           // WM_NAME
+        out.set32( start + 12, 0x01234567 );  // time
+        break;
+    case ev::codes::CLIENTMESSAGE:
+        out.set32( start + 4, WINDOW );
+        out.set32( start + 8, 39 );           // type
+        out.set8( start + 1, 32 );            // format
+        for ( size_t i {}; i < 5; ++i )
+            out.set32( start + 12 + i * 4, uint32_t( i ) );
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Encodes representative instance of core request: lists and strings
+ *   have a few members, value lists a few values, and other fields are zero
+ *   where that is valid.
+ * @param opcode major opcode
+ * @param msb_first whether to encode integers most significant byte first
+ * @return request encoding
+ */
+static std::vector< uint8_t > encodeRequest( const uint8_t opcode,
+                                             const bool msb_first ) {
+    std::vector< uint8_t > data;
+    wire::Writer out { data, msb_first };
+    out.put8( opcode );
+    out.put8( 0 );
+    out.put16( 0 );  // length, set below
+    switch ( opcode ) {
+    case oc::CREATEWINDOW:
+        out.set8( 1, 24 );             // depth
+        out.put32( WINDOW );
+        out.put32( ROOT_WINDOW );
+        out.put16( 10 );
+        out.put16( 10 );
+        out.put16( 640 );
+        out.put16( 480 );
+        out.put16( 1 );                // border-width
+        out.put16( 1 );                // class InputOutput
+        out.put32( 0 );                // visual CopyFromParent
+        // background-pixel border-pixel bit-gravity event-mask colormap
+        out.put32( 0x0000281a );
+        out.put32( 0x00ffffff );
+        out.put32( 0x00000000 );
+        out.put32( 1 );                // NorthWest
+        out.put32( 0x00028007 );       // KeyPress KeyRelease ButtonPress Exposure StructureNotify
+        out.put32( COLORMAP );
+        break;
+    case oc::CHANGEWINDOWATTRIBUTES:
+        out.put32( WINDOW );
+        out.put32( 0x00000800 );       // event-mask
+        out.put32( 0x00428007 );
+        break;
+    case oc::CONFIGUREWINDOW:
+        out.put32( WINDOW );
+        out.put16( 0x000f );           // x y width height
+        out.zeros( 2 );
+        out.put32( 10 );
+        out.put32( 10 );
+        out.put32( 800 );
+        out.put32( 600 );
+        break;
+    case oc::INTERNATOM:
+        out.put16( uint16_t( ATOM_NAME.size() ) );
+        out.zeros( 2 );
+        out.putPadded( ATOM_NAME );
+        break;
+    case oc::CHANGEPROPERTY: {
+        static constexpr std::string_view TITLE { "xtracepp - Terminal" };
+        out.put32( WINDOW );
+        out.put32( 39 );               // WM_NAME
+        out.put32( 31 );               // STRING
+        out.put8( 8 );                 // format
+        out.zeros( 3 );
+        out.put32( uint32_t( TITLE.size() ) );
+        out.putPadded( TITLE );
+    }   break;
+    case oc::SENDEVENT:
+        out.put32( WINDOW );
+        out.put32( 0 );                // event-mask
+        putEvent( out, protocol::events::codes::CLIENTMESSAGE );
+        break;
+    case oc::CREATEGC:
+        out.put32( GC );
+        out.put32( WINDOW );
+        // foreground background line-width font graphics-exposures
+        out.put32( 0x0001401c );
+        out.put32( 0x00000000 );
+        out.put32( 0x00ffffff );
+        out.put32( 1 );
+        out.put32( FONT );
+        out.put32( 0 );
+        break;
+    case oc::CHANGEGC:
+        out.put32( GC );
+        out.put32( 0x0000000c );       // foreground background
+        out.put32( 0x00336699 );
+        out.put32( 0x00ffffff );
+        break;
+    case oc::SETDASHES:
+        out.put32( GC );
+        out.put16( 0 );                // dash-offset
+        out.put16( 2 );
+        out.put8( 4 );
+        out.put8( 2 );
+        align( out );
+        break;
+    case oc::SETCLIPRECTANGLES:
+        out.put32( GC );
+        out.put16( 0 );
+        out.put16( 0 );
+        for ( uint16_t i {}; i < 2; ++i ) {
+            out.put16( uint16_t( i * 100 ) );
+            out.put16( 0 );
+            out.put16( 80 );
+            out.put16( 24 );
+        }
+        break;
+    case oc::POLYPOINT:
+    case oc::POLYLINE:
+        out.put32( WINDOW );
+        out.put32( GC );
+        for ( uint16_t i {}; i < 8; ++i ) {
+            out.put16( uint16_t( i * 10 ) );
+            out.put16( uint16_t( i * i ) );
+        }
+        break;
+    case oc::POLYSEGMENT:
+        out.put32( WINDOW );
+        out.put32( GC );
+        for ( uint16_t i {}; i < 4; ++i ) {
+            out.put16( uint16_t( i * 10 ) );
+            out.put16( 0 );
+            out.put16( uint16_t( i * 10 ) );
+            out.put16( 100 );
+        }
+        break;
+    case oc::POLYRECTANGLE:
+    case oc::POLYFILLRECTANGLE:
+        out.put32( WINDOW );
+        out.put32( GC );
+        for ( uint16_t i {}; i < 4; ++i ) {
+            out.put16( uint16_t( i * 100 ) );
+            out.put16( 20 );
+            out.put16( 96 );
+            out.put16( 24 );
+        }
+        break;
+    case oc::POLYARC:
+    case oc::POLYFILLARC:
+        out.put32( WINDOW );
+        out.put32( GC );
+        for ( uint16_t i {}; i < 2; ++i ) {
+            out.put16( uint16_t( i * 50 ) );
+            out.put16( 50 );
+            out.put16( 40 );
+            out.put16( 40 );
+            out.put16( 0 );            // angle1
+            out.put16( 360 * 64 );     // angle2
+        }
+        break;
+    case oc::FILLPOLY:
+        out.put32( WINDOW );
+        out.put32( GC );
+        out.put8( 2 );                 // shape Convex
+        out.put8( 0 );                 // coordinate-mode Origin
+        out.zeros( 2 );
+        for ( uint16_t i {}; i < 6; ++i ) {
+            out.put16( uint16_t( 100 + ( i % 3 ) * 20 ) );
+            out.put16( uint16_t( 100 + ( i / 3 ) * 20 ) );
+        }
+        break;
+    case oc::PUTIMAGE:
+        out.set8( 1, 2 );              // format ZPixmap
+        out.put32( WINDOW );
+        out.put32( GC );
+        out.put16( 16 );
+        out.put16( 16 );
+        out.put16( 0 );
+        out.put16( 0 );
+        out.put8( 0 );                 // left-pad
+        out.put8( 24 );                // depth
+        out.zeros( 2 );
+        out.zeros( 16 * 16 * 4 );
+        break;
+    case oc::POLYTEXT8:
+        out.put32( WINDOW );
+        out.put32( GC );
+        out.put16( 10 );
+        out.put16( 20 );
+        for ( const std::string_view str : { "Hello,", "world" } ) {
+            out.put8( uint8_t( str.size() ) );
+            out.put8( 2 );             // delta
+            for ( const char c : str )
+                out.put8( uint8_t( c ) );
+        }
+        align( out );
+        break;
+    case oc::POLYTEXT16:
+        out.put32( WINDOW );
+        out.put32( GC );
+        out.put16( 10 );
+        out.put16( 20 );
+        out.put8( 5 );
+        out.put8( 0 );
+        for ( const char c : std::string_view( "Hello" ) ) {
+            out.put8( 0 );
+            out.put8( uint8_t( c ) );
+        }
+        align( out );
+        break;
+    case oc::IMAGETEXT8: {
+        static constexpr std::string_view TEXT { "Open Recent..." };
+        out.set8( 1, uint8_t( TEXT.size() ) );
+        out.put32( WINDOW );
+        out.put32( GC );
+        out.put16( 10 );
+        out.put16( 20 );
+        out.putPadded( TEXT );
+    }   break;
+    case oc::IMAGETEXT16: {
+        static constexpr std::string_view TEXT { "Open Recent..." };
+        out.set8( 1, uint8_t( TEXT.size() ) );
+        out.put32( WINDOW );
+        out.put32( GC );
+        out.put16( 10 );
+        out.put16( 20 );
+        for ( const char c : TEXT ) {
+            out.put8( 0 );
+            out.put8( uint8_t( c ) );
+        }
+        align( out );
+    }   break;
+    case oc::OPENFONT: {
+        static constexpr std::string_view NAME {
+            "-misc-fixed-medium-r-semicondensed--13-120-75-75-c-60-iso8859-1" };
+        out.put32( FONT );
+        out.put16( uint16_t( NAME.size() ) );
+        out.zeros( 2 );
+        out.putPadded( NAME );
+    }   break;
+    case oc::LISTFONTS:
+    case oc::LISTFONTSWITHINFO: {
+        static constexpr std::string_view PATTERN { "-*-fixed-*" };
+        out.put16( 100 );              // max-names
+        out.put16( uint16_t( PATTERN.size() ) );
+        out.putPadded( PATTERN );
+    }   break;
+    case oc::SETFONTPATH:
+        out.put16( 2 );
+        out.zeros( 2 );
+        putSTRs( out, { "built-ins", "/usr/share/fonts/X11/misc" } );
+        align( out );
+        break;
+    case oc::QUERYTEXTEXTENTS:
+        out.set8( 1, 1 );              // odd-length
+        out.put32( FONT );
+        for ( const char c : std::string_view( "abc" ) ) {
+            out.put8( 0 );
+            out.put8( uint8_t( c ) );
+        }
+        align( out );
+        break;
+    case oc::ALLOCNAMEDCOLOR:
+    case oc::LOOKUPCOLOR: {
+        static constexpr std::string_view NAME { "cornflower blue" };
+        out.put32( COLORMAP );
+        out.put16( uint16_t( NAME.size() ) );
+        out.zeros( 2 );
+        out.putPadded( NAME );
+    }   break;
+    case oc::STORENAMEDCOLOR: {
+        static constexpr std::string_view NAME { "cornflower blue" };
+        out.set8( 1, 0x07 );           // do-red do-green do-blue
+        out.put32( COLORMAP );
+        out.put32( 0x00000010 );       // pixel
+        out.put16( uint16_t( NAME.size() ) );
+        out.zeros( 2 );
+        out.putPadded( NAME );
+    }   break;
+    case oc::FREECOLORS:
+        out.put32( COLORMAP );
+        out.put32( 0 );                // plane-mask
+        for ( uint32_t i {}; i < 4; ++i )
+            out.put32( 0x10 + i );
+        break;
+    case oc::QUERYCOLORS:
+        out.put32( COLORMAP );
+        for ( uint32_t i {}; i < 4; ++i )
+            out.put32( 0x10 + i );
+        break;
+    case oc::STORECOLORS:
+        out.put32( COLORMAP );
+        for ( uint16_t i {}; i < 2; ++i ) {
+            out.put32( 0x10u + i );
+            out.put16( 0xffff );
+            out.put16( uint16_t( i * 0x8000 ) );
+            out.put16( 0x0000 );
+            out.put8( 0x07 );          // do-red do-green do-blue
+            out.zeros( 1 );
+        }
+        break;
+    case oc::QUERYEXTENSION:
+        out.put16( uint16_t( EXTENSION_NAME.size() ) );
+        out.zeros( 2 );
+        out.putPadded( EXTENSION_NAME );
+        break;
+    case oc::CHANGEKEYBOARDMAPPING:
+        out.set8( 1, 2 );              // keycode-count
+        out.put8( 38 );                // first-keycode
+        out.put8( 2 );                 // keysyms-per-keycode
+        out.zeros( 2 );
+        for ( const uint32_t keysym : { 0x61, 0x41, 0x62, 0x42 } )
+            out.put32( keysym );
+        break;
+    case oc::CHANGEKEYBOARDCONTROL:
+        out.put32( 0x00000003 );       // key-click-percent bell-percent
+        out.put32( 50 );
+        out.put32( 75 );
+        break;
+    case oc::CHANGEHOSTS:
+        out.put8( 0 );                 // family Internet
+        out.zeros( 1 );
+        out.put16( 4 );
+        for ( const uint8_t octet : { 127, 0, 0, 1 } )
+            out.put8( octet );
+        break;
+    case oc::ROTATEPROPERTIES:
+        out.put32( WINDOW );
+        out.put16( 3 );
+        out.put16( 1 );                // delta
+        for ( const uint32_t atom : { 39, 37, 34 } )
+            out.put32( atom );
+        break;
+    case oc::SETPOINTERMAPPING:
+        out.set8( 1, 3 );
+        for ( const uint8_t button : { 1, 2, 3 } )
+            out.put8( button );
+        align( out );
+        break;
+    case oc::SETMODIFIERMAPPING:
+        out.set8( 1, 2 );              // keycodes-per-modifier
+        for ( uint8_t i {}; i < 16; ++i )
+            out.put8( i % 3 == 0 ? 0 : uint8_t( 8 + i ) );
+        break;
+    default:
+        assert( request_sizes[ opcode ] != 0 );
+        out.zeros( request_sizes[ opcode ] - out.size() );
+        break;
+    }
+    assert( out.size() >= request_sizes[ opcode ] );
+    assert( out.size() % wire::ALIGN == 0 );
+    out.set16( 2, uint16_t( out.size() / wire::ALIGN ) );
+    return data;
+}
+
+/**
+ * @brief Encodes representative instance of reply to core request: lists
+ *   and strings have a few members, and other fields are zero where that is
+ *   valid.
+ * @param opcode major opcode of request
+ * @param msb_first whether to encode integers most significant byte first
+ * @return reply encoding
+ */
+static std::vector< uint8_t > encodeReply( const uint8_t opcode,
+                                           const bool msb_first ) {
+    std::vector< uint8_t > data;
+    wire::Writer out { data, msb_first };
+    out.put8( rq::Reply::REPLY );
+    out.put8( 0 );
+    out.put16( SEQUENCE );
+    out.put32( 0 );  // extra-aligned-units, set below
+    switch ( opcode ) {
+    case oc::GETWINDOWATTRIBUTES:
+        out.put32( VISUAL );
+        out.put16( 1 );                // class InputOutput
+        out.zeros( reply_sizes[ opcode ] - out.size() );
+        break;
+    case oc::GETGEOMETRY:
+        out.set8( 1, 24 );             // depth
+        out.put32( ROOT_WINDOW );
+        out.put16( 10 );
+        out.put16( 10 );
+        out.put16( 640 );
+        out.put16( 480 );
+        out.put16( 1 );                // border-width
+        out.zeros( reply_sizes[ opcode ] - out.size() );
+        break;
+    case oc::QUERYTREE:
+        out.put32( ROOT_WINDOW );
+        out.put32( ROOT_WINDOW );
+        out.put16( 3 );
+        out.zeros( 14 );
+        for ( uint32_t i {}; i < 3; ++i )
+            out.put32( WINDOW + i );
+        break;
+    case oc::INTERNATOM:
+        out.put32( protocol::atoms::predefined::MAX + 1 );
+        out.zeros( 20 );
+        break;
+    case oc::GETATOMNAME: {
+        static constexpr std::string_view NAME { "WM_PROTOCOLS" };
+        out.put16( uint16_t( NAME.size() ) );
+        out.zeros( 22 );
+        out.putPadded( NAME );
+    }   break;
+    case oc::GETPROPERTY: {
+        static constexpr std::string_view VALUE { "xtracepp - Terminal" };
+        out.set8( 1, 8 );              // format
+        out.put32( 31 );               // STRING
+        out.put32( 0 );                // bytes-after
+        out.put32( uint32_t( VALUE.size() ) );
+        out.zeros( 12 );
+        out.putPadded( VALUE );
+    }   break;
+    case oc::LISTPROPERTIES:
+        out.put16( 4 );
+        out.zeros( 22 );
+        for ( const uint32_t atom : { 39, 37, 34, 40 } )
+            out.put32( atom );
+        break;
+    case oc::GETMOTIONEVENTS:
+        out.put32( 2 );
+        out.zeros( 20 );
+        for ( uint16_t i {}; i < 2; ++i ) {
+            out.put32( 0x01234567u + i );
+            out.put16( uint16_t( 20 + i ) );
+            out.put16( 40 );
+        }
+        break;
+    case oc::LISTFONTS:
+        out.put16( 2 );
+        out.zeros( 22 );
+        putSTRs( out, { "fixed", "-misc-fixed-medium-r-normal--13-120-75-75-c-70-iso8859-1" } );
+        align( out );
+        break;
+    case oc::GETFONTPATH:
+        out.put16( 2 );
+        out.zeros( 22 );
+        putSTRs( out, { "built-ins", "/usr/share/fonts/X11/misc" } );
+        align( out );
+        break;
+    case oc::GETIMAGE:
+        out.set8( 1, 24 );             // depth
+        out.put32( VISUAL );
+        out.zeros( 20 );
+        out.zeros( 8 * 8 * 4 );
+        break;
+    case oc::LISTINSTALLEDCOLORMAPS:
+        out.put16( 1 );
+        out.zeros( 22 );
+        out.put32( COLORMAP );
+        break;
+    case oc::QUERYCOLORS:
+        out.put16( 2 );
+        out.zeros( 22 );
+        for ( uint16_t i {}; i < 2; ++i ) {
+            out.put16( 0xffff );
+            out.put16( uint16_t( i * 0x8000 ) );
+            out.put16( 0x0000 );
+            out.zeros( 2 );
+        }
+        break;
+    case oc::LISTEXTENSIONS:
+        out.set8( 1, 3 );
+        out.zeros( 24 );
+        putSTRs( out, { "BIG-REQUESTS", "MIT-SHM", "XInputExtension" } );
+        align( out );
+        break;
+    case oc::GETKEYBOARDMAPPING:
+        out.set8( 1, 2 );              // keysyms-per-keycode
+        out.zeros( 24 );
+        for ( const uint32_t keysym : { 0x61, 0x41, 0x62, 0x42 } )
+            out.put32( keysym );
+        break;
+    case oc::GETPOINTERMAPPING:
+        out.set8( 1, 3 );
+        out.zeros( 24 );
+        for ( const uint8_t button : { 1, 2, 3 } )
+            out.put8( button );
+        align( out );
+        break;
+    case oc::GETMODIFIERMAPPING:
+        out.set8( 1, 1 );              // keycodes-per-modifier
+        out.zeros( 24 );
+        for ( uint8_t i {}; i < 8; ++i )
+            out.put8( i % 2 == 0 ? uint8_t( 50 + i ) : 0 );
+        break;
+    case oc::LISTHOSTS:
+        out.set8( 1, 1 );              // mode Enabled
+        out.put16( 1 );
+        out.zeros( 22 );
+        out.put8( 0 );                 // family Internet
+        out.zeros( 1 );
+        out.put16( 4 );
+        for ( const uint8_t octet : { 127, 0, 0, 1 } )
+            out.put8( octet );
+        break;
+    default:
+        assert( reply_sizes[ opcode ] != 0 );
+        out.zeros( reply_sizes[ opcode ] - out.size() );
+        break;
+    }
+    assert( out.size() >= rq::Reply::DEFAULT_ENCODING_SZ );
+    assert( out.size() % wire::ALIGN == 0 );
+    out.set32( 4, uint32_t( ( out.size() - rq::Reply::DEFAULT_ENCODING_SZ ) /
+                            wire::ALIGN ) );
+    return data;
+}
+
+/**
+ * @brief Encodes instance of core event.
+ * @param code event code
+ * @param msb_first whether to encode integers most significant byte first
+ * @return event encoding
+ */
+static std::vector< uint8_t > encodeEvent( const uint8_t code,
+                                           const bool msb_first ) {
+    std::vector< uint8_t > data;
+    wire::Writer out { data, msb_first };
+    putEvent( out, code );
+    return data;
+}
+
+/**
+ * @brief Encodes instance of core error.
+ * @param code error code
+ * @param msb_first whether to encode integers most significant byte first
+ * @return error encoding
+ */
+static std::vector< uint8_t > encodeError( const uint8_t code,
+                                           const bool msb_first ) {
+    std::vector< uint8_t > data;
+    wire::Writer out { data, msb_first };
+    out.put8( protocol::errors::Error::ERROR );
+    out.put8( code );
+    out.put16( SEQUENCE );
+    out.put32( WINDOW );               // bad value
+    out.put16( 0 );                    // minor opcode
+    out.put8( oc::GETPROPERTY );       // major opcode
+    out.zeros( protocol::errors::Error::ENCODING_SZ - out.size() );
+    return data;
+}
+
+/**
+ * @brief Timing of one parsing function on one encoding with one combination
+ *   of settings.
+ */
+struct Result {
+    /** @brief Message kind, eg "request". */
+    std::string_view kind;
+    /** @brief Message or list member name. */
+    std::string_view name;
+    /** @brief Opcode or code, or 0 for list members. */
+    uint32_t code {};
+    /** @brief Whether encoding was in opposite of host byte order. */
+    bool     byteswap {};
+    /** @brief `--verbose` setting. */
+    bool     verbose {};
+    /** @brief `--multiline` setting. */
+    bool     multiline {};
+    /** @brief Bytes of encoding parsed. */
+    size_t   bytes {};
+    /** @brief Timed iterations. */
+    size_t   iterations {};
+    /** @brief Mean time per parse in nanoseconds. */
+    double   mean_ns {};
+    /** @brief Minimum time per parse in nanoseconds. */
+    uint64_t min_ns {};
+    /** @brief Median time per parse in nanoseconds. */
+    uint64_t p50_ns {};
+    /** @brief 90th percentile time per parse in nanoseconds. */
+    uint64_t p90_ns {};
+    /** @brief 99th percentile time per parse in nanoseconds. */
+    uint64_t p99_ns {};
+
+    /**
+     * @brief Returns key identifying case across result files.
+     * @return key
+     */
+    std::string key() const {
+        return fmt::format( "{},{},{:d},{:d},{:d}", kind, name,
+                            byteswap, verbose, multiline );
+    }
+};
+
+/**
+ * @brief Runs parsing functions of an [X11ProtocolParser](#X11ProtocolParser)
+ *   in isolation; friend of parser to reach its dispatch tables.
+ */
+class ParserBenchmark {
+private:
+    /** @brief Parser under test. */
+    X11ProtocolParser& _parser;
+    /** @brief Settings referenced by parser, changed between runs. */
+    Settings&          _settings;
+    /** @brief Connection passed to parsing functions. */
+    Connection         _conn;
+    /** @brief Timed iterations per case. */
+    size_t             _iterations;
+    /** @brief Cases are run only if name contains this. */
+    std::string_view   _filter;
+    /** @brief Median cost of reading clock twice, subtracted from samples. */
+    uint64_t           _clock_overhead_ns {};
+
+    /**
+     * @brief Measures cost of reading clock twice.
+     * @return median cost in nanoseconds
+     */
+    static uint64_t _measureClockOverhead() {
+        std::vector< uint64_t > samples( 10'000 );
+        for ( uint64_t& sample : samples ) {
+            const uint64_t start { monotonic::now() };
+            sample = monotonic::now() - start;
+        }
+        std::sort( samples.begin(), samples.end() );
+        return samples[ samples.size() / 2 ];
+    }
+    /**
+     * @brief Times parse, checking first that it consumes whole encoding.
+     * @param result result with case fields set, timings filled in
+     * @param data encoding
+     * @param parse parses `data`, returns bytes parsed
+     * @param setup run untimed before each parse, eg to restash strings
+     * @param teardown run untimed after each parse, eg to unstash strings
+     */
+    void _time( Result* result, const std::vector< uint8_t >& data,
+                const std::function< size_t() >& parse,
+                const std::function< void() >& setup = {},
+                const std::function< void() >& teardown = {} ) {
+        assert( result != nullptr );
+        if ( setup ) setup();
+        [[maybe_unused]] const size_t bytes_parsed { parse() };
+        if ( teardown ) teardown();
+        assert( bytes_parsed == data.size() );
+        result->bytes = data.size();
+        // warm up caches and branch predictors
+        for ( size_t i {}; i < _iterations / 10; ++i ) {
+            if ( setup ) setup();
+            parse();
+            if ( teardown ) teardown();
+        }
+        std::vector< uint64_t > samples( _iterations );
+        for ( uint64_t& sample : samples ) {
+            if ( setup ) setup();
+            const uint64_t start { monotonic::now() };
+            parse();
+            const uint64_t elapsed { monotonic::now() - start };
+            if ( teardown ) teardown();
+            sample = elapsed > _clock_overhead_ns ?
+                elapsed - _clock_overhead_ns : 0;
+        }
+        std::sort( samples.begin(), samples.end() );
+        uint64_t sum {};
+        for ( const uint64_t sample : samples )
+            sum += sample;
+        result->iterations = samples.size();
+        result->mean_ns = double( sum ) / double( samples.size() );
+        result->min_ns = samples.front();
+        result->p50_ns = samples[ samples.size() * 50 / 100 ];
+        result->p90_ns = samples[ samples.size() * 90 / 100 ];
+        result->p99_ns = samples[ samples.size() * 99 / 100 ];
+    }
+    /**
+     * @brief Times one request and, if it has one, its reply parsing function.
+     * @param opcode major opcode
+     * @param base case fields shared by request and reply
+     * @param[out] results appended timings
+     */
+    void _runRequest( const uint8_t opcode, const Result& base,
+                      std::vector< Result >* results ) {
+        using XPP = X11ProtocolParser;
+        const XPP::_RequestOpcodeTraits& traits {
+            XPP::_core_requests.at( opcode ).request };
+        if ( traits.name.find( _filter ) == std::string_view::npos )
+            return;
+        const bool msb_first { wire::host_msb_first != base.byteswap };
+        // InternAtom and QueryExtension stash a string from the request
+        //   for use in parsing the reply
+        const std::string_view stashed {
+            opcode == oc::INTERNATOM ? ATOM_NAME :
+            opcode == oc::QUERYEXTENSION ? EXTENSION_NAME : "" };
+        {
+            Result result { base };
+            result.kind = "request";
+            result.name = traits.name;
+            result.code = opcode;
+            const std::vector< uint8_t > data { encodeRequest( opcode, msb_first ) };
+            _time( &result, data, [&](){
+                return ( _parser.*traits.request_parse_func )(
+                    &_conn, data.data(), data.size() ).bytes_parsed; },
+                {}, stashed.empty() ? std::function< void() > {} : [&](){
+                    _parser._unstashString( &_conn, _conn.sequence ); } );
+            results->push_back( result );
+        }
+        if ( traits.reply_parse_func == nullptr )
+            return;
+        Result result { base };
+        result.kind = "reply";
+        result.name = traits.name;
+        result.code = opcode;
+        const std::vector< uint8_t > data { encodeReply( opcode, msb_first ) };
+        _time( &result, data, [&](){
+            return ( _parser.*traits.reply_parse_func )(
+                &_conn, data.data(), data.size() ).bytes_parsed; },
+            stashed.empty() ? std::function< void() > {} : [&](){
+                _parser._stashString( &_conn, SEQUENCE, stashed ); } );
+        results->push_back( result );
+    }
+    /**
+     * @brief Times one event parsing function.
+     * @param code event code
+     * @param base case fields
+     * @param[out] results appended timing
+     */
+    void _runEvent( const uint8_t code, const Result& base,
+                    std::vector< Result >* results ) {
+        using XPP = X11ProtocolParser;
+        const XPP::_EventCodeTraits& traits { XPP::_core_events.at( code ) };
+        if ( traits.name.find( _filter ) == std::string_view::npos )
+            return;
+        Result result { base };
+        result.kind = "event";
+        result.name = traits.name;
+        result.code = code;
+        const std::vector< uint8_t > data {
+            encodeEvent( code, wire::host_msb_first != base.byteswap ) };
+        _time( &result, data, [&](){
+            return ( _parser.*traits.parse_func )(
+                &_conn, data.data(), data.size(),
+                _parser._ROOT_WS ).bytes_parsed; } );
+        results->push_back( result );
+    }
+    /**
+     * @brief Times one error parsing function.
+     * @param code error code
+     * @param base case fields
+     * @param[out] results appended timing
+     */
+    void _runError( const uint8_t code, const Result& base,
+                    std::vector< Result >* results ) {
+        using XPP = X11ProtocolParser;
+        const XPP::_ErrorCodeTraits& traits { XPP::_core_errors.at( code ) };
+        if ( traits.name.find( _filter ) == std::string_view::npos )
+            return;
+        Result result { base };
+        result.kind = "error";
+        result.name = traits.name;
+        result.code = code;
+        const std::vector< uint8_t > data {
+            encodeError( code, wire::host_msb_first != base.byteswap ) };
+        _time( &result, data, [&](){
+            return ( _parser.*traits.parse_func )(
+                &_conn, data.data(), data.size() ).bytes_parsed; } );
+        results->push_back( result );
+    }
+    /**
+     * @brief Times one `_parseListMember` specialization.
+     * @tparam ProtocolT list member type
+     * @param name list member name
+     * @param encode appends encoding of one list member
+     * @param base case fields
+     * @param[out] results appended timing
+     */
+    template< typename ProtocolT >
+    void _runListMember( const std::string_view name,
+                         const std::function< void( wire::Writer& ) >& encode,
+                         const Result& base, std::vector< Result >* results ) {
+        if ( name.find( _filter ) == std::string_view::npos )
+            return;
+        Result result { base };
+        result.kind = "list_member";
+        result.name = name;
+        std::vector< uint8_t > data;
+        wire::Writer out { data, wire::host_msb_first != base.byteswap };
+        encode( out );
+        _time( &result, data, [&](){
+            return _parser._parseListMember< ProtocolT >(
+                data.data(), data.size(), _conn.byteswap,
+                _parser._ROOT_WS.nested() ).bytes_parsed; } );
+        results->push_back( result );
+    }
+    /**
+     * @brief Times all `_parseListMember` specializations defined out of
+     *   line, plus the generic struct parsing used by the drawing requests.
+     * @param base case fields
+     * @param[out] results appended timings
+     */
+    void _runListMembers( const Result& base, std::vector< Result >* results ) {
+        using protocol::connection_setup::Acceptance;
+        _runListMember< protocol::STR >( "STR", [](wire::Writer& out){
+            putSTRs( out, { "BIG-REQUESTS" } ); }, base, results );
+        _runListMember< protocol::HOST >( "HOST", [](wire::Writer& out){
+            out.put8( 0 );             // family Internet
+            out.zeros( 1 );
+            out.put16( 4 );
+            for ( const uint8_t octet : { 127, 0, 0, 1 } )
+                out.put8( octet ); }, base, results );
+        _runListMember< rq::PolyText8::TEXTITEM8 >(
+            "TEXTITEM8", [](wire::Writer& out){
+                out.put8( 5 );
+                out.put8( 2 );         // delta
+                for ( const char c : std::string_view( "Hello" ) )
+                    out.put8( uint8_t( c ) ); }, base, results );
+        _runListMember< rq::PolyText16::TEXTITEM16 >(
+            "TEXTITEM16", [](wire::Writer& out){
+                out.put8( 3 );
+                out.put8( 2 );         // delta
+                for ( const char c : std::string_view( "abc" ) ) {
+                    out.put8( 0 );
+                    out.put8( uint8_t( c ) );
+                } }, base, results );
+        const auto putDepth { [](wire::Writer& out){
+            out.put8( 24 );            // depth
+            out.zeros( 1 );
+            out.put16( 1 );            // visuals
+            out.zeros( 4 );
+            out.put32( VISUAL );
+            out.put8( 4 );             // class TrueColor
+            out.put8( 8 );             // bits-per-rgb-value
+            out.put16( 256 );          // colormap-entries
+            out.put32( 0x00ff0000 );
+            out.put32( 0x0000ff00 );
+            out.put32( 0x000000ff );
+            out.zeros( 4 ); } };
+        _runListMember< Acceptance::SCREEN::DEPTH >(
+            "DEPTH", putDepth, base, results );
+        _runListMember< Acceptance::SCREEN >(
+            "SCREEN", [&putDepth](wire::Writer& out){
+                out.put32( ROOT_WINDOW );
+                out.put32( COLORMAP );
+                out.put32( 0x00ffffff );  // white-pixel
+                out.put32( 0x00000000 );  // black-pixel
+                out.put32( 0 );           // current-input-masks
+                out.put16( 1920 );
+                out.put16( 1080 );
+                out.put16( 508 );
+                out.put16( 285 );
+                out.put16( 1 );           // min-installed-maps
+                out.put16( 1 );           // max-installed-maps
+                out.put32( VISUAL );
+                out.put8( 0 );            // backing-stores Never
+                out.put8( 0 );            // save-unders
+                out.put8( 24 );           // root-depth
+                out.put8( 1 );            // allowed-depths
+                putDepth( out ); }, base, results );
+        _runListMember< protocol::POINT >( "POINT", [](wire::Writer& out){
+            out.put16( 10 );
+            out.put16( 20 ); }, base, results );
+        _runListMember< protocol::RECTANGLE >( "RECTANGLE", [](wire::Writer& out){
+            out.put16( 10 );
+            out.put16( 20 );
+            out.put16( 96 );
+            out.put16( 24 ); }, base, results );
+    }
+
+public:
+    /**
+     * @param parser parser under test
+     * @param settings settings referenced by parser
+     * @param iterations timed iterations per case
+     * @param filter cases are run only if name contains this
+     */
+    ParserBenchmark( X11ProtocolParser& parser, Settings& settings,
+                     const size_t iterations, const std::string_view filter ) :
+        _parser( parser ), _settings( settings ), _iterations( iterations ),
+        _filter( filter ), _clock_overhead_ns( _measureClockOverhead() ) {
+        _conn.sequence = SEQUENCE;
+    }
+    /**
+     * @brief Times every parsing function, in each byte order and with each
+     *   combination of `--verbose` and `--multiline`.
+     * @return timings
+     */
+    std::vector< Result > run() {
+        using XPP = X11ProtocolParser;
+        // dispatch tables are unordered
+        std::map< uint8_t, bool > requests, events, errors;
+        for ( const auto& [ opcode, traits ] : XPP::_core_requests )
+            requests.emplace( opcode, true );
+        for ( const auto& [ code, traits ] : XPP::_core_events )
+            events.emplace( code, true );
+        for ( const auto& [ code, traits ] : XPP::_core_errors )
+            errors.emplace( code, true );
+        std::vector< Result > results;
+        for ( const bool byteswap : { false, true } ) {
+            _conn.byteswap = byteswap;
+            for ( const bool verbose : { false, true } ) {
+                for ( const bool multiline : { false, true } ) {
+                    _settings.verbose = verbose;
+                    _settings.multiline = multiline;
+                    _parser.applySettings();
+                    Result base;
+                    base.byteswap = byteswap;
+                    base.verbose = verbose;
+                    base.multiline = multiline;
+                    for ( const auto& [ opcode, unused ] : requests )
+                        _runRequest( opcode, base, &results );
+                    for ( const auto& [ code, unused ] : events )
+                        _runEvent( code, base, &results );
+                    for ( const auto& [ code, unused ] : errors )
+                        _runError( code, base, &results );
+                    _runListMembers( base, &results );
+                }
+            }
+        }
+        return results;
+    }
+};
+
+/** @brief Header line of results file. */
+static constexpr std::string_view CSV_HEADER {
+    "kind,name,byteswap,verbose,multiline,code,bytes,iterations,"
+    "mean_ns,min_ns,p50_ns,p90_ns,p99_ns" };
+
+/**
+ * @brief Writes results file.
+ * @param path file path
+ * @param results timings
+ * @return whether file was written
+ */
+static bool writeResults( const char* path, const std::vector< Result >& results ) {
+    std::ofstream ofs { path };
+    ofs << CSV_HEADER << '\n';
+    for ( const Result& r : results ) {
+        ofs << fmt::format( "{},{},{},{},{:.1f},{},{},{},{}\n",
+                            r.key(), r.code, r.bytes, r.iterations, r.mean_ns,
+                            r.min_ns, r.p50_ns, r.p90_ns, r.p99_ns );
+    }
+    return bool( ofs );
+}
+
+/**
+ * @brief Reads median times from previous results file.
+ * @param path file path
+ * @param[out] p50s median time in nanoseconds by case key
+ * @return whether file was read
+ */
+static bool readBaseline( const char* path,
+                          std::map< std::string, uint64_t >* p50s ) {
+    assert( p50s != nullptr );
+    std::ifstream ifs { path };
+    std::string line;
+    if ( !std::getline( ifs, line ) || line != CSV_HEADER )
+        return false;
+    while ( std::getline( ifs, line ) ) {
+        std::vector< std::string > fields;
+        std::istringstream iss { line };
+        for ( std::string field; std::getline( iss, field, ',' ); )
+            fields.push_back( field );
+        if ( fields.size() != 13 )
+            return false;
+        const std::string key { fmt::format( "{},{},{},{},{}", fields[ 0 ],
+                                             fields[ 1 ], fields[ 2 ],
+                                             fields[ 3 ], fields[ 4 ] ) };
+        ( *p50s )[ key ] = std::strtoull( fields[ 10 ].c_str(), nullptr, 10 );
+    }
+    return true;
+}
+
+/**
+ * @brief Prints median times, one row per parsing function and one column
+ *   per combination of byte order and settings.
+ * @param results timings
+ */
+static void printSummary( const std::vector< Result >& results ) {
+    // rows in order of first appearance
+    std::vector< std::string > rows;
+    std::map< std::string, std::array< uint64_t, 8 > > p50s;
+    for ( const Result& r : results ) {
+        const std::string row { fmt::format( "{} {}", r.kind, r.name ) };
+        if ( p50s.find( row ) == p50s.end() )
+            rows.push_back( row );
+        p50s[ row ][ size_t( r.byteswap ) * 4 + size_t( r.verbose ) * 2 +
+                     size_t( r.multiline ) ] = r.p50_ns;
+    }
+    fmt::println( "median ns per parse (v: --verbose, m: --multiline)" );
+    fmt::println( "{:<36} {:>31} | {:>31}", "", "native byte order",
+                  "byteswapped" );
+    fmt::println( "{:<36} {:>7} {:>7} {:>7} {:>7} | {:>7} {:>7} {:>7} {:>7}",
+                  "", "-", "m", "v", "vm", "-", "m", "v", "vm" );
+    for ( const std::string& row : rows ) {
+        const std::array< uint64_t, 8 >& ns { p50s.at( row ) };
+        fmt::println( "{:<36} {:>7} {:>7} {:>7} {:>7} | {:>7} {:>7} {:>7} {:>7}",
+                      row, ns[ 0 ], ns[ 1 ], ns[ 2 ], ns[ 3 ],
+                      ns[ 4 ], ns[ 5 ], ns[ 6 ], ns[ 7 ] );
+    }
+}
+
+/**
+ * @brief Prints cases whose median time rose past threshold since baseline.
+ * @param results timings
+ * @param baseline median times by case key from previous results
+ * @param threshold_pct percent increase considered a regression
+ * @return count of regressions
+ */
+static size_t printRegressions( const std::vector< Result >& results,
+                                const std::map< std::string, uint64_t >& baseline,
+                                const double threshold_pct ) {
+    size_t regressions {};
+    for ( const Result& r : results ) {
+        const auto it { baseline.find( r.key() ) };
+        if ( it == baseline.end() || it->second == 0 )
+            continue;
+        const double change_pct {
+            ( double( r.p50_ns ) / double( it->second ) - 1 ) * 100 };
+        if ( change_pct <= threshold_pct )
+            continue;
+        if ( regressions++ == 0 )
+            fmt::println( "regressions over {:.0f}% in median:", threshold_pct );
+        fmt::println( "  {} {} (byteswap={:d} verbose={:d} multiline={:d}): "
+                      "{} ns -> {} ns (+{:.0f}%)", r.kind, r.name, r.byteswap,
+                      r.verbose, r.multiline, it->second, r.p50_ns, change_pct );
+    }
+    return regressions;
+}
+
+/** @brief Usage message, formatted with process name. */
+static constexpr std::string_view USAGE {
+    "usage: {} [-n iterations] [-f name] [-o results.csv]\n"
+    "          [-b baseline.csv [-t threshold %]]\n"
+    "  -n  timed iterations per case (default 1000)\n"
+    "  -f  only time parsers whose name contains this\n"
+    "  -o  results file (default parser_benchmark.csv)\n"
+    "  -b  compare medians to previous results file, exit with failure if\n"
+    "      any rose past threshold\n"
+    "  -t  regression threshold in percent (default 10)" };
+
+int main( const int argc, char* const* argv ) {
+    const char* process_name { argv[ 0 ] };
+    // parser and its settings are singletons, settings parsed from no options
+    const char* settings_argv[] { process_name, nullptr };
+    Settings settings { 1, settings_argv };
+    X11ProtocolParser parser { settings };
+
+    size_t iterations { 1000 };
+    std::string_view filter;
+    const char* results_path { "parser_benchmark.csv" };
+    const char* baseline_path {};
+    double threshold_pct { 10 };
+    ::optind = 1;
+    for ( int c; ( c = ::getopt( argc, argv, "n:f:o:b:t:" ) ) != -1; ) {
+        switch ( c ) {
+        case 'n':
+            iterations = std::strtoul( ::optarg, nullptr, 10 );
+            if ( iterations == 0 ) {
+                fmt::println( ::stderr, "{}: invalid iterations {:?}",
+                              process_name, ::optarg );
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'f':
+            filter = ::optarg;
+            break;
+        case 'o':
+            results_path = ::optarg;
+            break;
+        case 'b':
+            baseline_path = ::optarg;
+            break;
+        case 't':
+            threshold_pct = std::strtod( ::optarg, nullptr );
+            break;
+        default:
+            fmt::println( ::stderr, USAGE, process_name );
+            return EXIT_FAILURE;
+        }
+    }
+    if ( ::optind != argc ) {
+        fmt::println( ::stderr, USAGE, process_name );
+        return EXIT_FAILURE;
+    }
+    std::map< std::string, uint64_t > baseline;
+    if ( baseline_path != nullptr && !readBaseline( baseline_path, &baseline ) ) {
+        fmt::println( ::stderr, "{}: could not read results file {:?}",
+                      process_name, baseline_path );
+        return EXIT_FAILURE;
+    }
+
+    ParserBenchmark benchmark { parser, settings, iterations, filter };
+    const std::vector< Result > results { benchmark.run() };
+    printSummary( results );
+    if ( !writeResults( results_path, results ) ) {
+        fmt::println( ::stderr, "{}: could not write results file {:?}",
+                      process_name, results_path );
+        return EXIT_FAILURE;
+    }
+    fmt::println( "{} cases written to {}", results.size(), results_path );
+    if ( baseline_path != nullptr &&
+         printRegressions( results, baseline, threshold_pct ) > 0 ) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
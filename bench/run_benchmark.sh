@@ -0,0 +1,71 @@
+#!/bin/bash
+# Runs x11_load_generator against fake_x_server directly, then through
+#   xtracepp, reporting proxy throughput and added round trip latency.
+#
+# usage: run_benchmark.sh <xtracepp> <fake_x_server> <x11_load_generator>
+#          [-n clients] [-t seconds] [-m mix] [-r events_per_sec] [-s]
+#          [-- xtracepp options...]
+#   FAKE_DISPLAY and PROXY_DISPLAY set display numbers (default 97 and 98);
+#   xtracepp logs to /dev/null unless its options include -o/--outfile
+
+set -e
+
+if [ $# -lt 3 ]; then
+    sed -n '5,9p' "$0" | sed 's/^# \?//'
+    exit 1
+fi
+xtracepp=$1
+fake_x_server=$2
+load_generator=$3
+shift 3
+
+load_args=()
+event_rate=0
+while [ $# -gt 0 ]; do
+    case $1 in
+        -n|-t|-m) load_args+=("$1" "$2"); shift 2 ;;
+        -s)       load_args+=("$1"); shift ;;
+        -r)       event_rate=$2; shift 2 ;;
+        --)       shift; break ;;
+        *)        echo "$0: unknown option $1" >&2; exit 1 ;;
+    esac
+done
+xtracepp_args=("$@")
+case " ${xtracepp_args[*]} " in
+    *" -o "*|*" --outfile"*) ;;
+    *) xtracepp_args+=(-o /dev/null) ;;
+esac
+
+fake_display=${FAKE_DISPLAY:-97}
+proxy_display=${PROXY_DISPLAY:-98}
+workdir=$(mktemp -d)
+pids=()
+cleanup() {
+    for pid in "${pids[@]}"; do
+        kill -INT "$pid" 2>/dev/null || true
+        wait "$pid" 2>/dev/null || true
+    done
+    rm -rf "$workdir"
+}
+trap cleanup EXIT
+
+wait_for_socket() {
+    for _ in $(seq 100); do
+        [ -S "/tmp/.X11-unix/X$1" ] && return 0
+        sleep 0.05
+    done
+    echo "$0: display :$1 did not start" >&2
+    exit 1
+}
+
+"$fake_x_server" -d "$fake_display" -a "$workdir/xauth" -r "$event_rate" &
+pids+=($!)
+wait_for_socket "$fake_display"
+
+XAUTHORITY="$workdir/xauth" "$xtracepp" --keeprunning \
+    --display ":$fake_display" --proxydisplay ":$proxy_display" \
+    "${xtracepp_args[@]}" &
+pids+=($!)
+wait_for_socket "$proxy_display"
+
+"$load_generator" -b ":$fake_display" -d ":$proxy_display" "${load_args[@]}"
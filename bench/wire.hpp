@@ -0,0 +1,193 @@
+#ifndef BENCH_WIRE_HPP
+#define BENCH_WIRE_HPP
+
+/**
+ * @file wire.hpp
+ * @brief Helpers shared by benchmark programs for encoding and decoding X11
+ *   messages by hand, and for connecting to displays by name.
+ */
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cstdint>
+#include <cstdlib>        // strtol
+
+#include <sys/socket.h>   // socket, connect, AF_UNIX
+#include <sys/un.h>       // sockaddr_un
+#include <unistd.h>       // close
+
+#include <fmt/format.h>
+
+
+namespace wire {
+
+/**
+ * @brief X11 messages are aligned to 4B units.
+ */
+inline constexpr size_t ALIGN { 4 };
+
+/**
+ * @brief Rounds size up to alignment.
+ * @param sz size in bytes
+ * @return aligned size in bytes
+ */
+inline constexpr size_t pad( const size_t sz ) {
+    return ( sz + ALIGN - 1 ) / ALIGN * ALIGN;
+}
+
+/**
+ * @brief Appends integers to message buffer in either byte order.
+ */
+class Writer {
+private:
+    /** @brief Buffer appended to. */
+    std::vector< uint8_t >& _out;
+    /** @brief Whether to encode integers most significant byte first. */
+    bool _msb_first {};
+
+public:
+    /**
+     * @param out buffer to append to
+     * @param msb_first whether to encode integers most significant byte first
+     */
+    Writer( std::vector< uint8_t >& out, const bool msb_first ) :
+        _out( out ), _msb_first( msb_first ) {}
+    /** @brief Appends byte. @param val value */
+    void put8( const uint8_t val ) {
+        _out.push_back( val );
+    }
+    /** @brief Appends 2B integer. @param val value */
+    void put16( const uint16_t val ) {
+        put8( uint8_t( _msb_first ? val >> 8 : val ) );
+        put8( uint8_t( _msb_first ? val : val >> 8 ) );
+    }
+    /** @brief Appends 4B integer. @param val value */
+    void put32( const uint32_t val ) {
+        put16( uint16_t( _msb_first ? val >> 16 : val ) );
+        put16( uint16_t( _msb_first ? val : val >> 16 ) );
+    }
+    /** @brief Appends zero bytes. @param n bytes to append */
+    void zeros( const size_t n ) {
+        _out.insert( _out.end(), n, 0 );
+    }
+    /** @brief Appends bytes followed by zero bytes to alignment. @param str bytes */
+    void putPadded( const std::string_view str ) {
+        _out.insert( _out.end(), str.begin(), str.end() );
+        zeros( pad( str.size() ) - str.size() );
+    }
+    /**
+     * @brief Overwrites byte at offset, eg to fill in header data byte.
+     * @param offset offset into buffer
+     * @param val value
+     */
+    void set8( const size_t offset, const uint8_t val ) {
+        _out.at( offset ) = val;
+    }
+    /**
+     * @brief Overwrites 2B integer at offset, eg to fill in length.
+     * @param offset offset into buffer
+     * @param val value
+     */
+    void set16( const size_t offset, const uint16_t val ) {
+        _out.at( offset )     = uint8_t( _msb_first ? val >> 8 : val );
+        _out.at( offset + 1 ) = uint8_t( _msb_first ? val : val >> 8 );
+    }
+    /**
+     * @brief Overwrites 4B integer at offset, eg to fill in length.
+     * @param offset offset into buffer
+     * @param val value
+     */
+    void set32( const size_t offset, const uint32_t val ) {
+        set16( offset + ( _msb_first ? 0 : 2 ), uint16_t( val >> 16 ) );
+        set16( offset + ( _msb_first ? 2 : 0 ), uint16_t( val ) );
+    }
+    /** @brief Returns current buffer size. @return size in bytes */
+    size_t size() const {
+        return _out.size();
+    }
+};
+
+/**
+ * @brief Reads 2B integer in either byte order.
+ * @param data encoded integer
+ * @param msb_first whether integer is encoded most significant byte first
+ * @return value
+ */
+inline uint16_t get16( const uint8_t* data, const bool msb_first ) {
+    return msb_first ? uint16_t( data[ 0 ] << 8 | data[ 1 ] ) :
+                       uint16_t( data[ 1 ] << 8 | data[ 0 ] );
+}
+
+/**
+ * @brief Reads 4B integer in either byte order.
+ * @param data encoded integer
+ * @param msb_first whether integer is encoded most significant byte first
+ * @return value
+ */
+inline uint32_t get32( const uint8_t* data, const bool msb_first ) {
+    return msb_first ?
+        uint32_t( get16( data, true ) ) << 16 | get16( data + 2, true ) :
+        uint32_t( get16( data + 2, false ) ) << 16 | get16( data, false );
+}
+
+/**
+ * @brief Whether host byte order is most significant byte first.
+ */
+inline const bool host_msb_first {
+    [](){ const uint16_t val { 1 };
+          return *reinterpret_cast< const uint8_t* >( &val ) == 0; }() };
+
+/**
+ * @brief Parses display number from local display name, eg ":1" or ":1.0".
+ * @param name display name
+ * @return display number, or -1 if name is not of local display
+ */
+inline int displayNumber( const std::string_view name ) {
+    if ( name.size() < 2 || name.front() != ':' )
+        return -1;
+    char* end {};
+    const std::string number { name.substr( 1 ) };
+    const long display { std::strtol( number.c_str(), &end, 10 ) };
+    if ( end == number.c_str() || ( *end != '\0' && *end != '.' ) ||
+         display < 0 ) {
+        return -1;
+    }
+    return int( display );
+}
+
+/**
+ * @brief Returns path of Unix socket of local display.
+ * @param display display number
+ * @return socket path
+ */
+inline std::string socketPath( const int display ) {
+    return fmt::format( "/tmp/.X11-unix/X{}", display );
+}
+
+/**
+ * @brief Connects to local display by Unix socket.
+ * @param display display number
+ * @return connected socket, or -1 on failure (with `errno` set)
+ */
+inline int connectDisplay( const int display ) {
+    const int fd { ::socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 ) };
+    if ( fd < 0 )
+        return -1;
+    ::sockaddr_un addr {};
+    addr.sun_family = AF_UNIX;
+    const std::string path { socketPath( display ) };
+    path.copy( addr.sun_path, sizeof( addr.sun_path ) - 1 );
+    if ( ::connect( fd, reinterpret_cast< ::sockaddr* >( &addr ),
+                    sizeof( addr ) ) != 0 ) {
+        ::close( fd );
+        return -1;
+    }
+    return fd;
+}
+
+}  // namespace wire
+
+
+#endif  // BENCH_WIRE_HPP
@@ -0,0 +1,716 @@
+#include <array>
+#include <atomic>
+#include <chrono>                 // duration
+#include <functional>             // cref
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <cassert>
+#include <cerrno>                 // errno, EINTR
+#include <cstdint>
+#include <cstdio>                 // stderr
+#include <cstdlib>                // EXIT_FAILURE, EXIT_SUCCESS, strtol, strtod
+#include <cstring>                // strerror
+
+#include <getopt.h>               // getopt
+#include <sys/socket.h>           // send, recv
+#include <time.h>                 // clock_gettime
+#include <unistd.h>               // close
+
+#include <fmt/format.h>
+
+#include <LatencyHistogram.hpp>
+#include <protocol/connection_setup.hpp>
+#include <protocol/requests.hpp>
+
+#include "wire.hpp"
+
+/**
+ * @file x11_load_generator.cpp
+ * @brief Opens concurrent X11 clients to a display and drives a mix of core
+ *   requests, reporting throughput and round trip latency; given a baseline
+ *   display (eg the server behind `xtracepp`), runs against it first and
+ *   reports the latency added by the proxy.
+ */
+
+/**
+ * @brief Reads monotonic clock.
+ * @return monotonic time in nanoseconds
+ */
+static uint64_t nowNs() {
+    ::timespec ts {};
+    ::clock_gettime( CLOCK_MONOTONIC, &ts );
+    return uint64_t( ts.tv_sec ) * 1'000'000'000 + uint64_t( ts.tv_nsec );
+}
+
+/**
+ * @brief Cheap deterministic PRNG (xorshift64), one per client thread.
+ */
+class Random {
+private:
+    /** @brief Generator state, never 0. */
+    uint64_t _state;
+
+public:
+    /** @param seed seed, any value */
+    explicit Random( const uint64_t seed ) : _state( seed | 1 ) {}
+    /**
+     * @brief Returns next value in range.
+     * @param bound exclusive upper bound
+     * @return value in range 0..bound-1
+     */
+    uint32_t below( const uint32_t bound ) {
+        _state ^= _state << 13;
+        _state ^= _state >> 7;
+        _state ^= _state << 17;
+        return uint32_t( _state % bound );
+    }
+};
+
+/**
+ * @brief Resources and state available to request encoders.
+ */
+struct ClientContext {
+    /** @brief Request output buffer writer. */
+    wire::Writer& out;
+    /** @brief Client's PRNG. */
+    Random&       random;
+    /** @brief Window owned by client. */
+    uint32_t      window;
+    /** @brief Graphics context owned by client. */
+    uint32_t      gc;
+    /** @brief Pixmap owned by client. */
+    uint32_t      pixmap;
+};
+
+/**
+ * @brief Appends request header, returning offset at which to set length.
+ * @param ctx client context
+ * @param opcode major opcode
+ * @param data second header byte
+ * @return offset of request in buffer
+ */
+static size_t beginRequest( ClientContext& ctx, const uint8_t opcode,
+                            const uint8_t data = 0 ) {
+    const size_t start { ctx.out.size() };
+    ctx.out.put8( opcode );
+    ctx.out.put8( data );
+    ctx.out.put16( 0 );  // length, set by endRequest
+    return start;
+}
+
+/**
+ * @brief Sets request length after encoding.
+ * @param ctx client context
+ * @param start offset of request in buffer
+ */
+static void endRequest( ClientContext& ctx, const size_t start ) {
+    assert( ( ctx.out.size() - start ) % wire::ALIGN == 0 );
+    ctx.out.set16( start + 2,
+                   uint16_t( ( ctx.out.size() - start ) / wire::ALIGN ) );
+}
+
+/** @brief Atom names interned by clients, as by toolkits at startup. */
+static constexpr std::array< std::string_view, 8 > ATOM_NAMES {
+    "WM_PROTOCOLS", "WM_DELETE_WINDOW", "_NET_WM_NAME", "UTF8_STRING",
+    "_NET_WM_STATE", "_NET_WM_PID", "_MOTIF_WM_HINTS", "CLIPBOARD"
+};
+
+namespace oc = protocol::requests::opcodes;
+
+/**
+ * @brief Encodes one request of each supported opcode with randomized
+ *   parameters.
+ * @param ctx client context
+ * @param opcode major opcode
+ */
+static void encodeRequest( ClientContext& ctx, const uint8_t opcode ) {
+    wire::Writer& out { ctx.out };
+    switch ( opcode ) {
+    case oc::GETWINDOWATTRIBUTES:
+    case oc::GETGEOMETRY:
+    case oc::QUERYPOINTER: {
+        const size_t start { beginRequest( ctx, opcode ) };
+        out.put32( ctx.window );
+        endRequest( ctx, start );
+    }   break;
+    case oc::GETINPUTFOCUS: {
+        const size_t start { beginRequest( ctx, opcode ) };
+        endRequest( ctx, start );
+    }   break;
+    case oc::TRANSLATECOORDINATES: {
+        const size_t start { beginRequest( ctx, opcode ) };
+        out.put32( ctx.window );
+        out.put32( ctx.window );
+        out.put16( uint16_t( ctx.random.below( 640 ) ) );
+        out.put16( uint16_t( ctx.random.below( 480 ) ) );
+        endRequest( ctx, start );
+    }   break;
+    case oc::INTERNATOM: {
+        const std::string_view name {
+            ATOM_NAMES[ ctx.random.below( ATOM_NAMES.size() ) ] };
+        const size_t start { beginRequest( ctx, opcode, 0 ) };
+        out.put16( uint16_t( name.size() ) );
+        out.zeros( 2 );
+        out.putPadded( name );
+        endRequest( ctx, start );
+    }   break;
+    case oc::GETPROPERTY: {
+        const size_t start { beginRequest( ctx, opcode, 0 ) };
+        out.put32( ctx.window );
+        out.put32( 39 );  // WM_NAME
+        out.put32( 0 );   // AnyPropertyType
+        out.put32( 0 );   // long-offset
+        out.put32( 256 ); // long-length
+        endRequest( ctx, start );
+    }   break;
+    case oc::CHANGEPROPERTY: {
+        static constexpr std::string_view TITLE { "xtracepp benchmark client" };
+        const size_t start { beginRequest( ctx, opcode, 0 ) };  // Replace
+        out.put32( ctx.window );
+        out.put32( 39 );  // WM_NAME
+        out.put32( 31 );  // STRING
+        out.put8( 8 );    // format
+        out.zeros( 3 );
+        out.put32( uint32_t( TITLE.size() ) );
+        out.putPadded( TITLE );
+        endRequest( ctx, start );
+    }   break;
+    case oc::CONFIGUREWINDOW: {
+        const size_t start { beginRequest( ctx, opcode ) };
+        out.put32( ctx.window );
+        out.put16( 0x000c );  // width | height
+        out.zeros( 2 );
+        out.put32( 320 + ctx.random.below( 320 ) );
+        out.put32( 240 + ctx.random.below( 240 ) );
+        endRequest( ctx, start );
+    }   break;
+    case oc::CHANGEGC: {
+        const size_t start { beginRequest( ctx, opcode ) };
+        out.put32( ctx.gc );
+        out.put32( 0x0000000c );  // foreground | background
+        out.put32( ctx.random.below( 0x01000000 ) );
+        out.put32( ctx.random.below( 0x01000000 ) );
+        endRequest( ctx, start );
+    }   break;
+    case oc::COPYAREA: {
+        const size_t start { beginRequest( ctx, opcode ) };
+        out.put32( ctx.pixmap );
+        out.put32( ctx.window );
+        out.put32( ctx.gc );
+        out.put16( 0 );
+        out.put16( 0 );
+        out.put16( uint16_t( ctx.random.below( 640 ) ) );
+        out.put16( uint16_t( ctx.random.below( 480 ) ) );
+        out.put16( 64 );
+        out.put16( 64 );
+        endRequest( ctx, start );
+    }   break;
+    case oc::POLYSEGMENT:
+    case oc::POLYFILLRECTANGLE: {
+        const size_t start { beginRequest( ctx, opcode ) };
+        out.put32( ctx.window );
+        out.put32( ctx.gc );
+        for ( uint32_t i {}, n { 1 + ctx.random.below( 16 ) }; i < n; ++i ) {
+            out.put16( uint16_t( ctx.random.below( 640 ) ) );
+            out.put16( uint16_t( ctx.random.below( 480 ) ) );
+            out.put16( uint16_t( ctx.random.below( 64 ) ) );
+            out.put16( uint16_t( ctx.random.below( 64 ) ) );
+        }
+        endRequest( ctx, start );
+    }   break;
+    case oc::PUTIMAGE: {
+        static constexpr uint16_t SIDE { 16 };
+        const size_t start { beginRequest( ctx, opcode, 2 ) };  // ZPixmap
+        out.put32( ctx.window );
+        out.put32( ctx.gc );
+        out.put16( SIDE );
+        out.put16( SIDE );
+        out.put16( uint16_t( ctx.random.below( 640 ) ) );
+        out.put16( uint16_t( ctx.random.below( 480 ) ) );
+        out.put8( 0 );    // left-pad
+        out.put8( 24 );   // depth
+        out.zeros( 2 );
+        out.zeros( SIDE * SIDE * 4 );
+        endRequest( ctx, start );
+    }   break;
+    case oc::IMAGETEXT8: {
+        static constexpr std::array< std::string_view, 4 > STRINGS {
+            "File", "Edit", "Open Recent...", "The quick brown fox jumps" };
+        const std::string_view str {
+            STRINGS[ ctx.random.below( STRINGS.size() ) ] };
+        const size_t start {
+            beginRequest( ctx, opcode, uint8_t( str.size() ) ) };
+        out.put32( ctx.window );
+        out.put32( ctx.gc );
+        out.put16( uint16_t( ctx.random.below( 640 ) ) );
+        out.put16( uint16_t( ctx.random.below( 480 ) ) );
+        out.putPadded( str );
+        endRequest( ctx, start );
+    }   break;
+    default:
+        assert( false );
+        break;
+    }
+}
+
+/**
+ * @brief Weighted request opcode, one entry of a [Mix](#Mix).
+ */
+struct MixEntry {
+    /** @brief Major opcode. */
+    uint8_t  opcode;
+    /** @brief Relative frequency. */
+    uint32_t weight;
+};
+
+/**
+ * @brief Named request mix.
+ */
+struct Mix {
+    /** @brief Mix name, as given to `-m`. */
+    std::string_view        name;
+    /** @brief Weighted opcodes. */
+    std::vector< MixEntry > entries;
+};
+
+/**
+ * @brief Request mixes: `toolkit` approximates a GUI toolkit redrawing and
+ *   querying state, `drawing` is void requests with an occasional sync,
+ *   `roundtrip` is only requests with replies.
+ */
+static const std::array< Mix, 3 > MIXES { {
+    { "toolkit", { { oc::POLYFILLRECTANGLE,   20 }, { oc::IMAGETEXT8,          15 },
+                   { oc::CHANGEGC,            15 }, { oc::COPYAREA,            10 },
+                   { oc::POLYSEGMENT,         10 }, { oc::PUTIMAGE,             5 },
+                   { oc::CONFIGUREWINDOW,      5 }, { oc::CHANGEPROPERTY,       5 },
+                   { oc::GETPROPERTY,          4 }, { oc::INTERNATOM,           3 },
+                   { oc::QUERYPOINTER,         3 }, { oc::GETGEOMETRY,          2 },
+                   { oc::GETINPUTFOCUS,        2 }, { oc::TRANSLATECOORDINATES, 1 } } },
+    { "drawing", { { oc::POLYFILLRECTANGLE,   30 }, { oc::IMAGETEXT8,          25 },
+                   { oc::CHANGEGC,            20 }, { oc::COPYAREA,            15 },
+                   { oc::POLYSEGMENT,         15 }, { oc::PUTIMAGE,            10 },
+                   { oc::GETINPUTFOCUS,        1 } } },
+    { "roundtrip", { { oc::GETPROPERTY,        4 }, { oc::INTERNATOM,           3 },
+                     { oc::QUERYPOINTER,       3 }, { oc::GETGEOMETRY,          2 },
+                     { oc::GETWINDOWATTRIBUTES, 2 }, { oc::GETINPUTFOCUS,       2 },
+                     { oc::TRANSLATECOORDINATES, 1 } } },
+} };
+
+/**
+ * @brief Whether opcode expects a reply, among those in [MIXES](#MIXES).
+ * @param opcode major opcode
+ * @return whether reply is expected
+ */
+static bool hasReply( const uint8_t opcode ) {
+    switch ( opcode ) {
+    case oc::GETWINDOWATTRIBUTES:
+    case oc::GETGEOMETRY:
+    case oc::INTERNATOM:
+    case oc::GETPROPERTY:
+    case oc::QUERYPOINTER:
+    case oc::TRANSLATECOORDINATES:
+    case oc::GETINPUTFOCUS:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Totals for one client, or summed over all clients.
+ */
+struct Results {
+    /** @brief Requests sent. */
+    uint64_t requests {};
+    /** @brief Replies and errors received. */
+    uint64_t replies {};
+    /** @brief Events received. */
+    uint64_t events {};
+    /** @brief Bytes sent. */
+    uint64_t bytes_sent {};
+    /** @brief Bytes received. */
+    uint64_t bytes_received {};
+    /** @brief Round trip time of requests with replies, in nanoseconds. */
+    LatencyHistogram round_trips;
+    /** @brief Error message if client failed. */
+    std::string error;
+
+    /**
+     * @brief Sums results of another client.
+     * @param other client results
+     * @return this
+     */
+    Results& operator+=( const Results& other ) {
+        requests       += other.requests;
+        replies        += other.replies;
+        events         += other.events;
+        bytes_sent     += other.bytes_sent;
+        bytes_received += other.bytes_received;
+        round_trips    += other.round_trips;
+        if ( error.empty() )
+            error = other.error;
+        return *this;
+    }
+};
+
+/**
+ * @brief Buffered reader of server messages on client socket.
+ */
+class ServerReader {
+private:
+    /** @brief Client socket. */
+    int _fd;
+    /** @brief Received bytes. */
+    std::vector< uint8_t > _buffer;
+    /** @brief Bytes of `_buffer` already consumed. */
+    size_t _consumed {};
+
+public:
+    /** @param fd client socket */
+    explicit ServerReader( const int fd ) : _fd( fd ) {}
+    /**
+     * @brief Blocks until at least `sz` unconsumed bytes are buffered.
+     * @param sz bytes required
+     * @param[out] results adds bytes received
+     * @return pointer to unconsumed bytes, or nullptr if connection closed
+     */
+    const uint8_t* require( const size_t sz, Results* results ) {
+        while ( _buffer.size() - _consumed < sz ) {
+            if ( _consumed > 0 ) {
+                _buffer.erase( _buffer.begin(),
+                               _buffer.begin() + std::ptrdiff_t( _consumed ) );
+                _consumed = 0;
+            }
+            uint8_t buf[ 64 * 1024 ];
+            const ::ssize_t ret { ::recv( _fd, buf, sizeof( buf ), 0 ) };
+            if ( ret == -1 && errno == EINTR )
+                continue;
+            if ( ret <= 0 )
+                return nullptr;
+            _buffer.insert( _buffer.end(), buf, buf + ret );
+            results->bytes_received += uint64_t( ret );
+        }
+        return _buffer.data() + _consumed;
+    }
+    /**
+     * @brief Marks bytes consumed.
+     * @param sz bytes consumed
+     */
+    void consume( const size_t sz ) {
+        _consumed += sz;
+    }
+};
+
+/**
+ * @brief Sends all of buffer.
+ * @param fd client socket
+ * @param[in,out] buffer bytes to send, cleared after
+ * @param[out] results adds bytes sent
+ * @return whether all bytes were sent
+ */
+static bool sendAll( const int fd, std::vector< uint8_t >* buffer,
+                     Results* results ) {
+    for ( size_t sent {}; sent < buffer->size(); ) {
+        const ::ssize_t ret { ::send( fd, buffer->data() + sent,
+                                      buffer->size() - sent, MSG_NOSIGNAL ) };
+        if ( ret == -1 && errno == EINTR )
+            continue;
+        if ( ret <= 0 )
+            return false;
+        sent += size_t( ret );
+    }
+    results->bytes_sent += buffer->size();
+    buffer->clear();
+    return true;
+}
+
+/**
+ * @brief Options shared by all client threads.
+ */
+struct Options {
+    /** @brief Clients to run concurrently. */
+    uint32_t    clients { 4 };
+    /** @brief Seconds to run each phase. */
+    double      seconds { 5 };
+    /** @brief Request mix. */
+    const Mix*  mix { &MIXES[ 0 ] };
+    /** @brief Whether to encode in opposite of host byte order. */
+    bool        byteswap {};
+};
+
+/** @brief Void requests buffered before sending. */
+static constexpr size_t FLUSH_SZ { 16 * 1024 };
+
+/**
+ * @brief Runs one client until `stop` is set.
+ * @param display display number
+ * @param options shared options
+ * @param seed PRNG seed
+ * @param stop set when phase ends
+ * @param[out] results client totals
+ */
+static void runClient( const int display, const Options& options,
+                       const uint64_t seed, const std::atomic_bool& stop,
+                       Results* results ) {
+    assert( results != nullptr );
+    const int fd { wire::connectDisplay( display ) };
+    if ( fd < 0 ) {
+        results->error = fmt::format( "connect to :{}: {}", display,
+                                      std::strerror( errno ) );
+        return;
+    }
+    const bool msb_first { wire::host_msb_first != options.byteswap };
+    std::vector< uint8_t > buffer;
+    wire::Writer out { buffer, msb_first };
+    ServerReader reader { fd };
+
+    // connection setup, without authorization
+    using protocol::connection_setup::Initiation;
+    out.put8( msb_first ? Initiation::MSBFIRST : Initiation::LSBFIRST );
+    out.zeros( 1 );
+    out.put16( 11 );
+    out.put16( 0 );
+    out.put16( 0 );
+    out.put16( 0 );
+    out.zeros( 2 );
+    if ( !sendAll( fd, &buffer, results ) ) {
+        results->error = "could not send connection setup";
+        ::close( fd );
+        return;
+    }
+    const uint8_t* setup { reader.require( 8, results ) };
+    if ( setup == nullptr ||
+         setup[ 0 ] != protocol::connection_setup::InitResponse::SUCCESS ) {
+        results->error = "connection setup refused";
+        ::close( fd );
+        return;
+    }
+    const size_t setup_sz { 8 + size_t( wire::get16( setup + 6, msb_first ) ) *
+        wire::ALIGN };
+    setup = reader.require( setup_sz, results );
+    if ( setup == nullptr ) {
+        results->error = "connection closed during setup";
+        ::close( fd );
+        return;
+    }
+    const uint32_t id_base { wire::get32( setup + 12, msb_first ) };
+    reader.consume( setup_sz );
+
+    Random random { seed };
+    ClientContext ctx { out, random, id_base | 1, id_base | 2, id_base | 3 };
+    uint32_t total_weight {};
+    for ( const MixEntry& entry : options.mix->entries )
+        total_weight += entry.weight;
+    uint16_t sequence {};
+    while ( !stop.load( std::memory_order_relaxed ) ) {
+        uint32_t pick { random.below( total_weight ) };
+        uint8_t opcode {};
+        for ( const MixEntry& entry : options.mix->entries ) {
+            if ( pick < entry.weight ) {
+                opcode = entry.opcode;
+                break;
+            }
+            pick -= entry.weight;
+        }
+        encodeRequest( ctx, opcode );
+        ++sequence;
+        ++results->requests;
+        if ( !hasReply( opcode ) ) {
+            if ( buffer.size() >= FLUSH_SZ && !sendAll( fd, &buffer, results ) )
+                break;
+            continue;
+        }
+        // block on reply, as Xlib and XCB clients do when they need a value
+        const uint64_t sent_ns { nowNs() };
+        if ( !sendAll( fd, &buffer, results ) )
+            break;
+        bool answered {};
+        while ( !answered ) {
+            const uint8_t* msg { reader.require( 32, results ) };
+            if ( msg == nullptr )
+                break;
+            size_t sz { 32 };
+            if ( msg[ 0 ] == protocol::requests::Reply::REPLY ) {
+                sz += size_t( wire::get32( msg + 4, msb_first ) ) * wire::ALIGN;
+                // may reallocate buffer
+                msg = reader.require( sz, results );
+                if ( msg == nullptr )
+                    break;
+            }
+            if ( msg[ 0 ] <= protocol::requests::Reply::REPLY ) {
+                ++results->replies;
+                answered = ( wire::get16( msg + 2, msb_first ) == sequence );
+            } else {
+                ++results->events;
+            }
+            reader.consume( sz );
+        }
+        if ( !answered )
+            break;
+        results->round_trips.record( nowNs() - sent_ns );
+    }
+    if ( !stop.load() )
+        results->error = "connection closed by server";
+    ::close( fd );
+}
+
+/**
+ * @brief Runs all clients concurrently against display.
+ * @param display display number
+ * @param options shared options
+ * @param[out] elapsed_s seconds phase ran
+ * @return summed results
+ */
+static Results runPhase( const int display, const Options& options,
+                         double* elapsed_s ) {
+    std::vector< Results > results ( options.clients );
+    std::vector< std::thread > threads;
+    std::atomic_bool stop {};
+    const uint64_t start_ns { nowNs() };
+    for ( uint32_t i {}; i < options.clients; ++i ) {
+        threads.emplace_back( runClient, display, std::cref( options ),
+                              uint64_t( i + 1 ) * 0x9e3779b97f4a7c15,
+                              std::cref( stop ), &results[ i ] );
+    }
+    std::this_thread::sleep_for(
+        std::chrono::duration< double >( options.seconds ) );
+    stop.store( true );
+    for ( std::thread& thread : threads )
+        thread.join();
+    *elapsed_s = double( nowNs() - start_ns ) / 1e9;
+    Results total;
+    for ( const Results& client : results )
+        total += client;
+    return total;
+}
+
+/** @brief Round trip percentiles reported. */
+static constexpr std::array< double, 5 > PERCENTILES { 50, 90, 99, 99.9, 100 };
+
+/**
+ * @brief Prints phase results.
+ * @param label phase label
+ * @param results summed results
+ * @param elapsed_s seconds phase ran
+ */
+static void printPhase( const std::string_view label, const Results& results,
+                        const double elapsed_s ) {
+    const uint64_t messages {
+        results.requests + results.replies + results.events };
+    fmt::println( "{}: {} requests, {} replies/errors, {} events in {:.2f}s",
+                  label, results.requests, results.replies, results.events,
+                  elapsed_s );
+    fmt::println( "{}: {:.0f} msgs/s, {:.2f} MB/s ({:.2f} MB/s to server, "
+                  "{:.2f} MB/s to clients)", label,
+                  double( messages ) / elapsed_s,
+                  double( results.bytes_sent + results.bytes_received ) /
+                  elapsed_s / 1e6,
+                  double( results.bytes_sent ) / elapsed_s / 1e6,
+                  double( results.bytes_received ) / elapsed_s / 1e6 );
+    std::string percentiles;
+    for ( const double percentile : PERCENTILES ) {
+        percentiles += fmt::format(
+            " p{}={:.1f}", percentile,
+            double( results.round_trips.percentile( percentile ) ) / 1e3 );
+    }
+    fmt::println( "{}: {} round trips (us):{}", label,
+                  results.round_trips.count(), percentiles );
+}
+
+int main( const int argc, char* const* argv ) {
+    assert( argc >= 1 );
+    const char* process_name { argv[ 0 ] };
+    static constexpr std::string_view USAGE {
+        "usage: {} -d display [-b baseline_display] [-n clients] [-t seconds] "
+        "[-m toolkit|drawing|roundtrip] [-s]\n"
+        "  -d  display to load, eg :98 served by xtracepp\n"
+        "  -b  display to load first for comparison, eg :97 served directly by\n"
+        "      fake_x_server, to report latency added by proxy\n"
+        "  -n  concurrent clients, default 4\n"
+        "  -t  seconds to run against each display, default 5\n"
+        "  -m  request mix, default toolkit\n"
+        "  -s  encode requests in opposite of host byte order" };
+    Options options;
+    int display { -1 };
+    int baseline_display { -1 };
+    for ( int c; ( c = ::getopt( argc, argv, "d:b:n:t:m:sh" ) ) != -1; ) {
+        switch ( c ) {
+        case 'd':
+            display = wire::displayNumber( optarg );
+            break;
+        case 'b':
+            baseline_display = wire::displayNumber( optarg );
+            if ( baseline_display < 0 ) {
+                fmt::println( ::stderr, "{}: invalid display {:?}",
+                              process_name, optarg );
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'n':
+            options.clients = uint32_t( std::strtol( optarg, nullptr, 10 ) );
+            break;
+        case 't':
+            options.seconds = std::strtod( optarg, nullptr );
+            break;
+        case 'm':
+            options.mix = nullptr;
+            for ( const Mix& mix : MIXES ) {
+                if ( mix.name == optarg )
+                    options.mix = &mix;
+            }
+            if ( options.mix == nullptr ) {
+                fmt::println( ::stderr, "{}: unknown mix {:?}",
+                              process_name, optarg );
+                return EXIT_FAILURE;
+            }
+            break;
+        case 's':
+            options.byteswap = true;
+            break;
+        default:
+            fmt::println( ::stderr, USAGE, process_name );
+            return c == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if ( display < 0 || options.clients == 0 || options.seconds <= 0 ) {
+        fmt::println( ::stderr, USAGE, process_name );
+        return EXIT_FAILURE;
+    }
+    fmt::println( "{} clients, {} mix, {:.1f}s per display", options.clients,
+                  options.mix->name, options.seconds );
+
+    Results baseline;
+    if ( baseline_display >= 0 ) {
+        double elapsed_s {};
+        baseline = runPhase( baseline_display, options, &elapsed_s );
+        if ( !baseline.error.empty() ) {
+            fmt::println( ::stderr, "{}: baseline :{}: {}", process_name,
+                          baseline_display, baseline.error );
+            return EXIT_FAILURE;
+        }
+        printPhase( fmt::format( "baseline :{}", baseline_display ),
+                    baseline, elapsed_s );
+    }
+    double elapsed_s {};
+    const Results results { runPhase( display, options, &elapsed_s ) };
+    if ( !results.error.empty() ) {
+        fmt::println( ::stderr, "{}: :{}: {}", process_name, display,
+                      results.error );
+        return EXIT_FAILURE;
+    }
+    printPhase( fmt::format( "target :{}", display ), results, elapsed_s );
+    if ( baseline_display >= 0 ) {
+        std::string added;
+        for ( const double percentile : PERCENTILES ) {
+            added += fmt::format(
+                " p{}={:+.1f}", percentile,
+                ( double( results.round_trips.percentile( percentile ) ) -
+                  double( baseline.round_trips.percentile( percentile ) ) ) / 1e3 );
+        }
+        fmt::println( "added round trip latency (us):{}", added );
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,574 @@
+#include <algorithm>              // max
+#include <array>
+#include <fstream>
+#include <functional>             // cref
+#include <iterator>               // istreambuf_iterator
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <cassert>
+#include <cerrno>                 // errno, EINTR, EAGAIN
+#include <cstdint>
+#include <cstdio>                 // stderr
+#include <cstdlib>                // EXIT_FAILURE, EXIT_SUCCESS, strtol, strtod
+#include <cstring>                // memcpy, strerror
+
+#include <fcntl.h>                // fcntl, O_NONBLOCK
+#include <getopt.h>               // getopt
+#include <poll.h>                 // ppoll, pollfd, POLLIN, POLLOUT
+#include <sys/socket.h>           // send, recv
+#include <time.h>                 // clock_gettime, timespec
+#include <unistd.h>               // close
+
+#include <fmt/format.h>
+
+#include <LatencyHistogram.hpp>
+#include <TrafficRecording.hpp>
+#include <protocol/connection_setup.hpp>
+#include <protocol/requests.hpp>
+
+#include "wire.hpp"
+
+/**
+ * @file x11_replay.cpp
+ * @brief Replays client traffic captured with `xtracepp --record` to a
+ *   display (eg `xtracepp` in front of `fake_x_server`) at scaled speed, as
+ *   several concurrent copies with resource IDs rebased per copy, reporting
+ *   throughput and how far sends fell behind the recorded schedule.
+ */
+
+/**
+ * @brief Reads monotonic clock.
+ * @return monotonic time in nanoseconds
+ */
+static uint64_t nowNs() {
+    ::timespec ts {};
+    ::clock_gettime( CLOCK_MONOTONIC, &ts );
+    return uint64_t( ts.tv_sec ) * 1'000'000'000 + uint64_t( ts.tv_nsec );
+}
+
+/**
+ * @brief Requests received together, sent together on replay.
+ */
+struct Step {
+    /** @brief Time received, relative to first step (nanoseconds.) */
+    uint64_t offset_ns {};
+    /** @brief End of step in #Recording::requests. */
+    size_t   end {};
+};
+
+/**
+ * @brief Client traffic of one connection, prepared for replay.
+ */
+struct Recording {
+    /** @brief File path. */
+    std::string path;
+    /** @brief Whether client encoded integers most significant byte first. */
+    bool     msb_first {};
+    /** @brief Connection setup request, sent verbatim. */
+    std::vector< uint8_t > setup;
+    /** @brief Requests following setup, excluding any skipped. */
+    std::vector< uint8_t > requests;
+    /** @brief Count of requests in #requests. */
+    uint64_t request_ct {};
+    /** @brief Count of requests skipped as BIG-REQUESTS encoded. */
+    uint64_t skipped_ct {};
+    /** @brief Groups of #requests by time received. */
+    std::vector< Step > steps;
+    /** @brief `resource-id-base` recorded client allocated IDs from. */
+    uint32_t id_base {};
+    /** @brief `resource-id-mask` recorded client allocated IDs with. */
+    uint32_t id_mask {};
+    /** @brief Offsets in #requests of words within recorded client's ID range. */
+    std::vector< size_t > id_offsets;
+};
+
+/**
+ * @brief Loads recording and splits client traffic into requests.
+ * @param path recording file path
+ * @param[out] recording loaded recording
+ * @return error message, or empty string on success
+ */
+static std::string loadRecording( const std::string& path,
+                                  Recording* recording ) {
+    assert( recording != nullptr );
+    std::ifstream ifs { path, std::ios::binary };
+    if ( !ifs )
+        return fmt::format( "could not open: {}", std::strerror( errno ) );
+    const std::vector< uint8_t > file {
+        std::istreambuf_iterator< char >( ifs ),
+        std::istreambuf_iterator< char >() };
+    TrafficRecording::FileHeader header {};
+    if ( file.size() < sizeof( header ) )
+        return "truncated file header";
+    std::memcpy( &header, file.data(), sizeof( header ) );
+    if ( header.magic != TrafficRecording::MAGIC ||
+         header.version != TrafficRecording::VERSION ||
+         header.header_sz < sizeof( header ) ) {
+        return "not a recording of this version";
+    }
+    recording->path = path;
+
+    // concatenate each direction, noting time each client byte was received
+    std::vector< uint8_t > client;
+    std::vector< Step > client_reads;
+    std::vector< uint8_t > server;
+    for ( size_t pos { header.header_sz }; pos < file.size(); ) {
+        TrafficRecording::RecordHeader record {};
+        if ( file.size() - pos < sizeof( record ) )
+            return "truncated record header";
+        std::memcpy( &record, file.data() + pos, sizeof( record ) );
+        pos += sizeof( record );
+        if ( file.size() - pos < record.size )
+            return "truncated record";
+        std::vector< uint8_t >& stream {
+            record.direction == TrafficRecording::CLIENT_TO_SERVER ?
+            client : server };
+        stream.insert( stream.end(), file.begin() + std::ptrdiff_t( pos ),
+                       file.begin() + std::ptrdiff_t( pos + record.size ) );
+        if ( record.direction == TrafficRecording::CLIENT_TO_SERVER )
+            client_reads.push_back( { record.offset_ns, client.size() } );
+        pos += record.size;
+    }
+
+    using protocol::connection_setup::Initiation;
+    if ( client.size() < sizeof( Initiation::Header ) )
+        return "no connection setup request";
+    if ( client[ 0 ] != Initiation::MSBFIRST &&
+         client[ 0 ] != Initiation::LSBFIRST ) {
+        return "invalid byte order in connection setup request";
+    }
+    const bool msb_first { client[ 0 ] == Initiation::MSBFIRST };
+    recording->msb_first = msb_first;
+    const size_t setup_sz { sizeof( Initiation::Header ) +
+        wire::pad( wire::get16( client.data() + 6, msb_first ) ) +
+        wire::pad( wire::get16( client.data() + 8, msb_first ) ) };
+    if ( client.size() < setup_sz )
+        return "truncated connection setup request";
+    recording->setup.assign( client.begin(),
+                             client.begin() + std::ptrdiff_t( setup_sz ) );
+    // Acceptance::Encoding resource-id-base and resource-id-mask
+    if ( server.size() < 20 ||
+         server[ 0 ] != protocol::connection_setup::InitResponse::SUCCESS ) {
+        return "no successful connection setup reply";
+    }
+    recording->id_base = wire::get32( server.data() + 12, msb_first );
+    recording->id_mask = wire::get32( server.data() + 16, msb_first );
+
+    // split into requests, timed by read that completed each
+    auto read_it { client_reads.begin() };
+    uint64_t first_ns {};
+    bool first_step { true };
+    for ( size_t pos { setup_sz }; pos + 4 <= client.size(); ) {
+        const uint8_t* request { client.data() + pos };
+        size_t sz { size_t( wire::get16( request + 2, msb_first ) ) * wire::ALIGN };
+        const bool big_request { sz == 0 };
+        if ( big_request ) {
+            if ( client.size() - pos < 8 )
+                break;
+            sz = size_t( wire::get32( request + 4, msb_first ) ) * wire::ALIGN;
+            if ( sz < 8 )
+                return fmt::format( "invalid request length at offset {}", pos );
+        }
+        // client may have closed mid-request
+        if ( client.size() - pos < sz )
+            break;
+        while ( read_it->end < pos + sz )
+            ++read_it;
+        pos += sz;
+        // BIG-REQUESTS must first be enabled by a reply the replay target
+        //   may not give, so such requests are left out
+        if ( big_request ) {
+            ++recording->skipped_ct;
+            continue;
+        }
+        if ( first_step ) {
+            first_ns = read_it->offset_ns;
+            first_step = false;
+        }
+        const size_t start { recording->requests.size() };
+        recording->requests.insert( recording->requests.end(),
+                                    request, request + sz );
+        ++recording->request_ct;
+        const uint64_t offset_ns { read_it->offset_ns - first_ns };
+        if ( recording->steps.empty() ||
+             recording->steps.back().offset_ns != offset_ns ) {
+            recording->steps.push_back( { offset_ns, {} } );
+        }
+        recording->steps.back().end = recording->requests.size();
+
+        // words after header that fall in client's ID range; image data is
+        //   not scanned, as pixels may too
+        if ( recording->id_base == 0 )
+            continue;
+        const size_t scan_end {
+            request[ 0 ] == protocol::requests::opcodes::PUTIMAGE ?
+            protocol::requests::PutImage::BASE_ENCODING_SZ : sz };
+        for ( size_t offset { 4 }; offset + 4 <= scan_end; offset += 4 ) {
+            const uint32_t word {
+                wire::get32( request + offset, msb_first ) };
+            if ( ( word & ~recording->id_mask ) == recording->id_base )
+                recording->id_offsets.push_back( start + offset );
+        }
+    }
+    if ( recording->requests.empty() )
+        return "no requests after connection setup";
+    return {};
+}
+
+/**
+ * @brief Options shared by all copies.
+ */
+struct Options {
+    /** @brief Copies of each recording to replay concurrently. */
+    uint32_t copies { 1 };
+    /** @brief Replay speed relative to recording, or 0 for maximum. */
+    double   speed { 1 };
+};
+
+/**
+ * @brief Totals of one or more replayed connections.
+ */
+struct Results {
+    /** @brief Requests sent, including final round trip. */
+    uint64_t requests {};
+    /** @brief Replies and errors received. */
+    uint64_t replies {};
+    /** @brief Events received. */
+    uint64_t events {};
+    /** @brief Bytes sent. */
+    uint64_t bytes_sent {};
+    /** @brief Bytes received. */
+    uint64_t bytes_received {};
+    /** @brief Time each step finished sending past its scheduled time. */
+    LatencyHistogram lag;
+    /** @brief Error message if replay failed. */
+    std::string error;
+
+    /**
+     * @brief Sums results of another connection.
+     * @param other connection results
+     * @return this
+     */
+    Results& operator+=( const Results& other ) {
+        requests       += other.requests;
+        replies        += other.replies;
+        events         += other.events;
+        bytes_sent     += other.bytes_sent;
+        bytes_received += other.bytes_received;
+        lag            += other.lag;
+        if ( error.empty() )
+            error = other.error;
+        return *this;
+    }
+};
+
+/**
+ * @brief Counts complete server messages in buffer and discards them.
+ * @param[in,out] input bytes received, complete messages erased
+ * @param msb_first whether server encodes integers most significant byte first
+ * @param[in,out] sequence last sequence number seen, extended past 16 bits
+ * @param final_sequence sequence number of reply ending replay
+ * @param[out] results adds replies and events
+ * @return whether reply to `final_sequence` was received
+ */
+static bool consumeServerMessages( std::vector< uint8_t >* input,
+                                   const bool msb_first, uint64_t* sequence,
+                                   const uint64_t final_sequence,
+                                   Results* results ) {
+    assert( input != nullptr );
+    assert( sequence != nullptr );
+    static constexpr uint8_t KEYMAP_NOTIFY { 11 };
+    static constexpr uint8_t GENERIC_EVENT { 35 };
+    bool finished {};
+    size_t pos {};
+    while ( input->size() - pos >= 32 ) {
+        const uint8_t* msg { input->data() + pos };
+        size_t sz { 32 };
+        if ( msg[ 0 ] == protocol::requests::Reply::REPLY ||
+             ( msg[ 0 ] & 0x7f ) == GENERIC_EVENT ) {
+            sz += size_t( wire::get32( msg + 4, msb_first ) ) * wire::ALIGN;
+        }
+        if ( input->size() - pos < sz )
+            break;
+        // 16-bit sequence numbers wrap, so are extended assuming messages
+        //   are fewer than 2^16 requests apart
+        if ( ( msg[ 0 ] & 0x7f ) != KEYMAP_NOTIFY ) {
+            *sequence += uint16_t( wire::get16( msg + 2, msb_first ) -
+                                   uint16_t( *sequence ) );
+        }
+        if ( msg[ 0 ] <= protocol::requests::Reply::REPLY ) {
+            ++results->replies;
+            finished = finished ||
+                ( msg[ 0 ] == protocol::requests::Reply::REPLY &&
+                  *sequence == final_sequence );
+        } else {
+            ++results->events;
+        }
+        pos += sz;
+    }
+    input->erase( input->begin(), input->begin() + std::ptrdiff_t( pos ) );
+    return finished;
+}
+
+/**
+ * @brief Replays one copy of recording, then makes a final round trip so that
+ *   all requests are known to have been processed.
+ * @param display display number
+ * @param options shared options
+ * @param recording recording to replay
+ * @param start_ns monotonic time at which replay of all copies began
+ * @param[out] results connection totals
+ */
+static void replayCopy( const int display, const Options& options,
+                        const Recording& recording, const uint64_t start_ns,
+                        Results* results ) {
+    assert( results != nullptr );
+    const int fd { wire::connectDisplay( display ) };
+    if ( fd < 0 ) {
+        results->error = fmt::format( "connect to :{}: {}", display,
+                                      std::strerror( errno ) );
+        return;
+    }
+    const bool msb_first { recording.msb_first };
+    std::vector< uint8_t > input;
+    const auto fail { [&]( std::string error ) {
+        results->error = fmt::format( "{}: {}", recording.path, error );
+        ::close( fd );
+    } };
+
+    // connection setup, blocking
+    for ( size_t sent {}; sent < recording.setup.size(); ) {
+        const ::ssize_t ret {
+            ::send( fd, recording.setup.data() + sent,
+                    recording.setup.size() - sent, MSG_NOSIGNAL ) };
+        if ( ret == -1 && errno == EINTR )
+            continue;
+        if ( ret <= 0 )
+            return fail( "could not send connection setup" );
+        sent += size_t( ret );
+    }
+    results->bytes_sent += recording.setup.size();
+    size_t setup_sz { 8 };
+    while ( input.size() < setup_sz ) {
+        uint8_t buf[ 4096 ];
+        const ::ssize_t ret { ::recv( fd, buf, sizeof( buf ), 0 ) };
+        if ( ret == -1 && errno == EINTR )
+            continue;
+        if ( ret <= 0 )
+            return fail( "connection closed during setup" );
+        input.insert( input.end(), buf, buf + ret );
+        results->bytes_received += uint64_t( ret );
+        if ( input[ 0 ] != protocol::connection_setup::InitResponse::SUCCESS )
+            return fail( "connection setup refused" );
+        if ( input.size() >= 8 ) {
+            setup_sz = 8 + size_t( wire::get16( input.data() + 6, msb_first ) ) *
+                wire::ALIGN;
+        }
+    }
+    const uint32_t id_base { wire::get32( input.data() + 12, msb_first ) };
+    const uint32_t id_mask { wire::get32( input.data() + 16, msb_first ) };
+    input.erase( input.begin(), input.begin() + std::ptrdiff_t( setup_sz ) );
+
+    // rebase IDs from recorded client's range to this connection's
+    std::vector< uint8_t > requests { recording.requests };
+    wire::Writer out { requests, msb_first };
+    for ( const size_t offset : recording.id_offsets ) {
+        const uint32_t id { wire::get32( requests.data() + offset, msb_first ) };
+        out.set32( offset, id_base | ( id & recording.id_mask & id_mask ) );
+    }
+    // final round trip
+    out.put8( protocol::requests::opcodes::GETINPUTFOCUS );
+    out.zeros( 1 );
+    out.put16( 1 );
+    const uint64_t final_sequence { recording.request_ct + 1 };
+    uint64_t sequence {};
+    results->requests += recording.request_ct + 1;
+
+    if ( ::fcntl( fd, F_SETFL, ::fcntl( fd, F_GETFL ) | O_NONBLOCK ) == -1 )
+        return fail( fmt::format( "fcntl: {}", std::strerror( errno ) ) );
+    size_t sent {};
+    size_t due_end {};
+    auto step_it { recording.steps.begin() };
+    // steps due but not yet completely sent, by end and scheduled time
+    std::vector< std::pair< size_t, uint64_t > > pending_steps;
+    bool finished {};
+    while ( !finished ) {
+        const uint64_t now_ns { nowNs() };
+        for ( ; step_it != recording.steps.end(); ++step_it ) {
+            const uint64_t due_ns { options.speed == 0 ? start_ns :
+                start_ns + uint64_t( double( step_it->offset_ns ) / options.speed ) };
+            if ( due_ns > now_ns )
+                break;
+            due_end = step_it->end;
+            pending_steps.emplace_back( step_it->end, due_ns );
+        }
+        if ( step_it == recording.steps.end() )
+            due_end = requests.size();
+
+        ::pollfd pfd { fd, POLLIN, 0 };
+        if ( sent < due_end )
+            pfd.events |= POLLOUT;
+        ::timespec timeout {};
+        const ::timespec* timeout_p { nullptr };
+        if ( sent == due_end && step_it != recording.steps.end() ) {
+            const uint64_t wait_ns {
+                start_ns + uint64_t( double( step_it->offset_ns ) /
+                                     options.speed ) - now_ns };
+            timeout.tv_sec = ::time_t( wait_ns / 1'000'000'000 );
+            timeout.tv_nsec = long( wait_ns % 1'000'000'000 );
+            timeout_p = &timeout;
+        }
+        if ( ::ppoll( &pfd, 1, timeout_p, nullptr ) == -1 ) {
+            if ( errno == EINTR )
+                continue;
+            return fail( fmt::format( "ppoll: {}", std::strerror( errno ) ) );
+        }
+        if ( pfd.revents & ( POLLERR | POLLHUP ) && !( pfd.revents & POLLIN ) )
+            return fail( "connection closed by server" );
+        if ( pfd.revents & POLLOUT ) {
+            const ::ssize_t ret { ::send( fd, requests.data() + sent,
+                                          due_end - sent, MSG_NOSIGNAL ) };
+            if ( ret == -1 && errno != EINTR && errno != EAGAIN )
+                return fail( "connection closed by server" );
+            if ( ret > 0 ) {
+                sent += size_t( ret );
+                results->bytes_sent += uint64_t( ret );
+                const uint64_t sent_ns { nowNs() };
+                auto pending_it { pending_steps.begin() };
+                for ( ; pending_it != pending_steps.end() &&
+                          pending_it->first <= sent; ++pending_it ) {
+                    results->lag.record( sent_ns - pending_it->second );
+                }
+                pending_steps.erase( pending_steps.begin(), pending_it );
+            }
+        }
+        if ( pfd.revents & POLLIN ) {
+            uint8_t buf[ 64 * 1024 ];
+            const ::ssize_t ret { ::recv( fd, buf, sizeof( buf ), 0 ) };
+            if ( ret == 0 || ( ret == -1 && errno != EINTR && errno != EAGAIN ) )
+                return fail( "connection closed by server" );
+            if ( ret > 0 ) {
+                input.insert( input.end(), buf, buf + ret );
+                results->bytes_received += uint64_t( ret );
+                finished = consumeServerMessages(
+                    &input, msb_first, &sequence, final_sequence, results );
+            }
+        }
+    }
+    ::close( fd );
+}
+
+/** @brief Schedule lag percentiles reported. */
+static constexpr std::array< double, 5 > PERCENTILES { 50, 90, 99, 99.9, 100 };
+
+int main( const int argc, char* const* argv ) {
+    assert( argc >= 1 );
+    const char* process_name { argv[ 0 ] };
+    static constexpr std::string_view USAGE {
+        "usage: {} -d display [-n copies] [-s speed|max] recording...\n"
+        "  -d  display to replay to, eg :98 served by xtracepp\n"
+        "  -n  concurrent copies of each recording, default 1, with resource\n"
+        "      IDs rebased to each copy's connection\n"
+        "  -s  speed relative to recording, eg 10, or max to send without\n"
+        "      delay, default 1\n"
+        "  recordings are C###.xrec files written by xtracepp --record" };
+    Options options;
+    int display { -1 };
+    for ( int c; ( c = ::getopt( argc, argv, "d:n:s:h" ) ) != -1; ) {
+        switch ( c ) {
+        case 'd':
+            display = wire::displayNumber( optarg );
+            break;
+        case 'n':
+            options.copies = uint32_t( std::strtol( optarg, nullptr, 10 ) );
+            break;
+        case 's':
+            options.speed = ( std::string_view( optarg ) == "max" ) ? 0 :
+                std::strtod( optarg, nullptr );
+            if ( options.speed <= 0 && std::string_view( optarg ) != "max" ) {
+                fmt::println( ::stderr, "{}: invalid speed {:?}",
+                              process_name, optarg );
+                return EXIT_FAILURE;
+            }
+            break;
+        default:
+            fmt::println( ::stderr, USAGE, process_name );
+            return c == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if ( display < 0 || options.copies == 0 || ::optind == argc ) {
+        fmt::println( ::stderr, USAGE, process_name );
+        return EXIT_FAILURE;
+    }
+
+    std::vector< Recording > recordings ( size_t( argc - ::optind ) );
+    uint64_t recorded_ns {};
+    uint64_t skipped_ct {};
+    for ( size_t i {}; i < recordings.size(); ++i ) {
+        const std::string path { argv[ ::optind + int( i ) ] };
+        if ( const std::string error { loadRecording( path, &recordings[ i ] ) };
+             !error.empty() ) {
+            fmt::println( ::stderr, "{}: {}: {}", process_name, path, error );
+            return EXIT_FAILURE;
+        }
+        if ( recordings[ i ].id_base == 0 ) {
+            fmt::println( ::stderr, "{}: {}: recorded resource-id-base is 0, "
+                          "IDs will not be rebased", process_name, path );
+        }
+        recorded_ns = std::max( recorded_ns,
+                                recordings[ i ].steps.back().offset_ns );
+        skipped_ct += recordings[ i ].skipped_ct;
+    }
+    fmt::println( "{} recordings ({:.2f}s), {} copies, {} speed",
+                  recordings.size(), double( recorded_ns ) / 1e9,
+                  options.copies, options.speed == 0 ? "max" :
+                  fmt::format( "{}x", options.speed ) );
+    if ( skipped_ct > 0 ) {
+        fmt::println( "skipping {} BIG-REQUESTS encoded requests per copy",
+                      skipped_ct );
+    }
+
+    std::vector< Results > results ( recordings.size() * options.copies );
+    std::vector< std::thread > threads;
+    const uint64_t start_ns { nowNs() };
+    for ( uint32_t copy {}; copy < options.copies; ++copy ) {
+        for ( size_t i {}; i < recordings.size(); ++i ) {
+            threads.emplace_back(
+                replayCopy, display, std::cref( options ),
+                std::cref( recordings[ i ] ), start_ns,
+                &results[ copy * recordings.size() + i ] );
+        }
+    }
+    for ( std::thread& thread : threads )
+        thread.join();
+    const double elapsed_s { double( nowNs() - start_ns ) / 1e9 };
+    Results total;
+    for ( const Results& connection : results )
+        total += connection;
+    if ( !total.error.empty() ) {
+        fmt::println( ::stderr, "{}: {}", process_name, total.error );
+        return EXIT_FAILURE;
+    }
+
+    fmt::println( "{} requests, {} replies/errors, {} events in {:.2f}s",
+                  total.requests, total.replies, total.events, elapsed_s );
+    fmt::println( "{:.0f} requests/s, {:.2f} MB/s ({:.2f} MB/s to server, "
+                  "{:.2f} MB/s to clients)",
+                  double( total.requests ) / elapsed_s,
+                  double( total.bytes_sent + total.bytes_received ) /
+                  elapsed_s / 1e6,
+                  double( total.bytes_sent ) / elapsed_s / 1e6,
+                  double( total.bytes_received ) / elapsed_s / 1e6 );
+    std::string percentiles;
+    for ( const double percentile : PERCENTILES ) {
+        percentiles += fmt::format(
+            " p{}={:.1f}", percentile,
+            double( total.lag.percentile( percentile ) ) / 1e3 );
+    }
+    fmt::println( "{} sends behind schedule (us):{}", total.lag.count(),
+                  percentiles );
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,138 @@
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>        // pair
+#include <vector>
+
+#include <cassert>
+#include <cerrno>         // errno, ENOENT
+#include <cstdint>
+#include <cstdio>         // FILE, fopen, fwrite, fclose, rename, remove
+#include <cstring>        // memcpy
+
+#include <fcntl.h>        // open, O_RDONLY, O_CLOEXEC
+#include <sys/mman.h>     // mmap, munmap
+#include <sys/stat.h>     // fstat
+#include <unistd.h>       // close
+
+#include <fmt/format.h>
+
+#include "AtomCache.hpp"
+#include "errors.hpp"
+
+
+std::pair< std::vector< std::string >, std::optional< std::string > >
+AtomCache::load( const std::string& path, const ServerKey& key ) {
+    const int fd { ::open( path.c_str(), O_RDONLY | O_CLOEXEC ) };
+    if ( fd < 0 ) {
+        // first run against any server
+        if ( errno == ENOENT )
+            return { {}, std::nullopt };
+        return { {}, errors::system::message( "open" ) };
+    }
+    struct ::stat st {};
+    if ( ::fstat( fd, &st ) != 0 ) {
+        const std::string error { errors::system::message( "fstat" ) };
+        ::close( fd );
+        return { {}, error };
+    }
+    const size_t file_sz ( st.st_size );
+    if ( file_sz < sizeof( FileHeader ) ) {
+        ::close( fd );
+        return { {}, "truncated file header" };
+    }
+    void* map { ::mmap( nullptr, file_sz, PROT_READ, MAP_PRIVATE, fd, 0 ) };
+    ::close( fd );
+    if ( map == MAP_FAILED )
+        return { {}, errors::system::message( "mmap" ) };
+    const uint8_t* data { static_cast< const uint8_t* >( map ) };
+
+    std::vector< std::string > atoms;
+    std::optional< std::string > error;
+    FileHeader header;
+    ::memcpy( &header, data, sizeof( header ) );
+    const size_t offsets_pos { size_t( header.header_sz ) + header.vendor_len };
+    const size_t arena_pos {
+        offsets_pos + ( size_t( header.atom_ct ) + 1 ) * sizeof( uint32_t ) };
+    if ( header.magic != MAGIC || header.version != VERSION ||
+         header.header_sz < sizeof( header ) ) {
+        error = "not an atom cache of this version";
+    } else if ( header.atom_ct == 0 || arena_pos > file_sz ) {
+        error = "truncated atom table";
+    } else if ( header.release_number == key.release_number &&
+                header.root == key.root &&
+                header.start_time == key.start_time &&
+                std::string_view(
+                    reinterpret_cast< const char* >( data + header.header_sz ),
+                    header.vendor_len ) == key.vendor ) {
+        // offsets may be unaligned after vendor string
+        uint32_t end {};
+        ::memcpy( &end, data + offsets_pos, sizeof( end ) );
+        atoms.reserve( header.atom_ct );
+        for ( uint32_t i {}; i < header.atom_ct; ++i ) {
+            const uint32_t begin { end };
+            ::memcpy( &end, data + offsets_pos + ( i + 1 ) * sizeof( end ),
+                      sizeof( end ) );
+            if ( end < begin || arena_pos + end > file_sz ) {
+                atoms.clear();
+                error = "invalid atom name offsets";
+                break;
+            }
+            atoms.emplace_back(
+                reinterpret_cast< const char* >( data + arena_pos + begin ),
+                end - begin );
+        }
+    }
+    // otherwise cache belongs to another (eg restarted) server, and is
+    //   replaced once atoms are fetched
+    ::munmap( map, file_sz );
+    return { atoms, error };
+}
+
+std::optional< std::string >
+AtomCache::save( const std::string& path, const ServerKey& key,
+                 const std::vector< std::string >& atoms ) {
+    assert( !atoms.empty() );
+    // readers never see a partially written cache
+    const std::string tmp_path { fmt::format( "{}.tmp", path ) };
+    ::FILE* fs { ::fopen( tmp_path.c_str(), "we" ) };
+    if ( fs == nullptr )
+        return errors::system::message( "fopen" );
+    const FileHeader header {
+        MAGIC, VERSION, sizeof( FileHeader ), key.start_time,
+        key.release_number, key.root, uint32_t( key.vendor.size() ),
+        uint32_t( atoms.size() ) };
+    std::vector< uint32_t > offsets;
+    offsets.reserve( atoms.size() + 1 );
+    uint32_t offset {};
+    offsets.push_back( offset );
+    for ( const std::string& atom : atoms ) {
+        offset += uint32_t( atom.size() );
+        offsets.push_back( offset );
+    }
+    bool written {
+        ::fwrite( &header, sizeof( header ), 1, fs ) == 1 &&
+        ::fwrite( key.vendor.data(), 1, key.vendor.size(), fs ) ==
+        key.vendor.size() &&
+        ::fwrite( offsets.data(), sizeof( uint32_t ), offsets.size(), fs ) ==
+        offsets.size() };
+    for ( auto it { atoms.begin() }; written && it != atoms.end(); ++it )
+        written = ::fwrite( it->data(), 1, it->size(), fs ) == it->size();
+    if ( !written ) {
+        const std::string error { errors::system::message( "fwrite" ) };
+        ::fclose( fs );
+        std::remove( tmp_path.c_str() );
+        return error;
+    }
+    if ( ::fclose( fs ) != 0 ) {
+        const std::string error { errors::system::message( "fclose" ) };
+        std::remove( tmp_path.c_str() );
+        return error;
+    }
+    if ( std::rename( tmp_path.c_str(), path.c_str() ) != 0 ) {
+        const std::string error { errors::system::message( "rename" ) };
+        std::remove( tmp_path.c_str() );
+        return error;
+    }
+    return std::nullopt;
+}
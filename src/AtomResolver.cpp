@@ -0,0 +1,127 @@
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <cassert>
+#include <cstdint>
+
+#include <unistd.h>       // close
+
+#include <fmt/format.h>
+
+#include "AtomResolver.hpp"
+#include "SocketBuffer.hpp"
+#include "X11ProtocolParser.hpp"
+
+#include "protocol/Response.hpp"
+#include "protocol/errors.hpp"
+#include "protocol/events.hpp"
+#include "protocol/requests.hpp"
+
+
+AtomResolver::~AtomResolver() {
+    if ( isOpen() )
+        ::close( _fd );
+}
+
+void AtomResolver::open( const int fd ) {
+    assert( !isOpen() );
+    assert( fd >= 0 );
+    _fd = fd;
+}
+
+std::vector< uint32_t > AtomResolver::close() {
+    std::vector< uint32_t > unanswered;
+    for ( const auto& [ sequence, atom ] : _in_flight )
+        unanswered.push_back( atom );
+    unanswered.insert( unanswered.end(), _queued.begin(), _queued.end() );
+    _in_flight.clear();
+    _queued.clear();
+    _buffer.clear();
+    if ( isOpen() ) {
+        ::close( _fd );
+        _fd = _UNINIT_FD;
+    }
+    return unanswered;
+}
+
+std::optional< std::string > AtomResolver::write() {
+    assert( isOpen() );
+    using Align = X11ProtocolParser::Alignment;
+    using protocol::requests::GetAtomName;
+    GetAtomName::Prefix req_prefix {};
+    req_prefix.opcode = protocol::requests::opcodes::GETATOMNAME;
+    GetAtomName::Length req_length {};
+    req_length.tl_aligned_units = Align::units( GetAtomName::BASE_ENCODING_SZ );
+    GetAtomName::Encoding req_encoding {};
+    SocketBuffer req_buffer;
+    for ( ; !_queued.empty() && _in_flight.size() < WINDOW;
+          _queued.pop_front() ) {
+        req_buffer.load( &req_prefix, sizeof( req_prefix ) );
+        req_buffer.load( &req_length, sizeof( req_length ) );
+        req_encoding.atom.data = _queued.front();
+        req_buffer.load( &req_encoding, sizeof( req_encoding ) );
+        _in_flight.emplace_back( ++_sequence, _queued.front() );
+    }
+    if ( req_buffer.empty() )
+        return std::nullopt;
+    req_buffer.setMessageSize( req_buffer.size() );
+    req_buffer.markMessageParsed();
+    const auto [ bytes_written, write_error ] { req_buffer.write( _fd ) };
+    return write_error;
+}
+
+std::optional< std::string >
+AtomResolver::read( std::vector< Resolution >& resolved ) {
+    assert( isOpen() );
+    const auto [ bytes_read, read_error ] { _buffer.read( _fd ) };
+    if ( read_error )
+        return read_error;
+    if ( bytes_read == 0 )
+        return "X server closed atom resolution connection";
+    using Align = X11ProtocolParser::Alignment;
+    using protocol::Response;
+    using protocol::requests::GetAtomName;
+    static_assert( protocol::errors::Error::ENCODING_SZ ==
+                   sizeof( GetAtomName::Reply::Encoding ) );
+    while ( _buffer.size() >= sizeof( GetAtomName::Reply::Encoding ) ) {
+        const Response::Header* header {
+            reinterpret_cast< const Response::Header* >( _buffer.data() ) };
+        // no events selected, but skip any sent
+        if ( header->prefix != protocol::errors::Error::ERROR &&
+             header->prefix != protocol::requests::Reply::REPLY ) {
+            _buffer.unload( protocol::events::Event::ENCODING_SZ );
+            continue;
+        }
+        if ( _in_flight.empty() ||
+             header->sequence_num != _in_flight.front().first ) {
+            return fmt::format( "expected response to request {} but got {}",
+                                _in_flight.empty() ? 0 : _in_flight.front().first,
+                                header->sequence_num );
+        }
+        const uint32_t atom { _in_flight.front().second };
+        if ( header->prefix == protocol::errors::Error::ERROR ) {
+            // usually Atom error, as atom seen in traffic was bad
+            _buffer.unload( protocol::errors::Error::ENCODING_SZ );
+            _in_flight.pop_front();
+            resolved.push_back( { atom, std::nullopt } );
+            continue;
+        }
+        const GetAtomName::Reply::Header* rep_header {
+            reinterpret_cast< const GetAtomName::Reply::Header* >(
+                _buffer.data() ) };
+        const size_t name_sz { Align::size( rep_header->extra_aligned_units ) };
+        if ( _buffer.size() < GetAtomName::Reply::DEFAULT_ENCODING_SZ + name_sz )
+            break;
+        GetAtomName::Reply::Encoding rep_encoding;
+        _buffer.unload( &rep_encoding, sizeof( rep_encoding ) );
+        resolved.push_back(
+            { atom, std::string(
+                    reinterpret_cast< const char* >( _buffer.data() ),
+                    size_t( rep_encoding.name_len ) ) } );
+        if ( name_sz > 0 )
+            _buffer.unload( name_sz );
+        _in_flight.pop_front();
+    }
+    return std::nullopt;
+}
@@ -0,0 +1,50 @@
+#include <algorithm>      // max, min
+#include <memory>         // make_unique
+#include <string_view>
+
+#include <cstdint>
+#include <cstring>        // memcpy
+
+#include "AtomTable.hpp"
+
+
+std::string_view AtomTable::_store( const std::string_view name ) {
+    // data of empty view still non-null, to mark ATOM as interned
+    if ( name.empty() )
+        return { "", 0 };
+    if ( _block_sz - _block_used < name.size() ) {
+        _block_sz = std::max( _BLOCK_SZ, name.size() );
+        _blocks.emplace_back( std::make_unique< char[] >( _block_sz ) );
+        _block_used = 0;
+    }
+    char* copy { _blocks.back().get() + _block_used };
+    ::memcpy( copy, name.data(), name.size() );
+    _block_used += name.size();
+    return { copy, name.size() };
+}
+
+bool AtomTable::set( const uint32_t atom, const std::string_view name ) {
+    if ( const std::string_view* interned { find( atom ) };
+         interned != nullptr && *interned == name ) {
+        return false;
+    }
+    // replaced names are left in arena, as servers rarely reuse ATOMs
+    const std::string_view stored { _store( name ) };
+    if ( atom >= DENSE_LIMIT ) {
+        _overflow[ atom ] = stored;
+        return true;
+    }
+    if ( atom >= _dense.size() )
+        _dense.resize( atom + 1 );
+    _dense[ atom ] = stored;
+    return true;
+}
+
+void AtomTable::reserve( const uint32_t atom_ct, const size_t bytes ) {
+    _dense.reserve( std::min( atom_ct, DENSE_LIMIT ) );
+    if ( _block_sz - _block_used >= bytes )
+        return;
+    _block_sz = std::max( _BLOCK_SZ, bytes );
+    _blocks.emplace_back( std::make_unique< char[] >( _block_sz ) );
+    _block_used = 0;
+}
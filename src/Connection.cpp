@@ -8,6 +8,7 @@
 
 #include "Connection.hpp"
 #include "errors.hpp"
+#include "monotonic.hpp"
 
 
 Connection::Connection() :
@@ -21,7 +22,8 @@ Connection::Connection() :
             ::exit( EXIT_FAILURE );
         }
         return tv.tv_sec * uint64_t{ 1000 } + tv.tv_usec / 1000;
-    }() ) {
+    }() ),
+    start_ns ( monotonic::now() ) {
 }
 
 void
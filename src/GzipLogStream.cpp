@@ -0,0 +1,142 @@
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>        // move
+
+#include <cassert>
+#include <cerrno>
+#include <cstdio>         // FILE, fopencookie, setvbuf
+
+#include <fcntl.h>        // open, O_WRONLY, O_CREAT, O_TRUNC, O_CLOEXEC
+#include <unistd.h>       // write, fsync, close
+
+#include <zlib.h>         // z_stream, deflateInit2, deflate, deflateEnd...
+
+#include "GzipLogStream.hpp"
+#include "Metrics.hpp"
+
+
+void GzipLogStream::_compress() {
+    while ( true ) {
+        std::string block;
+        {
+            std::unique_lock< std::mutex > lock { _mutex };
+            _cv.wait( lock, [ this ](){
+                return _stopping || !_blocks.empty(); } );
+            if ( _blocks.empty() )
+                return;
+            block = std::move( _blocks.front() );
+            _blocks.pop_front();
+        }
+        _cv.notify_all();
+        if ( const int error { _writeBlock( block ) }; error != 0 ) {
+            std::lock_guard< std::mutex > lock { _mutex };
+            if ( _error == 0 )
+                _error = error;
+        }
+        Metrics::add( Metrics::GZIP_BYTES_COMPRESSED, block.size() );
+    }
+}
+
+int GzipLogStream::_writeBlock( const std::string& block ) {
+    // windowBits of 15 + 16 selects gzip header and trailer
+    static constexpr int GZIP_WINDOW_BITS { 15 + 16 };
+    static constexpr int MEM_LEVEL        { 8 };
+    ::z_stream zs {};
+    if ( ::deflateInit2( &zs, Z_BEST_SPEED, Z_DEFLATED,
+                         GZIP_WINDOW_BITS, MEM_LEVEL,
+                         Z_DEFAULT_STRATEGY ) != Z_OK ) {
+        return -1;
+    }
+    std::string out ( ::deflateBound( &zs, ::uLong( block.size() ) ), '\0' );
+    zs.next_in   = reinterpret_cast< ::Bytef* >( const_cast< char* >( block.data() ) );
+    zs.avail_in  = ::uInt( block.size() );
+    zs.next_out  = reinterpret_cast< ::Bytef* >( out.data() );
+    zs.avail_out = ::uInt( out.size() );
+    const int ret { ::deflate( &zs, Z_FINISH ) };
+    const size_t out_sz { zs.total_out };
+    ::deflateEnd( &zs );
+    if ( ret != Z_STREAM_END )
+        return -1;
+    for ( size_t written {}; written < out_sz; ) {
+        const ::ssize_t w_ret {
+            ::write( _fd, out.data() + written, out_sz - written ) };
+        if ( w_ret == -1 ) {
+            if ( errno == EINTR )
+                continue;
+            return errno;
+        }
+        written += size_t( w_ret );
+    }
+    return 0;
+}
+
+::ssize_t
+GzipLogStream::_cookieWrite( void* cookie, const char* buf, size_t size ) {
+    GzipLogStream* gls { static_cast< GzipLogStream* >( cookie ) };
+    assert( gls != nullptr );
+    {
+        std::unique_lock< std::mutex > lock { gls->_mutex };
+        // bound memory use when compression falls behind
+        gls->_cv.wait( lock, [ gls ](){
+            return gls->_blocks.size() < MAX_QUEUED_BLOCKS; } );
+        if ( gls->_error != 0 ) {
+            errno = gls->_error > 0 ? gls->_error : EIO;
+            return -1;
+        }
+        gls->_blocks.emplace_back( buf, size );
+    }
+    gls->_cv.notify_all();
+    Metrics::add( Metrics::GZIP_BYTES_QUEUED, size );
+    return ::ssize_t( size );
+}
+
+int GzipLogStream::_cookieClose( void* cookie ) {
+    GzipLogStream* gls { static_cast< GzipLogStream* >( cookie ) };
+    assert( gls != nullptr );
+    {
+        std::lock_guard< std::mutex > lock { gls->_mutex };
+        gls->_stopping = true;
+    }
+    gls->_cv.notify_all();
+    gls->_thread.join();
+    int error { gls->_error > 0 ? gls->_error : gls->_error < 0 ? EIO : 0 };
+    if ( ::fsync( gls->_fd ) == -1 && error == 0 )
+        error = errno;
+    if ( ::close( gls->_fd ) == -1 && error == 0 )
+        error = errno;
+    delete gls;
+    if ( error != 0 ) {
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
+
+::FILE* GzipLogStream::open( const char* path ) {
+    assert( path != nullptr );
+    const int fd { ::open( path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                           0644 ) };
+    if ( fd == -1 )
+        return nullptr;
+    GzipLogStream* gls { new GzipLogStream };
+    gls->_fd = fd;
+    static constexpr ::cookie_io_functions_t io_funcs {
+        nullptr, _cookieWrite, nullptr, _cookieClose };
+    ::FILE* fs { ::fopencookie( gls, "w", io_funcs ) };
+    if ( fs == nullptr ) {
+        const int error { errno };
+        ::close( fd );
+        delete gls;
+        errno = error;
+        return nullptr;
+    }
+    gls->_thread = std::thread( &GzipLogStream::_compress, gls );
+    if ( ::setvbuf( fs, nullptr, _IOFBF, BLOCK_SZ ) != 0 ) {
+        const int error { errno };
+        ::fclose( fs );
+        errno = error;
+        return nullptr;
+    }
+    return fs;
+}
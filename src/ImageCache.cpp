@@ -0,0 +1,73 @@
+#include <string>
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>        // memcpy
+
+#include "ImageCache.hpp"
+
+
+uint64_t ImageCache::hash( const uint8_t* data, const size_t sz ) {
+    assert( sz == 0 || data != nullptr );
+    static constexpr uint64_t M    { 0xc6a4a7935bd1e995 };
+    static constexpr int      R    { 47 };
+    static constexpr uint64_t SEED { 0x78747261636570 };  // "xtracep"
+    uint64_t h { SEED ^ ( sz * M ) };
+    const size_t aligned_sz { sz & ~size_t( 7 ) };
+    for ( size_t i {}; i < aligned_sz; i += sizeof( uint64_t ) ) {
+        uint64_t k;
+        // unaligned read; host byte order is fine, as only the sending end
+        //   of a tunnel hashes images
+        std::memcpy( &k, data + i, sizeof( k ) );
+        k *= M;
+        k ^= k >> R;
+        k *= M;
+        h ^= k;
+        h *= M;
+    }
+    if ( const size_t tail_sz { sz - aligned_sz }; tail_sz > 0 ) {
+        for ( size_t i {}; i < tail_sz; ++i )
+            h ^= uint64_t( data[ aligned_sz + i ] ) << ( 8 * i );
+        h *= M;
+    }
+    h ^= h >> R;
+    h *= M;
+    h ^= h >> R;
+    return h;
+}
+
+void ImageCache::_evictAbove( const size_t sz ) {
+    while ( _sz > sz ) {
+        assert( !_entries.empty() );
+        _sz -= _entries.back().sz;
+        _entries_by_hash.erase( _entries.back().hash );
+        _entries.pop_back();
+    }
+}
+
+void ImageCache::setBudget( const size_t budget ) {
+    _budget = budget;
+    _evictAbove( _budget );
+}
+
+const std::string* ImageCache::find( const uint64_t hash ) {
+    const auto it { _entries_by_hash.find( hash ) };
+    if ( it == _entries_by_hash.end() )
+        return nullptr;
+    _entries.splice( _entries.begin(), _entries, it->second );
+    return &it->second->data;
+}
+
+bool ImageCache::insert( const uint64_t hash, const size_t sz,
+                         const uint8_t* data/* = nullptr*/ ) {
+    assert( _entries_by_hash.count( hash ) == 0 );
+    if ( sz > _budget )
+        return false;
+    _evictAbove( _budget - sz );
+    _entries.push_front( { hash, sz, {} } );
+    if ( data != nullptr )
+        _entries.front().data.assign( reinterpret_cast< const char* >( data ), sz );
+    _entries_by_hash.emplace( hash, _entries.begin() );
+    _sz += sz;
+    return true;
+}
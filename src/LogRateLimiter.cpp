@@ -0,0 +1,127 @@
+#include <algorithm>      // min
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>        // move
+#include <vector>
+
+#include <cstdint>
+#include <cstdio>         // FILE
+
+#include <fmt/format.h>
+
+#include "LogRateLimiter.hpp"
+#include "monotonic.hpp"
+#include "optionTerms.hpp"
+
+
+std::optional< std::string >
+LogRateLimiter::addRule( const std::string_view expr ) {
+    _Rule rule;
+    std::optional< uint32_t > burst;
+    // terms not specific to rate limiting are passed on to MessageFilter
+    std::string selection_expr;
+    if ( const auto error { option_terms::forEachTerm(
+             expr, [ &rule, &burst, &selection_expr ](
+                 const option_terms::Term& term )
+             -> std::optional< std::string > {
+        const auto& [ key, value, str ] { term };
+        if ( key == "rate" ) {
+            const auto rate { option_terms::parseUnsigned( value ) };
+            if ( !rate || *rate == 0 )
+                return fmt::format( "invalid rate {:?}, expected integer > 0",
+                                    value );
+            rule.rate = *rate;
+        } else if ( key == "burst" ) {
+            burst = option_terms::parseUnsigned( value );
+            if ( !burst || *burst == 0 )
+                return fmt::format( "invalid burst {:?}, expected integer > 0",
+                                    value );
+        } else if ( key == "sample" ) {
+            const auto sample { option_terms::parseUnsigned( value ) };
+            if ( !sample || *sample == 0 )
+                return fmt::format( "invalid sample {:?}, expected integer > 0",
+                                    value );
+            rule.sample = *sample;
+        } else {
+            if ( !selection_expr.empty() )
+                selection_expr += ',';
+            selection_expr += str;
+        }
+        return std::nullopt;
+    } ) }; error ) {
+        return error;
+    }
+    if ( rule.rate == 0 && rule.sample == 1 )
+        return "expected at least one of: \"rate\",\"sample\"";
+    if ( burst && rule.rate == 0 )
+        return "\"burst\" requires \"rate\"";
+    rule.burst = burst ? *burst : rule.rate;
+    if ( !selection_expr.empty() ) {
+        if ( const auto error { rule.selection.addClause( selection_expr ) };
+             error ) {
+            return error;
+        }
+    }
+    _rules.emplace_back( std::move( rule ) );
+    return std::nullopt;
+}
+
+LogRateLimiter::Compiled
+LogRateLimiter::compile( const uint32_t conn_id ) const {
+    Compiled compiled;
+    compiled._interval_start_ns = Compiled::_now();
+    for ( const _Rule& rule : _rules ) {
+        Compiled::_Bucket bucket;
+        bucket.selection = rule.selection.compile( conn_id );
+        bucket.rate      = rule.rate;
+        bucket.burst     = rule.burst;
+        bucket.sample    = rule.sample;
+        bucket.tokens    = rule.burst;
+        bucket.refill_ns = compiled._interval_start_ns;
+        compiled._buckets.emplace_back( bucket );
+    }
+    return compiled;
+}
+
+uint64_t LogRateLimiter::Compiled::_now() {
+    return monotonic::coarseNow();
+}
+
+bool LogRateLimiter::Compiled::_Bucket::admit( const uint64_t now_ns ) {
+    if ( sample > 1 && sample_count++ % sample != 0 )
+        return false;
+    if ( rate == 0 )
+        return true;
+    if ( now_ns > refill_ns ) {
+        tokens = std::min(
+            double( burst ),
+            tokens + double( now_ns - refill_ns ) * rate /
+            monotonic::NS_PER_SEC );
+        refill_ns = now_ns;
+    }
+    if ( tokens < 1.0 )
+        return false;
+    tokens -= 1.0;
+    return true;
+}
+
+std::vector< std::string > LogRateLimiter::Compiled::summary(
+    const uint32_t conn_id, const bool force/* = false*/ ) {
+    std::vector< std::string > lines;
+    if ( _buckets.empty() )
+        return lines;
+    const uint64_t now_ns { _now() };
+    const uint64_t elapsed_ns { now_ns - _interval_start_ns };
+    if ( !force && elapsed_ns < SUMMARY_INTERVAL_NS )
+        return lines;
+    for ( const auto& [ kind_name, count ] : _suppressed ) {
+        lines.emplace_back( fmt::format(
+            "C{:03d}: suppressed {} {} {} in last {:.1f}s",
+            conn_id, count, kind_name.first, kind_name.second,
+            double( elapsed_ns ) / monotonic::NS_PER_SEC ) );
+    }
+    _suppressed.clear();
+    _interval_start_ns = now_ns;
+    return lines;
+}
@@ -0,0 +1,163 @@
+#include <memory>         // make_unique
+#include <mutex>
+#include <string>
+#include <utility>        // move
+
+#include <cassert>
+#include <cerrno>
+#include <cstdio>         // FILE, fopencookie, setvbuf
+
+#include <fmt/format.h>
+
+#include <fcntl.h>        // open, O_WRONLY, O_CREAT, O_TRUNC, O_CLOEXEC
+#include <unistd.h>       // write, fsync, close
+
+#include "LogWriterPool.hpp"
+#include "Metrics.hpp"
+#include "errors.hpp"
+
+
+LogWriterPool::LogWriterPool( const size_t thread_ct ) {
+    assert( thread_ct > 0 );
+    for ( size_t i {}; i < thread_ct; ++i ) {
+        _workers.emplace_back( std::make_unique< _Worker >() );
+        _Worker* worker { _workers.back().get() };
+        worker->thread = std::thread( _work, worker );
+    }
+}
+
+LogWriterPool::~LogWriterPool() {
+    for ( const auto& worker : _workers ) {
+        {
+            std::lock_guard< std::mutex > lock { worker->mutex };
+            worker->stopping = true;
+        }
+        worker->cv.notify_one();
+    }
+    for ( const auto& worker : _workers )
+        worker->thread.join();
+}
+
+void LogWriterPool::_submit( _Worker* worker, _Task&& task ) {
+    assert( worker != nullptr );
+    {
+        std::unique_lock< std::mutex > lock { worker->mutex };
+        // bound memory use when disk falls behind, as dropping any part of a
+        //   buffer would splice partial lines
+        const auto has_space { [ worker, &task ](){
+            return worker->queued_sz == 0 ||
+                worker->queued_sz + task.data.size() <= QUEUE_LIMIT_SZ; } };
+        if ( !has_space() ) {
+            Metrics::add( Metrics::LOG_WRITER_STALLS );
+            worker->space_cv.wait( lock, has_space );
+        }
+        worker->queued_sz += task.data.size();
+        worker->tasks.emplace_back( std::move( task ) );
+    }
+    worker->cv.notify_one();
+}
+
+void LogWriterPool::_close( _Shard* shard ) {
+    assert( shard != nullptr );
+    if ( ::fsync( shard->fd ) == -1 && shard->error.load() == 0 )
+        shard->error.store( errno );
+    if ( ::close( shard->fd ) == -1 && shard->error.load() == 0 )
+        shard->error.store( errno );
+    if ( const int error { shard->error.load() }; error != 0 ) {
+        errno = error;
+        fmt::println( ::stderr, "{:?}: error writing log file: {}",
+                      shard->path, errors::system::message() );
+    }
+    delete shard;
+}
+
+void LogWriterPool::_work( _Worker* worker ) {
+    assert( worker != nullptr );
+    while ( true ) {
+        _Task task;
+        {
+            std::unique_lock< std::mutex > lock { worker->mutex };
+            worker->cv.wait( lock, [ worker ](){
+                return worker->stopping || !worker->tasks.empty(); } );
+            if ( worker->tasks.empty() )
+                return;
+            task = std::move( worker->tasks.front() );
+            worker->tasks.pop_front();
+            worker->queued_sz -= task.data.size();
+        }
+        worker->space_cv.notify_all();
+        _Shard* shard { task.shard };
+        assert( shard != nullptr );
+        for ( size_t written {}; written < task.data.size(); ) {
+            const ::ssize_t ret { ::write( shard->fd, task.data.data() + written,
+                                           task.data.size() - written ) };
+            if ( ret == -1 ) {
+                if ( errno == EINTR )
+                    continue;
+                if ( shard->error.load() == 0 )
+                    shard->error.store( errno );
+                break;
+            }
+            written += size_t( ret );
+        }
+        Metrics::add( Metrics::LOG_WRITER_BYTES_WRITTEN, task.data.size() );
+        if ( task.close )
+            _close( shard );
+    }
+}
+
+::ssize_t
+LogWriterPool::_cookieWrite( void* cookie, const char* buf, size_t size ) {
+    _Shard* shard { static_cast< _Shard* >( cookie ) };
+    assert( shard != nullptr );
+    if ( const int error { shard->error.load() }; error != 0 ) {
+        errno = error;
+        return -1;
+    }
+    _submit( shard->worker, { shard, std::string( buf, size ), false } );
+    Metrics::add( Metrics::LOG_WRITER_BYTES_QUEUED, size );
+    return ::ssize_t( size );
+}
+
+int LogWriterPool::_cookieClose( void* cookie ) {
+    _Shard* shard { static_cast< _Shard* >( cookie ) };
+    assert( shard != nullptr );
+    // shard is freed by worker, so read any earlier error before queueing
+    const int error { shard->error.load() };
+    _submit( shard->worker, { shard, {}, true } );
+    if ( error != 0 ) {
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
+
+::FILE* LogWriterPool::open( const std::string& path, const bool unbuffered ) {
+    const int fd { ::open( path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                           0644 ) };
+    if ( fd == -1 )
+        return nullptr;
+    _Shard* shard { new _Shard };
+    shard->path = path;
+    shard->fd = fd;
+    shard->worker = _workers.at( _next_worker_i ).get();
+    _next_worker_i = ( _next_worker_i + 1 ) % _workers.size();
+    static constexpr ::cookie_io_functions_t io_funcs {
+        nullptr, _cookieWrite, nullptr, _cookieClose };
+    ::FILE* fs { ::fopencookie( shard, "w", io_funcs ) };
+    if ( fs == nullptr ) {
+        const int error { errno };
+        ::close( fd );
+        delete shard;
+        errno = error;
+        return nullptr;
+    }
+    if ( ::setvbuf( fs, nullptr, unbuffered ? _IONBF : _IOFBF,
+                    unbuffered ? 0 : STREAM_BUFFER_SZ ) != 0 ) {
+        const int error { errno };
+        ::fclose( fs );
+        errno = error;
+        return nullptr;
+    }
+    return fs;
+}
@@ -0,0 +1,114 @@
+#include <limits>         // numeric_limits
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>        // move
+
+#include <cassert>
+#include <cstdint>
+
+#include <fmt/format.h>
+
+#include "MessageFilter.hpp"
+#include "optionTerms.hpp"
+
+#include "protocol/errors.hpp"
+#include "protocol/events.hpp"
+#include "protocol/requests.hpp"
+
+
+template< typename NamesT >
+std::optional< uint8_t >
+MessageFilter::_parseCode( const std::string_view str, const NamesT& names ) {
+    if ( const auto code { option_terms::parseUnsigned( str ) }; code ) {
+        if ( *code > std::numeric_limits< uint8_t >::max() )
+            return std::nullopt;
+        return uint8_t( *code );
+    }
+    for ( size_t i {}, sz { names.size() }; i < sz; ++i ) {
+        if ( !names[ i ].empty() && names[ i ] == str )
+            return uint8_t( i );
+    }
+    return std::nullopt;
+}
+
+std::optional< std::string >
+MessageFilter::addClause( const std::string_view expr ) {
+    _Clause clause;
+    if ( const auto error { option_terms::forEachTerm(
+             expr, [ &clause ]( const option_terms::Term& term )
+             -> std::optional< std::string > {
+        const auto& [ key, value, str ] { term };
+        if ( key == "conn" ) {
+            const auto range { option_terms::parseRange( value ) };
+            if ( !range )
+                return fmt::format( "invalid connection range {:?}", value );
+            clause.conns = *range;
+        } else if ( key == "seq" ) {
+            const auto range { option_terms::parseRange( value ) };
+            if ( !range )
+                return fmt::format( "invalid sequence range {:?}", value );
+            clause.seqs = *range;
+        } else if ( key == "dir" ) {
+            return clause.dirs.select( value );
+        } else if ( key == "request" ) {
+            const size_t colon_i { value.find( ':' ) };
+            const auto major {
+                _parseCode( value.substr( 0, colon_i ),
+                            protocol::requests::names ) };
+            if ( !major )
+                return fmt::format( "invalid request opcode {:?}", value );
+            const auto minors_it { clause.minor_opcodes.find( *major ) };
+            // major opcode selected without minor opcodes selects all of them
+            const bool all_minors {
+                clause.requests.test( *major ) &&
+                minors_it == clause.minor_opcodes.end() };
+            if ( colon_i != std::string_view::npos ) {
+                const auto minor {
+                    option_terms::parseUnsigned( value.substr( colon_i + 1 ) ) };
+                if ( !minor || *minor > std::numeric_limits< uint8_t >::max() )
+                    return fmt::format( "invalid minor opcode {:?}", value );
+                if ( !all_minors )
+                    clause.minor_opcodes[ *major ].set( *minor );
+            } else if ( minors_it != clause.minor_opcodes.end() ) {
+                clause.minor_opcodes.erase( minors_it );
+            }
+            clause.requests.set( *major );
+            clause.selective = true;
+        } else if ( key == "event" ) {
+            const auto code {
+                _parseCode( value, protocol::events::names ) };
+            if ( !code )
+                return fmt::format( "invalid event code {:?}", value );
+            clause.events.set( *code );
+            clause.selective = true;
+        } else if ( key == "error" ) {
+            const auto code {
+                _parseCode( value, protocol::errors::names ) };
+            if ( !code )
+                return fmt::format( "invalid error code {:?}", value );
+            clause.errors.set( *code );
+            clause.selective = true;
+        } else {
+            return fmt::format( "unrecognized filter key {:?}, expected one of: "
+                                "\"conn\",\"dir\",\"request\",\"event\","
+                                "\"error\",\"seq\"", key );
+        }
+        return std::nullopt;
+    } ) }; error ) {
+        return error;
+    }
+    _clauses.emplace_back( std::move( clause ) );
+    return std::nullopt;
+}
+
+MessageFilter::Compiled
+MessageFilter::compile( const uint32_t conn_id ) const {
+    Compiled compiled;
+    compiled._pass_all = _clauses.empty();
+    for ( const _Clause& clause : _clauses ) {
+        if ( clause.conns.in( conn_id ) )
+            compiled._clauses.emplace_back( clause );
+    }
+    return compiled;
+}
@@ -0,0 +1,36 @@
+#include <algorithm>      // min max sort
+#include <utility>        // pair
+#include <vector>
+
+#include <cstdint>
+
+#include "MessageStats.hpp"
+
+
+MessageStats& MessageStats::operator+=( const MessageStats& other ) {
+    for ( const auto& [ key, other_counter ] : other._counters ) {
+        Counter& counter { _counters[ key ] };
+        counter.count += other_counter.count;
+        counter.bytes += other_counter.bytes;
+        counter.min_sz = std::min( counter.min_sz, other_counter.min_sz );
+        counter.max_sz = std::max( counter.max_sz, other_counter.max_sz );
+        counter.answered += other_counter.answered;
+    }
+    return *this;
+}
+
+std::vector< std::pair< MessageStats::Key, MessageStats::Counter > >
+MessageStats::sorted() const {
+    std::vector< std::pair< uint32_t, Counter > > packed (
+        _counters.begin(), _counters.end() );
+    std::sort( packed.begin(), packed.end(),
+               []( const auto& a, const auto& b ) { return a.first < b.first; } );
+    std::vector< std::pair< Key, Counter > > counters;
+    counters.reserve( packed.size() );
+    for ( const auto& [ key, counter ] : packed ) {
+        counters.emplace_back(
+            Key { Kind( key >> 16 ), uint8_t( key >> 8 ), uint8_t( key ) },
+            counter );
+    }
+    return counters;
+}
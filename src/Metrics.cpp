@@ -0,0 +1,24 @@
+#include <atomic>
+#include <memory>         // make_unique
+#include <mutex>
+
+#include <cstdint>
+
+#include "Metrics.hpp"
+
+
+Metrics::_Shard* Metrics::_registerShard() {
+    std::lock_guard< std::mutex > lock { _shards_mutex };
+    _shards.emplace_back( std::make_unique< _Shard >() );
+    return _shards.back().get();
+}
+
+Metrics::SnapshotT Metrics::snapshot() {
+    SnapshotT sums {};
+    std::lock_guard< std::mutex > lock { _shards_mutex };
+    for ( const auto& shard : _shards ) {
+        for ( size_t i {}; i < COUNTER_CT; ++i )
+            sums[ i ] += shard->values[ i ].load( std::memory_order_relaxed );
+    }
+    return sums;
+}
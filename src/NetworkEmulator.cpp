@@ -0,0 +1,98 @@
+#include <algorithm>      // max
+#include <optional>
+#include <random>         // uniform_int_distribution
+#include <string>
+#include <string_view>
+
+#include <cstdint>
+
+#include <fmt/format.h>
+
+#include "NetworkEmulator.hpp"
+#include "monotonic.hpp"
+#include "optionTerms.hpp"
+
+
+std::optional< std::string >
+NetworkEmulator::addRule( const std::string_view expr ) {
+    static constexpr uint64_t NS_PER_MS { 1'000'000 };
+    static constexpr uint64_t BYTES_PER_KBIT { 1000 / 8 };
+    _Rule rule;
+    if ( const auto error { option_terms::forEachTerm(
+             expr, [ &rule ]( const option_terms::Term& term )
+             -> std::optional< std::string > {
+        const auto& [ key, value, str ] { term };
+        if ( key == "conn" ) {
+            const auto range { option_terms::parseRange( value ) };
+            if ( !range )
+                return fmt::format( "invalid connection range {:?}", value );
+            rule.conns = *range;
+        } else if ( key == "dir" ) {
+            return rule.dirs.select( value );
+        } else if ( key == "delay" ) {
+            const auto ms { option_terms::parseUnsigned( value ) };
+            if ( !ms )
+                return fmt::format( "invalid delay {:?}, expected milliseconds",
+                                    value );
+            rule.delay_ns = *ms * NS_PER_MS;
+        } else if ( key == "jitter" ) {
+            const auto ms { option_terms::parseUnsigned( value ) };
+            if ( !ms )
+                return fmt::format( "invalid jitter {:?}, expected milliseconds",
+                                    value );
+            rule.jitter_ns = *ms * NS_PER_MS;
+        } else if ( key == "bw" ) {
+            const auto kbit { option_terms::parseUnsigned( value ) };
+            if ( !kbit || *kbit == 0 )
+                return fmt::format( "invalid bandwidth {:?}, expected kbit/s > 0",
+                                    value );
+            rule.bytes_per_sec = *kbit * BYTES_PER_KBIT;
+        } else {
+            return fmt::format( "unknown key {:?}, expected one of: \"conn\","
+                                "\"dir\",\"delay\",\"jitter\",\"bw\"", key );
+        }
+        return std::nullopt;
+    } ) }; error ) {
+        return error;
+    }
+    _rules.emplace_back( rule );
+    return std::nullopt;
+}
+
+NetworkEmulator::Link
+NetworkEmulator::compile( const uint32_t conn_id,
+                          const bool client_to_server ) const {
+    Link link;
+    link._rng.seed( conn_id * 2 + client_to_server + 1 );
+    for ( const _Rule& rule : _rules ) {
+        if ( !rule.conns.in( conn_id ) ||
+             !( client_to_server ? rule.dirs.client_to_server :
+                                   rule.dirs.server_to_client ) ) {
+            continue;
+        }
+        link._delay_ns      = rule.delay_ns;
+        link._jitter_ns     = rule.jitter_ns;
+        link._bytes_per_sec = rule.bytes_per_sec;
+        break;
+    }
+    return link;
+}
+
+uint64_t NetworkEmulator::Link::releaseTime( const uint64_t now_ns,
+                                             const size_t bytes ) {
+    // bytes are serialized onto link after any still being sent, then
+    //   propagate with latency
+    _free_ns = std::max( now_ns, _free_ns );
+    if ( _bytes_per_sec != 0 )
+        _free_ns += bytes * monotonic::NS_PER_SEC / _bytes_per_sec;
+    uint64_t release_ns { _free_ns + _delay_ns };
+    if ( _jitter_ns != 0 ) {
+        std::uniform_int_distribution< uint64_t > jitter { 0, _jitter_ns * 2 };
+        release_ns = std::max( release_ns + jitter( _rng ), _jitter_ns ) -
+            _jitter_ns;
+    }
+    // TCP delivers in order, so a message never overtakes the one before it
+    release_ns = std::max( release_ns, _last_release_ns );
+    _last_release_ns = release_ns;
+    return release_ns;
+}
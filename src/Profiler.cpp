@@ -0,0 +1,121 @@
+#include <algorithm>      // sort
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>         // FILE, fopen, fclose
+
+#include <fmt/format.h>
+
+#include "Profiler.hpp"
+#include "errors.hpp"
+#include "monotonic.hpp"
+
+
+uint32_t Profiler::_enter( const std::string_view name ) {
+    assert( !_nodes.empty() );
+    const auto [ it, inserted ] {
+        _nodes[ _current ].children.try_emplace( name, uint32_t( _nodes.size() ) ) };
+    if ( inserted ) {
+        // invalidates references to nodes, so only indices are held
+        _nodes.emplace_back();
+        _nodes.back().name = name;
+        _nodes.back().parent = _current;
+    }
+    _current = it->second;
+    return _current;
+}
+
+void Profiler::_exit( const uint32_t node, const uint64_t ticks ) {
+    assert( node == _current );
+    assert( node != 0 );
+    _Node& exited { _nodes[ node ] };
+    ++exited.calls;
+    exited.ticks += ticks;
+    _current = exited.parent;
+    _nodes[ _current ].child_ticks += ticks;
+}
+
+double Profiler::_nsPerTick() {
+    const uint64_t ticks { _ticks() - _start_ticks };
+    const uint64_t ns { monotonic::now() - _start_ns };
+    return ticks == 0 ? 1.0 : double( ns ) / double( ticks );
+}
+
+std::string
+Profiler::_stack( uint32_t node, const std::string_view separator ) {
+    std::vector< std::string_view > names;
+    for ( ; node != 0; node = _nodes[ node ].parent )
+        names.emplace_back( _nodes[ node ].name );
+    names.emplace_back( _nodes[ 0 ].name );
+    std::string stack;
+    for ( auto it { names.rbegin() }; it != names.rend(); ++it ) {
+        if ( !stack.empty() )
+            stack += separator;
+        stack += *it;
+    }
+    return stack;
+}
+
+void Profiler::enable( const std::string_view root_name ) {
+    assert( !_enabled );
+    _nodes.emplace_back();
+    _nodes.front().name = root_name;
+    _start_ns = monotonic::now();
+    _start_ticks = _ticks();
+    _enabled = true;
+}
+
+void Profiler::report( ::FILE* log_fs ) {
+    if ( !_enabled )
+        return;
+    const double ns_per_tick { _nsPerTick() };
+    uint64_t total_self_ticks {};
+    std::vector< uint32_t > order;
+    for ( uint32_t i { 1 }; i < _nodes.size(); ++i ) {
+        order.emplace_back( i );
+        total_self_ticks += _nodes[ i ].ticks - _nodes[ i ].child_ticks;
+    }
+    std::sort( order.begin(), order.end(), []( const uint32_t a, const uint32_t b ) {
+        return ( _nodes[ a ].ticks - _nodes[ a ].child_ticks ) >
+            ( _nodes[ b ].ticks - _nodes[ b ].child_ticks ); } );
+    static constexpr double NS_PER_MS { 1'000'000 };
+    fmt::println( log_fs, "Profile (main loop time by scope, excluding nested "
+                  "scopes):" );
+    fmt::println( log_fs, "{: >6} {: >11} {: >11} {: >10} {: >9}  {}",
+                  "self%", "self(ms)", "total(ms)", "calls", "avg(ns)", "stack" );
+    for ( const uint32_t i : order ) {
+        const _Node& node { _nodes[ i ] };
+        const uint64_t self_ticks { node.ticks - node.child_ticks };
+        fmt::println( log_fs, "{: >6.2f} {: >11.3f} {: >11.3f} {: >10} {: >9.0f}  {}",
+                      total_self_ticks == 0 ? 0.0 :
+                      100.0 * double( self_ticks ) / double( total_self_ticks ),
+                      double( self_ticks ) * ns_per_tick / NS_PER_MS,
+                      double( node.ticks ) * ns_per_tick / NS_PER_MS,
+                      node.calls,
+                      double( node.ticks ) * ns_per_tick / double( node.calls ),
+                      _stack( i, ";" ) );
+    }
+}
+
+std::optional< std::string > Profiler::writeFolded( const char* path ) {
+    assert( path != nullptr );
+    if ( !_enabled )
+        return std::nullopt;
+    ::FILE* fs { ::fopen( path, "w" ) };
+    if ( fs == nullptr )
+        return errors::system::message( "fopen" );
+    const double ns_per_tick { _nsPerTick() };
+    for ( uint32_t i { 1 }; i < _nodes.size(); ++i ) {
+        const _Node& node { _nodes[ i ] };
+        fmt::println( fs, "{} {}", _stack( i, ";" ),
+                      uint64_t( double( node.ticks - node.child_ticks ) *
+                                ns_per_tick ) );
+    }
+    if ( ::fclose( fs ) != 0 )
+        return errors::system::message( "fclose" );
+    return std::nullopt;
+}
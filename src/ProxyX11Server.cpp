@@ -1,10 +1,11 @@
 #include <atomic>              // atomic, atomic_bool, atomic_int
 #include <filesystem>          // filesystem::copy filesystem::remove
 #include <fstream>             // ifstream ofstream
+#include <iterator>            // back_inserter
 #include <optional>            // nullopt
 #include <string>
 #include <string_view>
-#include <utility>             // move
+#include <utility>             // move, pair
 #include <vector>
 
 #include <cassert>
@@ -12,14 +13,17 @@
 #include <cstdint>
 #include <cstdio>              // rename
 #include <cstdlib>             // exit, EXIT_FAILURE, getenv, strtol
-#include <cstring>             // memcpy
+#include <cstring>             // memcpy, strncpy
+#include <ctime>               // timespec
 
 #include <arpa/inet.h>         // ntohs, inet_ntop, htons
 #include <linux/tcp.h>         // TCP_NODELAY
+#include <netdb.h>             // addrinfo, getaddrinfo, freeaddrinfo, gai_strerror
 #include <netinet/in.h>        // sockaddr_in, sockaddr_in6, INET6_ADDRSTRLEN...
-#include <poll.h>              // pollfd, POLLPRI, POLLIN, POLLOUT, poll
-#include <signal.h>            // sigaction, SIGABRT, SIGCHLD
+#include <poll.h>              // pollfd, POLLPRI, POLLIN, POLLOUT, ppoll
+#include <signal.h>            // sigaction, pthread_sigmask, SIGABRT, SIGCHLD...
 #include <sys/socket.h>        // setsockopt, socket, accept, AF_INET, AF_INE...
+#include <sys/stat.h>          // lstat, chmod, S_ISSOCK
 #include <sys/un.h>            // sockaddr_un
 #include <unistd.h>            // close, unlink, _exit, execvp, fork
 
@@ -27,7 +31,10 @@
 
 #include "ProxyX11Server.hpp"
 #include "Connection.hpp"
+#include "Metrics.hpp"
+#include "Profiler.hpp"
 #include "errors.hpp"
+#include "monotonic.hpp"
 
 
 /** @brief Whether child process has closed; made signal handler-accessible. */
@@ -67,6 +74,21 @@ static void handleSIGCHLD( [[maybe_unused]] int sig, ::siginfo_t* info,
     }
 }
 
+/** @brief Whether latency, stats and profile table printing was requested by
+ *    `SIGUSR1`; made signal handler-accessible. */
+static std::atomic_bool reports_requested {};
+static_assert( decltype( reports_requested )::is_always_lock_free );
+
+/**
+ * @brief Signal handler for `SIGUSR1`.
+ * @param sig number of signal intercepted
+ * @see `sigaction(2)` for prototype `sa_handler`
+ */
+static void handleSIGUSR1( [[maybe_unused]] int sig ) {
+    assert( sig == SIGUSR1 );
+    reports_requested.store( true );
+}
+
 /** @brief File path if [_in_display](#ProxyX11Server::_in_display) uses Unix
  *    socket; made signal handler-accessible. */
 static std::atomic<const char*> in_display_sun_path {};
@@ -77,10 +99,16 @@ static std::atomic<const char*> out_display_sun_path {};
 static std::atomic<const char*> xauth_path {};
 /** @brief X auth file backup path; made signal handler-accessible. */
 static std::atomic<const char*> xauth_bup_path {};
+/** @brief File path of `--metrics` unix socket; made signal handler-accessible. */
+static std::atomic<const char*> metrics_sun_path {};
+/** @brief File path of `--control` unix socket; made signal handler-accessible. */
+static std::atomic<const char*> control_sun_path {};
 static_assert( decltype( in_display_sun_path )::is_always_lock_free );
 static_assert( decltype( out_display_sun_path )::is_always_lock_free );
 static_assert( decltype( xauth_path )::is_always_lock_free );
 static_assert( decltype( xauth_bup_path )::is_always_lock_free );
+static_assert( decltype( metrics_sun_path )::is_always_lock_free );
+static_assert( decltype( control_sun_path )::is_always_lock_free );
 
 /**
  * @brief Signal handler for terminating signals `SIGINT`, `SIGTERM`,
@@ -103,6 +131,14 @@ static void handleTerminatingSignal( int sig ) {
          outdisp_sun_path != nullptr ) {
         ::unlink( outdisp_sun_path );
     }
+    if ( const char* metrics_path { metrics_sun_path.load() };
+         metrics_path != nullptr ) {
+        ::unlink( metrics_path );
+    }
+    if ( const char* control_path { control_sun_path.load() };
+         control_path != nullptr ) {
+        ::unlink( control_path );
+    }
     // restore original xauth file
     if ( const char* xauth_path_ { xauth_path.load() },
          * xauth_bup_path_ { xauth_bup_path.load() };
@@ -112,6 +148,26 @@ static void handleTerminatingSignal( int sig ) {
     ::_exit( ProxyX11Server::SIGNAL_RETVAL_OFFSET + sig );
 }
 
+/**
+ * @brief Registers [handleTerminatingSignal](#handleTerminatingSignal) for
+ *   `SIGINT`, `SIGTERM`, `SIGABRT`, and `SIGSEGV`.
+ * @param process_name name of this program for error messages
+ */
+static void registerTerminatingSignalHandler( const char* process_name ) {
+    // `struct` needed to disambiguate from sigaction(2)
+    struct ::sigaction act {};
+    act.sa_handler = &handleTerminatingSignal;
+    if ( ::sigaction( SIGINT, &act, nullptr ) == -1 ||
+         ::sigaction( SIGTERM, &act, nullptr ) == -1 ||
+         ::sigaction( SIGABRT, &act, nullptr ) == -1 ||
+         ::sigaction( SIGSEGV, &act, nullptr ) == -1 ) {
+        fmt::println( ::stderr, "{}: {}: {}",
+                      process_name, __PRETTY_FUNCTION__,
+                      errors::system::message( "sigaction" ) );
+        ::exit( EXIT_FAILURE );
+    }
+}
+
 ProxyX11Server::ProxyX11Server( const int argc, const char* argv[] ) :
     settings( argc, argv ), _parser( settings ) {
     // strict, cheap alternative to singleton pattern
@@ -123,18 +179,45 @@ ProxyX11Server::ProxyX11Server( const int argc, const char* argv[] ) :
     }
     instantiated = true;
 
+    ::pthread_sigmask( SIG_BLOCK, nullptr, &_poll_sigmask );
+    ::sigdelset( &_poll_sigmask, SIGUSR1 );
     _parseDisplayNames();
 
+    if ( settings.log_dir != nullptr )
+        _log_writers.emplace( _LOG_WRITER_THREAD_CT );
     if ( settings.copyauth )
         _copyAuthentication();
     if ( settings.systemtimeformat )
         _fetchCurrentServerTime();
     if ( settings.prefetchatoms )
-        _parser.importFetchedAtoms( _fetchInternedAtoms() );
+        _prefetchAtoms();
+    if ( settings.resolveatoms )
+        _openAtomResolver();
 }
 
 ProxyX11Server::~ProxyX11Server() {
-    ::close( _listener_fd );
+    // restore logs owned by settings and connections
+    if ( _precapture_log_fs != nullptr )
+        _capture( {} );
+    // flush per-connection log files of any connections left open on error
+    for ( const auto& [ id, conn ] : _connections ) {
+        if ( conn.log_fs != settings.log_fs )
+            ::fclose( conn.log_fs );
+    }
+    // with --tunnellisten, listener is owned by tunnel
+    if ( settings.tunnel_listen == nullptr )
+        ::close( _listener_fd );
+    _tunnel.stop();
+    if ( _metrics_fd != _UNINIT_FD ) {
+        ::close( _metrics_fd );
+        std::filesystem::remove( settings.metrics_path );
+    }
+    for ( const auto& [ fd, input ] : _control_clients )
+        ::close( fd );
+    if ( _control_fd != _UNINIT_FD ) {
+        ::close( _control_fd );
+        std::filesystem::remove( settings.control_path );
+    }
     // delete unix sockets
     if ( _in_display.ai_family == AF_UNIX )
         std::filesystem::remove( _in_display.unaddr.sun_path );
@@ -146,12 +229,269 @@ ProxyX11Server::~ProxyX11Server() {
 }
 
 int ProxyX11Server::run() {
+    if ( settings.profile_path != nullptr )
+        Profiler::enable( "xtracepp" );
+    _openTunnel();
     _listenForClients();
+    _listenForMetrics();
+    _listenForControl();
     _startSubcommandClient();
-    return _processClientQueue();
+    if ( settings.latency || settings.stats || settings.profile_path != nullptr ) {
+        // `struct` needed to disambiguate from sigaction(2)
+        struct ::sigaction act {};
+        // only delivered during ppoll(2) in main thread, which is not
+        //   restarted after handlers regardless of SA_RESTART
+        act.sa_handler = &handleSIGUSR1;
+        if ( ::sigaction( SIGUSR1, &act, nullptr ) == -1 ) {
+            fmt::println( ::stderr, "{}: {}: {}",
+                          settings.process_name, __PRETTY_FUNCTION__,
+                          errors::system::message( "sigaction" ) );
+            ::exit( EXIT_FAILURE );
+        }
+    }
+    const int retval { _processClientQueue() };
+    _parser.flushHeldLines( true );
+    _parser.logLatencies();
+    // connections may be left open when main loop exits on error
+    _parser.logTotalStats( _connections );
+    _logProfile();
+    return retval;
+}
+
+void ProxyX11Server::_logProfile() {
+    if ( settings.profile_path == nullptr )
+        return;
+    Profiler::report( settings.log_fs );
+    if ( const auto error { Profiler::writeFolded( settings.profile_path ) };
+         error ) {
+        fmt::println( ::stderr, "{}: could not write --profile stacks {:?}: {}",
+                      settings.process_name, settings.profile_path, *error );
+    }
+}
+
+int ProxyX11Server::_listenOnUnixSocket( const char* path ) {
+    assert( path != nullptr );
+    const int fd { ::socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 ) };
+    if ( fd < 0 )  {
+        fmt::println( ::stderr, "{}: {}: {}",
+                      settings.process_name, __PRETTY_FUNCTION__,
+                      errors::system::message( "socket" ) );
+        ::exit( EXIT_FAILURE );
+    }
+    ::sockaddr_un addr {};
+    addr.sun_family = AF_UNIX;
+    assert( std::string_view( path ).size() < sizeof( addr.sun_path ) );
+    ::strncpy( addr.sun_path, path, sizeof( addr.sun_path ) - 1 );
+    // as with PROXYDISPLAY, socket may remain from SIGKILL termination, but
+    //   never remove anything else found at path
+    struct ::stat path_stat {};
+    if ( ::lstat( path, &path_stat ) == 0 ) {
+        if ( !S_ISSOCK( path_stat.st_mode ) ) {
+            ::close( fd );
+            fmt::println( ::stderr, "{}: {}: {:?} exists and is not a socket",
+                          settings.process_name, __PRETTY_FUNCTION__, path );
+            ::exit( EXIT_FAILURE );
+        }
+        if ( ::unlink( path ) != 0 ) {
+            ::close( fd );
+            fmt::println( ::stderr, "{}: {}: {}",
+                          settings.process_name, __PRETTY_FUNCTION__,
+                          errors::system::message( "unlink" ) );
+            ::exit( EXIT_FAILURE );
+        }
+    } else if ( errno != ENOENT ) {
+        ::close( fd );
+        fmt::println( ::stderr, "{}: {}: {}",
+                      settings.process_name, __PRETTY_FUNCTION__,
+                      errors::system::message( "lstat" ) );
+        ::exit( EXIT_FAILURE );
+    }
+    if ( ::bind( fd, reinterpret_cast< ::sockaddr* >( &addr ),
+                 sizeof( addr ) ) != 0 ) {
+        ::close( fd );
+        fmt::println( ::stderr, "{}: {}: {}",
+                      settings.process_name, __PRETTY_FUNCTION__,
+                      errors::system::message( "bind" ) );
+        ::exit( EXIT_FAILURE );
+    }
+    // owner only, regardless of umask; no client can connect before listen(2)
+    if ( ::chmod( path, S_IRUSR | S_IWUSR ) != 0 ) {
+        ::close( fd );
+        std::filesystem::remove( path );
+        fmt::println( ::stderr, "{}: {}: {}",
+                      settings.process_name, __PRETTY_FUNCTION__,
+                      errors::system::message( "chmod" ) );
+        ::exit( EXIT_FAILURE );
+    }
+    if ( ::listen( fd, _MAX_PENDING_CONNECTIONS ) != 0 ) {
+        ::close( fd );
+        std::filesystem::remove( path );
+        fmt::println( ::stderr, "{}: {}: {}",
+                      settings.process_name, __PRETTY_FUNCTION__,
+                      errors::system::message( "listen" ) );
+        ::exit( EXIT_FAILURE );
+    }
+    return fd;
+}
+
+void ProxyX11Server::_listenForMetrics() {
+    if ( settings.metrics_path == nullptr )
+        return;
+    _metrics_fd = _listenOnUnixSocket( settings.metrics_path );
+    metrics_sun_path.store( settings.metrics_path );
+    registerTerminatingSignalHandler( settings.process_name );
+}
+
+void ProxyX11Server::_listenForControl() {
+    if ( settings.control_path == nullptr )
+        return;
+    _control_fd = _listenOnUnixSocket( settings.control_path );
+    control_sun_path.store( settings.control_path );
+    registerTerminatingSignalHandler( settings.process_name );
+}
+
+std::string ProxyX11Server::_formatMetrics() {
+    const Metrics::SnapshotT counters { Metrics::snapshot() };
+    std::string out;
+    auto it { std::back_inserter( out ) };
+    fmt::format_to( it, "# HELP xtracepp_connections Open client connections.\n"
+                    "# TYPE xtracepp_connections gauge\n"
+                    "xtracepp_connections {}\n", _connections.size() );
+    fmt::format_to( it, "# HELP xtracepp_bytes_total Bytes read from sockets.\n"
+                    "# TYPE xtracepp_bytes_total counter\n"
+                    "xtracepp_bytes_total{{direction=\"client_to_server\"}} {}\n"
+                    "xtracepp_bytes_total{{direction=\"server_to_client\"}} {}\n",
+                    counters[ Metrics::BYTES_CLIENT_TO_SERVER ],
+                    counters[ Metrics::BYTES_SERVER_TO_CLIENT ] );
+    fmt::format_to( it, "# HELP xtracepp_messages_total Messages parsed.\n"
+                    "# TYPE xtracepp_messages_total counter\n"
+                    "xtracepp_messages_total{{direction=\"client_to_server\"}} {}\n"
+                    "xtracepp_messages_total{{direction=\"server_to_client\"}} {}\n",
+                    counters[ Metrics::MESSAGES_CLIENT_TO_SERVER ],
+                    counters[ Metrics::MESSAGES_SERVER_TO_CLIENT ] );
+    fmt::format_to( it, "# HELP xtracepp_parse_errors_total Connections closed "
+                    "due to parsing errors.\n"
+                    "# TYPE xtracepp_parse_errors_total counter\n"
+                    "xtracepp_parse_errors_total {}\n",
+                    counters[ Metrics::PARSE_ERRORS ] );
+    fmt::format_to( it, "# HELP xtracepp_backpressure_stalls_total Times "
+                    "buffered messages began waiting to be forwarded to a full "
+                    "socket.\n"
+                    "# TYPE xtracepp_backpressure_stalls_total counter\n"
+                    "xtracepp_backpressure_stalls_total {}\n",
+                    counters[ Metrics::BACKPRESSURE_STALLS ] );
+    fmt::format_to( it, "# HELP xtracepp_reply_cache_total Cacheable requests "
+                    "answered by proxy or forwarded, with --replycache.\n"
+                    "# TYPE xtracepp_reply_cache_total counter\n"
+                    "xtracepp_reply_cache_total{{result=\"hit\"}} {}\n"
+                    "xtracepp_reply_cache_total{{result=\"miss\"}} {}\n",
+                    counters[ Metrics::REPLY_CACHE_HITS ],
+                    counters[ Metrics::REPLY_CACHE_MISSES ] );
+    fmt::format_to( it, "# HELP xtracepp_buffered_bytes Bytes held in "
+                    "connection buffers.\n"
+                    "# TYPE xtracepp_buffered_bytes gauge\n" );
+    for ( auto& [ id, conn ] : _connections ) {
+        fmt::format_to( it, "xtracepp_buffered_bytes{{conn=\"{}\",direction="
+                        "\"client_to_server\"}} {}\n"
+                        "xtracepp_buffered_bytes{{conn=\"{}\",direction="
+                        "\"server_to_client\"}} {}\n",
+                        id, conn.client_buffer.size(),
+                        id, conn.server_buffer.size() );
+    }
+    fmt::format_to( it, "# HELP xtracepp_log_queue_bytes Log bytes queued for "
+                    "writer threads but not yet written.\n"
+                    "# TYPE xtracepp_log_queue_bytes gauge\n"
+                    "xtracepp_log_queue_bytes{{sink=\"outdir\"}} {}\n"
+                    "xtracepp_log_queue_bytes{{sink=\"compress\"}} {}\n",
+                    counters[ Metrics::LOG_WRITER_BYTES_QUEUED ] -
+                    counters[ Metrics::LOG_WRITER_BYTES_WRITTEN ],
+                    counters[ Metrics::GZIP_BYTES_QUEUED ] -
+                    counters[ Metrics::GZIP_BYTES_COMPRESSED ] );
+    fmt::format_to( it, "# HELP xtracepp_log_writer_stalls_total Times log "
+                    "output waited for a full writer thread queue.\n"
+                    "# TYPE xtracepp_log_writer_stalls_total counter\n"
+                    "xtracepp_log_writer_stalls_total {}\n",
+                    counters[ Metrics::LOG_WRITER_STALLS ] );
+    fmt::format_to( it, "# HELP xtracepp_tunnel_bytes_total Bytes carried by "
+                    "tunnel: read from proxied connections, framed after delta "
+                    "encoding, and sent on link after compression.\n"
+                    "# TYPE xtracepp_tunnel_bytes_total counter\n"
+                    "xtracepp_tunnel_bytes_total{{stage=\"channel\"}} {}\n"
+                    "xtracepp_tunnel_bytes_total{{stage=\"frame\"}} {}\n"
+                    "xtracepp_tunnel_bytes_total{{stage=\"link\"}} {}\n",
+                    counters[ Metrics::TUNNEL_CHANNEL_BYTES ],
+                    counters[ Metrics::TUNNEL_FRAME_BYTES ],
+                    counters[ Metrics::TUNNEL_LINK_BYTES ] );
+    fmt::format_to( it, "# HELP xtracepp_image_cache_total Tunneled images "
+                    "sent as reference to image already sent, or in full, with "
+                    "--imagecache.\n"
+                    "# TYPE xtracepp_image_cache_total counter\n"
+                    "xtracepp_image_cache_total{{result=\"hit\"}} {}\n"
+                    "xtracepp_image_cache_total{{result=\"miss\"}} {}\n"
+                    "# HELP xtracepp_image_cache_saved_bytes_total Image bytes "
+                    "not sent on tunnel due to --imagecache hits.\n"
+                    "# TYPE xtracepp_image_cache_saved_bytes_total counter\n"
+                    "xtracepp_image_cache_saved_bytes_total {}\n",
+                    counters[ Metrics::IMAGE_CACHE_HITS ],
+                    counters[ Metrics::IMAGE_CACHE_MISSES ],
+                    counters[ Metrics::IMAGE_CACHE_BYTES_SAVED ] );
+    fmt::format_to( it, "# HELP xtracepp_motion_events_total MotionNotify "
+                    "events forwarded to clients, or dropped as superseded "
+                    "with --motioncompress.\n"
+                    "# TYPE xtracepp_motion_events_total counter\n"
+                    "xtracepp_motion_events_total{{result=\"forwarded\"}} {}\n"
+                    "xtracepp_motion_events_total{{result=\"dropped\"}} {}\n",
+                    counters[ Metrics::MOTION_EVENTS ] -
+                    counters[ Metrics::MOTION_EVENTS_DROPPED ],
+                    counters[ Metrics::MOTION_EVENTS_DROPPED ] );
+    _parser.formatLatencyMetrics( &out );
+    return out;
+}
+
+void ProxyX11Server::_serveMetrics() {
+    const int fd { ::accept4( _metrics_fd, nullptr, nullptr, SOCK_CLOEXEC ) };
+    if ( fd < 0 ) {
+        fmt::println( ::stderr, "{}: {}: {}",
+                      settings.process_name, __PRETTY_FUNCTION__,
+                      errors::system::message( "accept4" ) );
+        return;
+    }
+    const std::string metrics { _formatMetrics() };
+    // never wait on scraper: snapshot is truncated if it does not fit in
+    //   socket send buffer
+    for ( size_t sent {}; sent < metrics.size(); ) {
+        const ::ssize_t ret { ::send( fd, metrics.data() + sent,
+                                      metrics.size() - sent,
+                                      MSG_DONTWAIT | MSG_NOSIGNAL ) };
+        if ( ret == -1 ) {
+            if ( errno == EINTR )
+                continue;
+            fmt::println( ::stderr, "{}: {}: {}",
+                          settings.process_name, __PRETTY_FUNCTION__,
+                          errors::system::message( "send" ) );
+            break;
+        }
+        sent += size_t( ret );
+    }
+    ::close( fd );
 }
 
 void ProxyX11Server::_parseDisplayNames() {
+    // with --tunnelconnect, X server is only reached by tunnel peer
+    if ( settings.tunnel_connect == nullptr )
+        _parseOutDisplayName();
+    // with --tunnellisten, clients are only accepted from tunnel peer
+    if ( settings.tunnel_listen == nullptr )
+        _parseInDisplayName();
+    // register handler so that any unix socket files created are deleted on
+    //   signal interrupt, not just on normal exit
+    if ( out_display_sun_path.load() != nullptr ||
+         in_display_sun_path.load() != nullptr ) {
+        registerTerminatingSignalHandler( settings.process_name );
+    }
+}
+
+void ProxyX11Server::_parseOutDisplayName() {
     const char* out_displayname { nullptr };
     if ( settings.out_displayname != nullptr ) {
         out_displayname = settings.out_displayname;
@@ -164,6 +504,9 @@ void ProxyX11Server::_parseDisplayNames() {
     if ( _out_display.ai_family == AF_UNIX ) {
         out_display_sun_path.store( _out_display.unaddr.sun_path );
     }
+}
+
+void ProxyX11Server::_parseInDisplayName() {
     const char* in_displayname { nullptr };
     if( settings.in_displayname != nullptr ) {
         in_displayname = settings.in_displayname;
@@ -182,23 +525,6 @@ void ProxyX11Server::_parseDisplayNames() {
     if ( _in_display.ai_family == AF_UNIX ) {
         in_display_sun_path.store( _in_display.unaddr.sun_path );
     }
-    // register handler so that any unix socket files created are deleted on
-    //   signal interrupt, not just on normal exit
-    if ( out_display_sun_path.load() != nullptr ||
-         in_display_sun_path.load() != nullptr ) {
-        // `struct` needed to disambiguate from sigaction(2)
-        struct ::sigaction act {};
-        act.sa_handler = &handleTerminatingSignal;
-        if ( ::sigaction( SIGINT, &act, nullptr ) == -1 ||
-             ::sigaction( SIGTERM, &act, nullptr ) == -1 ||
-             ::sigaction( SIGABRT, &act, nullptr ) == -1 ||
-             ::sigaction( SIGSEGV, &act, nullptr ) == -1 ) {
-            fmt::println( ::stderr, "{}: {}: {}",
-                          settings.process_name, __PRETTY_FUNCTION__,
-                          errors::system::message( "sigaction" ) );
-            ::exit( EXIT_FAILURE );
-        }
-    }
 }
 
 /**
@@ -471,6 +797,8 @@ void ProxyX11Server::_startSubcommandClient() {
     _child_pid = ::fork();
     switch ( _child_pid ) {
     case 0:  // fork succeeded, now in child
+        // signal mask survives execvp(3)
+        ::pthread_sigmask( SIG_SETMASK, &_poll_sigmask, nullptr );
         if ( ::setenv( _OUT_DISPLAYNAME_ENV_VAR.data(),
                        _in_display.name.data(), 1 ) != 0 ) {
         fmt::println( ::stderr, "{}: {}: {}",
@@ -527,17 +855,25 @@ void ProxyX11Server::_updatePollFlags() {
         server_pfd.events = POLLPRI;
         if ( conn.client_buffer.readReady() ) {
             client_pfd.events |= POLLIN;
-        } else {
-            assert( conn.client_buffer.writeReady() );
+        } else if ( conn.client_buffer.writeReady() ) {
             server_pfd.events |= POLLOUT;
+        } else {
+            // awaiting release by --netem timer
+            assert( conn.client_buffer.held() );
         }
         if ( conn.server_buffer.readReady() ) {
             server_pfd.events |= POLLIN;
-        } else {
-            assert( conn.server_buffer.writeReady() );
+        } else if ( conn.server_buffer.writeReady() ) {
             client_pfd.events |= POLLOUT;
+        } else {
+            // awaiting release by --netem timer
+            assert( conn.server_buffer.held() );
         }
     }
+    if ( _atom_resolver.isOpen() ) {
+        _pfds.at( _pfds_i_by_fd.at( _atom_resolver.fd() ) ).events =
+            POLLIN | ( _atom_resolver.writeReady() ? POLLOUT : _POLLNONE );
+    }
 }
 
 void ProxyX11Server::_processPolledSockets() {
@@ -545,6 +881,21 @@ void ProxyX11Server::_processPolledSockets() {
     for ( auto& [ id, conn ] : _connections ) {
         assert( conn.clientSideOpen() );
         assert( conn.serverSideOpen() );
+        // reading is paused while complete messages wait for full peer socket,
+        //   see _updatePollFlags; each such wait is counted once as it begins
+        const auto count_stall {
+            [this]( SocketBuffer& buffer, const int peer_fd,
+                    bool* stalled ) {
+                const bool was_stalled { *stalled };
+                *stalled = !buffer.readReady() && buffer.writeReady() &&
+                    !_socketWriteReady( peer_fd );
+                if ( *stalled && !was_stalled )
+                    Metrics::add( Metrics::BACKPRESSURE_STALLS );
+            } };
+        count_stall( conn.client_buffer, conn.server_fd,
+                     &conn.client_buffer_stalled );
+        count_stall( conn.server_buffer, conn.client_fd,
+                     &conn.server_buffer_stalled );
         if ( _socketReadReady( conn.client_fd ) ) {
             const auto& [ bytes_read, read_error ] {
                 conn.client_buffer.read( conn.client_fd ) };  // bufferFromClient();
@@ -556,21 +907,27 @@ void ProxyX11Server::_processPolledSockets() {
             }
             if ( bytes_read == 0 ) {
                 if ( settings.readwritedebug ) {
-                    fmt::println( settings.log_fs,
-                                  "C{:03d}:{}: got EOF, closing connection",
-                                  conn.id, _parser.CLIENT_TO_SERVER );
+                    _parser.println( conn.log_fs,
+                                     "C{:03d}:{}: got EOF, closing connection",
+                                     conn.id, _parser.CLIENT_TO_SERVER );
                 }
                 goto close_connection;
             }
             assert( !conn.client_buffer.empty() );
+            Metrics::add( Metrics::BYTES_CLIENT_TO_SERVER, bytes_read );
+            if ( conn.record_fs != nullptr ) {
+                _recordTraffic( &conn, TrafficRecording::CLIENT_TO_SERVER,
+                                conn.client_buffer, bytes_read );
+            }
             if ( settings.readwritedebug ) {
-                fmt::println( settings.log_fs,
-                              "C{:03d}:{:04d}B:{}: read from client into buffer",
-                              conn.id, bytes_read, _parser.CLIENT_TO_SERVER );
+                _parser.println( conn.log_fs,
+                                 "C{:03d}:{:04d}B:{}: read from client into buffer",
+                                 conn.id, bytes_read, _parser.CLIENT_TO_SERVER );
             }
             const auto& [ bytes_parsed, parse_error ] {
                 _parser.logClientMessages( &conn ) };
             if ( parse_error ) {
+                Metrics::add( Metrics::PARSE_ERRORS );
                 fmt::println( ::stderr, "C{:03d}:{}: error parsing client "
                               "messages: {}, closing connection",
                               conn.id, _parser.CLIENT_TO_SERVER, *parse_error );
@@ -579,8 +936,11 @@ void ProxyX11Server::_processPolledSockets() {
                 //   should force EOF and thus exit for any client X app
                 goto close_connection;
             }
+            // client messages may also insert replies into server_buffer
+            _holdParsed( &conn );
         } else if ( _socketWriteReady( conn.client_fd ) &&
                     conn.server_buffer.writeReady() ) {
+            const uint64_t held_since { conn.server_buffer.heldSince() };
             const auto& [ bytes_written, write_error ] {
                 conn.server_buffer.write( conn.client_fd ) }; // forwardToClient();
             if ( write_error ) {
@@ -591,10 +951,14 @@ void ProxyX11Server::_processPolledSockets() {
             }
             assert( bytes_written > 0 );
             if ( settings.readwritedebug ) {
-                fmt::println( settings.log_fs,
-                              "C{:03d}:{:04d}B:{}: wrote from buffer to client",
-                              conn.id, bytes_written, _parser.SERVER_TO_CLIENT );
+                _parser.println( conn.log_fs,
+                                 "C{:03d}:{:04d}B:{}: wrote from buffer to client "
+                                 "(oldest held {}us)",
+                                 conn.id, bytes_written, _parser.SERVER_TO_CLIENT,
+                                 ( conn.server_buffer.writeTime() -
+                                   held_since ) / 1000 );
             }
+            _parser.logForwarded( &conn, &conn.server_buffer );
         } else if ( const auto poll_error { _socketPollError( conn.client_fd ) };
                     poll_error ) {
             fmt::println( ::stderr, "C{:03d}: client socket poll error: {}, "
@@ -613,28 +977,38 @@ void ProxyX11Server::_processPolledSockets() {
             }
             if ( bytes_read == 0 ) {
                 if ( settings.readwritedebug ) {
-                    fmt::println( settings.log_fs,
-                                  "C{:03d}:{}: got EOF, closing connection",
-                                  conn.id, _parser.SERVER_TO_CLIENT );
+                    _parser.println( conn.log_fs,
+                                     "C{:03d}:{}: got EOF, closing connection",
+                                     conn.id, _parser.SERVER_TO_CLIENT );
                 }
                 goto close_connection;
             }
             assert( !conn.server_buffer.empty() );
+            Metrics::add( Metrics::BYTES_SERVER_TO_CLIENT, bytes_read );
+            // only server connection setup reply is recorded, for its
+            //   resource-id-base and resource-id-mask
+            if ( conn.record_fs != nullptr && conn.status != Connection::OPEN ) {
+                _recordTraffic( &conn, TrafficRecording::SERVER_TO_CLIENT,
+                                conn.server_buffer, bytes_read );
+            }
             if ( settings.readwritedebug ) {
-                fmt::println( settings.log_fs,
-                              "C{:03d}:{:04d}B:{}: read from server into buffer",
-                              conn.id, bytes_read, _parser.SERVER_TO_CLIENT );
+                _parser.println( conn.log_fs,
+                                 "C{:03d}:{:04d}B:{}: read from server into buffer",
+                                 conn.id, bytes_read, _parser.SERVER_TO_CLIENT );
             }
             const auto& [ bytes_parsed, parse_error ] {
                 _parser.logServerMessages( &conn ) };
             if ( parse_error ) {
+                Metrics::add( Metrics::PARSE_ERRORS );
                 fmt::println( ::stderr, "C{:03d}:{}: error parsing server "
                               "messages: {}, closing connection",
                               conn.id, _parser.SERVER_TO_CLIENT, *parse_error );
                 goto close_connection;
             }
+            _holdParsed( &conn );
         } else if ( _socketWriteReady( conn.server_fd ) &&
                     conn.client_buffer.writeReady() ) {
+            const uint64_t held_since { conn.client_buffer.heldSince() };
             const auto& [ bytes_written, write_error ] {
                 conn.client_buffer.write( conn.server_fd ) }; // forwardToServer();
             if ( write_error ) {
@@ -645,10 +1019,14 @@ void ProxyX11Server::_processPolledSockets() {
             }
             assert( bytes_written > 0 );
             if ( settings.readwritedebug ) {
-                fmt::println( settings.log_fs,
-                              "C{:03d}:{:04d}B:{}: wrote from buffer to server",
-                              conn.id, bytes_written, _parser.CLIENT_TO_SERVER );
+                _parser.println( conn.log_fs,
+                                 "C{:03d}:{:04d}B:{}: wrote from buffer to server "
+                                 "(oldest held {}us)",
+                                 conn.id, bytes_written, _parser.CLIENT_TO_SERVER,
+                                 ( conn.client_buffer.writeTime() -
+                                   held_since ) / 1000 );
             }
+            _parser.logForwarded( &conn, &conn.client_buffer );
         } else if ( const auto poll_error { _socketPollError( conn.server_fd ) };
                     poll_error ) {
             fmt::println( ::stderr, "C{:03d}: server socket poll error: {}, "
@@ -668,9 +1046,153 @@ void ProxyX11Server::_processPolledSockets() {
         fmt::println( ::stderr, "{}: {}: listening socket poll error: {}",
                       settings.process_name, __PRETTY_FUNCTION__, *error );
     }
+    if ( _metrics_fd != _UNINIT_FD && _socketReadReady( _metrics_fd ) )
+        _serveMetrics();
+    if ( _control_fd != _UNINIT_FD )
+        _processControlSockets();
+    _processAtomResolver();
+}
+
+void ProxyX11Server::_holdParsed( Connection* conn ) {
+    assert( conn != nullptr );
+    const uint64_t now_ns { monotonic::now() };
+    for ( const auto& [ buffer, link ] : {
+            std::pair{ &conn->client_buffer, &conn->client_netem },
+            std::pair{ &conn->server_buffer, &conn->server_netem } } ) {
+        // once holding, buffer only writes released bytes, even if link
+        //   has since been disabled by control command
+        if ( buffer->unheld() == 0 || ( !link->enabled() && !buffer->holding() ) )
+            continue;
+        const uint64_t release_ns {
+            link->releaseTime( now_ns, buffer->unheld() ) };
+        buffer->holdParsed( release_ns );
+        buffer->release( now_ns );
+        if ( buffer->held() )
+            _netem_timers.schedule( release_ns, conn->id );
+    }
+}
+
+void ProxyX11Server::_releaseHeld() {
+    const uint64_t now_ns { monotonic::now() };
+    _netem_timers.expire( now_ns, [ this, now_ns ]( const uint32_t id ) {
+        // connection may have closed since scheduling
+        const auto conn_it { _connections.find( int( id ) ) };
+        if ( conn_it == _connections.end() )
+            return;
+        conn_it->second.client_buffer.release( now_ns );
+        conn_it->second.server_buffer.release( now_ns );
+    } );
+}
+
+void ProxyX11Server::_recordTraffic(
+    Connection* conn, const TrafficRecording::Direction direction,
+    SocketBuffer& buffer, const size_t bytes_read ) {
+    assert( conn != nullptr );
+    assert( conn->record_fs != nullptr );
+    assert( bytes_read > 0 && bytes_read <= buffer.size() );
+    // bytes just read are last in buffer
+    const auto error { TrafficRecording::append(
+            conn->record_fs, direction, buffer.readTime() - conn->start_ns,
+            buffer.data() + buffer.size() - bytes_read, bytes_read ) };
+    if ( !error )
+        return;
+    fmt::println( ::stderr, "C{:03d}: error writing recording: {}, "
+                  "recording stopped", conn->id, *error );
+    TrafficRecording::close( conn->record_fs );
+    conn->record_fs = nullptr;
+}
+
+void ProxyX11Server::_openTunnel() {
+    const bool connect { settings.tunnel_connect != nullptr };
+    if ( !connect && settings.tunnel_listen == nullptr )
+        return;
+    // split [<host>:]<port> at last colon, allowing IPv6 hosts in brackets
+    const std::string_view arg {
+        connect ? settings.tunnel_connect : settings.tunnel_listen };
+    const size_t colon_i { arg.rfind( ':' ) };
+    std::string host;
+    std::string port { arg };
+    if ( colon_i != std::string_view::npos ) {
+        host = arg.substr( 0, colon_i );
+        port = arg.substr( colon_i + 1 );
+        if ( host.size() >= 2 && host.front() == '[' && host.back() == ']' )
+            host = host.substr( 1, host.size() - 2 );
+    }
+    if ( port.empty() || ( connect && host.empty() ) ) {
+        fmt::println( ::stderr, "{}: invalid --tunnel{} address {:?}, expected "
+                      "{}<port>", settings.process_name,
+                      connect ? "connect" : "listen", arg,
+                      connect ? "<host>:" : "[<host>:]" );
+        ::exit( EXIT_FAILURE );
+    }
+    ::addrinfo hints {};
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    // without AI_PASSIVE, listening with no host binds only loopback: the
+    //   link is unauthenticated, and its connections reach the X server as
+    //   this user
+    ::addrinfo* res {};
+    if ( const int gai_ret { ::getaddrinfo( host.empty() ? nullptr : host.c_str(),
+                                            port.c_str(), &hints, &res ) };
+         gai_ret != 0 ) {
+        fmt::println( ::stderr, "{}: could not resolve tunnel address {:?}: {}",
+                      settings.process_name, arg, ::gai_strerror( gai_ret ) );
+        ::exit( EXIT_FAILURE );
+    }
+    int fd { _UNINIT_FD };
+    std::string error;
+    for ( const ::addrinfo* ai { res }; ai != nullptr; ai = ai->ai_next ) {
+        fd = ::socket( ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC,
+                       ai->ai_protocol );
+        if ( fd < 0 ) {
+            error = errors::system::message( "socket" );
+            continue;
+        }
+        // see _connectToServer and _listenForClients
+        const int on { 1 };
+        if ( connect ) {
+            if ( ::setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on) ) == 0 &&
+                 ::setsockopt( fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on) ) == 0 &&
+                 ::connect( fd, ai->ai_addr, ai->ai_addrlen ) == 0 ) {
+                break;
+            }
+            error = errors::system::message( "connect" );
+        } else {
+            if ( ::setsockopt( fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on) ) == 0 &&
+                 ::bind( fd, ai->ai_addr, ai->ai_addrlen ) == 0 &&
+                 ::listen( fd, 1 ) == 0 ) {
+                break;
+            }
+            error = errors::system::message( "bind" );
+        }
+        ::close( fd );
+        fd = _UNINIT_FD;
+    }
+    ::freeaddrinfo( res );
+    if ( fd == _UNINIT_FD ) {
+        fmt::println( ::stderr, "{}: could not {} tunnel address {:?}: {}",
+                      settings.process_name, connect ? "connect to" : "listen on",
+                      arg, error );
+        ::exit( EXIT_FAILURE );
+    }
+    if ( const auto start_error { _tunnel.start(
+             connect ? Tunnel::Role::CONNECT : Tunnel::Role::LISTEN, fd,
+             settings.image_cache_sz ) };
+         start_error ) {
+        fmt::println( ::stderr, "{}: could not start tunnel: {}",
+                      settings.process_name, *start_error );
+        ::exit( EXIT_FAILURE );
+    }
+    fmt::println( ::stderr, "{} tunnel peer at {:?}",
+                  connect ? "Connected to" : "Listening for", arg );
 }
 
 void ProxyX11Server::_listenForClients() {
+    // channels opened by tunnel peer stand in for accepted clients
+    if ( settings.tunnel_listen != nullptr ) {
+        _listener_fd = _tunnel.acceptFd();
+        return;
+    }
     const int fd { ::socket(
             _in_display.ai_family, _in_display.ai_socktype,
             _in_display.ai_protocol ) };
@@ -733,6 +1255,14 @@ void ProxyX11Server::_listenForClients() {
 
 bool ProxyX11Server::_acceptClient( Connection* conn ) {
     assert( conn != nullptr );
+    if ( settings.tunnel_listen != nullptr ) {
+        const auto channel { _tunnel.acceptChannel() };
+        if ( !channel )
+            return false;
+        conn->client_fd   = channel->second;
+        conn->client_desc = fmt::format( "tunnel channel {}", channel->first );
+        return true;
+    }
     std::string client_desc;
     union {
         ::sockaddr     addr;
@@ -856,7 +1386,19 @@ void ProxyX11Server::_openConnection() {
     assert( conn.client_fd > _listener_fd );
     assert( !conn.client_desc.empty() );
     fmt::println( ::stderr, "Connected to client: {}", conn.client_desc );
-    conn.server_fd = _connectToServer();
+    if ( settings.tunnel_connect != nullptr ) {
+        conn.server_fd = _tunnel.openChannel();
+        if ( conn.server_fd == -1 ) {
+            fmt::println( ::stderr, "{}: {}: tunnel to {:?} is closed, could "
+                          "not connect client to X server",
+                          settings.process_name, __PRETTY_FUNCTION__,
+                          settings.tunnel_connect );
+            conn.closeClientSide();
+            return;
+        }
+    } else {
+        conn.server_fd = _connectToServer();
+    }
     if ( conn.server_fd == -1 ) {
         fmt::println( ::stderr, "{}: {}: failure to connect to X server for display: {:?}",
                       settings.process_name, __PRETTY_FUNCTION__,
@@ -865,33 +1407,105 @@ void ProxyX11Server::_openConnection() {
         return;
     }
     assert( conn.server_fd > _listener_fd );
+    conn.log_fs = settings.log_fs;
+    conn.logging = settings.logging;
+    if ( _log_writers ) {
+        const std::string log_path {
+            fmt::format( "{}/C{:03d}.log", settings.log_dir, conn.id ) };
+        conn.log_fs = _log_writers->open( log_path, settings.unbuffered );
+        if ( conn.log_fs == nullptr ) {
+            fmt::println( ::stderr, "{}: {}: could not open log file {:?}, {}",
+                          settings.process_name, __PRETTY_FUNCTION__, log_path,
+                          errors::system::message( "open" ) );
+            conn.closeClientSide();
+            conn.closeServerSide();
+            return;
+        }
+        if ( _precapture_log_fs != nullptr ) {
+            conn.precapture_log_fs = conn.log_fs;
+            conn.log_fs = settings.log_fs;
+        }
+        _parser.println( conn.log_fs, "C{:03d}: Connected to client: {}",
+                         conn.id, conn.client_desc );
+    }
+    if ( settings.record_dir != nullptr ) {
+        const std::string record_path {
+            fmt::format( "{}/C{:03d}.xrec", settings.record_dir, conn.id ) };
+        conn.record_fs = TrafficRecording::open( record_path, conn.start_time );
+        // recording is secondary to proxying, so client is still served
+        if ( conn.record_fs == nullptr ) {
+            fmt::println( ::stderr, "{}: {}: could not open recording file {:?}, "
+                          "{}; not recording connection {}",
+                          settings.process_name, __PRETTY_FUNCTION__,
+                          record_path, errors::system::message( "open" ),
+                          conn.id );
+        }
+    }
+    conn.log_filter = settings.filter.compile( conn.id );
+    conn.log_limiter = settings.ratelimiter.compile( conn.id );
+    conn.client_netem = settings.netem.compile( conn.id, true );
+    conn.server_netem = settings.netem.compile( conn.id, false );
 
-    _connections.emplace( conn.id, conn );
     _addSocketToPoll( conn.client_fd );
     _addSocketToPoll( conn.server_fd );
+    _connections.emplace( conn.id, std::move( conn ) );
 }
 
 void ProxyX11Server::_closeConnections( const std::vector< int >& ids ) {
+    // held lines may be bound for log files about to be closed
+    if ( !ids.empty() )
+        _parser.flushHeldLines( true );
     for ( const int id : ids ) {
         Connection& conn { _connections.at( id ) };
+        for ( const std::string& line : conn.log_limiter.summary( conn.id, true ) )
+            _parser.println( conn.log_fs, "{}", line );
+        _parser.logStalls( &conn );
+        _parser.logStats( &conn );
+        _parser.mergeStats( &conn );
+        _parser.closeReplyCache( &conn, _connections.size() == 1 );
+        if ( conn.motion_events_dropped > 0 ) {
+            _parser.println( conn.log_fs, "C{:03d}: dropped {} of {} "
+                             "MotionNotify events as superseded", conn.id,
+                             conn.motion_events_dropped, conn.motion_events );
+        }
         if ( !conn.client_buffer.empty() ) {
-            fmt::println(
-                settings.log_fs,
+            _parser.println(
+                conn.log_fs,
                 "C{:03d}:{:04d}B:{}: discarded unsent buffer",
                 conn.id, conn.client_buffer.size(), _parser.CLIENT_TO_SERVER );
         }
         if ( !conn.server_buffer.empty() ) {
-            fmt::println(
-                settings.log_fs,
+            _parser.println(
+                conn.log_fs,
                 "C{:03d}:{:04d}B:{}: discarded unsent buffer",
                 conn.id, conn.server_buffer.size(), _parser.SERVER_TO_CLIENT );
         }
+        if ( conn.record_fs != nullptr ) {
+            if ( const auto error { TrafficRecording::close( conn.record_fs ) };
+                 error ) {
+                fmt::println( ::stderr, "C{:03d}: error closing recording: {}",
+                              conn.id, *error );
+            }
+        }
+        // per-connection log files are fsynced and closed by writer threads
+        ::FILE* own_log_fs { conn.precapture_log_fs != nullptr ?
+                             conn.precapture_log_fs : conn.log_fs };
+        if ( own_log_fs != settings.log_fs && ::fclose( own_log_fs ) != 0 ) {
+            fmt::println( ::stderr, "C{:03d}: error closing log file: {}",
+                          conn.id, errors::system::message( "fclose" ) );
+        }
         _pfds_i_by_fd.erase( conn.client_fd );
         conn.closeClientSide();
         _pfds_i_by_fd.erase( conn.server_fd );
         conn.closeServerSide();
         _connections.erase( id );
     }
+    _compactPoll();
+    // listener should still be open even if all connections were closed
+    assert( !_pfds_i_by_fd.empty() );
+}
+
+void ProxyX11Server::_compactPoll() {
     // zip _pfds array to _pfds_i_by_fd keys
     std::vector< ::pollfd > new_pfds;
     int i {};
@@ -903,27 +1517,64 @@ void ProxyX11Server::_closeConnections( const std::vector< int >& ids ) {
         ++i;
     }
     _pfds = std::move( new_pfds );
-    // listener should still be open even if all connections were closed
-    assert( !_pfds_i_by_fd.empty() );
 }
 
 int ProxyX11Server::_processClientQueue() {
     _addSocketToPoll( _listener_fd, POLLPRI | POLLIN );
+    if ( _metrics_fd != _UNINIT_FD )
+        _addSocketToPoll( _metrics_fd, POLLIN );
+    if ( _control_fd != _UNINIT_FD )
+        _addSocketToPoll( _control_fd, POLLIN );
+    if ( _atom_resolver.isOpen() )
+        _addSocketToPoll( _atom_resolver.fd(), POLLIN );
 
     static constexpr int NO_TIMEOUT { -1 };
+    // wake periodically to summarize suppressed messages once traffic stops
+    const int idle_timeout { settings.ratelimiter.empty() ? NO_TIMEOUT :
+        int( LogRateLimiter::SUMMARY_INTERVAL_NS / 1'000'000 ) };
+    // wake to print lines held for ATOM names even if names never arrive
+    static constexpr int HOLD_TIMEOUT {
+        int( X11ProtocolParser::ATOM_HOLD_NS / 1'000'000 ) };
     while ( child_running.load() || !_connections.empty() || settings.keeprunning ) {
+        if ( reports_requested.exchange( false ) ) {
+            // reports go to main log after any lines held for ATOM names
+            _parser.flushHeldLines( true );
+            _parser.logLatencies();
+            _parser.logTotalStats( _connections );
+            _logProfile();
+        }
+        _importRevalidatedAtoms();
+        _requestUnresolvedAtoms();
         _updatePollFlags();
-        // blocks until polled fds have new events or interrupted by signal
-        if ( ::poll( _pfds.data(), nfds_t( _pfds.size() ), NO_TIMEOUT ) == -1 ) {
+        int timeout { _parser.holdingLines() ? HOLD_TIMEOUT : idle_timeout };
+        // wake for next release of messages held by --netem
+        if ( const int netem_timeout { _netem_timers.timeoutMs( monotonic::now() ) };
+             netem_timeout != NO_TIMEOUT &&
+             ( timeout == NO_TIMEOUT || netem_timeout < timeout ) ) {
+            timeout = netem_timeout;
+        }
+        // blocks until polled fds have new events, timeout, or interrupted by
+        //   signal; SIGUSR1 is unblocked only for the wait, so a report
+        //   requested since checking above always interrupts it
+        ::timespec timeout_ts { timeout / 1000, ( timeout % 1000 ) * 1'000'000 };
+        if ( ::ppoll( _pfds.data(), nfds_t( _pfds.size() ),
+                      timeout == NO_TIMEOUT ? nullptr : &timeout_ts,
+                      &_poll_sigmask ) == -1 ) {
             if ( errno != 0 && errno != EINTR ) {
                 fmt::println( ::stderr, "{}: {}: {}",
                               settings.process_name, __PRETTY_FUNCTION__,
-                              errors::system::message( "poll" ) );
+                              errors::system::message( "ppoll" ) );
                 return EXIT_FAILURE;
             }
             continue;
         }
+        _releaseHeld();
         _processPolledSockets();
+        _parser.flushHeldLines();
+        for ( auto& [ id, conn ] : _connections ) {
+            for ( const std::string& line : conn.log_limiter.summary( conn.id ) )
+                _parser.println( conn.log_fs, "{}", line );
+        }
     }
     if ( _child_used && !settings.keeprunning )
         return child_retval.load();
@@ -0,0 +1,322 @@
+#include <algorithm>                      // min
+#include <charconv>                       // from_chars
+#include <filesystem>                     // filesystem::path
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cassert>
+#include <cerrno>                         // errno, EAGAIN, EINTR
+#include <cstdint>
+#include <cstdio>                         // FILE, fopen, fclose, fflush, setvbuf
+
+#include <poll.h>                         // POLLIN
+#include <sys/socket.h>                   // accept4, recv, send, SOCK_CLOEXEC...
+#include <unistd.h>                       // close
+
+#include <fmt/format.h>
+
+#include "ProxyX11Server.hpp"
+#include "MessageFilter.hpp"
+#include "errors.hpp"
+
+
+/**
+ * @brief Sends all of `text` to control client without blocking.
+ * @param fd control client socket
+ * @param text bytes to send
+ * @return whether all bytes were sent
+ */
+static bool sendControlResponse( const int fd, const std::string_view text ) {
+    for ( size_t sent {}; sent < text.size(); ) {
+        const ::ssize_t ret { ::send( fd, text.data() + sent, text.size() - sent,
+                                      MSG_DONTWAIT | MSG_NOSIGNAL ) };
+        if ( ret == -1 ) {
+            if ( errno == EINTR )
+                continue;
+            return false;
+        }
+        sent += size_t( ret );
+    }
+    return true;
+}
+
+/**
+ * @brief Determines if file name has the form `C[0-9]*.log` of per-connection
+ *   `--outdir` log files.
+ * @param name file name, without directory
+ * @return whether name is reserved for connection logs
+ */
+static bool isConnectionLogName( const std::string_view name ) {
+    static constexpr std::string_view SUFFIX { ".log" };
+    return name.size() >= 2 + SUFFIX.size() && name[ 0 ] == 'C' &&
+        name[ 1 ] >= '0' && name[ 1 ] <= '9' &&
+        name.substr( name.size() - SUFFIX.size() ) == SUFFIX;
+}
+
+/**
+ * @brief Splits first whitespace-delimited word from text.
+ * @param[in,out] text text from which word is removed
+ * @return first word, or empty if none
+ */
+static std::string_view nextWord( std::string_view* text ) {
+    assert( text != nullptr );
+    static constexpr std::string_view WHITESPACE { " \t\r" };
+    const size_t start { text->find_first_not_of( WHITESPACE ) };
+    if ( start == std::string_view::npos ) {
+        *text = {};
+        return {};
+    }
+    text->remove_prefix( start );
+    const size_t end { std::min( text->find_first_of( WHITESPACE ),
+                                 text->size() ) };
+    const std::string_view word { text->substr( 0, end ) };
+    text->remove_prefix( end );
+    return word;
+}
+
+/**
+ * @brief Parses "on" or "off" command argument.
+ * @param word command argument
+ * @return `true` for "on", `false` for "off", or `std::nullopt` otherwise
+ */
+static std::optional< bool > parseOnOff( const std::string_view word ) {
+    if ( word == "on" )
+        return true;
+    if ( word == "off" )
+        return false;
+    return std::nullopt;
+}
+
+void ProxyX11Server::_processControlSockets() {
+    assert( _control_fd != _UNINIT_FD );
+    std::vector< int > fds_to_close;
+    for ( auto& [ fd, input ] : _control_clients ) {
+        if ( !_socketReadReady( fd ) ) {
+            if ( _socketPollError( fd ) )
+                fds_to_close.emplace_back( fd );
+            continue;
+        }
+        char buf[ _MAX_CONTROL_LINE_SZ ];
+        const ::ssize_t ret { ::recv( fd, buf, sizeof( buf ), MSG_DONTWAIT ) };
+        if ( ret == -1 && ( errno == EAGAIN || errno == EINTR ) )
+            continue;
+        if ( ret <= 0 ) {
+            fds_to_close.emplace_back( fd );
+            continue;
+        }
+        input.append( buf, size_t( ret ) );
+        // commands run between polls, so never in the middle of a message
+        size_t line_end;
+        while ( ( line_end = input.find( '\n' ) ) != std::string::npos ) {
+            const std::string response {
+                _runControlCommand( std::string_view( input ).substr( 0, line_end ) ) };
+            input.erase( 0, line_end + 1 );
+            if ( !sendControlResponse( fd, response ) ) {
+                fds_to_close.emplace_back( fd );
+                break;
+            }
+        }
+        if ( input.size() > _MAX_CONTROL_LINE_SZ ) {
+            sendControlResponse( fd, "error: command too long\n" );
+            fds_to_close.emplace_back( fd );
+        }
+    }
+    if ( !fds_to_close.empty() ) {
+        for ( const int fd : fds_to_close ) {
+            ::close( fd );
+            _control_clients.erase( fd );
+            _pfds_i_by_fd.erase( fd );
+        }
+        _compactPoll();
+    }
+    if ( _socketReadReady( _control_fd ) ) {
+        const int fd { ::accept4( _control_fd, nullptr, nullptr,
+                                  SOCK_CLOEXEC | SOCK_NONBLOCK ) };
+        if ( fd < 0 ) {
+            fmt::println( ::stderr, "{}: {}: {}",
+                          settings.process_name, __PRETTY_FUNCTION__,
+                          errors::system::message( "accept4" ) );
+            return;
+        }
+        _addSocketToPoll( fd, POLLIN );
+        _control_clients.emplace( fd, std::string {} );
+    }
+}
+
+std::string
+ProxyX11Server::_runControlCommand( const std::string_view line ) {
+    static constexpr std::string_view OK { "ok\n" };
+    static constexpr std::string_view HELP {
+        R"(commands:
+  list                   list open connections
+  log on|off [<conn id>] toggle logging of all (and new) or one connection
+  verbose on|off         toggle --verbose
+  multiline on|off       toggle --multiline
+  filter add <expr>      add --filter expression
+  filter clear           remove all --filter expressions
+  netem add <expr>       add --netem expression
+  netem clear            remove all --netem expressions
+  capture <path>         log all connections to file under --outdir
+  capture stop           end capture, resume previous log
+  stats                  print metrics snapshot
+)" };
+    std::string_view args { line };
+    const std::string_view command { nextWord( &args ) };
+    if ( command.empty() )
+        return std::string( OK );
+    if ( command == "help" )
+        return fmt::format( "{}{}", HELP, OK );
+    if ( command == "list" ) {
+        std::string response;
+        for ( const auto& [ id, conn ] : _connections ) {
+            response += fmt::format( "C{:03d}: logging {}: {}\n", conn.id,
+                                     conn.logging ? "on" : "off",
+                                     conn.client_desc );
+        }
+        return response.append( OK );
+    }
+    if ( command == "log" ) {
+        const std::optional< bool > on { parseOnOff( nextWord( &args ) ) };
+        if ( !on )
+            return "error: expected log on|off [<conn id>]\n";
+        if ( const std::string_view id_str { nextWord( &args ) };
+             !id_str.empty() ) {
+            int id {};
+            const auto [ ptr, ec ] { std::from_chars(
+                    id_str.data(), id_str.data() + id_str.size(), id ) };
+            const auto conn_it { _connections.find( id ) };
+            if ( ec != std::errc{} || ptr != id_str.data() + id_str.size() ||
+                 conn_it == _connections.end() ) {
+                return fmt::format( "error: no open connection {:?}\n", id_str );
+            }
+            conn_it->second.logging = *on;
+            return std::string( OK );
+        }
+        settings.logging = *on;
+        for ( auto& [ id, conn ] : _connections )
+            conn.logging = *on;
+        return std::string( OK );
+    }
+    if ( command == "verbose" || command == "multiline" ) {
+        const std::optional< bool > on { parseOnOff( nextWord( &args ) ) };
+        if ( !on )
+            return fmt::format( "error: expected {} on|off\n", command );
+        ( command == "verbose" ? settings.verbose : settings.multiline ) = *on;
+        _parser.applySettings();
+        return std::string( OK );
+    }
+    if ( command == "filter" ) {
+        const std::string_view subcommand { nextWord( &args ) };
+        if ( subcommand == "add" ) {
+            const std::string_view expr { nextWord( &args ) };
+            if ( expr.empty() )
+                return "error: expected filter add <expr>\n";
+            if ( const auto error { settings.filter.addClause( expr ) }; error )
+                return fmt::format( "error: {}\n", *error );
+        } else if ( subcommand == "clear" ) {
+            settings.filter = MessageFilter {};
+        } else {
+            return "error: expected filter add <expr> or filter clear\n";
+        }
+        for ( auto& [ id, conn ] : _connections )
+            conn.log_filter = settings.filter.compile( conn.id );
+        return std::string( OK );
+    }
+    if ( command == "netem" ) {
+        const std::string_view subcommand { nextWord( &args ) };
+        if ( subcommand == "add" ) {
+            const std::string_view expr { nextWord( &args ) };
+            if ( expr.empty() )
+                return "error: expected netem add <expr>\n";
+            if ( const auto error { settings.netem.addRule( expr ) }; error )
+                return fmt::format( "error: {}\n", *error );
+        } else if ( subcommand == "clear" ) {
+            settings.netem.clear();
+        } else {
+            return "error: expected netem add <expr> or netem clear\n";
+        }
+        // messages already held keep their release times
+        for ( auto& [ id, conn ] : _connections ) {
+            conn.client_netem = settings.netem.compile( conn.id, true );
+            conn.server_netem = settings.netem.compile( conn.id, false );
+        }
+        return std::string( OK );
+    }
+    if ( command == "capture" ) {
+        const std::string_view path { nextWord( &args ) };
+        if ( path.empty() )
+            return "error: expected capture <path> or capture stop\n";
+        if ( const auto error { _capture( path == "stop" ? "" : path ) }; error )
+            return fmt::format( "error: {}\n", *error );
+        return std::string( OK );
+    }
+    if ( command == "stats" )
+        return _formatMetrics().append( OK );
+    return fmt::format( "error: unknown command {:?}, try help\n", command );
+}
+
+std::optional< std::string >
+ProxyX11Server::_capture( const std::string_view path ) {
+    ::FILE* new_fs {};
+    if ( !path.empty() ) {
+        // control clients may only write files under --outdir
+        if ( settings.log_dir == nullptr )
+            return "capture requires --outdir";
+        const std::filesystem::path relative_path { path };
+        if ( relative_path.is_absolute() )
+            return fmt::format( "capture path {:?} must be relative to --outdir",
+                                path );
+        for ( const std::filesystem::path& component : relative_path ) {
+            if ( component == ".." ) {
+                return fmt::format( "capture path {:?} must not contain \"..\"",
+                                    path );
+            }
+        }
+        if ( isConnectionLogName( relative_path.filename().native() ) ) {
+            return fmt::format( "capture path {:?} is reserved for connection "
+                                "logs", path );
+        }
+        const std::filesystem::path capture_path {
+            std::filesystem::path( settings.log_dir ) / relative_path };
+        // never truncate an existing file
+        new_fs = ::fopen( capture_path.c_str(), "wxe" );
+        if ( new_fs == nullptr )
+            return errors::system::message( "fopen" );
+        if ( settings.unbuffered )
+            ::setvbuf( new_fs, nullptr, _IONBF, 0 );
+    } else {
+        if ( _precapture_log_fs == nullptr )
+            return "no capture in progress";
+        new_fs = _precapture_log_fs;
+    }
+    ::FILE* old_fs { settings.log_fs };
+    // held lines are bound for old streams
+    _parser.flushHeldLines( true );
+    ::fflush( old_fs );
+    for ( auto& [ id, conn ] : _connections ) {
+        ::fflush( conn.log_fs );
+        if ( path.empty() ) {
+            conn.log_fs = conn.precapture_log_fs;
+            conn.precapture_log_fs = nullptr;
+            continue;
+        }
+        // connection's own --outdir file is set aside until capture ends
+        if ( conn.precapture_log_fs == nullptr )
+            conn.precapture_log_fs = conn.log_fs;
+        conn.log_fs = new_fs;
+    }
+    settings.log_fs = new_fs;
+    if ( _precapture_log_fs == nullptr ) {
+        _precapture_log_fs = old_fs;
+        return std::nullopt;
+    }
+    // ending or replacing capture, old stream is capture file
+    std::optional< std::string > error;
+    if ( ::fclose( old_fs ) != 0 )
+        error = errors::system::message( "fclose" );
+    if ( path.empty() )
+        _precapture_log_fs = nullptr;
+    return error;
+}
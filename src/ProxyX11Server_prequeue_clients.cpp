@@ -1,3 +1,5 @@
+#include <chrono>                         // seconds
+#include <future>                         // async, future_status
 #include <optional>                       // nullopt
 #include <string>
 #include <utility>                        // ignore
@@ -10,11 +12,15 @@
 #include <cstdlib>                        // exit, EXIT_FAILURE
 #include <ctime>                          // time
 
+#include <fcntl.h>                        // fcntl, F_SETFD, FD_CLOEXEC
 #include <poll.h>                         // pollfd, POLLIN, POLLOUT, poll
+#include <sys/socket.h>                   // AF_UNIX
+#include <sys/stat.h>                     // stat
 #include <unistd.h>                       // close, _exit, write, STDERR_FILE...
 
 #include <fmt/format.h>
 
+#include "AtomCache.hpp"
 #include "ProxyX11Server.hpp"
 #include "X11ProtocolParser.hpp"
 #include "errors.hpp"
@@ -113,7 +119,8 @@ polledReadMessage( SocketBuffer& buffer, const int fd,
 }
 
 bool ProxyX11Server::_authenticateServerConnection(
-    const int server_fd, protocol::WINDOW* screen0_root/* = nullptr*/ ) {
+    const int server_fd, protocol::WINDOW* screen0_root/* = nullptr*/,
+    AtomCache::ServerKey* server_key/* = nullptr*/ ) {
     SocketBuffer buffer;
 
     using Align = X11ProtocolParser::Alignment;
@@ -181,6 +188,12 @@ bool ProxyX11Server::_authenticateServerConnection(
     Acceptance::Encoding accept_encoding {};
     buffer.unload( &accept_encoding, sizeof( Acceptance::Encoding ) );
     // skip suffix `vendor`
+    if ( server_key != nullptr ) {
+        server_key->vendor.assign(
+            reinterpret_cast< const char* >( buffer.data() ),
+            size_t( accept_encoding.vendor_len ) );
+        server_key->release_number = accept_encoding.release_number;
+    }
     buffer.unload( Align::pad( accept_encoding.vendor_len ) );
     // skip suffix `pixmap-formats`
     buffer.unload( accept_encoding.pixmap_formats_ct *
@@ -191,6 +204,8 @@ bool ProxyX11Server::_authenticateServerConnection(
     buffer.unload( &screen_header, sizeof( Acceptance::SCREEN::Header ) );
     if ( screen0_root != nullptr )
         *screen0_root = screen_header.root;
+    if ( server_key != nullptr )
+        server_key->root = screen_header.root.data;
     return true;
 }
 
@@ -317,7 +332,7 @@ static void handleTerminatingSignal( int sig ) {
 }
 
 std::vector< std::string >
-ProxyX11Server::_fetchInternedAtoms() {
+ProxyX11Server::_fetchInternedAtoms( const bool background/* = false*/ ) {
     using Align = X11ProtocolParser::Alignment;
 
     const int server_fd { _connectToServer() };
@@ -325,6 +340,8 @@ ProxyX11Server::_fetchInternedAtoms() {
         fmt::println(
             ::stderr, "{}: {}: failure to connect to X server for display: {:?}",
             settings.process_name, __PRETTY_FUNCTION__, _out_display.name );
+        if ( background )
+            return {};
         ::exit( EXIT_FAILURE );
     }
     std::vector< std::string > fetched_atoms ( 1 );  // indices start at 1
@@ -338,25 +355,31 @@ ProxyX11Server::_fetchInternedAtoms() {
         ////// prepare for loop
         // ANSI Control Sequence Introducer
         constexpr char CSI[ sizeof( "\x1b[" ) ] { "\x1b[" };
-        fmt::print( ::stderr, "fetching interned ATOMs: " );
-        // hide cursor
-        fmt::print( ::stderr, "{}?25l", CSI );
-        // register handler so that cursor is unhidden on on any signal
-        //   interrupt that may occur during InternAtom request loop
         // `struct` needed to disambiguate from sigaction(2)
         struct ::sigaction act {};
-        act.sa_handler = &handleTerminatingSignal;
-        if ( ::sigaction( SIGABRT, &act, nullptr ) == -1 ||
-             ::sigaction( SIGINT, &act, nullptr ) == -1  ||
-             ::sigaction( SIGSEGV, &act, nullptr ) == -1 ||
-             ::sigaction( SIGTERM, &act, nullptr ) == -1 ) {
-            fmt::println( ::stderr, "{}: {}: {}",
-                          settings.process_name, __PRETTY_FUNCTION__,
-                          errors::system::message( "sigaction" ) );
-            goto failure;
+        // progress display (and so signal handlers) only when main queue is
+        //   not yet running
+        if ( !background ) {
+            fmt::print( ::stderr, "fetching interned ATOMs: " );
+            // hide cursor
+            fmt::print( ::stderr, "{}?25l", CSI );
+            // register handler so that cursor is unhidden on on any signal
+            //   interrupt that may occur during InternAtom request loop
+            act.sa_handler = &handleTerminatingSignal;
+            if ( ::sigaction( SIGABRT, &act, nullptr ) == -1 ||
+                 ::sigaction( SIGINT, &act, nullptr ) == -1  ||
+                 ::sigaction( SIGSEGV, &act, nullptr ) == -1 ||
+                 ::sigaction( SIGTERM, &act, nullptr ) == -1 ) {
+                fmt::println( ::stderr, "{}: {}: {}",
+                              settings.process_name, __PRETTY_FUNCTION__,
+                              errors::system::message( "sigaction" ) );
+                goto failure;
+            }
         }
-        ////// loop GetAtomName request for first region of contiguous ATOM ids
-        //////   starting at 1
+        ////// pipeline GetAtomName requests for first region of contiguous
+        //////   ATOM ids starting at 1; replies arrive in request order, and
+        //////   as this connection sends no other requests, the sequence
+        //////   number of each reply (or error) is the ATOM it describes
         using protocol::requests::GetAtomName;
         GetAtomName::Prefix req_prefix {};
         req_prefix.opcode = protocol::requests::opcodes::GETATOMNAME;
@@ -365,109 +388,133 @@ ProxyX11Server::_fetchInternedAtoms() {
             Align::units( GetAtomName::BASE_ENCODING_SZ );
         GetAtomName::Encoding req_encoding {};
         GetAtomName::Reply::Encoding rep_encoding {};
-        static constexpr size_t STRINGBUF_SZ { 1000 };
-        char stringbuf[ STRINGBUF_SZ ];
-        SocketBuffer buffer;
-        for ( uint32_t atom_i { 1 }; true; ++atom_i ) {
-            ////// send GetAtomName request
-            buffer.load( &req_prefix, sizeof( req_prefix ) );
-            buffer.load( &req_length, sizeof( req_length ) );
-            req_encoding.atom.data = atom_i;
-            buffer.load( &req_encoding, sizeof( req_encoding ) );
-            const size_t bytes_loaded { GetAtomName::BASE_ENCODING_SZ };
-            assert( buffer.size() == bytes_loaded );
-            buffer.setMessageSize( bytes_loaded );
-            buffer.markMessageParsed();
-            const auto [ bytes_written, write_error ] {
-                polledWriteMessage( buffer, server_fd, bytes_loaded ) };
-            if ( write_error ) {
+        SocketBuffer req_buffer;
+        SocketBuffer rep_buffer;
+        // next ATOM to request, while next ATOM to be answered is always
+        //   fetched_atoms.size()
+        uint32_t next_atom { 1 };
+        for ( bool region_ended {}; !region_ended; ) {
+            ////// refill window of GetAtomName requests once half answered,
+            //////   so that replies to other half cover time spent writing
+            if ( next_atom - fetched_atoms.size() <= _ATOM_PREFETCH_WINDOW / 2 ) {
+                for ( ; next_atom - fetched_atoms.size() < _ATOM_PREFETCH_WINDOW;
+                      ++next_atom ) {
+                    req_buffer.load( &req_prefix, sizeof( req_prefix ) );
+                    req_buffer.load( &req_length, sizeof( req_length ) );
+                    req_encoding.atom.data = next_atom;
+                    req_buffer.load( &req_encoding, sizeof( req_encoding ) );
+                }
+                const size_t bytes_loaded { req_buffer.size() };
+                assert( bytes_loaded % GetAtomName::BASE_ENCODING_SZ == 0 );
+                req_buffer.setMessageSize( bytes_loaded );
+                req_buffer.markMessageParsed();
+                const auto [ bytes_written, write_error ] {
+                    polledWriteMessage( req_buffer, server_fd, bytes_loaded ) };
+                if ( write_error ) {
+                    fmt::println( ::stderr, "{}: {}",
+                                  settings.process_name, *write_error );
+                    goto failure;
+                }
+            }
+            ////// read whatever replies have arrived, possibly ending with
+            //////   partial reply completed by next read
+            if ( const auto poll_error { pollSingleSocket( server_fd, POLLIN ) };
+                 poll_error ) {
                 fmt::println( ::stderr, "{}: {}",
-                              settings.process_name, *write_error );
+                              settings.process_name, *poll_error );
                 goto failure;
             }
-            ////// parse GetAtomName reply to get string interned at ATOM id
-            //////   (first protocol error ends loop)
-            const auto [ first_bytes_read, first_read_error ] {
-                polledRead( buffer, server_fd ) };
-            if ( first_read_error ) {
-                fmt::println( ::stderr, "{}: {}",
-                              settings.process_name, *first_read_error );
+            const auto [ bytes_read, read_error ] { rep_buffer.read( server_fd ) };
+            if ( read_error || bytes_read == 0 ) {
+                fmt::println( ::stderr, "{}: {}", settings.process_name,
+                              read_error ? *read_error :
+                              "X server closed connection during atom prefetch" );
                 goto failure;
             }
-            assert( first_bytes_read >= sizeof( protocol::Response::Header ) );
-            size_t response_sz {};
-            bool protocol_error {};
+            ////// parse each complete GetAtomName reply to get string interned
+            //////   at ATOM id (first protocol error ends loop)
             using protocol::Response;
-            if ( const Response::Header* header {
-                    reinterpret_cast< const Response::Header* >( buffer.data() ) };
-                header->prefix == protocol::errors::Error::ERROR ) {
-                response_sz = protocol::errors::Error::ENCODING_SZ;
-                protocol_error = true;
-            } else {
+            while ( !region_ended &&
+                    rep_buffer.size() >= sizeof( GetAtomName::Reply::Encoding ) ) {
+                const Response::Header* header {
+                    reinterpret_cast< const Response::Header* >(
+                        rep_buffer.data() ) };
+                const uint32_t atom_i ( fetched_atoms.size() );
+                if ( header->sequence_num != uint16_t( atom_i ) ) {
+                    fmt::println( ::stderr, "{}: {}: expected response to "
+                                  "request {} but got {}, reverting to default "
+                                  "atom lookup", settings.process_name,
+                                  __PRETTY_FUNCTION__, uint16_t( atom_i ),
+                                  header->sequence_num );
+                    fetched_atoms.clear();
+                    break;
+                }
+                if ( header->prefix == protocol::errors::Error::ERROR ) {
+                    static_assert( protocol::errors::Error::ENCODING_SZ ==
+                                   sizeof( GetAtomName::Reply::Encoding ) );
+                    protocol::errors::Error::Encoding err_encoding;
+                    rep_buffer.unload( &err_encoding, sizeof( err_encoding ) );
+                    // expect Atom error at end of first contiguous region of
+                    //   server's ATOMs; replies to any later requests in
+                    //   window are discarded
+                    if ( err_encoding.header.code != protocol::errors::codes::ATOM ) {
+                        fmt::println( ::stderr, "{}: failed atom prefech with X error {}, "
+                                      "reverting to default atom lookup",
+                                      settings.process_name,
+                                      protocol::errors::names[ err_encoding.header.code ] );
+                        fetched_atoms.clear();
+                    }
+                    region_ended = true;
+                    break;
+                }
                 assert( header->prefix == protocol::requests::Reply::REPLY );
-                assert( buffer.size() >= sizeof( GetAtomName::Reply::Header ) );
                 const GetAtomName::Reply::Header* rep_header {
                     reinterpret_cast< const GetAtomName::Reply::Header* >(
-                        buffer.data() ) };
-                response_sz = GetAtomName::Reply::DEFAULT_ENCODING_SZ +
-                    Align::size( rep_header->extra_aligned_units );
-            }
-            buffer.setMessageSize( response_sz );
-            const auto [ remaining_bytes_read, remaining_read_error ] {
-                polledReadMessage( buffer, server_fd, response_sz ) };
-            if ( remaining_read_error ) {
-                fmt::println( ::stderr, "{}: {}",
-                              settings.process_name, *remaining_read_error );
-                goto failure;
-            }
-            assert( first_bytes_read + remaining_bytes_read == response_sz );
-            if ( protocol_error ) {
-                protocol::errors::Error::Encoding err_encoding;
-                buffer.unload( &err_encoding, sizeof( err_encoding ) );
-                assert( buffer.empty() );
-                // expect Atom error at end of first contiguous region of server's ATOMs
-                if ( err_encoding.header.code != protocol::errors::codes::ATOM ) {
-                    fmt::println( ::stderr, "{}: failed atom prefech with X error {}, "
-                                  "reverting to default atom lookup",
-                                  settings.process_name,
-                                  protocol::errors::names[ err_encoding.header.code ] );
-                    fetched_atoms.clear();
+                        rep_buffer.data() ) };
+                const size_t name_sz {
+                    Align::size( rep_header->extra_aligned_units ) };
+                if ( rep_buffer.size() <
+                     GetAtomName::Reply::DEFAULT_ENCODING_SZ + name_sz ) {
+                    break;
                 }
-                break;
+                rep_buffer.unload( &rep_encoding, sizeof( rep_encoding ) );
+                assert( rep_encoding.header.extra_aligned_units ==
+                        Align::units( Align::pad( rep_encoding.name_len ) ) );
+                fetched_atoms.emplace_back(
+                    reinterpret_cast< const char* >( rep_buffer.data() ),
+                    size_t( rep_encoding.name_len ) );
+                if ( name_sz > 0 )
+                    rep_buffer.unload( name_sz );
             }
-            buffer.unload( &rep_encoding, sizeof( rep_encoding ) );
-            assert( rep_encoding.header.reply == protocol::requests::Reply::REPLY );
-            assert( rep_encoding.header.sequence_num == atom_i );
-            assert( rep_encoding.header.extra_aligned_units ==
-                    Align::units( Align::pad( rep_encoding.name_len ) ) );
-            assert( buffer.size() < STRINGBUF_SZ );
-            assert( buffer.size() == Align::pad( rep_encoding.name_len ) );
-            buffer.unload( stringbuf, buffer.size() );
-            stringbuf[ rep_encoding.name_len ] = '\0';
-            fetched_atoms.emplace_back( stringbuf );
-            assert( buffer.empty() );
+            // sequence mismatch cleared fetched_atoms
+            if ( fetched_atoms.empty() )
+                break;
+            if ( background )
+                continue;
             // Update ATOM counter in place to keep user aware of progress
             static constexpr int COUNTER_W { 5 };
             // \x1b[#D cursor right # cols
             fmt::print( ::stderr, "{:{}d}{}{}D",
-                        atom_i, COUNTER_W, CSI, COUNTER_W );
+                        fetched_atoms.size() - 1, COUNTER_W, CSI, COUNTER_W );
         }
         ////// loop cleanup
-        // need newline after cursor looping horizontally
-        fmt::println( ::stderr, "" );
-        // show cursor
-        fmt::print( ::stderr, "{}?25h", CSI );
-        // restore default signal behavior
-        act.sa_handler = SIG_DFL;
-        if ( ::sigaction( SIGABRT, &act, nullptr ) == -1 ||
-             ::sigaction( SIGINT, &act, nullptr ) == -1  ||
-             ::sigaction( SIGSEGV, &act, nullptr ) == -1 ||
-             ::sigaction( SIGTERM, &act, nullptr ) == -1 ) {
-            fmt::println(
-                ::stderr, "{}: {}: {}",
-                settings.process_name, __PRETTY_FUNCTION__,
-                errors::system::message( "sigaction" ) );
-            goto failure;
+        if ( !background ) {
+            // need newline after cursor looping horizontally
+            fmt::println( ::stderr, "" );
+            // show cursor
+            fmt::print( ::stderr, "{}?25h", CSI );
+            // restore default signal behavior
+            act.sa_handler = SIG_DFL;
+            if ( ::sigaction( SIGABRT, &act, nullptr ) == -1 ||
+                 ::sigaction( SIGINT, &act, nullptr ) == -1  ||
+                 ::sigaction( SIGSEGV, &act, nullptr ) == -1 ||
+                 ::sigaction( SIGTERM, &act, nullptr ) == -1 ) {
+                fmt::println(
+                    ::stderr, "{}: {}: {}",
+                    settings.process_name, __PRETTY_FUNCTION__,
+                    errors::system::message( "sigaction" ) );
+                goto failure;
+            }
         }
     }
 
@@ -475,5 +522,166 @@ ProxyX11Server::_fetchInternedAtoms() {
     return fetched_atoms;
 failure:
     ::close( server_fd );
+    if ( background )
+        return {};
     ::exit( EXIT_FAILURE );
 }
+
+AtomCache::ServerKey ProxyX11Server::_fetchServerKey() {
+    AtomCache::ServerKey server_key {};
+    const int server_fd { _connectToServer() };
+    if( server_fd < 0 ) {
+        fmt::println(
+            ::stderr, "{}: {}: failure to connect to X server for display: {:?}",
+            settings.process_name, __PRETTY_FUNCTION__, _out_display.name );
+        ::exit( EXIT_FAILURE );
+    }
+    if ( !_authenticateServerConnection( server_fd, nullptr, &server_key ) ) {
+        fmt::println(
+            ::stderr, "{}: {}: failed to authenticate connection to X server",
+            settings.process_name, __PRETTY_FUNCTION__ );
+        ::close( server_fd );
+        ::exit( EXIT_FAILURE );
+    }
+    ::close( server_fd );
+    // X server creates its socket on startup; remains 0 for TCP (or abstract
+    //   namespace sockets), when cache is not used
+    if ( _out_display.ai_family == AF_UNIX ) {
+        struct ::stat st {};
+        if ( ::stat( _out_display.unaddr.sun_path, &st ) == 0 )
+            server_key.start_time = uint64_t( st.st_mtime );
+    }
+    return server_key;
+}
+
+void ProxyX11Server::_prefetchAtoms() {
+    assert( settings.prefetchatoms );
+    if ( settings.atom_cache_path == nullptr ) {
+        _parser.importFetchedAtoms( _fetchInternedAtoms() );
+        return;
+    }
+    const AtomCache::ServerKey server_key { _fetchServerKey() };
+    const std::string cache_path { settings.atom_cache_path };
+    // other fields are shared by every instance of same server build, so
+    //   without start time a cache could be trusted for a different server
+    if ( server_key.start_time == 0 ) {
+        fmt::println( ::stderr, "{}: not using atom cache {:?}: X server start "
+                      "time unknown (eg TCP display)",
+                      settings.process_name, cache_path );
+        _parser.importFetchedAtoms( _fetchInternedAtoms() );
+        return;
+    }
+    auto [ cached_atoms, load_error ] {
+        AtomCache::load( cache_path, server_key ) };
+    if ( load_error ) {
+        fmt::println( ::stderr, "{}: ignoring atom cache {:?}: {}",
+                      settings.process_name, cache_path, *load_error );
+    }
+    if ( cached_atoms.empty() ) {
+        // no usable cache: fetch before tracing begins, as without cache
+        const std::vector< std::string > fetched_atoms {
+            _fetchInternedAtoms() };
+        _parser.importFetchedAtoms( fetched_atoms );
+        if ( fetched_atoms.empty() )
+            return;
+        if ( const auto save_error {
+                AtomCache::save( cache_path, server_key, fetched_atoms ) };
+             save_error ) {
+            fmt::println( ::stderr, "{}: could not write atom cache {:?}: {}",
+                          settings.process_name, cache_path, *save_error );
+        }
+        return;
+    }
+    _parser.importFetchedAtoms( cached_atoms );
+    fmt::println( ::stderr, "loaded {} interned ATOMs from cache {:?}, "
+                  "revalidating in background", cached_atoms.size() - 1,
+                  cache_path );
+    // server may have interned more atoms since cache was written, or
+    //   (rarely) be a different server with same key
+    _atom_revalidation = std::async(
+        std::launch::async, [ this, server_key, cache_path ]() {
+            std::vector< std::string > fetched_atoms {
+                _fetchInternedAtoms( true ) };
+            if ( fetched_atoms.empty() )
+                return fetched_atoms;
+            if ( const auto save_error {
+                    AtomCache::save( cache_path, server_key, fetched_atoms ) };
+                 save_error ) {
+                fmt::println( ::stderr, "{}: could not write atom cache {:?}: {}",
+                              settings.process_name, cache_path, *save_error );
+            }
+            return fetched_atoms;
+        } );
+}
+
+void ProxyX11Server::_importRevalidatedAtoms() {
+    if ( !_atom_revalidation.valid() ||
+         _atom_revalidation.wait_for( std::chrono::seconds( 0 ) ) !=
+         std::future_status::ready ) {
+        return;
+    }
+    const std::vector< std::string > fetched_atoms {
+        _atom_revalidation.get() };
+    if ( fetched_atoms.empty() )
+        return;
+    const size_t updated_ct { _parser.importFetchedAtoms( fetched_atoms ) };
+    fmt::println( ::stderr, "revalidated {} interned ATOMs, {} new or changed "
+                  "since cache", fetched_atoms.size() - 1, updated_ct );
+}
+
+void ProxyX11Server::_openAtomResolver() {
+    assert( settings.resolveatoms );
+    const int server_fd { _connectToServer() };
+    if( server_fd < 0 ) {
+        fmt::println(
+            ::stderr, "{}: {}: failure to connect to X server for display: {:?}",
+            settings.process_name, __PRETTY_FUNCTION__, _out_display.name );
+        ::exit( EXIT_FAILURE );
+    }
+    if ( !_authenticateServerConnection( server_fd ) ) {
+        fmt::println(
+            ::stderr, "{}: {}: failed to authenticate connection to X server",
+            settings.process_name, __PRETTY_FUNCTION__ );
+        ::close( server_fd );
+        ::exit( EXIT_FAILURE );
+    }
+    // not inherited by subcommand client
+    ::fcntl( server_fd, F_SETFD, FD_CLOEXEC );
+    _atom_resolver.open( server_fd );
+}
+
+void ProxyX11Server::_requestUnresolvedAtoms() {
+    for ( const uint32_t atom : _parser.takeUnresolvedAtoms() ) {
+        if ( _atom_resolver.isOpen() )
+            _atom_resolver.request( atom );
+        else
+            _parser.resolveAtom( atom, std::nullopt );
+    }
+}
+
+void ProxyX11Server::_processAtomResolver() {
+    if ( !_atom_resolver.isOpen() )
+        return;
+    const int fd { _atom_resolver.fd() };
+    std::optional< std::string > error;
+    if ( _socketReadReady( fd ) ) {
+        std::vector< AtomResolver::Resolution > resolved;
+        error = _atom_resolver.read( resolved );
+        for ( const AtomResolver::Resolution& resolution : resolved )
+            _parser.resolveAtom( resolution.atom, resolution.name );
+    } else {
+        error = _socketPollError( fd );
+    }
+    if ( !error && _socketWriteReady( fd ) )
+        error = _atom_resolver.write();
+    if ( !error )
+        return;
+    fmt::println( ::stderr, "{}: stopped resolving ATOMs: {}",
+                  settings.process_name, *error );
+    _pfds_i_by_fd.erase( fd );
+    _compactPoll();
+    for ( const uint32_t atom : _atom_resolver.close() )
+        _parser.resolveAtom( atom, std::nullopt );
+    settings.resolveatoms = false;
+    _requestUnresolvedAtoms();
+}
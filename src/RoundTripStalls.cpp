@@ -0,0 +1,52 @@
+#include <algorithm>      // copy, min, partial_sort_copy
+#include <utility>        // pair
+#include <vector>
+
+#include <cstdint>
+
+#include "RoundTripStalls.hpp"
+
+
+void RoundTripStalls::request(
+    const uint8_t major_opcode, const uint8_t minor_opcode,
+    const uint16_t sequence, const uint64_t recv_ns ) {
+    if ( _resuming_site != nullptr ) {
+        _resuming_site->resume_ns += recv_ns - _resuming_since_ns;
+        ++_resuming_site->resume_ct;
+        _resuming_site = nullptr;
+    }
+    std::copy( _recent.begin() + 1, _recent.end(), _recent.begin() );
+    _recent.back() = OpcodesT( major_opcode << 8 | minor_opcode );
+    _last_sequence = sequence;
+    _last_sent_ns = recv_ns;
+    _awaiting_reply = true;
+}
+
+void RoundTripStalls::reply( const uint16_t sequence, const uint64_t recv_ns ) {
+    // client sent other requests while awaiting reply, so was not blocked
+    if ( !_awaiting_reply || sequence != _last_sequence )
+        return;
+    _awaiting_reply = false;
+    const uint64_t blocked_ns { recv_ns - _last_sent_ns };
+    // std::map element pointers are stable
+    SiteStats& site { _sites[ _recent ] };
+    if ( site.count == 0 )
+        site.first_sequence = sequence;
+    ++site.count;
+    site.blocked_ns += blocked_ns;
+    ++_stall_ct;
+    _blocked_ns += blocked_ns;
+    _resuming_site = &site;
+    _resuming_since_ns = recv_ns;
+}
+
+std::vector< std::pair< RoundTripStalls::SiteT, RoundTripStalls::SiteStats > >
+RoundTripStalls::topSites( const size_t max_ct ) const {
+    std::vector< std::pair< SiteT, SiteStats > > top (
+        std::min( max_ct, _sites.size() ) );
+    std::partial_sort_copy(
+        _sites.begin(), _sites.end(), top.begin(), top.end(),
+        []( const auto& a, const auto& b ) {
+            return a.second.blocked_ns > b.second.blocked_ns; } );
+    return top;
+}
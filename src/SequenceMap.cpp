@@ -0,0 +1,91 @@
+#include <deque>
+#include <optional>
+#include <utility>        // move
+#include <vector>
+
+#include <cassert>
+#include <cstdint>
+
+#include "SequenceMap.hpp"
+
+
+void SequenceMap::forward( const bool reply_expected ) {
+    ++_forwarded;
+    if ( _offsets.back().offset != _offset )
+        _offsets.push_back( { _forwarded, _offset } );
+    if ( reply_expected )
+        _replies_due.push_back( _forwarded );
+}
+
+void SequenceMap::answerLocally( const uint16_t client_seq,
+                                 std::vector< uint8_t >&& reply ) {
+    ++_offset;
+    _local_replies.push_back( { _forwarded, client_seq, std::move( reply ) } );
+}
+
+bool SequenceMap::syncNeeded() const {
+    if ( _local_replies.empty() )
+        return false;
+    const uint64_t after { _local_replies.back().after };
+    // a reply due at or after local reply will report server progress
+    return after > _seen &&
+        ( _replies_due.empty() || _replies_due.back() < after );
+}
+
+void SequenceMap::forwardSync() {
+    assert( !_local_replies.empty() );
+    ++_forwarded;
+    --_offset;
+    _replies_due.push_back( _forwarded );
+    _syncs.push_back( _forwarded );
+    _local_replies.back().after = _forwarded;
+}
+
+uint16_t SequenceMap::toClient( const uint16_t server_seq ) {
+    // server messages arrive in sequence order, save events reporting an
+    //   earlier request than the latest reply
+    const int16_t delta ( server_seq - uint16_t( _seen ) );
+    const uint64_t seq { _seen + delta };
+    if ( delta > 0 )
+        _seen = seq;
+    while ( _offsets.size() > 1 && _offsets[ 1 ].server_seq <= seq )
+        _offsets.pop_front();
+    while ( !_replies_due.empty() && _replies_due.front() < _seen )
+        _replies_due.pop_front();
+    uint16_t client_seq ( seq + _offsets.front().offset );
+    // events are numbered by last request processed, which from client view
+    //   includes any answered locally
+    if ( int16_t( client_seq - _last_client_seq ) < 0 )
+        client_seq = _last_client_seq;
+    _last_client_seq = client_seq;
+    return client_seq;
+}
+
+bool SequenceMap::takeSyncReply() {
+    while ( !_syncs.empty() && _syncs.front() < _seen )
+        _syncs.pop_front();
+    if ( _syncs.empty() || _syncs.front() != _seen )
+        return false;
+    _syncs.pop_front();
+    answered();
+    return true;
+}
+
+void SequenceMap::answered() {
+    if ( !_replies_due.empty() && _replies_due.front() == _seen )
+        _replies_due.pop_front();
+}
+
+std::optional< std::vector< uint8_t > > SequenceMap::takeLocalReply() {
+    if ( _local_replies.empty() )
+        return std::nullopt;
+    _LocalReply& local { _local_replies.front() };
+    if ( local.after > _seen ||
+         ( !_replies_due.empty() && _replies_due.front() <= local.after ) ) {
+        return std::nullopt;
+    }
+    _last_client_seq = local.client_seq;
+    std::vector< uint8_t > reply { std::move( local.reply ) };
+    _local_replies.pop_front();
+    return reply;
+}
@@ -1,5 +1,6 @@
 #include <algorithm>      // min
-#include <filesystem>     // filesystem::remove
+#include <charconv>       // from_chars
+#include <filesystem>     // filesystem::is_directory
 #include <string_view>
 #include <string>
 #include <vector>
@@ -11,12 +12,16 @@
 
 #include <getopt.h>       // getopt_long
 #include <stdio_ext.h>    // __flbf __fbufsize
+#include <sys/un.h>       // sockaddr_un
 #include <unistd.h>       // optarg optind
 
 #include <fmt/format.h>
 
 #include "Settings.hpp"
 #include "errors.hpp"
+#ifdef XTRACEPP_WITH_ZLIB
+#include "GzipLogStream.hpp"
+#endif
 
 
 void Settings::_recordFileStreamBufferDefaults() {
@@ -91,10 +96,31 @@ void Settings::_parseFromArgv( const int argc, const char* argv[] ) {
         { "verbose",              no_argument,       nullptr,           'v' },
         { "systemtimeformat",     no_argument,       nullptr,           's' },
         { "prefetchatoms",        no_argument,       nullptr,           'p' },
+        { "atomcache",            required_argument, nullptr,           'a' },
+        { "resolveatoms",         no_argument,       nullptr,           'A' },
+        { "filter",               required_argument, nullptr,           'f' },
+        { "ratelimit",            required_argument, nullptr,           'r' },
+        { "outdir",               required_argument, nullptr,           'O' },
+        { "compress",             no_argument,       nullptr,           'z' },
+        { "shmring",              required_argument, nullptr,           'R' },
+        { "timestamps",           required_argument, nullptr,           't' },
+        { "latency",              no_argument,       nullptr,           'L' },
+        { "stalls",               no_argument,       nullptr,           'S' },
+        { "stats",                no_argument,       nullptr,           'c' },
+        { "metrics",              required_argument, nullptr,           'M' },
+        { "control",              required_argument, nullptr,           'C' },
+        { "profile",              required_argument, nullptr,           'P' },
+        { "record",               required_argument, nullptr,           'T' },
+        { "replycache",           no_argument,       nullptr,           'Q' },
+        { "tunnelconnect",        required_argument, nullptr,           'U' },
+        { "tunnellisten",         required_argument, nullptr,           'W' },
+        { "imagecache",           required_argument, nullptr,           'I' },
+        { "netem",                required_argument, nullptr,           'N' },
+        { "motioncompress",       no_argument,       nullptr,           'G' },
         { "help",                 no_argument,       &long_only_option, LO_HELP },
         { nullptr,                0,                 nullptr,           0 }
     };
-    const std::string_view optstring { "+d:D:ke:E:wo:umvsp" };
+    const std::string_view optstring { "+d:D:ke:E:wo:O:umvspa:Af:r:zR:t:LScM:C:P:T:QU:W:I:N:G" };
     const std::string_view help_msg {
         R"(xtracepp - intercept, log, and modify (based on user options) message data going
   between X server and clients
@@ -127,6 +153,75 @@ Options:
         X protocol TIMESTAMPs interpreted against system time in formatting
      --prefetchatoms    / -p
         first fetch already interned strings to reduce unrecognized ATOMs
+     --atomcache        / -a <cache file path>
+        implies --prefetchatoms; keep fetched ATOMs in file, to start tracing
+          from the file when it matches X server, refetching in background
+     --resolveatoms     / -A
+        look up names of unrecognized ATOMs on a side connection to X server,
+          holding log lines that await them briefly
+     --filter           / -f <filter expression>
+        only log messages matching expression (may be used more than once):
+          key=value[,key=value...] with keys conn, dir, request, event, error, seq
+     --ratelimit        / -r <rate limit expression>
+        limit logging of messages selected by filter keys (may be used more than
+          once), with rate=<msgs/s>[,burst=<msgs>] and/or sample=<log 1 in N>
+     --outdir           / -O <directory path>
+        write messages for each connection to separate log file C###.log in
+          directory
+     --compress         / -z
+        gzip compress --outfile log file (if built with XTRACEPP_WITH_ZLIB);
+          cannot be used with --unbuffered
+     --shmring          / -R <name>[:<MiB>]
+        also publish logged messages to POSIX shared memory ring buffer
+          /dev/shm/<name> (default 16MiB) for live consumers
+     --timestamps       / -t <field>[,<field>...]
+        add message timing fields to log prefix, any of: abs (wall clock time
+          of receipt), rel (since connection start), parse (receipt to log);
+          or log line as each message is forwarded with: fwd (forwarding
+          since connection start), inproxy (receipt to forwarding)
+     --latency          / -L
+        record request to reply/error latency per opcode, print percentiles on
+          exit or on SIGUSR1
+     --stalls           / -S
+        report requests on which each client blocked awaiting reply, by call
+          site (preceding requests), when connection closes
+     --stats            / -c
+        instead of logging each message, count messages and bytes by type,
+          printed when each connection closes and in total on exit or on
+          SIGUSR1
+     --metrics          / -M <socket path>
+        serve Prometheus text format metrics snapshot to each client connecting
+          to unix socket
+     --control          / -C <socket path>
+        accept commands on unix socket to change logging while running, eg
+          "log off", "verbose on", "filter add <expr>", "capture <path>" (path
+          relative to --outdir)
+     --profile          / -P <folded stacks path>
+        time proxy stages (read, framing, parse, println, write) per message
+          type, print table on exit and write folded stacks for flame graphs
+     --record           / -T <directory path>
+        write raw client traffic of each connection to separate file C###.xrec
+          in directory, for replay by bench/x11_replay
+     --replycache       / -Q
+        answer InternAtom, GetAtomName, QueryExtension and ListExtensions from
+          replies already seen on any connection, without forwarding them
+     --tunnelconnect    / -U <host>:<port>
+        carry all client connections to a remote xtracepp started with
+          --tunnellisten, instead of connecting to --display
+     --tunnellisten     / -W [<host>:]<port>
+        accept a tunnel from xtracepp started with --tunnelconnect, and connect
+          its connections to --display, instead of listening for clients;
+          host defaults to loopback, as the tunnel is not authenticated
+     --imagecache       / -I <MiB>
+        with tunnel, cache PutImage and GetImage data up to size per connection,
+          sending images already sent as references
+     --netem            / -N <network emulation expression>
+        hold messages before forwarding to emulate a remote display (may be
+          used more than once), with keys conn, dir and delay=<ms>,
+          jitter=<ms>, bw=<kbit/s>
+     --motioncompress   / -G
+        when client falls behind, drop MotionNotify events not yet sent that
+          are directly followed by another for the same window
 )" };
     std::unordered_set< std::string_view > enabled_extensions;
     std::unordered_set< std::string_view > disabled_extensions;
@@ -189,7 +284,6 @@ Options:
             break;
         case 'o':
             if ( log_path != nullptr ) {
-                std::filesystem::remove( log_path );
                 fmt::println( ::stderr, "{}: -o option may only be used once",
                               process_name );
                 ::exit( EXIT_FAILURE );
@@ -197,14 +291,117 @@ Options:
             assert( optarg != nullptr );
             log_path = optarg;
             assert( log_path != nullptr && log_path[0] != '\0' );
-            log_fs = ::fopen( log_path, "we" );
-            if ( log_fs == nullptr ) {
-                fmt::println( ::stderr, "{}: could not open log file {:?}, {}",
-                              process_name, log_path,
-                              errors::system::message( "fopen" ) );
+            break;
+        case 'z':
+            compress = true;
+            break;
+        case 'L':
+            latency = true;
+            break;
+        case 'S':
+            stalls = true;
+            break;
+        case 'c':
+            stats = true;
+            break;
+        case 'M':
+            assert( optarg != nullptr );
+            if ( std::string_view( optarg ).size() >=
+                 sizeof( ::sockaddr_un::sun_path ) ) {
+                fmt::println( ::stderr, "{}: --metrics socket path {:?} too long",
+                              process_name, optarg );
                 ::exit( EXIT_FAILURE );
             }
+            metrics_path = optarg;
             break;
+        case 'C':
+            assert( optarg != nullptr );
+            if ( std::string_view( optarg ).size() >=
+                 sizeof( ::sockaddr_un::sun_path ) ) {
+                fmt::println( ::stderr, "{}: --control socket path {:?} too long",
+                              process_name, optarg );
+                ::exit( EXIT_FAILURE );
+            }
+            control_path = optarg;
+            break;
+        case 'P':
+            assert( optarg != nullptr );
+            profile_path = optarg;
+            break;
+        case 't': {
+            assert( optarg != nullptr );
+            const std::string_view arg { optarg };
+            for ( size_t field_start {}; field_start <= arg.size(); ) {
+                size_t field_end { arg.find( ',', field_start ) };
+                if ( field_end == std::string_view::npos )
+                    field_end = arg.size();
+                const std::string_view field {
+                    arg.substr( field_start, field_end - field_start ) };
+                field_start = field_end + 1;
+                if ( field == "abs" ) {
+                    timestamp_absolute = true;
+                } else if ( field == "rel" ) {
+                    timestamp_relative = true;
+                } else if ( field == "parse" ) {
+                    timestamp_parse = true;
+                } else if ( field == "fwd" ) {
+                    timestamp_forward = true;
+                } else if ( field == "inproxy" ) {
+                    timestamp_inproxy = true;
+                } else {
+                    fmt::println( ::stderr, "{}: invalid --timestamps field {:?}, "
+                                  "expected one of: \"abs\",\"rel\",\"parse\","
+                                  "\"fwd\",\"inproxy\"",
+                                  process_name, field );
+                    ::exit( EXIT_FAILURE );
+                }
+            }
+        }   break;
+        case 'R': {
+            assert( optarg != nullptr );
+            const std::string_view arg { optarg };
+            const size_t colon_i { arg.find( ':' ) };
+            shm_ring_name = arg.substr( 0, colon_i );
+            if ( colon_i != std::string_view::npos ) {
+                const std::string_view mib_str { arg.substr( colon_i + 1 ) };
+                size_t mib {};
+                const auto [ ptr, ec ] { std::from_chars(
+                    mib_str.data(), mib_str.data() + mib_str.size(), mib ) };
+                if ( mib_str.empty() || ec != std::errc{} ||
+                     ptr != mib_str.data() + mib_str.size() || mib == 0 ) {
+                    fmt::println( ::stderr, "{}: invalid --shmring size {:?}",
+                                  process_name, mib_str );
+                    ::exit( EXIT_FAILURE );
+                }
+                shm_ring_capacity = mib * 1024 * 1024;
+            }
+            if ( shm_ring_name.empty() ||
+                 shm_ring_name.find( '/' ) != std::string::npos ) {
+                fmt::println( ::stderr, "{}: invalid --shmring name {:?}",
+                              process_name, shm_ring_name );
+                ::exit( EXIT_FAILURE );
+            }
+        }   break;
+        case 'O': {
+            assert( optarg != nullptr );
+            std::error_code ec;
+            if ( !std::filesystem::is_directory( optarg, ec ) ) {
+                fmt::println( ::stderr, "{}: --outdir {:?} is not a directory",
+                              process_name, optarg );
+                ::exit( EXIT_FAILURE );
+            }
+            log_dir = optarg;
+        }   break;
+        case 'T': {
+            assert( optarg != nullptr );
+            std::error_code ec;
+            if ( !std::filesystem::is_directory( optarg, ec ) ) {
+                fmt::println( ::stderr, "{}: --record {:?} is not a directory",
+                              process_name, optarg );
+                ::exit( EXIT_FAILURE );
+            }
+            record_dir = optarg;
+        }   break;
         case 'm':
             multiline = true;
             break;
@@ -217,6 +414,69 @@ Options:
         case 'p':
             prefetchatoms = true;
             break;
+        case 'a':
+            assert( optarg != nullptr );
+            prefetchatoms = true;
+            atom_cache_path = optarg;
+            break;
+        case 'A':
+            resolveatoms = true;
+            break;
+        case 'Q':
+            replycache = true;
+            break;
+        case 'G':
+            motioncompress = true;
+            break;
+        case 'U':
+            assert( optarg != nullptr );
+            tunnel_connect = optarg;
+            break;
+        case 'W':
+            assert( optarg != nullptr );
+            tunnel_listen = optarg;
+            break;
+        case 'I': {
+            assert( optarg != nullptr );
+            const std::string_view mib_str { optarg };
+            // budget is sent to tunnel peer as 32 bits
+            static constexpr size_t MAX_MIB { 4095 };
+            size_t mib {};
+            const auto [ ptr, ec ] { std::from_chars(
+                mib_str.data(), mib_str.data() + mib_str.size(), mib ) };
+            if ( mib_str.empty() || ec != std::errc{} ||
+                 ptr != mib_str.data() + mib_str.size() || mib == 0 ||
+                 mib > MAX_MIB ) {
+                fmt::println( ::stderr, "{}: invalid --imagecache size {:?}, "
+                              "expected 1-{} MiB", process_name, mib_str, MAX_MIB );
+                ::exit( EXIT_FAILURE );
+            }
+            image_cache_sz = mib * 1024 * 1024;
+        }   break;
+        case 'f':
+            assert( optarg != nullptr );
+            if ( const auto error { filter.addClause( optarg ) }; error ) {
+                fmt::println( ::stderr, "{}: invalid filter expression {:?}: {}",
+                              process_name, optarg, *error );
+                ::exit( EXIT_FAILURE );
+            }
+            break;
+        case 'r':
+            assert( optarg != nullptr );
+            if ( const auto error { ratelimiter.addRule( optarg ) }; error ) {
+                fmt::println( ::stderr, "{}: invalid rate limit expression {:?}: {}",
+                              process_name, optarg, *error );
+                ::exit( EXIT_FAILURE );
+            }
+            break;
+        case 'N':
+            assert( optarg != nullptr );
+            if ( const auto error { netem.addRule( optarg ) }; error ) {
+                fmt::println( ::stderr, "{}: invalid network emulation "
+                              "expression {:?}: {}", process_name, optarg, *error );
+                ::exit( EXIT_FAILURE );
+            }
+            break;
         case '\0':
             switch( long_only_option ) {
             case LO_HELP:
@@ -248,6 +508,69 @@ Options:
         subcmd_argv = argv + optind;
     }
 
+    if ( tunnel_connect != nullptr && tunnel_listen != nullptr ) {
+        fmt::println( ::stderr, "{}: --tunnelconnect/-U and --tunnellisten/-W "
+                      "cannot be in same command", process_name );
+        ::exit( EXIT_FAILURE );
+    }
+    if ( image_cache_sz != 0 &&
+         tunnel_connect == nullptr && tunnel_listen == nullptr ) {
+        fmt::println( ::stderr, "{}: --imagecache requires --tunnelconnect or "
+                      "--tunnellisten", process_name );
+        ::exit( EXIT_FAILURE );
+    }
+    if ( tunnel_connect != nullptr ) {
+        // no X server is reachable from this end to query
+        if ( prefetchatoms || resolveatoms || systemtimeformat ) {
+            fmt::println( ::stderr, "{}: --tunnelconnect cannot be used with "
+                          "--prefetchatoms, --atomcache, --resolveatoms or "
+                          "--systemtimeformat", process_name );
+            ::exit( EXIT_FAILURE );
+        }
+        copyauth = false;
+    }
+    if ( tunnel_listen != nullptr ) {
+        if ( subcmd_argc > 0 ) {
+            fmt::println( ::stderr, "{}: --tunnellisten cannot be used with a "
+                          "subcommand", process_name );
+            ::exit( EXIT_FAILURE );
+        }
+        // peer may reconnect after link is lost
+        keeprunning = true;
+        copyauth = false;
+    }
+
+    // log file opened after parsing all options, as --compress may follow --outfile
+    if ( compress && log_path == nullptr ) {
+        fmt::println( ::stderr, "{}: --compress requires --outfile",
+                      process_name );
+        ::exit( EXIT_FAILURE );
+    }
+    // unbuffered stream would make each fragment of a line its own gzip member
+    if ( compress && unbuffered ) {
+        fmt::println( ::stderr, "{}: --compress cannot be used with --unbuffered",
+                      process_name );
+        ::exit( EXIT_FAILURE );
+    }
+    if ( log_path != nullptr ) {
+        if ( compress ) {
+#ifdef XTRACEPP_WITH_ZLIB
+            log_fs = GzipLogStream::open( log_path );
+#else
+            fmt::println( ::stderr, "{}: --compress not supported, rebuild "
+                          "with XTRACEPP_WITH_ZLIB", process_name );
+            ::exit( EXIT_FAILURE );
+#endif
+        } else {
+            log_fs = ::fopen( log_path, "we" );
+        }
+        if ( log_fs == nullptr ) {
+            fmt::println( ::stderr, "{}: could not open log file {:?}, {}",
+                          process_name, log_path,
+                          errors::system::message( "open" ) );
+            ::exit( EXIT_FAILURE );
+        }
+    }
     if ( log_fs == ::stdout || log_fs == ::stderr )
         _recordFileStreamBufferDefaults();
     if ( unbuffered ) {
@@ -0,0 +1,125 @@
+#include <algorithm>      // min
+#include <atomic>         // atomic_thread_fence
+#include <new>            // placement new
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <cassert>
+#include <cerrno>         // errno, EEXIST
+#include <cstdint>
+#include <cstring>        // memcpy
+
+#include <fcntl.h>        // O_CREAT, O_EXCL, O_RDWR
+#include <sys/mman.h>     // shm_open, shm_unlink, mmap, munmap
+#include <unistd.h>       // ftruncate, close
+
+#include <fmt/format.h>
+
+#include "ShmRing.hpp"
+#include "errors.hpp"
+
+
+/** @brief Record alignment in data region. */
+static constexpr size_t RECORD_ALIGN { 8 };
+
+ShmRing::~ShmRing() {
+    if ( _header == nullptr )
+        return;
+    ::munmap( _header, _map_sz );
+    ::shm_unlink( _name.c_str() );
+}
+
+std::optional< std::string >
+ShmRing::open( const std::string_view name, size_t capacity ) {
+    assert( _header == nullptr );
+    // data region must hold at least a few maximally sized records
+    static constexpr size_t MIN_CAPACITY { 64 * 1024 };
+    size_t pow2_capacity { MIN_CAPACITY };
+    while ( pow2_capacity < capacity )
+        pow2_capacity <<= 1;
+    capacity = pow2_capacity;
+
+    _name = ( !name.empty() && name.front() == '/' ) ?
+        std::string( name ) : fmt::format( "/{}", name );
+    // traced traffic is private to this user, and an object left by an
+    //   earlier run is replaced rather than reused, so that no object created
+    //   in advance by another user is ever written
+    int fd { ::shm_open( _name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600 ) };
+    if ( fd == -1 && errno == EEXIST ) {
+        // fails for objects of other users, under sticky /dev/shm
+        if ( ::shm_unlink( _name.c_str() ) == -1 )
+            return errors::system::message( "shm_unlink" );
+        fd = ::shm_open( _name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600 );
+    }
+    if ( fd == -1 )
+        return errors::system::message( "shm_open" );
+    static constexpr size_t HEADER_SZ {
+        ( sizeof( Header ) + RECORD_ALIGN - 1 ) / RECORD_ALIGN * RECORD_ALIGN };
+    _map_sz = HEADER_SZ + capacity;
+    if ( ::ftruncate( fd, off_t( _map_sz ) ) == -1 ) {
+        const std::string error { errors::system::message( "ftruncate" ) };
+        ::close( fd );
+        ::shm_unlink( _name.c_str() );
+        return error;
+    }
+    void* map { ::mmap( nullptr, _map_sz, PROT_READ | PROT_WRITE, MAP_SHARED,
+                        fd, 0 ) };
+    ::close( fd );
+    if ( map == MAP_FAILED ) {
+        const std::string error { errors::system::message( "mmap" ) };
+        ::shm_unlink( _name.c_str() );
+        return error;
+    }
+    _header = new ( map ) Header {};
+    _header->magic     = MAGIC;
+    _header->version   = VERSION;
+    _header->header_sz = uint32_t( HEADER_SZ );
+    _header->capacity  = capacity;
+    _data = static_cast< uint8_t* >( map ) + HEADER_SZ;
+    return std::nullopt;
+}
+
+void ShmRing::publish( const RecordType type, const Direction direction,
+                       const uint8_t code, const uint8_t minor_opcode,
+                       const uint16_t sequence, const uint32_t conn_id,
+                       const uint64_t recv_ns, const std::string_view text ) {
+    assert( _header != nullptr );
+    const uint64_t capacity { _header->capacity };
+    RecordHeader record {};
+    record.type         = type;
+    record.direction    = direction;
+    record.code         = code;
+    record.minor_opcode = minor_opcode;
+    record.sequence     = sequence;
+    record.conn_id      = conn_id;
+    record.text_sz = uint32_t( std::min(
+        text.size(), size_t( capacity / 4 ) - sizeof( RecordHeader ) ) );
+    record.size = uint32_t(
+        ( sizeof( RecordHeader ) + record.text_sz + RECORD_ALIGN - 1 ) /
+        RECORD_ALIGN * RECORD_ALIGN );
+    record.time_ns      = recv_ns;
+
+    size_t offset ( _pos & ( capacity - 1 ) );
+    uint64_t pad_sz {};
+    if ( offset + record.size > capacity ) {
+        pad_sz = capacity - offset;
+        offset = 0;
+    }
+    // claim bytes before writing them, so consumers can detect torn reads
+    _header->reserve_pos.store( _pos + pad_sz + record.size,
+                                std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+    if ( pad_sz != 0 ) {
+        // records are aligned, so at least size and type fit in padding
+        const uint32_t pad_size ( pad_sz );
+        const uint16_t pad_type { PADDING };
+        uint8_t* pad { _data + ( _pos & ( capacity - 1 ) ) };
+        std::memcpy( pad, &pad_size, sizeof( pad_size ) );
+        std::memcpy( pad + sizeof( pad_size ), &pad_type, sizeof( pad_type ) );
+    }
+    std::memcpy( _data + offset, &record, sizeof( record ) );
+    std::memcpy( _data + offset + sizeof( record ), text.data(), record.text_sz );
+    _pos += pad_sz + record.size;
+    _header->write_pos.store( _pos, std::memory_order_release );
+}
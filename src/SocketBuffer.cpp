@@ -1,9 +1,11 @@
+#include <algorithm>         // max, min, find_if
+#include <iterator>          // next, prev
 #include <optional>          // nullopt
 #include <string>
 #include <utility>           // pair
 
 #include <cassert>
-#include <cstring>           // memcpy
+#include <cstring>           // memcpy, memmove
 
 #include <sys/socket.h>      // send, recv
 #include <unistd.h>          // ssize_t
@@ -11,33 +13,60 @@
 #include <fmt/format.h>
 
 #include "SocketBuffer.hpp"
+#include "Profiler.hpp"
 #include "errors.hpp"
+#include "monotonic.hpp"
 
 
+void SocketBuffer::_reserve( const size_t sz ) {
+    if ( sz <= capacity() )
+        return;
+    // while bytes are held (or unparsed) the buffer may never empty to be
+    //   cleared, so once written bytes are at least half of it, move unwritten
+    //   bytes to the front rather than growing behind them
+    if ( _bytes_written > 0 && _bytes_written >= _buffer.size() / 2 ) {
+        ::memmove( _buffer.data(), data(), size() );
+        for ( _Read& read : _reads )
+            read.end -= _bytes_written;
+        for ( _Mark& mark : _marks )
+            mark.end -= _bytes_written;
+        _bytes_read    -= _bytes_written;
+        _bytes_written  = 0;
+        if ( sz <= capacity() )
+            return;
+    }
+    const size_t raw_sz { _buffer.size() + ( sz - capacity() ) };
+    // nearest larger multiple of _BLOCK_SZ
+    _buffer.resize(
+        raw_sz + ( ( _BLOCK_SZ - ( raw_sz % _BLOCK_SZ ) ) % _BLOCK_SZ ) );
+    assert( capacity() >= sz );
+}
+
 std::pair< size_t, std::optional< std::string > >
 SocketBuffer::read( const int sockfd,
                     const size_t bytes_to_read ) {
-    if ( bytes_to_read > capacity() ) {
-        const size_t raw_sz {
-            _buffer.size() + ( bytes_to_read - capacity() ) };
-        // nearest larger multiple of _BLOCK_SZ
-        _buffer.resize(
-            raw_sz + ( ( _BLOCK_SZ - ( raw_sz % _BLOCK_SZ ) ) % _BLOCK_SZ ) );
-        assert( capacity() >= bytes_to_read );
-    }
+    const Profiler::Scope scope { "read" };
+    _reserve( bytes_to_read );
     const ssize_t recv_ret {
         ::recv( sockfd, _buffer.data() + _bytes_read, bytes_to_read, _MSG_NONE ) };
     if ( recv_ret == -1 )
         return { 0, errors::system::message( "recv" ) };
     const size_t recv_sz ( recv_ret );
+    _read_ns = monotonic::now();
     _bytes_read += recv_sz;
+    if ( recv_sz > 0 )
+        _reads.push_back( { _bytes_read, _read_ns } );
     return { recv_sz, std::nullopt };
 }
 
 std::pair< size_t, std::optional< std::string > >
 SocketBuffer::read( const int sockfd ) {
+    // buffer may still hold parsed messages awaiting write, so only unparsed
+    //   bytes count toward next message; when buffer is full, grow by a block
+    //   rather than requesting 0 bytes (indistinguishable from peer shutdown)
     const size_t bytes_to_read {
-        !messageSizeSet() ? capacity() : ( _next_message_sz - size() ) };
+        !messageSizeSet() ? ( capacity() == 0 ? _BLOCK_SZ : capacity() ) :
+                            ( _next_message_sz - unparsed() ) };
     return read( sockfd, bytes_to_read );
 }
 
@@ -45,32 +74,167 @@ size_t SocketBuffer::load( const void* input,
                            const size_t bytes_to_load ) {
     assert( input != nullptr );
     assert( bytes_to_load > 0 );
-    if ( bytes_to_load > capacity() ) {
-        const size_t raw_sz {
-            _buffer.size() + ( bytes_to_load - capacity() ) };
-        // nearest larger multiple of _BLOCK_SZ
-        _buffer.resize(
-            raw_sz + ( ( _BLOCK_SZ - ( raw_sz % _BLOCK_SZ ) ) % _BLOCK_SZ ) );
-        assert( capacity() >= bytes_to_load );
-    }
+    _reserve( bytes_to_load );
     ::memcpy( _buffer.data() + _bytes_read, input, bytes_to_load );
+    _read_ns = monotonic::now();
     _bytes_read += bytes_to_load;
+    _reads.push_back( { _bytes_read, _read_ns } );
     return bytes_to_load;
 }
 
+void SocketBuffer::markMessageParsed( const uint16_t sequence,
+                                      const bool logged ) {
+    assert( messageSizeSet() );
+    _marks.push_back( { _bytes_written + _bytes_parsed + _next_message_sz,
+                        { sequence, logged, _next_message_sz, _read_ns, {} } } );
+    markMessageParsed();
+}
+
+std::optional< SocketBuffer::ParsedMessage > SocketBuffer::takeWritten() {
+    if ( _written.empty() )
+        return std::nullopt;
+    const ParsedMessage message { _written.front() };
+    _written.pop_front();
+    return message;
+}
+
+void SocketBuffer::_shiftReads( const size_t offset, const size_t sz,
+                                const bool inserted ) {
+    for ( _Read& read : _reads ) {
+        if ( read.end <= offset )
+            continue;
+        read.end = inserted ? read.end + sz :
+                              read.end - std::min( read.end - offset, sz );
+    }
+}
+
+void SocketBuffer::_popWritten() {
+    while ( !_reads.empty() && _reads.front().end <= _bytes_written )
+        _reads.pop_front();
+    // unloaded messages are not returned by takeWritten
+    while ( !_marks.empty() && _marks.front().end <= _bytes_written )
+        _marks.pop_front();
+}
+
+void SocketBuffer::dropMessage() {
+    assert( messageSizeSet() );
+    assert( unparsed() >= _next_message_sz );
+    uint8_t* message { data() + _bytes_parsed };
+    ::memmove( message, message + _next_message_sz,
+               unparsed() - _next_message_sz );
+    _shiftReads( _bytes_written + _bytes_parsed, _next_message_sz, false );
+    _bytes_read -= _next_message_sz;
+    _next_message_sz = _UNKNOWN_SZ;
+    if ( _bytes_written == _bytes_read )
+        clear();
+}
+
+void SocketBuffer::dropLastParsed() {
+    assert( lastParsed() != nullptr );
+    const size_t sz { _last_parsed_sz };
+    if ( _holding && unheld() < sz ) {
+        // message is not among parsed bytes yet to be held, so it ends last
+        //   hold, or else those released
+        if ( !_holds.empty() ) {
+            assert( unheld() == 0 && _holds.back().sz >= sz );
+            _holds.back().sz -= sz;
+            if ( _holds.back().sz == 0 )
+                _holds.pop_back();
+            _bytes_held -= sz;
+        } else {
+            assert( unheld() == 0 && _bytes_released >= sz );
+            _bytes_released -= sz;
+        }
+    }
+    const size_t end { _bytes_written + _bytes_parsed };
+    if ( !_marks.empty() && _marks.back().end == end )
+        _marks.pop_back();
+    uint8_t* message { lastParsed() };
+    ::memmove( message, message + sz, unparsed() );
+    _shiftReads( end - sz, sz, false );
+    _bytes_read     -= sz;
+    _bytes_parsed   -= sz;
+    _last_parsed_sz  = 0;
+    if ( _bytes_written == _bytes_read )
+        clear();
+}
+
+void SocketBuffer::insertParsed( const void* input,
+                                 const size_t bytes_to_insert ) {
+    assert( input != nullptr );
+    assert( bytes_to_insert > 0 );
+    _reserve( bytes_to_insert );
+    // inserted bytes are timed as if read now, splitting any read they fall in
+    const size_t offset { _bytes_written + _bytes_parsed };
+    _shiftReads( offset, bytes_to_insert, true );
+    auto read_it {
+        std::find_if( _reads.begin(), _reads.end(), [offset]( const _Read& read ) {
+            return read.end > offset; } ) };
+    const size_t read_begin {
+        read_it == _reads.begin() ? _bytes_written : std::prev( read_it )->end };
+    if ( read_it != _reads.end() && read_begin < offset )
+        read_it = std::next( _reads.insert( read_it, { offset, read_it->read_ns } ) );
+    _reads.insert( read_it, { offset + bytes_to_insert, monotonic::now() } );
+    uint8_t* insertion { data() + _bytes_parsed };
+    ::memmove( insertion + bytes_to_insert, insertion, unparsed() );
+    ::memcpy( insertion, input, bytes_to_insert );
+    _bytes_read   += bytes_to_insert;
+    _bytes_parsed += bytes_to_insert;
+    // inserted bytes may be several messages
+    _last_parsed_sz = 0;
+}
+
+size_t SocketBuffer::holdParsed( const uint64_t release_ns ) {
+    if ( !_holding ) {
+        // bytes parsed before holding began are held along with new ones
+        _holding = true;
+        _bytes_released = 0;
+    }
+    assert( _bytes_parsed >= _bytes_released + _bytes_held );
+    const size_t bytes_to_hold { unheld() };
+    if ( bytes_to_hold == 0 )
+        return 0;
+    _holds.push_back(
+        { bytes_to_hold, _holds.empty() ? release_ns :
+                         std::max( release_ns, _holds.back().release_ns ) } );
+    _bytes_held += bytes_to_hold;
+    return bytes_to_hold;
+}
+
+size_t SocketBuffer::release( const uint64_t now_ns ) {
+    size_t bytes_released {};
+    while ( !_holds.empty() && _holds.front().release_ns <= now_ns ) {
+        bytes_released += _holds.front().sz;
+        _holds.pop_front();
+    }
+    _bytes_held     -= bytes_released;
+    _bytes_released += bytes_released;
+    return bytes_released;
+}
+
 std::pair< size_t, std::optional< std::string > >
 SocketBuffer::write( const int sockfd,
                      const size_t bytes_to_write ) {
-    assert( bytes_to_write <= _bytes_parsed );
+    const Profiler::Scope scope { "write" };
+    assert( bytes_to_write <= writable() );
     const ssize_t send_ret {
         ::send( sockfd, data(), bytes_to_write, _MSG_NONE ) };
     if ( send_ret == -1 )
         return { 0, errors::system::message( "send" ) };
     const size_t send_sz ( send_ret );
     assert( send_sz == bytes_to_write );
+    _write_ns = monotonic::now();
     // bytes written removed (hidden) from front of buffer
     _bytes_written += send_sz;
     _bytes_parsed  -= send_sz;
+    if ( _holding )
+        _bytes_released -= send_sz;
+    while ( !_marks.empty() && _marks.front().end <= _bytes_written ) {
+        _written.push_back( _marks.front().message );
+        _written.back().write_ns = _write_ns;
+        _marks.pop_front();
+    }
+    _popWritten();
     if ( _bytes_written == _bytes_read )
         clear();
     return { send_sz, std::nullopt };
@@ -78,7 +242,7 @@ SocketBuffer::write( const int sockfd,
 
 std::pair< size_t, std::optional< std::string > >
 SocketBuffer::write( const int sockfd ) {
-    return write( sockfd, _bytes_parsed );
+    return write( sockfd, writable() );
 }
 
 size_t SocketBuffer::unload( void* output,
@@ -88,6 +252,7 @@ size_t SocketBuffer::unload( void* output,
     ::memcpy( output, data(), bytes_to_unload );
     // bytes written removed (hidden) from front of buffer
     _bytes_written += bytes_to_unload;
+    _popWritten();
     if ( _bytes_written == _bytes_read )
         clear();
     return bytes_to_unload;
@@ -97,6 +262,7 @@ size_t SocketBuffer::unload( const size_t bytes_to_unload ) {
     assert( bytes_to_unload <= size() );
     // bytes written removed (hidden) from front of buffer
     _bytes_written += bytes_to_unload;
+    _popWritten();
     if ( _bytes_written == _bytes_read )
         clear();
     return bytes_to_unload;
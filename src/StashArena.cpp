@@ -0,0 +1,70 @@
+#include <algorithm>      // max, find_if
+#include <memory>         // make_unique
+#include <optional>
+#include <string_view>
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>        // memcpy
+
+#include "StashArena.hpp"
+
+
+void StashArena::_release( _Entry& entry ) {
+    assert( !entry.released );
+    entry.released = true;
+    _Block* block { entry.block };
+    // empty data is not stored
+    if ( block == nullptr )
+        return;
+    assert( block->live > 0 );
+    if ( --block->live > 0 )
+        return;
+    block->used = 0;
+    if ( block != _current )
+        _free_blocks.push_back( block );
+}
+
+void StashArena::stash( const uint16_t seq_num, const std::string_view str ) {
+    if ( str.empty() ) {
+        _entries.push_back( { seq_num, {}, nullptr } );
+        return;
+    }
+    if ( _current == nullptr || _current->sz - _current->used < str.size() ) {
+        // current block is freed by its last release
+        if ( _current != nullptr && _current->live == 0 )
+            _free_blocks.push_back( _current );
+        const auto free_it { std::find_if(
+                _free_blocks.begin(), _free_blocks.end(),
+                [ &str ]( const _Block* block ) {
+                    return block->sz >= str.size(); } ) };
+        if ( free_it != _free_blocks.end() ) {
+            _current = *free_it;
+            _free_blocks.erase( free_it );
+        } else {
+            _blocks.emplace_back( std::make_unique< _Block >() );
+            _current = _blocks.back().get();
+            _current->sz = std::max( BLOCK_SZ, str.size() );
+            _current->data = std::make_unique< char[] >( _current->sz );
+        }
+        assert( _current->used == 0 && _current->live == 0 );
+    }
+    char* copy { _current->data.get() + _current->used };
+    ::memcpy( copy, str.data(), str.size() );
+    _current->used += str.size();
+    ++_current->live;
+    _entries.push_back( { seq_num, { copy, str.size() }, _current } );
+}
+
+std::optional< std::string_view > StashArena::unstash( const uint16_t seq_num ) {
+    const auto it { std::find_if(
+            _entries.begin(), _entries.end(), [ seq_num ]( const _Entry& entry ) {
+                return !entry.released && entry.seq_num == seq_num; } ) };
+    if ( it == _entries.end() )
+        return std::nullopt;
+    const std::string_view str { it->str };
+    _release( *it );
+    while ( !_entries.empty() && _entries.front().released )
+        _entries.pop_front();
+    return str;
+}
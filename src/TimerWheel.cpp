@@ -0,0 +1,41 @@
+#include <algorithm>      // max, min
+#include <limits>         // numeric_limits
+
+#include <cstdint>
+
+#include "TimerWheel.hpp"
+
+
+void TimerWheel::schedule( const uint64_t deadline_ns, const uint32_t id ) {
+    // deadlines already past are due on next expiry
+    const uint64_t tick { std::max( deadline_ns / _TICK_NS, _tick ) };
+    _slots[ tick % _SLOT_CT ].push_back( { deadline_ns, id } );
+    ++_size;
+}
+
+int TimerWheel::timeoutMs( const uint64_t now_ns ) const {
+    if ( _size == 0 )
+        return -1;
+    static constexpr uint64_t NONE { std::numeric_limits< uint64_t >::max() };
+    uint64_t next_ns { NONE };
+    for ( uint64_t tick { _tick }; tick < _tick + _SLOT_CT && next_ns == NONE;
+          ++tick ) {
+        for ( const _Timer& timer : _slots[ tick % _SLOT_CT ] ) {
+            // timers of later rotations share slot
+            if ( timer.deadline_ns / _TICK_NS <= tick )
+                next_ns = std::min( next_ns, timer.deadline_ns );
+        }
+    }
+    if ( next_ns == NONE ) {
+        // all timers are more than one rotation away
+        for ( const std::vector< _Timer >& slot : _slots ) {
+            for ( const _Timer& timer : slot )
+                next_ns = std::min( next_ns, timer.deadline_ns );
+        }
+    }
+    if ( next_ns <= now_ns )
+        return 0;
+    const uint64_t timeout_ms { ( next_ns - now_ns + _TICK_NS - 1 ) / _TICK_NS };
+    return int( std::min< uint64_t >(
+                    timeout_ms, std::numeric_limits< int >::max() ) );
+}
@@ -0,0 +1,47 @@
+#include <optional>
+#include <string>
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>         // FILE, fopen, fwrite, fclose
+
+#include "TrafficRecording.hpp"
+#include "errors.hpp"
+
+
+::FILE* TrafficRecording::open( const std::string& path,
+                                const uint64_t start_time ) {
+    ::FILE* fs { ::fopen( path.c_str(), "we" ) };
+    if ( fs == nullptr )
+        return nullptr;
+    const FileHeader header {
+        MAGIC, VERSION, sizeof( FileHeader ), start_time };
+    if ( ::fwrite( &header, sizeof( header ), 1, fs ) != 1 ) {
+        ::fclose( fs );
+        return nullptr;
+    }
+    return fs;
+}
+
+std::optional< std::string >
+TrafficRecording::append( ::FILE* fs, const Direction direction,
+                          const uint64_t offset_ns,
+                          const uint8_t* data, const size_t sz ) {
+    assert( fs != nullptr );
+    assert( data != nullptr );
+    assert( sz > 0 );
+    const RecordHeader header {
+        offset_ns, uint32_t( sz ), direction, {} };
+    if ( ::fwrite( &header, sizeof( header ), 1, fs ) != 1 ||
+         ::fwrite( data, 1, sz, fs ) != sz ) {
+        return errors::system::message( "fwrite" );
+    }
+    return std::nullopt;
+}
+
+std::optional< std::string > TrafficRecording::close( ::FILE* fs ) {
+    assert( fs != nullptr );
+    if ( ::fclose( fs ) != 0 )
+        return errors::system::message( "fclose" );
+    return std::nullopt;
+}
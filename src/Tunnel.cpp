@@ -0,0 +1,925 @@
+#include <algorithm>      // min, any_of
+#include <memory>         // make_unique
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>        // pair, move
+#include <vector>
+
+#include <cassert>
+#include <cerrno>         // errno, EINTR, EAGAIN, EWOULDBLOCK
+#include <cstdint>
+#include <cstdio>         // stderr
+
+#include <poll.h>         // pollfd, poll, POLLIN, POLLOUT, POLLHUP, POLLERR
+#include <sys/socket.h>   // socketpair, send, recv, accept4, AF_UNIX, MSG_...
+#include <unistd.h>       // close
+
+#ifdef XTRACEPP_WITH_ZLIB
+#include <zlib.h>         // z_stream, deflateInit2, deflate, inflateInit2...
+#endif
+
+#include <fmt/format.h>
+
+#include "Tunnel.hpp"
+#include "ImageCache.hpp"
+#include "Metrics.hpp"
+#include "errors.hpp"
+#include "protocol/requests.hpp"
+
+
+/**
+ * @brief Link compression state, one deflate stream per direction.
+ */
+struct Tunnel::_Codec {
+#ifdef XTRACEPP_WITH_ZLIB
+    /** @brief Compresses frames sent. */
+    ::z_stream deflater {};
+    /** @brief Decompresses frames received. */
+    ::z_stream inflater {};
+    /** @brief Whether both streams were initialized. */
+    bool       ok {};
+
+    _Codec() {
+        // negative windowBits selects raw deflate, as link has its own
+        //   handshake and is never checked against a trailer
+        static constexpr int RAW_WINDOW_BITS { -15 };
+        static constexpr int MEM_LEVEL       { 8 };
+        ok = ::deflateInit2( &deflater, Z_BEST_SPEED, Z_DEFLATED,
+                             RAW_WINDOW_BITS, MEM_LEVEL,
+                             Z_DEFAULT_STRATEGY ) == Z_OK;
+        ok = ::inflateInit2( &inflater, RAW_WINDOW_BITS ) == Z_OK && ok;
+    }
+    ~_Codec() {
+        ::deflateEnd( &deflater );
+        ::inflateEnd( &inflater );
+    }
+    _Codec( const _Codec& ) = delete;
+    _Codec& operator=( const _Codec& ) = delete;
+#endif
+};
+
+namespace {
+
+/**
+ * @brief Appends 32-bit value in little-endian order, as used by frame
+ *   headers regardless of host or X11 connection byte order.
+ * @param[out] out string to append to
+ * @param value value to append
+ */
+void appendCard32( std::string& out, const uint32_t value ) {
+    for ( int i {}; i < 4; ++i )
+        out.push_back( char( ( value >> ( 8 * i ) ) & 0xff ) );
+}
+
+/**
+ * @brief Appends 64-bit value in little-endian order, see
+ *   [appendCard32](#appendCard32).
+ * @param[out] out string to append to
+ * @param value value to append
+ */
+void appendCard64( std::string& out, const uint64_t value ) {
+    appendCard32( out, uint32_t( value ) );
+    appendCard32( out, uint32_t( value >> 32 ) );
+}
+
+/**
+ * @brief Reads 32-bit little-endian value written by
+ *   [appendCard32](#appendCard32).
+ * @param data bytes to read
+ * @return value read
+ */
+uint32_t readCard32( const uint8_t* data ) {
+    return uint32_t( data[ 0 ] ) | ( uint32_t( data[ 1 ] ) << 8 ) |
+        ( uint32_t( data[ 2 ] ) << 16 ) | ( uint32_t( data[ 3 ] ) << 24 );
+}
+
+/**
+ * @brief Reads 64-bit little-endian value written by
+ *   [appendCard64](#appendCard64).
+ * @param data bytes to read
+ * @return value read
+ */
+uint64_t readCard64( const uint8_t* data ) {
+    return uint64_t( readCard32( data ) ) |
+        ( uint64_t( readCard32( data + 4 ) ) << 32 );
+}
+
+/**
+ * @brief Whether socket operation failed only for lack of data or space.
+ * @return whether `errno` is `EAGAIN`, `EWOULDBLOCK` or `EINTR`
+ */
+bool wouldBlock() {
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+}  // namespace
+
+Tunnel::Tunnel() = default;
+
+Tunnel::~Tunnel() {
+    stop();
+}
+
+std::optional< std::string > Tunnel::start(
+    const Role role, const int fd, const size_t image_budget ) {
+    assert( !_thread.joinable() );
+    assert( fd >= 0 );
+    assert( image_budget <= UINT32_MAX );
+    _role = role;
+    _image_budget = image_budget;
+    if ( ::socketpair( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0,
+                       _wake_fds ) == -1 ) {
+        ::close( fd );
+        return errors::system::message( "socketpair" );
+    }
+    if ( _role == Role::LISTEN ) {
+        if ( ::socketpair( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK,
+                           0, _accept_fds ) == -1 ) {
+            ::close( fd );
+            return errors::system::message( "socketpair" );
+        }
+        _listen_fd = fd;
+    } else {
+        _openLink( fd );
+    }
+    _open.store( true );
+    _thread = std::thread( &Tunnel::_serve, this );
+    return std::nullopt;
+}
+
+void Tunnel::stop() {
+    if ( _thread.joinable() ) {
+        {
+            std::lock_guard< std::mutex > lock { _mutex };
+            _stopping = true;
+        }
+        ::send( _wake_fds[ 0 ], "", 1, MSG_DONTWAIT | MSG_NOSIGNAL );
+        _thread.join();
+    }
+    _open.store( false );
+    if ( _link_fd != _UNINIT_FD )
+        ::close( _link_fd );
+    if ( _listen_fd != _UNINIT_FD )
+        ::close( _listen_fd );
+    _link_fd = _listen_fd = _UNINIT_FD;
+    for ( const auto& [ id, channel ] : _channels )
+        ::close( channel.fd );
+    _channels.clear();
+    for ( const auto& [ id, fd ] : _opened )
+        ::close( fd );
+    _opened.clear();
+    for ( const auto& [ id, fd ] : _accepted )
+        ::close( fd );
+    _accepted.clear();
+    for ( int& fd : _wake_fds ) {
+        if ( fd != _UNINIT_FD )
+            ::close( fd );
+        fd = _UNINIT_FD;
+    }
+    for ( int& fd : _accept_fds ) {
+        if ( fd != _UNINIT_FD )
+            ::close( fd );
+        fd = _UNINIT_FD;
+    }
+}
+
+int Tunnel::openChannel() {
+    assert( _role == Role::CONNECT );
+    if ( !isOpen() )
+        return _UNINIT_FD;
+    // proxy end stays blocking, as SocketBuffer expects
+    int fds[ 2 ] {};
+    if ( ::socketpair( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds ) == -1 )
+        return _UNINIT_FD;
+    {
+        std::lock_guard< std::mutex > lock { _mutex };
+        _opened.emplace_back( _next_channel_id++, fds[ 0 ] );
+    }
+    ::send( _wake_fds[ 0 ], "", 1, MSG_DONTWAIT | MSG_NOSIGNAL );
+    return fds[ 1 ];
+}
+
+std::optional< std::pair< uint32_t, int > > Tunnel::acceptChannel() {
+    assert( _role == Role::LISTEN );
+    char notice {};
+    ::recv( _accept_fds[ 1 ], &notice, sizeof( notice ), MSG_DONTWAIT );
+    std::lock_guard< std::mutex > lock { _mutex };
+    if ( _accepted.empty() )
+        return std::nullopt;
+    const std::pair< uint32_t, int > channel { _accepted.front() };
+    _accepted.pop_front();
+    return channel;
+}
+
+void Tunnel::_serve() {
+    std::vector< ::pollfd > pfds;
+    std::vector< uint32_t > pfd_channel_ids;
+    while ( true ) {
+        {
+            std::lock_guard< std::mutex > lock { _mutex };
+            if ( _stopping )
+                return;
+        }
+        _takeOpenedChannels();
+        if ( _link_fd != _UNINIT_FD ) {
+            std::optional< std::string > error { _flushFrames() };
+            if ( !error )
+                error = _writeLink();
+            if ( error )
+                _closeLink( *error );
+        }
+        if ( _role == Role::CONNECT && _link_fd == _UNINIT_FD )
+            _open.store( false );
+        pfds.clear();
+        pfd_channel_ids.clear();
+        pfds.push_back( { _wake_fds[ 1 ], POLLIN, 0 } );
+        if ( _link_fd != _UNINIT_FD ) {
+            // reading paused while any channel is backed up
+            const bool channels_backed_up {
+                std::any_of( _channels.begin(), _channels.end(),
+                             []( const auto& id_channel ) {
+                                 return id_channel.second.out.size() >
+                                     _MAX_CHANNEL_BACKLOG; } ) };
+            pfds.push_back( { _link_fd,
+                              short( ( channels_backed_up ? 0 : POLLIN ) |
+                                     ( _link_out.empty() ? 0 : POLLOUT ) ),
+                              0 } );
+        } else if ( _listen_fd != _UNINIT_FD ) {
+            pfds.push_back( { _listen_fd, POLLIN, 0 } );
+        }
+        const size_t channels_i { pfds.size() };
+        for ( const auto& [ id, channel ] : _channels ) {
+            short events {};
+            // reading paused while link is backed up
+            if ( !channel.closing && _link_backlog < _MAX_LINK_BACKLOG )
+                events |= POLLIN;
+            if ( !channel.out.empty() )
+                events |= POLLOUT;
+            pfds.push_back( { channel.fd, events, 0 } );
+            pfd_channel_ids.push_back( id );
+        }
+        if ( ::poll( pfds.data(), ::nfds_t( pfds.size() ), -1 ) == -1 ) {
+            if ( errno == EINTR )
+                continue;
+            fmt::println( ::stderr, "tunnel: {}, closing tunnel",
+                          errors::system::message( "poll" ) );
+            _closeLink( "poll failed" );
+            _open.store( false );
+            return;
+        }
+        if ( pfds[ 0 ].revents & POLLIN ) {
+            char drain[ 64 ];
+            while ( ::recv( _wake_fds[ 1 ], drain, sizeof( drain ),
+                            MSG_DONTWAIT ) > 0 ) {}
+        }
+        if ( channels_i > 1 ) {
+            const ::pollfd& pfd { pfds[ 1 ] };
+            if ( pfd.fd == _link_fd ) {
+                std::optional< std::string > error;
+                if ( pfd.revents & ( POLLIN | POLLHUP | POLLERR ) )
+                    error = _readLink();
+                if ( !error && ( pfd.revents & POLLOUT ) )
+                    error = _writeLink();
+                if ( error )
+                    _closeLink( *error );
+            } else if ( pfd.fd == _listen_fd && ( pfd.revents & POLLIN ) ) {
+                const int fd { ::accept4( _listen_fd, nullptr, nullptr,
+                                          SOCK_CLOEXEC ) };
+                if ( fd == -1 ) {
+                    fmt::println( ::stderr, "tunnel: {}",
+                                  errors::system::message( "accept4" ) );
+                } else {
+                    fmt::println( ::stderr, "tunnel: peer connected" );
+                    _openLink( fd );
+                }
+            }
+        }
+        for ( size_t i { channels_i }; i < pfds.size(); ++i ) {
+            const uint32_t id { pfd_channel_ids[ i - channels_i ] };
+            // channel may have been closed with link
+            const auto channel_it { _channels.find( id ) };
+            if ( channel_it == _channels.end() ||
+                 channel_it->second.fd != pfds[ i ].fd ) {
+                continue;
+            }
+            _Channel& channel { channel_it->second };
+            const short revents { pfds[ i ].revents };
+            if ( ( revents & POLLOUT ) && !_writeChannel( id, channel ) )
+                continue;
+            if ( revents & ( POLLIN | POLLHUP | POLLERR ) )
+                _readChannel( id, channel );
+        }
+    }
+}
+
+void Tunnel::_openLink( const int fd ) {
+    assert( _link_fd == _UNINIT_FD );
+    _link_fd = fd;
+    _codec = std::make_unique< _Codec >();
+    _handshake_received = false;
+    _peer_image_budget = 0;
+    _frames.clear();
+    _link_in.clear();
+    _link_frames.clear();
+    _link_out.clear();
+    _link_out_sent = 0;
+    std::string handshake { _MAGIC };
+#ifdef XTRACEPP_WITH_ZLIB
+    handshake.push_back( char( _FLAG_DEFLATE ) );
+#else
+    handshake.push_back( '\0' );
+#endif
+    appendCard32( handshake, uint32_t( _image_budget ) );
+    _link_backlog = handshake.size();
+    _link_out.push_back( std::move( handshake ) );
+}
+
+void Tunnel::_closeLink( const std::string_view reason ) {
+    fmt::println( ::stderr, "tunnel: link closed: {}{}", reason,
+                  _channels.empty() ? "" :
+                  fmt::format( ", closing {} connections", _channels.size() ) );
+    if ( _link_fd != _UNINIT_FD ) {
+        ::close( _link_fd );
+        _link_fd = _UNINIT_FD;
+    }
+    // closing tunnel ends shows proxied connections EOF
+    for ( const auto& [ id, channel ] : _channels )
+        ::close( channel.fd );
+    _channels.clear();
+    _codec.reset();
+    _frames.clear();
+    _link_in.clear();
+    _link_frames.clear();
+    _link_out.clear();
+    _link_out_sent = 0;
+    _link_backlog = 0;
+}
+
+void Tunnel::_takeOpenedChannels() {
+    std::vector< std::pair< uint32_t, int > > opened;
+    {
+        std::lock_guard< std::mutex > lock { _mutex };
+        opened.swap( _opened );
+    }
+    for ( const auto& [ id, fd ] : opened ) {
+        if ( _link_fd == _UNINIT_FD ) {
+            ::close( fd );
+            continue;
+        }
+        _addChannel( id, fd );
+        _appendFrame( _OPEN, id );
+    }
+}
+
+void Tunnel::_addChannel( const uint32_t id, const int fd ) {
+    assert( _channels.count( id ) == 0 );
+    _Channel& channel { _channels[ id ] };
+    channel.fd = fd;
+    channel.sent_images.setBudget( _image_budget );
+    channel.received_images.setBudget( _peer_image_budget );
+}
+
+void Tunnel::_closeChannel( const uint32_t id, const bool notify_peer ) {
+    const auto channel_it { _channels.find( id ) };
+    assert( channel_it != _channels.end() );
+    const _Channel& channel { channel_it->second };
+    if ( const size_t image_ct { channel.image_hits + channel.image_misses };
+         image_ct > 0 ) {
+        fmt::println( ::stderr, "tunnel: channel {}: image cache hit rate "
+                      "{:.1f}% ({}/{}), {}B saved", id,
+                      100.0 * double( channel.image_hits ) / double( image_ct ),
+                      channel.image_hits, image_ct, channel.image_bytes_saved );
+    }
+    ::close( channel.fd );
+    _channels.erase( channel_it );
+    if ( notify_peer )
+        _appendFrame( _CLOSE, id );
+}
+
+bool Tunnel::_readChannel( const uint32_t id, _Channel& channel ) {
+    char buf[ _READ_SZ ];
+    const ::ssize_t recv_ret {
+        ::recv( channel.fd, buf, sizeof( buf ), MSG_DONTWAIT ) };
+    if ( recv_ret == -1 && wouldBlock() )
+        return true;
+    if ( recv_ret <= 0 ) {
+        // proxied connection closed
+        _closeChannel( id, true );
+        return false;
+    }
+    Metrics::add( Metrics::TUNNEL_CHANNEL_BYTES, size_t( recv_ret ) );
+    channel.in.append( buf, size_t( recv_ret ) );
+    const uint8_t* data {
+        reinterpret_cast< const uint8_t* >( channel.in.data() ) };
+    const bool client_to_server { _role == Role::CONNECT };
+    size_t offset {};
+    while ( offset < channel.in.size() ) {
+        const size_t sz { channel.in.size() - offset };
+        const std::optional< size_t > message_sz {
+            _nextMessageSize( channel, data + offset, sz ) };
+        if ( !message_sz ) {
+            ( client_to_server ? channel.client_stage : channel.server_stage ) =
+                _Stage::UNFRAMED;
+            _appendFrame( _DATA, id, data + offset, sz );
+            offset += sz;
+            break;
+        }
+        if ( *message_sz == 0 || *message_sz > sz )
+            break;
+        _encodeMessage( id, channel, data + offset, *message_sz );
+        offset += *message_sz;
+    }
+    channel.in.erase( 0, offset );
+    return true;
+}
+
+bool Tunnel::_writeChannel( const uint32_t id, _Channel& channel ) {
+    assert( !channel.out.empty() );
+    const ::ssize_t send_ret {
+        ::send( channel.fd, channel.out.data(), channel.out.size(),
+                MSG_DONTWAIT | MSG_NOSIGNAL ) };
+    if ( send_ret == -1 ) {
+        if ( wouldBlock() )
+            return true;
+        _closeChannel( id, !channel.closing );
+        return false;
+    }
+    channel.out.erase( 0, size_t( send_ret ) );
+    if ( channel.out.empty() && channel.closing ) {
+        _closeChannel( id, false );
+        return false;
+    }
+    return true;
+}
+
+std::optional< size_t > Tunnel::_nextMessageSize(
+    const _Channel& channel, const uint8_t* data, const size_t sz ) const {
+    assert( data != nullptr );
+    const bool client_to_server { _role == Role::CONNECT };
+    const _Stage stage {
+        client_to_server ? channel.client_stage : channel.server_stage };
+    if ( stage == _Stage::UNFRAMED )
+        return std::nullopt;
+    // byte order of connection setup from client is set by its first byte
+    _ByteOrder byte_order { channel.byte_order };
+    if ( client_to_server && stage == _Stage::SETUP ) {
+        byte_order = data[ 0 ] == 'B' ? _ByteOrder::MSB_FIRST :
+                     data[ 0 ] == 'l' ? _ByteOrder::LSB_FIRST :
+                                        _ByteOrder::UNKNOWN;
+    }
+    if ( byte_order == _ByteOrder::UNKNOWN )
+        return std::nullopt;
+    const bool msb_first { byte_order == _ByteOrder::MSB_FIRST };
+    const auto card16 { [ data, msb_first ]( const size_t i ) -> size_t {
+        return msb_first ? ( size_t( data[ i ] ) << 8 ) | data[ i + 1 ] :
+                           data[ i ] | ( size_t( data[ i + 1 ] ) << 8 ); } };
+    const auto card32 { [ &card16, msb_first ]( const size_t i ) -> size_t {
+        return msb_first ? ( card16( i ) << 16 ) | card16( i + 2 ) :
+                           card16( i ) | ( card16( i + 2 ) << 16 ); } };
+    const auto pad4 { []( const size_t n ) { return ( n + 3 ) & ~size_t( 3 ); } };
+    size_t message_sz {};
+    if ( client_to_server ) {
+        if ( stage == _Stage::SETUP ) {
+            // byte-order, unused, major/minor version, then lengths of
+            //   authorization name and data
+            static constexpr size_t SETUP_HEADER_SZ { 12 };
+            if ( sz < SETUP_HEADER_SZ )
+                return 0;
+            message_sz = SETUP_HEADER_SZ + pad4( card16( 6 ) ) + pad4( card16( 8 ) );
+        } else {
+            if ( sz < 4 )
+                return 0;
+            message_sz = card16( 2 ) * 4;
+            // BIG-REQUESTS extended length follows 0 length
+            if ( message_sz == 0 ) {
+                if ( sz < 8 )
+                    return 0;
+                message_sz = card32( 4 ) * 4;
+                if ( message_sz < 8 )
+                    return std::nullopt;
+            }
+        }
+    } else {
+        if ( stage == _Stage::SETUP ) {
+            // status, then length of additional data at byte 6
+            static constexpr size_t SETUP_HEADER_SZ { 8 };
+            if ( sz < SETUP_HEADER_SZ )
+                return 0;
+            message_sz = SETUP_HEADER_SZ + card16( 6 ) * 4;
+        } else {
+            static constexpr size_t RESPONSE_SZ       { 32 };
+            static constexpr uint8_t REPLY            { 1 };
+            static constexpr uint8_t GENERIC_EVENT    { 35 };
+            static constexpr uint8_t SEND_EVENT_MASK  { 0x80 };
+            if ( sz < RESPONSE_SZ )
+                return 0;
+            message_sz = RESPONSE_SZ;
+            // replies and GenericEvents have extra length at byte 4
+            if ( data[ 0 ] == REPLY ||
+                 ( data[ 0 ] & ~SEND_EVENT_MASK ) == GENERIC_EVENT ) {
+                message_sz += card32( 4 ) * 4;
+            }
+        }
+    }
+    if ( message_sz > _MAX_PAYLOAD_SZ )
+        return std::nullopt;
+    return message_sz;
+}
+
+void Tunnel::_noteMessage( _Channel& channel, const bool client_to_server,
+                           const uint8_t* data, const size_t sz ) const {
+    assert( data != nullptr );
+    if ( sz == 0 )
+        return;
+    if ( client_to_server ) {
+        if ( channel.client_stage == _Stage::MESSAGES ) {
+            ++channel.request_seq;
+            // replies are only encoded by listening end
+            if ( _role == Role::LISTEN && _image_budget > 0 &&
+                 data[ 0 ] == protocol::requests::opcodes::GETIMAGE ) {
+                channel.image_reply_seqs.push_back( channel.request_seq );
+            }
+            return;
+        }
+        if ( channel.client_stage != _Stage::SETUP )
+            return;
+        channel.byte_order = data[ 0 ] == 'B' ? _ByteOrder::MSB_FIRST :
+                             data[ 0 ] == 'l' ? _ByteOrder::LSB_FIRST :
+                                                _ByteOrder::UNKNOWN;
+        channel.client_stage = _Stage::MESSAGES;
+        return;
+    }
+    if ( channel.server_stage != _Stage::SETUP )
+        return;
+    channel.server_stage = _Stage::MESSAGES;
+    // further authentication exchange has no specified encoding
+    static constexpr uint8_t AUTHENTICATE { 2 };
+    if ( data[ 0 ] == AUTHENTICATE ) {
+        channel.client_stage = _Stage::UNFRAMED;
+        channel.server_stage = _Stage::UNFRAMED;
+    }
+}
+
+std::optional< size_t > Tunnel::_imageOffset(
+    _Channel& channel, const uint8_t* data, const size_t sz ) {
+    assert( data != nullptr );
+    assert( sz > 0 );
+    if ( _image_budget == 0 )
+        return std::nullopt;
+    size_t image_offset {};
+    if ( _role == Role::CONNECT ) {
+        using protocol::requests::PutImage;
+        if ( data[ 0 ] != protocol::requests::opcodes::PUTIMAGE || sz < 4 )
+            return std::nullopt;
+        // length of 0 (in either byte order) marks BIG-REQUESTS encoding
+        image_offset = ( data[ 2 ] == 0 && data[ 3 ] == 0 ) ?
+            PutImage::BASE_BIG_ENCODING_SZ : PutImage::BASE_ENCODING_SZ;
+    } else {
+        using protocol::requests::GetImage;
+        if ( data[ 0 ] != GetImage::Reply::REPLY || sz < 4 )
+            return std::nullopt;
+        const uint16_t seq {
+            channel.byte_order == _ByteOrder::MSB_FIRST ?
+            uint16_t( ( data[ 2 ] << 8 ) | data[ 3 ] ) :
+            uint16_t( data[ 2 ] | ( data[ 3 ] << 8 ) ) };
+        // GetImage requests answered with an error are passed over
+        std::deque< uint16_t >& seqs { channel.image_reply_seqs };
+        while ( !seqs.empty() && seqs.front() != seq &&
+                int16_t( seq - seqs.front() ) > 0 ) {
+            seqs.pop_front();
+        }
+        if ( seqs.empty() || seqs.front() != seq )
+            return std::nullopt;
+        seqs.pop_front();
+        image_offset = GetImage::Reply::DEFAULT_ENCODING_SZ;
+    }
+    if ( sz < image_offset + MIN_CACHED_IMAGE_SZ )
+        return std::nullopt;
+    return image_offset;
+}
+
+void Tunnel::_appendFrameHeader( const _FrameType type, const uint32_t id,
+                                 const size_t sz ) {
+    assert( sz <= _MAX_PAYLOAD_SZ );
+    _frames.push_back( char( type ) );
+    appendCard32( _frames, id );
+    appendCard32( _frames, uint32_t( sz ) );
+}
+
+void Tunnel::_appendFrame( const _FrameType type, const uint32_t id,
+                           const uint8_t* payload/* = nullptr*/,
+                           const size_t sz/* = 0*/ ) {
+    assert( sz == 0 || payload != nullptr );
+    _appendFrameHeader( type, id, sz );
+    if ( sz > 0 )
+        _frames.append( reinterpret_cast< const char* >( payload ), sz );
+}
+
+void Tunnel::_encodeMessage( const uint32_t id, _Channel& channel,
+                             const uint8_t* data, const size_t sz ) {
+    assert( data != nullptr );
+    assert( sz > 0 );
+    const bool client_to_server { _role == Role::CONNECT };
+    const _Stage stage {
+        client_to_server ? channel.client_stage : channel.server_stage };
+    if ( stage == _Stage::MESSAGES ) {
+        if ( const auto image_offset { _imageOffset( channel, data, sz ) };
+             image_offset &&
+             _encodeImage( id, channel, data, sz, *image_offset ) ) {
+            return;
+        }
+    }
+    if ( stage != _Stage::MESSAGES || sz > MAX_DELTA_SZ ) {
+        _appendFrame( _MESSAGE, id, data, sz );
+        _noteMessage( channel, client_to_server, data, sz );
+        return;
+    }
+    std::string& prev { channel.sent[ data[ 0 ] ] };
+    if ( prev.empty() ) {
+        _appendFrame( _MESSAGE, id, data, sz );
+    } else {
+        _appendFrame( _DELTA, id, data, sz );
+        char* delta { _frames.data() + _frames.size() - sz };
+        for ( size_t i { 1 }, common_sz { std::min( sz, prev.size() ) };
+              i < common_sz; ++i ) {
+            delta[ i ] ^= prev[ i ];
+        }
+    }
+    prev.assign( reinterpret_cast< const char* >( data ), sz );
+}
+
+bool Tunnel::_encodeImage( const uint32_t id, _Channel& channel,
+                           const uint8_t* data, const size_t sz,
+                           const size_t image_offset ) {
+    assert( data != nullptr );
+    assert( image_offset < sz );
+    const uint8_t* image { data + image_offset };
+    const size_t image_sz { sz - image_offset };
+    if ( image_sz > channel.sent_images.budget() )
+        return false;
+    const uint64_t hash { ImageCache::hash( image, image_sz ) };
+    if ( channel.sent_images.find( hash ) != nullptr ) {
+        _appendFrameHeader( _IMAGE_REF, id, _HASH_SZ + image_offset );
+        appendCard64( _frames, hash );
+        _frames.append( reinterpret_cast< const char* >( data ), image_offset );
+        ++channel.image_hits;
+        channel.image_bytes_saved += image_sz;
+        Metrics::add( Metrics::IMAGE_CACHE_HITS );
+        Metrics::add( Metrics::IMAGE_CACHE_BYTES_SAVED, image_sz );
+        return true;
+    }
+    channel.sent_images.insert( hash, image_sz );
+    _appendFrameHeader( _IMAGE, id, _HASH_SZ + 4 + sz );
+    appendCard64( _frames, hash );
+    appendCard32( _frames, uint32_t( image_offset ) );
+    _frames.append( reinterpret_cast< const char* >( data ), sz );
+    ++channel.image_misses;
+    Metrics::add( Metrics::IMAGE_CACHE_MISSES );
+    return true;
+}
+
+std::optional< std::string > Tunnel::_flushFrames() {
+    if ( _frames.empty() )
+        return std::nullopt;
+    Metrics::add( Metrics::TUNNEL_FRAME_BYTES, _frames.size() );
+    std::string chunk;
+#ifdef XTRACEPP_WITH_ZLIB
+    assert( _codec );
+    if ( !_codec->ok )
+        return "could not initialize zlib";
+    ::z_stream& zs { _codec->deflater };
+    zs.next_in  = reinterpret_cast< ::Bytef* >( _frames.data() );
+    zs.avail_in = ::uInt( _frames.size() );
+    do {
+        const size_t out_sz { chunk.size() };
+        chunk.resize( out_sz + _READ_SZ );
+        zs.next_out  = reinterpret_cast< ::Bytef* >( chunk.data() + out_sz );
+        zs.avail_out = ::uInt( _READ_SZ );
+        // sync flush ends on a byte boundary, so peer can inflate all frames
+        //   so far without waiting for more
+        if ( ::deflate( &zs, Z_SYNC_FLUSH ) == Z_STREAM_ERROR )
+            return "zlib deflate error";
+        chunk.resize( out_sz + _READ_SZ - zs.avail_out );
+    } while ( zs.avail_out == 0 );
+    _frames.clear();
+#else
+    chunk = std::move( _frames );
+    _frames.clear();
+#endif
+    _link_backlog += chunk.size();
+    _link_out.push_back( std::move( chunk ) );
+    return std::nullopt;
+}
+
+std::optional< std::string > Tunnel::_readLink() {
+    char buf[ _READ_SZ ];
+    const ::ssize_t recv_ret {
+        ::recv( _link_fd, buf, sizeof( buf ), MSG_DONTWAIT ) };
+    if ( recv_ret == -1 ) {
+        if ( wouldBlock() )
+            return std::nullopt;
+        return errors::system::message( "recv" );
+    }
+    if ( recv_ret == 0 )
+        return "peer closed link";
+    _link_in.append( buf, size_t( recv_ret ) );
+    if ( !_handshake_received ) {
+        if ( _link_in.size() < _HANDSHAKE_SZ )
+            return std::nullopt;
+        if ( std::string_view( _link_in ).substr( 0, _MAGIC.size() ) != _MAGIC )
+            return "peer is not an xtracepp tunnel";
+#ifdef XTRACEPP_WITH_ZLIB
+        static constexpr uint8_t FLAGS { _FLAG_DEFLATE };
+#else
+        static constexpr uint8_t FLAGS {};
+#endif
+        if ( uint8_t( _link_in[ _MAGIC.size() ] ) != FLAGS ) {
+            return fmt::format( "peer {} built with XTRACEPP_WITH_ZLIB",
+                                FLAGS & _FLAG_DEFLATE ? "not" : "was" );
+        }
+        _peer_image_budget = readCard32(
+            reinterpret_cast< const uint8_t* >( _link_in.data() ) +
+            _MAGIC.size() + 1 );
+        for ( auto& [ id, channel ] : _channels )
+            channel.received_images.setBudget( _peer_image_budget );
+        _link_in.erase( 0, _HANDSHAKE_SZ );
+        _handshake_received = true;
+    }
+#ifdef XTRACEPP_WITH_ZLIB
+    assert( _codec );
+    if ( !_codec->ok )
+        return "could not initialize zlib";
+    ::z_stream& zs { _codec->inflater };
+    zs.next_in  = reinterpret_cast< ::Bytef* >( _link_in.data() );
+    zs.avail_in = ::uInt( _link_in.size() );
+    while ( zs.avail_in > 0 ) {
+        const size_t out_sz { _link_frames.size() };
+        _link_frames.resize( out_sz + _READ_SZ );
+        zs.next_out  = reinterpret_cast< ::Bytef* >( _link_frames.data() + out_sz );
+        zs.avail_out = ::uInt( _READ_SZ );
+        const int ret { ::inflate( &zs, Z_SYNC_FLUSH ) };
+        _link_frames.resize( out_sz + _READ_SZ - zs.avail_out );
+        if ( ret != Z_OK && ret != Z_BUF_ERROR )
+            return fmt::format( "zlib inflate error {}", ret );
+    }
+    _link_in.clear();
+#else
+    _link_frames.append( _link_in );
+    _link_in.clear();
+#endif
+    const uint8_t* data {
+        reinterpret_cast< const uint8_t* >( _link_frames.data() ) };
+    size_t offset {};
+    while ( _link_frames.size() - offset >= _FRAME_HEADER_SZ ) {
+        const uint8_t* header { data + offset };
+        const uint32_t id { readCard32( header + 1 ) };
+        const size_t payload_sz { readCard32( header + 5 ) };
+        if ( payload_sz > _MAX_PAYLOAD_SZ )
+            return fmt::format( "frame of {}B exceeds maximum", payload_sz );
+        if ( _link_frames.size() - offset < _FRAME_HEADER_SZ + payload_sz )
+            break;
+        if ( auto error { _dispatchFrame( header[ 0 ], id,
+                                          header + _FRAME_HEADER_SZ,
+                                          payload_sz ) }; error ) {
+            return error;
+        }
+        offset += _FRAME_HEADER_SZ + payload_sz;
+    }
+    _link_frames.erase( 0, offset );
+    return std::nullopt;
+}
+
+std::optional< std::string > Tunnel::_dispatchFrame(
+    const uint8_t type, const uint32_t id,
+    const uint8_t* payload, const size_t sz ) {
+    assert( sz == 0 || payload != nullptr );
+    if ( type == _OPEN ) {
+        if ( _role != Role::LISTEN || _channels.count( id ) != 0 )
+            return fmt::format( "unexpected open of channel {}", id );
+        // proxy end stays blocking, as SocketBuffer expects
+        int fds[ 2 ] {};
+        if ( ::socketpair( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds ) == -1 ) {
+            fmt::println( ::stderr, "tunnel: channel {}: {}", id,
+                          errors::system::message( "socketpair" ) );
+            _appendFrame( _CLOSE, id );
+            return std::nullopt;
+        }
+        _addChannel( id, fds[ 0 ] );
+        {
+            std::lock_guard< std::mutex > lock { _mutex };
+            _accepted.emplace_back( id, fds[ 1 ] );
+        }
+        ::send( _accept_fds[ 0 ], "", 1, MSG_DONTWAIT | MSG_NOSIGNAL );
+        return std::nullopt;
+    }
+    // frames may still arrive for channels closed on this side
+    const auto channel_it { _channels.find( id ) };
+    if ( channel_it == _channels.end() )
+        return std::nullopt;
+    _Channel& channel { channel_it->second };
+    // received messages travel opposite to those read from channel
+    const bool client_to_server { _role == Role::LISTEN };
+    _Stage& stage {
+        client_to_server ? channel.client_stage : channel.server_stage };
+    switch ( type ) {
+    case _CLOSE:
+        if ( channel.out.empty() )
+            _closeChannel( id, false );
+        else
+            channel.closing = true;
+        break;
+    case _DATA:
+        stage = _Stage::UNFRAMED;
+        channel.out.append( reinterpret_cast< const char* >( payload ), sz );
+        break;
+    case _MESSAGE:
+        [[fallthrough]];
+    case _DELTA: {
+        if ( sz == 0 )
+            return fmt::format( "empty message in channel {}", id );
+        const size_t out_sz { channel.out.size() };
+        channel.out.append( reinterpret_cast< const char* >( payload ), sz );
+        char* message { channel.out.data() + out_sz };
+        const bool delta_eligible {
+            stage == _Stage::MESSAGES && sz <= MAX_DELTA_SZ };
+        std::string& prev { channel.received[ payload[ 0 ] ] };
+        if ( type == _DELTA ) {
+            if ( !delta_eligible || prev.empty() ) {
+                return fmt::format( "delta without reference in channel {}",
+                                    id );
+            }
+            for ( size_t i { 1 }, common_sz { std::min( sz, prev.size() ) };
+                  i < common_sz; ++i ) {
+                message[ i ] ^= prev[ i ];
+            }
+        }
+        if ( delta_eligible )
+            prev.assign( message, sz );
+        _noteMessage( channel, client_to_server,
+                      reinterpret_cast< const uint8_t* >( message ), sz );
+    }   break;
+    case _IMAGE: {
+        static constexpr size_t IMAGE_HEADER_SZ { _HASH_SZ + 4 };
+        if ( sz <= IMAGE_HEADER_SZ )
+            return fmt::format( "empty image message in channel {}", id );
+        const uint64_t hash { readCard64( payload ) };
+        const size_t image_offset { readCard32( payload + _HASH_SZ ) };
+        const uint8_t* message { payload + IMAGE_HEADER_SZ };
+        const size_t message_sz { sz - IMAGE_HEADER_SZ };
+        if ( image_offset == 0 || image_offset >= message_sz ||
+             channel.received_images.find( hash ) != nullptr ||
+             !channel.received_images.insert(
+                 hash, message_sz - image_offset, message + image_offset ) ) {
+            return fmt::format( "image not cacheable in channel {}", id );
+        }
+        channel.out.append( reinterpret_cast< const char* >( message ),
+                            message_sz );
+        _noteMessage( channel, client_to_server, message, message_sz );
+    }   break;
+    case _IMAGE_REF: {
+        if ( sz <= _HASH_SZ )
+            return fmt::format( "empty image reference in channel {}", id );
+        const std::string* image {
+            channel.received_images.find( readCard64( payload ) ) };
+        if ( image == nullptr )
+            return fmt::format( "reference to unknown image in channel {}", id );
+        const size_t out_sz { channel.out.size() };
+        channel.out.append( reinterpret_cast< const char* >( payload + _HASH_SZ ),
+                            sz - _HASH_SZ );
+        channel.out.append( *image );
+        _noteMessage( channel, client_to_server,
+                      reinterpret_cast< const uint8_t* >(
+                          channel.out.data() + out_sz ),
+                      channel.out.size() - out_sz );
+    }   break;
+    default:
+        return fmt::format( "unknown frame type {}", type );
+    }
+    return std::nullopt;
+}
+
+std::optional< std::string > Tunnel::_writeLink() {
+    while ( !_link_out.empty() ) {
+        const std::string& chunk { _link_out.front() };
+        const ::ssize_t send_ret {
+            ::send( _link_fd, chunk.data() + _link_out_sent,
+                    chunk.size() - _link_out_sent,
+                    MSG_DONTWAIT | MSG_NOSIGNAL ) };
+        if ( send_ret == -1 ) {
+            if ( wouldBlock() )
+                return std::nullopt;
+            return errors::system::message( "send" );
+        }
+        Metrics::add( Metrics::TUNNEL_LINK_BYTES, size_t( send_ret ) );
+        _link_out_sent += size_t( send_ret );
+        if ( _link_out_sent < chunk.size() )
+            return std::nullopt;
+        _link_backlog -= chunk.size();
+        _link_out_sent = 0;
+        _link_out.pop_front();
+    }
+    return std::nullopt;
+}
@@ -1,3 +1,6 @@
+#include <array>
+#include <charconv>                              // from_chars
+#include <iterator>                              // back_inserter
 #include <string>
 #include <string_view>
 #include <optional>                              // nullopt
@@ -8,13 +11,18 @@
 #include <cstdint>
 #include <cstdio>                                // feof, ferror
 #include <cstdlib>                               // exit, EXIT_FAILURE
+#include <ctime>                                 // time_t, tm, gmtime_r
 
 #include <fmt/format.h>
 
 #include "Connection.hpp"
+#include "Metrics.hpp"
+#include "Profiler.hpp"
+#include "RoundTripStalls.hpp"
 #include "Settings.hpp"
 #include "SocketBuffer.hpp"
 #include "X11ProtocolParser.hpp"
+#include "monotonic.hpp"
 
 #include "protocol/Response.hpp"
 #include "protocol/atoms.hpp"
@@ -25,25 +33,23 @@
 #include "protocol/requests.hpp"
 #include "protocol/extensions/requests.hpp"
 #include "protocol/extensions/big_requests.hpp"
+#include "protocol/extensions/big_requests/requests.hpp"
 
 
 void
 X11ProtocolParser::_stashString(
-    const uint32_t conn_id, const uint16_t seq_num,
-    const std::string_view str ) {
-    const _StashedStringID ss_id { conn_id, seq_num };
-    assert( _stashed_strings.find( ss_id ) == _stashed_strings.end() );
-    _stashed_strings.emplace( ss_id, str );
+    Connection* conn, const uint16_t seq_num, const std::string_view str ) {
+    assert( conn != nullptr );
+    conn->request_stash.stash( seq_num, str );
 }
 
 std::string_view
-X11ProtocolParser::_unstashString( const uint32_t conn_id,
-                                   const uint16_t seq_num ) {
-    auto ss_it { _stashed_strings.find( { conn_id, seq_num } ) };
-    assert( ss_it != _stashed_strings.end() );
-    std::string_view str { ss_it->second };
-    _stashed_strings.erase( ss_it );
-    return str;
+X11ProtocolParser::_unstashString( Connection* conn, const uint16_t seq_num ) {
+    assert( conn != nullptr );
+    const std::optional< std::string_view > str {
+        conn->request_stash.unstash( seq_num ) };
+    assert( str.has_value() );
+    return *str;
 }
 
 X11ProtocolParser::X11ProtocolParser( const Settings& settings_ ) :
@@ -62,21 +68,124 @@ X11ProtocolParser::X11ProtocolParser( const Settings& settings_ ) :
             ::ferror( settings_.log_fs ) == 0 );
 
     for ( uint32_t i { 1 }; i <= protocol::atoms::predefined::MAX; ++i ) {
-        _interned_atoms.emplace( i, protocol::atoms::predefined::strings.at( i ) );
+        _interned_atoms.set( i, protocol::atoms::predefined::strings.at( i ) );
+    }
+    if ( !settings.shm_ring_name.empty() ) {
+        if ( const auto error { _shm_ring.open( settings.shm_ring_name,
+                                                settings.shm_ring_capacity ) };
+             error ) {
+            fmt::println( ::stderr, "{}: could not open shared memory ring {:?}: {}",
+                          settings.process_name, settings.shm_ring_name, *error );
+            ::exit( EXIT_FAILURE );
+        }
     }
 }
 
-void X11ProtocolParser::importFetchedAtoms(
+void X11ProtocolParser::applySettings() {
+    _ROOT_WS = _Whitespace( 0, settings.multiline );
+}
+
+size_t X11ProtocolParser::importFetchedAtoms(
     const std::vector< std::string >& fetched_atoms ) {
     assert( settings.prefetchatoms );
     // by default core predefined ATOMS 1..68 should be interned
-    assert( _interned_atoms.size() == protocol::atoms::predefined::MAX );
+    assert( _interned_atoms.find( protocol::atoms::predefined::MAX ) != nullptr );
+    size_t fetched_sz {};
+    for ( const std::string& atom_str : fetched_atoms )
+        fetched_sz += atom_str.size();
+    // one arena block for all names, rather than one allocation each
+    _interned_atoms.reserve( uint32_t( fetched_atoms.size() ), fetched_sz );
+    size_t updated_ct {};
     for ( uint32_t i { protocol::atoms::predefined::MAX + 1 },
               sz ( fetched_atoms.size() ); i < sz; ++i ) {
-        _interned_atoms.emplace( i, fetched_atoms.at( i ) );
+        // may replace atoms imported from --atomcache file
+        if ( _interned_atoms.set( i, fetched_atoms[ i ] ) )
+            ++updated_ct;
+    }
+    return updated_ct;
+}
+
+std::vector< uint32_t > X11ProtocolParser::takeUnresolvedAtoms() {
+    std::vector< uint32_t > atoms;
+    atoms.swap( _unresolved_atoms );
+    return atoms;
+}
+
+void X11ProtocolParser::resolveAtom(
+    const uint32_t atom, const std::optional< std::string >& name ) {
+    _pending_atoms.erase( atom );
+    if ( name ) {
+        _interned_atoms.set( atom, *name );
+        _unresolvable_atoms.erase( atom );
+    } else if ( _interned_atoms.find( atom ) == nullptr ) {
+        // not retried, as server has no atom by that value
+        _unresolvable_atoms.insert( atom );
+    }
+}
+
+void X11ProtocolParser::flushHeldLines( const bool force/* = false*/ ) {
+    const uint64_t now { monotonic::now() };
+    while ( !_held_lines.empty() ) {
+        const _HeldLine& line { _held_lines.front() };
+        if ( !force && now - line.held_ns < ATOM_HOLD_NS &&
+             _awaitsAtoms( line.text ) ) {
+            break;
+        }
+        fmt::println( line.log_fs, "{}", _resolveAtomMarks( line.text ) );
+        _held_lines.pop_front();
     }
 }
 
+bool X11ProtocolParser::_awaitsAtoms( const std::string_view text ) const {
+    for ( size_t begin { text.find( _ATOM_MARK ) };
+          begin != std::string_view::npos; ) {
+        const size_t end { text.find( _ATOM_MARK, begin + 1 ) };
+        assert( end != std::string_view::npos );
+        uint32_t atom {};
+        std::from_chars( text.data() + begin + 1, text.data() + end, atom );
+        if ( _pending_atoms.count( atom ) != 0 )
+            return true;
+        begin = text.find( _ATOM_MARK, end + 1 );
+    }
+    return false;
+}
+
+std::string
+X11ProtocolParser::_resolveAtomMarks( const std::string_view text ) const {
+    std::string resolved;
+    size_t copied {};
+    for ( size_t begin { text.find( _ATOM_MARK ) };
+          begin != std::string_view::npos;
+          begin = text.find( _ATOM_MARK, copied ) ) {
+        const size_t end { text.find( _ATOM_MARK, begin + 1 ) };
+        assert( end != std::string_view::npos );
+        uint32_t atom {};
+        std::from_chars( text.data() + begin + 1, text.data() + end, atom );
+        resolved.append( text.substr( copied, begin - copied ) );
+        const std::string_view* name { _interned_atoms.find( atom ) };
+        resolved.append( name == nullptr ? "unrecognized atom" :
+                         fmt::format( "{:?}", *name ) );
+        copied = end + 1;
+    }
+    resolved.append( text.substr( copied ) );
+    return resolved;
+}
+
+void X11ProtocolParser::_publish(
+    const ShmRing::RecordType type, const ShmRing::Direction direction,
+    const uint8_t code, const uint8_t minor_opcode,
+    const uint16_t sequence, const uint32_t conn_id, const uint64_t recv_ns,
+    const std::string_view text ) {
+    // no ATOM pending, so text can not contain marks
+    if ( _pending_atoms.empty() ) {
+        _shm_ring.publish( type, direction, code, minor_opcode, sequence,
+                           conn_id, recv_ns, text );
+        return;
+    }
+    _shm_ring.publish( type, direction, code, minor_opcode, sequence,
+                       conn_id, recv_ns, _resolveAtomMarks( text ) );
+}
+
 size_t
 X11ProtocolParser::_logRequest(
     Connection* conn, const uint8_t* data, const size_t sz ) {
@@ -85,13 +194,29 @@ X11ProtocolParser::_logRequest(
     namespace ext = protocol::extensions;
     assert( sz >= sizeof( ext::requests::Request::Prefix ) +
             sizeof( ext::requests::Request::Length ) );
+    const Profiler::Scope kind_scope { "Request" };
 
     const ext::requests::Request::Prefix* prefix {
         reinterpret_cast< const ext::requests::Request::Prefix* >( data ) };
     const uint8_t major_opcode { _ordered( prefix->major_opcode, conn->byteswap ) };
     const uint8_t minor_opcode { _ordered( prefix->minor_opcode, conn->byteswap ) };
     // map opcode to sequence number to aid in parsing request errors and replies
-    const protocol::CARD16 sequence { conn->registerRequest( major_opcode ) };
+    const protocol::CARD16 sequence {
+        conn->registerRequest( major_opcode, minor_opcode ) };
+    if ( settings.stats ) {
+        conn->stats.record( MessageStats::REQUEST, major_opcode,
+                            _minorOpcode( major_opcode, minor_opcode ), sz );
+    }
+    if ( settings.stalls ) {
+        conn->stalls.request( major_opcode,
+                              _minorOpcode( major_opcode, minor_opcode ),
+                              sequence, conn->client_buffer.readTime() );
+    }
+    // filtered requests are only parsed when parsing has side effects
+    bool logged { conn->logging && !settings.stats &&
+        conn->log_filter.request( major_opcode, minor_opcode, sequence ) };
+    if ( !logged && !_statefulParsing( major_opcode, minor_opcode ) )
+        return sz;
     std::string_view request_name { "(unknown opcode)" };
     _RequestOpcodeTraits::ParseFuncT request_parse_func {
         &X11ProtocolParser::_parseRequest< X11ProtocolParser::_UnknownRequest > };
@@ -113,19 +238,39 @@ X11ProtocolParser::_logRequest(
             request_parse_func = major_oct.request.request_parse_func;
         }
     }
-    // pointer-to-member access operator
-    const _ParsingOutputs request { ( this->*request_parse_func )( conn, data, sz ) };
+    // rate limits and sampling apply only to messages that pass filter
+    logged = logged && conn->log_limiter.admit(
+        [&]( const MessageFilter::Compiled& selection ) {
+            return selection.request( major_opcode, minor_opcode, sequence );
+        }, "Request", request_name );
+    if ( !logged && !_statefulParsing( major_opcode, minor_opcode ) )
+        return sz;
+    const Profiler::Scope name_scope { request_name };
+    const _ParsingOutputs request { Profiler::timed( "parse", [&]() {
+        // pointer-to-member access operator
+        return ( this->*request_parse_func )( conn, data, sz ); } ) };
+    if ( !logged )
+        return request.bytes_parsed;
+    const Profiler::Scope println_scope { "println" };
+    _message_logged = true;
     if ( !extension_name.empty() ) {
-        fmt::println( settings.log_fs,
-                      "C{:03d}:{:04d}B:{}:S{:05d}: Request {}({})-{}({}): {}",
-                      conn->id, request.bytes_parsed, CLIENT_TO_SERVER, sequence,
-                      extension_name, major_opcode,
-                      request_name, minor_opcode, request.str );
+        _println( conn->log_fs,
+                  "C{:03d}:{:04d}B:{}:S{:05d}{}: Request {}({})-{}({}): {}",
+                  conn->id, request.bytes_parsed, CLIENT_TO_SERVER, sequence,
+                  _formatTimestamps( conn, conn->client_buffer.readTime() ),
+                  extension_name, major_opcode,
+                  request_name, minor_opcode, request.str );
     } else {
-        fmt::println( settings.log_fs,
-                      "C{:03d}:{:04d}B:{}:S{:05d}: Request {}({}): {}",
-                      conn->id, request.bytes_parsed, CLIENT_TO_SERVER, sequence,
-                      request_name, major_opcode, request.str );
+        _println( conn->log_fs,
+                  "C{:03d}:{:04d}B:{}:S{:05d}{}: Request {}({}): {}",
+                  conn->id, request.bytes_parsed, CLIENT_TO_SERVER, sequence,
+                  _formatTimestamps( conn, conn->client_buffer.readTime() ),
+                  request_name, major_opcode, request.str );
+    }
+    if ( !settings.shm_ring_name.empty() ) {
+        _publish( ShmRing::REQUEST, ShmRing::CLIENT_TO_SERVER,
+                  major_opcode, minor_opcode, sequence, conn->id,
+                  conn->client_buffer.readTime(), request.str );
     }
     assert( request.bytes_parsed != 0 );
     assert( request.bytes_parsed <= sz );
@@ -137,6 +282,7 @@ size_t X11ProtocolParser::_logReply(
     assert( conn != nullptr );
     assert( data != nullptr );
     assert( sz >= protocol::requests::Reply::DEFAULT_ENCODING_SZ );
+    const Profiler::Scope kind_scope { "Reply" };
 
     using protocol::requests::Reply;
     const bool byteswap { conn->byteswap };
@@ -147,6 +293,31 @@ size_t X11ProtocolParser::_logReply(
     // get request opcode via sequence number
     const protocol::CARD16 sequence { _ordered( header->sequence_num, byteswap ) };
     const Connection::RequestOpcodes opcodes { conn->lookupRequest( sequence ) };
+    if ( settings.stats ) {
+        conn->stats.record( MessageStats::REPLY, opcodes.major,
+                            _minorOpcode( opcodes.major, opcodes.minor ), sz );
+    }
+    // ListFontsWithInfo presents edge case as it issues a series of replies
+    using protocol::requests::ListFontsWithInfo;
+    if ( opcodes.major != protocol::requests::opcodes::LISTFONTSWITHINFO ||
+         _ordered( reinterpret_cast< const ListFontsWithInfo::Reply::Header* >(
+                       data )->last_reply, byteswap ) ==
+         ListFontsWithInfo::Reply::LAST_REPLY ) {
+        if ( settings.latency )
+            _recordLatency( opcodes, conn->server_buffer.readTime() );
+        if ( settings.stalls )
+            conn->stalls.reply( sequence, conn->server_buffer.readTime() );
+        if ( settings.stats ) {
+            conn->stats.answered( opcodes.major,
+                                  _minorOpcode( opcodes.major, opcodes.minor ) );
+        }
+        conn->unregisterRequest( sequence );
+    }
+    // filtered replies are only parsed when parsing has side effects
+    bool logged { conn->logging && !settings.stats &&
+        conn->log_filter.reply( opcodes.major, opcodes.minor, sequence ) };
+    if ( !logged && !_statefulParsing( opcodes.major, opcodes.minor ) )
+        return sz;
     std::string_view request_name { "(unknown opcode)" };
     _RequestOpcodeTraits::ParseFuncT reply_parse_func {
         &X11ProtocolParser::_parseReply< X11ProtocolParser::_UnknownRequest > };
@@ -170,27 +341,39 @@ size_t X11ProtocolParser::_logReply(
             assert( reply_parse_func != nullptr );
         }
     }
-    // pointer-to-member access operator
-    const _ParsingOutputs reply { ( this->*reply_parse_func )( conn, data, sz ) };
+    // rate limits and sampling apply only to messages that pass filter
+    logged = logged && conn->log_limiter.admit(
+        [&]( const MessageFilter::Compiled& selection ) {
+            return selection.reply( opcodes.major, opcodes.minor, sequence );
+        }, "Reply to", request_name );
+    if ( !logged && !_statefulParsing( opcodes.major, opcodes.minor ) )
+        return sz;
+    const Profiler::Scope name_scope { request_name };
+    const _ParsingOutputs reply { Profiler::timed( "parse", [&]() {
+        // pointer-to-member access operator
+        return ( this->*reply_parse_func )( conn, data, sz ); } ) };
+    if ( !logged )
+        return reply.bytes_parsed;
+    const Profiler::Scope println_scope { "println" };
+    _message_logged = true;
     if ( !extension_name.empty() ) {
-        fmt::println( settings.log_fs,
-                      "C{:03d}:{:04d}B:{}:S{:05d}: Reply to {}({})-{}({}): {}",
-                      conn->id, reply.bytes_parsed, CLIENT_TO_SERVER, sequence,
-                      extension_name, opcodes.major,
-                      request_name, opcodes.minor, reply.str );
+        _println( conn->log_fs,
+                  "C{:03d}:{:04d}B:{}:S{:05d}{}: Reply to {}({})-{}({}): {}",
+                  conn->id, reply.bytes_parsed, CLIENT_TO_SERVER, sequence,
+                  _formatTimestamps( conn, conn->server_buffer.readTime() ),
+                  extension_name, opcodes.major,
+                  request_name, opcodes.minor, reply.str );
     } else {
-        fmt::println( settings.log_fs,
-                      "C{:03d}:{:04d}B:{}:S{:05d}: Reply to {}({}): {}",
-                      conn->id, reply.bytes_parsed, CLIENT_TO_SERVER, sequence,
-                      request_name, opcodes.major, reply.str );
+        _println( conn->log_fs,
+                  "C{:03d}:{:04d}B:{}:S{:05d}{}: Reply to {}({}): {}",
+                  conn->id, reply.bytes_parsed, CLIENT_TO_SERVER, sequence,
+                  _formatTimestamps( conn, conn->server_buffer.readTime() ),
+                  request_name, opcodes.major, reply.str );
     }
-    // ListFontsWithInfo presents edge case as it issues a series of replies
-    using protocol::requests::ListFontsWithInfo;
-    if ( opcodes.major != protocol::requests::opcodes::LISTFONTSWITHINFO ||
-         _ordered( reinterpret_cast< const ListFontsWithInfo::Reply::Header* >(
-                       data )->last_reply, byteswap ) ==
-         ListFontsWithInfo::Reply::LAST_REPLY ) {
-        conn->unregisterRequest( sequence );
+    if ( !settings.shm_ring_name.empty() ) {
+        _publish( ShmRing::REPLY, ShmRing::SERVER_TO_CLIENT,
+                  opcodes.major, opcodes.minor, sequence, conn->id,
+                  conn->server_buffer.readTime(), reply.str );
     }
     assert( reply.bytes_parsed != 0 );
     assert( reply.bytes_parsed <= sz );
@@ -203,6 +386,7 @@ size_t X11ProtocolParser::_logEvent(
     assert( conn != nullptr );
     assert( data != nullptr );
     assert( sz >= protocol::events::Event::ENCODING_SZ );
+    const Profiler::Scope kind_scope { "Event" };
 
     const bool byteswap { conn->byteswap };
     const protocol::events::Event::Header* header {
@@ -213,26 +397,54 @@ size_t X11ProtocolParser::_logEvent(
     const bool generated ( _ordered( header->code, byteswap ) &
                            SendEvent::GENERATED_EVENT_FLAG );
     // KeymapNotify presents edge case, as it does not encode a sequence number
+    const uint16_t sequence {
+        ( code == protocol::events::codes::KEYMAPNOTIFY ) ? conn->sequence :
+        _ordered( header->sequence_num, byteswap ) };
+    if ( settings.stats ) {
+        conn->stats.record( generated ? MessageStats::GENERATED_EVENT :
+                            MessageStats::EVENT, code, 0, sz );
+        return sz;
+    }
+    if ( !conn->logging || !conn->log_filter.event( code, sequence ) )
+        return sz;
+    const _EventCodeTraits& code_traits { _event_codes.at( code ) };
+    // rate limits and sampling apply only to messages that pass filter
+    if ( !conn->log_limiter.admit(
+             [&]( const MessageFilter::Compiled& selection ) {
+                 return selection.event( code, sequence );
+             }, "Event", code_traits.name ) ) {
+        return sz;
+    }
+    const Profiler::Scope name_scope { code_traits.name };
     const std::string sequence_str {
         ( code == protocol::events::codes::KEYMAPNOTIFY ) ? "?????" :
         fmt::format( "{:05d}", _ordered( header->sequence_num, byteswap ) ) };
-    const _ParsingOutputs event {
-        _parseEvent( conn, data, sz, _ROOT_WS ) };
+    const _ParsingOutputs event { Profiler::timed( "parse", [&]() {
+        return _parseEvent( conn, data, sz, _ROOT_WS ); } ) };
     assert( event.bytes_parsed == protocol::events::Event::ENCODING_SZ );
-    const _EventCodeTraits& code_traits { _event_codes.at( code ) };
+    const Profiler::Scope println_scope { "println" };
+    _message_logged = true;
     if ( code_traits.extension ) {
-        fmt::println( settings.log_fs,
-                      "C{:03d}:{:04d}B:{}:S{}: Event {}-{}({}){}: {}",
-                      conn->id, event.bytes_parsed, SERVER_TO_CLIENT,
-                      sequence_str, code_traits.extension_name,
-                      code_traits.name, code,
-                      generated ? " (generated)" : "", event.str );
+        _println( conn->log_fs,
+                  "C{:03d}:{:04d}B:{}:S{}{}: Event {}-{}({}){}: {}",
+                  conn->id, event.bytes_parsed, SERVER_TO_CLIENT,
+                  sequence_str,
+                  _formatTimestamps( conn, conn->server_buffer.readTime() ),
+                  code_traits.extension_name, code_traits.name, code,
+                  generated ? " (generated)" : "", event.str );
     } else {
-        fmt::println( settings.log_fs,
-                      "C{:03d}:{:04d}B:{}:S{}: Event {}({}){}: {}",
-                      conn->id, event.bytes_parsed, SERVER_TO_CLIENT,
-                      sequence_str, code_traits.name, code,
-                      generated ? " (generated)" : "", event.str );
+        _println( conn->log_fs,
+                  "C{:03d}:{:04d}B:{}:S{}{}: Event {}({}){}: {}",
+                  conn->id, event.bytes_parsed, SERVER_TO_CLIENT,
+                  sequence_str,
+                  _formatTimestamps( conn, conn->server_buffer.readTime() ),
+                  code_traits.name, code,
+                  generated ? " (generated)" : "", event.str );
+    }
+    if ( !settings.shm_ring_name.empty() ) {
+        _publish( ShmRing::EVENT, ShmRing::SERVER_TO_CLIENT,
+                  code, {}, sequence, conn->id,
+                  conn->server_buffer.readTime(), event.str );
     }
     return event.bytes_parsed;
 }
@@ -244,6 +456,7 @@ X11ProtocolParser::_logError(
     assert( conn != nullptr );
     assert( data != nullptr );
     assert( sz >= sizeof( Error::Encoding ) );
+    const Profiler::Scope kind_scope { "Error" };
 
     const bool byteswap { conn->byteswap };
     const Error::Encoding* encoding {
@@ -253,27 +466,355 @@ X11ProtocolParser::_logError(
         _ordered( encoding->header.code, byteswap ) };
     const protocol::CARD16 sequence {
         _ordered( encoding->header.sequence_num, byteswap ) };
+    if ( const Connection::RequestOpcodes* request {
+            conn->findRequest( sequence ) }; request != nullptr ) {
+        if ( settings.latency )
+            _recordLatency( *request, conn->server_buffer.readTime() );
+        if ( settings.stats ) {
+            conn->stats.answered( request->major,
+                                  _minorOpcode( request->major, request->minor ) );
+        }
+    }
+    // presume that no more messages will relate to this request
+    conn->unregisterRequest( sequence );
+    // request data stashed for reply that will not come
+    _stashed_atoms.erase( { conn->id, sequence } );
+    _reply_cache_misses.erase( { conn->id, sequence } );
+    conn->request_stash.discard( sequence );
+    if ( settings.stats ) {
+        conn->stats.record( MessageStats::ERROR, code, 0, sz );
+        return sz;
+    }
+    // errors match `request=` filter terms by the opcode of failed request
+    const uint8_t major_opcode {
+        _ordered( encoding->major_opcode, byteswap ) };
+    const uint8_t minor_opcode (
+        _ordered( encoding->minor_opcode, byteswap ) );
+    if ( !conn->logging ||
+         !conn->log_filter.error( code, major_opcode, minor_opcode, sequence ) )
+        return sz;
     const _ErrorCodeTraits& code_traits { _error_codes.at( code ) };
-    _ParsingOutputs error {
+    // rate limits and sampling apply only to messages that pass filter
+    if ( !conn->log_limiter.admit(
+             [&]( const MessageFilter::Compiled& selection ) {
+                 return selection.error(
+                     code, major_opcode, minor_opcode, sequence );
+             }, "Error", code_traits.name ) ) {
+        return sz;
+    }
+    const Profiler::Scope name_scope { code_traits.name };
+    const _ParsingOutputs error { Profiler::timed( "parse", [&]() {
         // pointer-to-member access operator
-        (this->*code_traits.parse_func)( conn, data, sz ) };
+        return ( this->*code_traits.parse_func )( conn, data, sz ); } ) };
+    const Profiler::Scope println_scope { "println" };
+    _message_logged = true;
     if ( code_traits.extension ) {
-        fmt::println( settings.log_fs,
-                      "C{:03d}:{:04d}B:{}:S{:05d}: Error {}-{}({}): {}",
-                      conn->id, error.bytes_parsed, CLIENT_TO_SERVER, sequence,
-                      code_traits.extension_name,
-                      code_traits.name, code, error.str );
+        _println( conn->log_fs,
+                  "C{:03d}:{:04d}B:{}:S{:05d}{}: Error {}-{}({}): {}",
+                  conn->id, error.bytes_parsed, CLIENT_TO_SERVER, sequence,
+                  _formatTimestamps( conn, conn->server_buffer.readTime() ),
+                  code_traits.extension_name,
+                  code_traits.name, code, error.str );
     } else {
-        fmt::println( settings.log_fs,
-                      "C{:03d}:{:04d}B:{}:S{:05d}: Error {}({}): {}",
-                      conn->id, error.bytes_parsed, SERVER_TO_CLIENT, sequence,
-                      code_traits.name, code, error.str );
+        _println( conn->log_fs,
+                  "C{:03d}:{:04d}B:{}:S{:05d}{}: Error {}({}): {}",
+                  conn->id, error.bytes_parsed, SERVER_TO_CLIENT, sequence,
+                  _formatTimestamps( conn, conn->server_buffer.readTime() ),
+                  code_traits.name, code, error.str );
+    }
+    if ( !settings.shm_ring_name.empty() ) {
+        _publish( ShmRing::ERROR, ShmRing::SERVER_TO_CLIENT,
+                  code, {}, sequence, conn->id,
+                  conn->server_buffer.readTime(), error.str );
     }
-    // presume that no more messages will relate to this request
-    conn->unregisterRequest( sequence );
     return error.bytes_parsed;
 }
 
+std::string X11ProtocolParser::_requestName(
+    const uint8_t major_opcode, const uint8_t minor_opcode ) const {
+    const auto major_oc_it { _major_opcodes.find( major_opcode ) };
+    if ( major_oc_it == _major_opcodes.end() )
+        return fmt::format( "(unknown opcode)({})", major_opcode );
+    const _MajorOpcodeTraits& major_oct { major_oc_it->second };
+    if ( !major_oct.extension )
+        return fmt::format( "{}({})", major_oct.request.name, major_opcode );
+    const auto minor_oc_it { major_oct.extension.requests.find( minor_opcode ) };
+    return fmt::format( "{}({})-{}({})", major_oct.extension.name, major_opcode,
+                        minor_oc_it != major_oct.extension.requests.end() ?
+                        minor_oc_it->second.name : "(unknown opcode)",
+                        minor_opcode );
+}
+
+bool X11ProtocolParser::_hasReply(
+    const uint8_t major_opcode, const uint8_t minor_opcode ) const {
+    const auto major_oc_it { _major_opcodes.find( major_opcode ) };
+    if ( major_oc_it == _major_opcodes.end() )
+        return false;
+    const _MajorOpcodeTraits& major_oct { major_oc_it->second };
+    if ( !major_oct.extension )
+        return major_oct.request.reply_parse_func != nullptr;
+    const auto minor_oc_it { major_oct.extension.requests.find( minor_opcode ) };
+    return minor_oc_it != major_oct.extension.requests.end() &&
+        minor_oc_it->second.reply_parse_func != nullptr;
+}
+
+bool X11ProtocolParser::_statefulParsing(
+    const uint8_t major_opcode, const uint8_t minor_opcode ) const {
+    using namespace protocol::requests;
+    if ( major_opcode <= opcodes::MAX ) {
+        return major_opcode == opcodes::INTERNATOM ||
+            major_opcode == opcodes::GETATOMNAME ||
+            major_opcode == opcodes::QUERYEXTENSION;
+    }
+    namespace big_requests = protocol::extensions::big_requests;
+    const auto major_oc_it { _major_opcodes.find( major_opcode ) };
+    return major_oc_it != _major_opcodes.end() &&
+        major_oc_it->second.extension.name == big_requests::name &&
+        minor_opcode == big_requests::requests::opcodes::BIGREQENABLE;
+}
+
+void X11ProtocolParser::logLatencies() const {
+    if ( !settings.latency )
+        return;
+    static constexpr uint64_t NS_PER_US { 1000 };
+    static constexpr int NAME_W { 40 };
+    fmt::println( settings.log_fs, "Request to reply/error latency (us):" );
+    fmt::println( settings.log_fs, "{: <{}} {: >9} {: >9} {: >9} {: >9} {: >9}",
+                  "request", NAME_W, "count", "p50", "p90", "p99", "max" );
+    for ( const auto& [ opcodes, histogram ] : _reply_latencies ) {
+        fmt::println( settings.log_fs, "{: <{}} {: >9} {: >9} {: >9} {: >9} {: >9}",
+                      _requestName( opcodes.first, opcodes.second ), NAME_W,
+                      histogram.count(),
+                      histogram.percentile( 50 ) / NS_PER_US,
+                      histogram.percentile( 90 ) / NS_PER_US,
+                      histogram.percentile( 99 ) / NS_PER_US,
+                      histogram.max() / NS_PER_US );
+    }
+}
+
+void X11ProtocolParser::formatLatencyMetrics( std::string* out ) const {
+    assert( out != nullptr );
+    if ( !settings.latency )
+        return;
+    // bucket upper bounds in microseconds
+    static constexpr std::array< uint64_t, 14 > BOUNDS_US {
+        50, 100, 250, 500, 1'000, 2'500, 5'000, 10'000, 25'000, 50'000,
+        100'000, 250'000, 500'000, 1'000'000 };
+    static constexpr uint64_t NS_PER_US { 1000 };
+    static constexpr double US_PER_SEC { 1'000'000 };
+    static constexpr std::string_view METRIC { "xtracepp_reply_latency_seconds" };
+    auto it { std::back_inserter( *out ) };
+    fmt::format_to( it, "# HELP {} Time from request receipt to reply or error "
+                    "receipt.\n# TYPE {} histogram\n", METRIC, METRIC );
+    for ( const auto& [ opcodes, histogram ] : _reply_latencies ) {
+        const std::string name { _requestName( opcodes.first, opcodes.second ) };
+        for ( const uint64_t bound_us : BOUNDS_US ) {
+            fmt::format_to( it, "{}_bucket{{request=\"{}\",le=\"{}\"}} {}\n",
+                            METRIC, name, bound_us / US_PER_SEC,
+                            histogram.countAtMost( bound_us * NS_PER_US ) );
+        }
+        fmt::format_to( it, "{}_bucket{{request=\"{}\",le=\"+Inf\"}} {}\n"
+                        "{}_sum{{request=\"{}\"}} {}\n"
+                        "{}_count{{request=\"{}\"}} {}\n",
+                        METRIC, name, histogram.count(),
+                        METRIC, name,
+                        double( histogram.sum() ) / monotonic::NS_PER_SEC,
+                        METRIC, name, histogram.count() );
+    }
+}
+
+void X11ProtocolParser::logStalls( const Connection* conn ) const {
+    assert( conn != nullptr );
+    if ( !settings.stalls )
+        return;
+    static constexpr size_t TOP_SITE_CT { 10 };
+    static constexpr double NS_PER_MS { 1'000'000 };
+    static constexpr uint64_t NS_PER_US { 1000 };
+    const RoundTripStalls& stalls { conn->stalls };
+    fmt::println( conn->log_fs, "C{:03d}: {} blocking round trips, blocked "
+                  "{:.3f}ms of {:.3f}s connected",
+                  conn->id, stalls.count(), stalls.blockedTime() / NS_PER_MS,
+                  double( monotonic::now() - conn->start_ns ) /
+                  monotonic::NS_PER_SEC );
+    if ( stalls.count() == 0 )
+        return;
+    fmt::println( conn->log_fs, "C{:03d}: {: >12} {: >7} {: >9} {: >10} {: <6}  {}",
+                  conn->id, "blocked(ms)", "count", "avg(us)", "resume(us)",
+                  "first", "request (after preceding requests)" );
+    for ( const auto& [ site, site_stats ] : stalls.topSites( TOP_SITE_CT ) ) {
+        std::string context;
+        for ( size_t i {}; i < RoundTripStalls::CONTEXT_DEPTH; ++i ) {
+            if ( site[ i ] == 0 )
+                continue;
+            context += fmt::format( "{}{}", context.empty() ? " after " : ", ",
+                                    _requestName( uint8_t( site[ i ] >> 8 ),
+                                                  uint8_t( site[ i ] ) ) );
+        }
+        const RoundTripStalls::OpcodesT stalled { site.back() };
+        fmt::println( conn->log_fs,
+                      "C{:03d}: {: >12.3f} {: >7} {: >9} {: >10} S{:05d}  {}{}",
+                      conn->id, site_stats.blocked_ns / NS_PER_MS,
+                      site_stats.count,
+                      site_stats.blocked_ns / site_stats.count / NS_PER_US,
+                      site_stats.resume_ct == 0 ? 0 :
+                      site_stats.resume_ns / site_stats.resume_ct / NS_PER_US,
+                      site_stats.first_sequence,
+                      _requestName( uint8_t( stalled >> 8 ), uint8_t( stalled ) ),
+                      context );
+    }
+}
+
+void X11ProtocolParser::mergeStats( const Connection* conn ) {
+    assert( conn != nullptr );
+    if ( !settings.stats )
+        return;
+    _total_stats += conn->stats;
+}
+
+void X11ProtocolParser::logStats( const Connection* conn ) const {
+    assert( conn != nullptr );
+    if ( !settings.stats )
+        return;
+    _logStats( conn->log_fs, fmt::format( "C{:03d}", conn->id ), conn->stats );
+}
+
+void X11ProtocolParser::logTotalStats(
+    const std::unordered_map< int, Connection >& open_connections ) const {
+    if ( !settings.stats )
+        return;
+    if ( open_connections.empty() ) {
+        _logStats( settings.log_fs, "total", _total_stats );
+        return;
+    }
+    MessageStats total_stats { _total_stats };
+    for ( const auto& [ id, conn ] : open_connections )
+        total_stats += conn.stats;
+    _logStats( settings.log_fs, "total", total_stats );
+}
+
+void X11ProtocolParser::_logStats(
+    ::FILE* log_fs, const std::string_view prefix,
+    const MessageStats& stats ) const {
+    const std::vector< std::pair< MessageStats::Key, MessageStats::Counter > >
+        counters { stats.sorted() };
+    std::array< MessageStats::Counter, MessageStats::KIND_CT > kind_totals {};
+    for ( const auto& [ key, counter ] : counters ) {
+        kind_totals[ key.kind ].count += counter.count;
+        kind_totals[ key.kind ].bytes += counter.bytes;
+    }
+    fmt::println( log_fs, "{}: {} requests ({}B), {} replies ({}B), {} events "
+                  "({} generated), {} errors",
+                  prefix,
+                  kind_totals[ MessageStats::REQUEST ].count,
+                  kind_totals[ MessageStats::REQUEST ].bytes,
+                  kind_totals[ MessageStats::REPLY ].count,
+                  kind_totals[ MessageStats::REPLY ].bytes,
+                  kind_totals[ MessageStats::EVENT ].count +
+                  kind_totals[ MessageStats::GENERATED_EVENT ].count,
+                  kind_totals[ MessageStats::GENERATED_EVENT ].count,
+                  kind_totals[ MessageStats::ERROR ].count );
+    if ( counters.empty() )
+        return;
+    static constexpr int NAME_W { 56 };
+    fmt::println( log_fs, "{}: {: <{}} {: >9} {: >11} {: >7} {: >7} {: >8}",
+                  prefix, "message", NAME_W, "count", "bytes", "min", "max",
+                  "noreply" );
+    for ( const auto& [ key, counter ] : counters ) {
+        std::string name;
+        std::string noreply { "-" };
+        switch ( key.kind ) {
+        case MessageStats::REQUEST:
+            name = "Request " + _requestName( key.code, key.minor_opcode );
+            if ( _hasReply( key.code, key.minor_opcode ) )
+                noreply = fmt::format( "{}", counter.count - counter.answered );
+            break;
+        case MessageStats::REPLY:
+            name = "Reply " + _requestName( key.code, key.minor_opcode );
+            break;
+        case MessageStats::EVENT:
+            [[fallthrough]];
+        case MessageStats::GENERATED_EVENT: {
+            const _EventCodeTraits& code_traits { _event_codes.at( key.code ) };
+            name = code_traits.extension ?
+                fmt::format( "Event {}-{}({})", code_traits.extension_name,
+                             code_traits.name, key.code ) :
+                fmt::format( "Event {}({})", code_traits.name, key.code );
+            if ( key.kind == MessageStats::GENERATED_EVENT )
+                name += " (generated)";
+        }   break;
+        case MessageStats::ERROR: {
+            const _ErrorCodeTraits& code_traits { _error_codes.at( key.code ) };
+            name = code_traits.extension ?
+                fmt::format( "Error {}-{}({})", code_traits.extension_name,
+                             code_traits.name, key.code ) :
+                fmt::format( "Error {}({})", code_traits.name, key.code );
+        }   break;
+        default:
+            assert( 0 );
+            break;
+        }
+        fmt::println( log_fs, "{}: {: <{}} {: >9} {: >11} {: >7} {: >7} {: >8}",
+                      prefix, name, NAME_W, counter.count, counter.bytes,
+                      counter.min_sz, counter.max_sz, noreply );
+    }
+}
+
+std::string
+X11ProtocolParser::_formatTimestamps(
+    const Connection* conn, const uint64_t recv_ns ) const {
+    assert( conn != nullptr );
+    std::string fields;
+    if ( settings.timestamp_absolute ) {
+        const uint64_t real_ns { monotonic::toRealtime( recv_ns ) };
+        const std::time_t secs ( real_ns / monotonic::NS_PER_SEC );
+        std::tm utc {};
+        ::gmtime_r( &secs, &utc );
+        fields += fmt::format( ":T{:02d}:{:02d}:{:02d}.{:06d}",
+                               utc.tm_hour, utc.tm_min, utc.tm_sec,
+                               ( real_ns % monotonic::NS_PER_SEC ) / 1000 );
+    }
+    if ( settings.timestamp_relative ) {
+        const uint64_t rel_ns { recv_ns - conn->start_ns };
+        fields += fmt::format( ":R{}.{:06d}",
+                               rel_ns / monotonic::NS_PER_SEC,
+                               ( rel_ns % monotonic::NS_PER_SEC ) / 1000 );
+    }
+    if ( settings.timestamp_parse ) {
+        fields += fmt::format( ":P{}us",
+                               ( monotonic::now() - recv_ns ) / 1000 );
+    }
+    return fields;
+}
+
+void X11ProtocolParser::logForwarded( Connection* conn, SocketBuffer* buffer ) {
+    assert( conn != nullptr );
+    assert( buffer == &conn->client_buffer || buffer == &conn->server_buffer );
+    const std::string_view direction {
+        buffer == &conn->client_buffer ? CLIENT_TO_SERVER : SERVER_TO_CLIENT };
+    while ( const std::optional< SocketBuffer::ParsedMessage > message {
+            buffer->takeWritten() } ) {
+        if ( settings.latency && buffer == &conn->client_buffer )
+            conn->requestSent( message->sequence, message->write_ns );
+        if ( !message->logged || !conn->logging ||
+             !( settings.timestamp_forward || settings.timestamp_inproxy ) ) {
+            continue;
+        }
+        std::string fields;
+        if ( settings.timestamp_forward ) {
+            const uint64_t rel_ns { message->write_ns - conn->start_ns };
+            fields += fmt::format( ":F{}.{:06d}",
+                                   rel_ns / monotonic::NS_PER_SEC,
+                                   ( rel_ns % monotonic::NS_PER_SEC ) / 1000 );
+        }
+        if ( settings.timestamp_inproxy ) {
+            fields += fmt::format( ":I{}us",
+                                   ( message->write_ns - message->read_ns ) / 1000 );
+        }
+        _println( conn->log_fs, "C{:03d}:{:04d}B:{}:S{:05d}{}: forwarded",
+                  conn->id, message->sz, direction, message->sequence, fields );
+    }
+}
+
 X11ProtocolParser::_CodeTraits::~_CodeTraits() = default;
 X11ProtocolParser::_SingleCodeTraits::~_SingleCodeTraits() = default;
 
@@ -293,7 +834,9 @@ void X11ProtocolParser::_enableExtensionParsing(
     if ( auto it { _major_opcodes.find( major_opcode ) };
          it == _major_opcodes.end() ) {
         _major_opcodes.emplace(
-            major_opcode, _MajorOpcodeTraits( name, extension.requests ) );
+            major_opcode,
+            // name may be view of stashed request data, so keep static key
+            _MajorOpcodeTraits( ext_it->first, extension.requests ) );
         for ( const auto& [ offset, event ] : extension.events ) {
             assert( event.extension_name == name );
             _event_codes.emplace( first_event + offset, event );
@@ -309,15 +852,18 @@ std::pair< size_t, std::optional< std::string > >
 X11ProtocolParser::logClientMessages( Connection* conn ) {
     assert( conn != nullptr );
 
+    const Profiler::Scope direction_scope { "client" };
     size_t tl_bytes_parsed {};
     SocketBuffer& buffer { conn->client_buffer };
-    uint8_t* data { buffer.data() };
+    // messages parsed earlier may still be awaiting write
+    uint8_t* data { buffer.data() + buffer.parsed() };
     while ( buffer.parsed() < buffer.size() ) {
         if ( !buffer.messageSizeSet() ) {
+            const Profiler::Scope framing_scope { "framing" };
             switch ( conn->status ) {
             case Connection::UNESTABLISHED: {
                 using protocol::connection_setup::Initiation;
-                if ( buffer.size() < sizeof( Initiation::Header ) ) {
+                if ( buffer.unparsed() < sizeof( Initiation::Header ) ) {
                     goto length_checks;
                 }
                 const Initiation::Header* header {
@@ -342,7 +888,7 @@ X11ProtocolParser::logClientMessages( Connection* conn ) {
                         "authentication negotiation" ) };
             case Connection::OPEN: {
                 using protocol::requests::Request;
-                if ( buffer.size() <
+                if ( buffer.unparsed() <
                      sizeof( Request::Prefix ) + sizeof( Request::Length ) ) {
                     goto length_checks;
                 }
@@ -351,7 +897,7 @@ X11ProtocolParser::logClientMessages( Connection* conn ) {
                         data + sizeof( Request::Prefix ) ) };
                 if ( big_length->extended_length_flag ==
                      protocol::extensions::big_requests::EXTENDED_LENGTH_FLAG ) {
-                    if ( buffer.size() <
+                    if ( buffer.unparsed() <
                          sizeof( Request::Prefix ) + sizeof( Request::BigLength ) ) {
                         goto length_checks;
                     }
@@ -377,44 +923,61 @@ X11ProtocolParser::logClientMessages( Connection* conn ) {
     length_checks:
         if ( !buffer.messageSizeSet() ) {
             if ( settings.readwritedebug ) {
-                fmt::println( settings.log_fs,
-                              "C{:03d}:{}: waiting on incomplete message, "
-                              "{:04d}B insufficent to determine length",
-                              conn->id, CLIENT_TO_SERVER, buffer.unparsed() );
+                _println( conn->log_fs,
+                          "C{:03d}:{}: waiting on incomplete message, "
+                          "{:04d}B insufficent to determine length",
+                          conn->id, CLIENT_TO_SERVER, buffer.unparsed() );
             }
             break;
         }
         if ( buffer.incompleteMessage() ) {
             if ( settings.readwritedebug ) {
-                fmt::println( settings.log_fs,
-                              "C{:03d}:{}: waiting on incomplete message, "
-                              "received {:04d} of expected {:04d}B",
-                              conn->id, CLIENT_TO_SERVER, buffer.unparsed(),
-                              buffer.messageSize() );
+                _println( conn->log_fs,
+                          "C{:03d}:{}: waiting on incomplete message, "
+                          "received {:04d} of expected {:04d}B",
+                          conn->id, CLIENT_TO_SERVER, buffer.unparsed(),
+                          buffer.messageSize() );
             }
             break;
         }
         assert( conn->status != Connection::AUTHENTICATION );
         size_t bytes_parsed {};
+        uint16_t sequence {};
+        _message_logged = false;
         switch ( conn->status ) {
         case Connection::UNESTABLISHED:
             bytes_parsed = _logConnectionSetup<
                 protocol::connection_setup::Initiation >(
                     conn, data, buffer.messageSize() );
+            _message_logged = true;
             break;
         case Connection::OPEN:
             bytes_parsed = _logRequest(
                 conn, data, buffer.messageSize() );
+            sequence = conn->sequence;
+            if ( settings.replycache &&
+                 _answerFromCache( conn, data, buffer.messageSize() ) ) {
+                // request removed from buffer, so next message now at its
+                //   place unless buffer was reallocated
+                Metrics::add( Metrics::MESSAGES_CLIENT_TO_SERVER );
+                data = buffer.data() + buffer.parsed();
+                tl_bytes_parsed += bytes_parsed;
+                continue;
+            }
             break;
         default:
             break;
         }
         assert( bytes_parsed == buffer.messageSize() );
-        buffer.markMessageParsed();
+        if ( _recordsForwarding() )
+            buffer.markMessageParsed( sequence, _message_logged );
+        else
+            buffer.markMessageParsed();
+        Metrics::add( Metrics::MESSAGES_CLIENT_TO_SERVER );
         if ( settings.readwritedebug ) {
-            fmt::println( settings.log_fs,
-                          "C{:03d}:{:04d}B:{}: parsed message in buffer",
-                          conn->id, bytes_parsed, CLIENT_TO_SERVER );
+            _println( conn->log_fs,
+                      "C{:03d}:{:04d}B:{}: parsed message in buffer",
+                      conn->id, bytes_parsed, CLIENT_TO_SERVER );
         }
         data += bytes_parsed;
         tl_bytes_parsed += bytes_parsed;
@@ -422,19 +985,57 @@ X11ProtocolParser::logClientMessages( Connection* conn ) {
     return { tl_bytes_parsed, std::nullopt };
 }
 
+bool X11ProtocolParser::_compressMotion(
+    Connection* conn, const uint8_t* data ) {
+    using protocol::events::MotionNotify;
+    assert( conn != nullptr );
+    assert( data != nullptr );
+    // generated events (code msb set) are left as sent
+    const MotionNotify::Encoding* encoding {
+        reinterpret_cast< const MotionNotify::Encoding* >( data ) };
+    if ( encoding->header.code != protocol::events::codes::MOTIONNOTIFY )
+        return false;
+    Metrics::add( Metrics::MOTION_EVENTS );
+    ++conn->motion_events;
+    SocketBuffer& buffer { conn->server_buffer };
+    const uint8_t* prev_data { buffer.lastParsed() };
+    if ( prev_data == nullptr ||
+         buffer.lastParsedSize() != MotionNotify::ENCODING_SZ ) {
+        return false;
+    }
+    const MotionNotify::Encoding* prev_encoding {
+        reinterpret_cast< const MotionNotify::Encoding* >( prev_data ) };
+    // byte order is the same for both, so fields compare as encoded; only
+    //   time and coordinates may differ
+    if ( prev_encoding->header.code != encoding->header.code ||
+         prev_encoding->header.detail != encoding->header.detail ||
+         prev_encoding->event.data != encoding->event.data ||
+         prev_encoding->state.data != encoding->state.data ||
+         prev_encoding->same_screen.data != encoding->same_screen.data ) {
+        return false;
+    }
+    buffer.dropLastParsed();
+    Metrics::add( Metrics::MOTION_EVENTS_DROPPED );
+    ++conn->motion_events_dropped;
+    return true;
+}
+
 std::pair< size_t, std::optional< std::string > >
 X11ProtocolParser::logServerMessages( Connection* conn ) {
     assert( conn != nullptr );
 
+    const Profiler::Scope direction_scope { "server" };
     size_t tl_bytes_parsed {};
     SocketBuffer& buffer { conn->server_buffer };
-    uint8_t* data { buffer.data() };
+    // messages parsed earlier may still be awaiting write
+    uint8_t* data { buffer.data() + buffer.parsed() };
     while ( buffer.parsed() < buffer.size() ) {
         if ( !buffer.messageSizeSet() ) {
+            const Profiler::Scope framing_scope { "framing" };
             switch ( conn->status ) {
             case Connection::UNESTABLISHED: {
                 using protocol::connection_setup::InitResponse;
-                if ( buffer.size() < sizeof( InitResponse::Header ) ) {
+                if ( buffer.unparsed() < sizeof( InitResponse::Header ) ) {
                     goto length_checks;
                 }
                 const InitResponse::Header* header {
@@ -454,7 +1055,7 @@ X11ProtocolParser::logServerMessages( Connection* conn ) {
                         "authentication negotiation" ) };
             case Connection::OPEN: {
                 using protocol::Response;
-                if ( buffer.size() < sizeof( Response::Header ) ) {
+                if ( buffer.unparsed() < sizeof( Response::Header ) ) {
                     goto length_checks;
                 }
                 const Response::Header* resp_header {
@@ -466,6 +1067,9 @@ X11ProtocolParser::logServerMessages( Connection* conn ) {
                     break;
                 case Response::REPLY_PREFIX: {
                     using protocol::requests::Reply;
+                    if ( buffer.unparsed() < sizeof( Reply::Header ) ) {
+                        goto length_checks;
+                    }
                     const Reply::Header* reply_header {
                         reinterpret_cast< const Reply::Header* >( data ) };
                     buffer.setMessageSize(
@@ -489,35 +1093,51 @@ X11ProtocolParser::logServerMessages( Connection* conn ) {
     length_checks:
         if ( !buffer.messageSizeSet() ) {
             if ( settings.readwritedebug ) {
-                fmt::println( settings.log_fs,
-                              "C{:03d}:{}: waiting on incomplete message, "
-                              "{:04d}B insufficent to determine length",
-                              conn->id, SERVER_TO_CLIENT, buffer.unparsed() );
+                _println( conn->log_fs,
+                          "C{:03d}:{}: waiting on incomplete message, "
+                          "{:04d}B insufficent to determine length",
+                          conn->id, SERVER_TO_CLIENT, buffer.unparsed() );
             }
             break;
         }
         if ( buffer.incompleteMessage() ) {
             if ( settings.readwritedebug ) {
-                fmt::println( settings.log_fs,
-                              "C{:03d}:{}: waiting on incomplete message, "
-                              "received {:04d} of expected {:04d}B",
-                              conn->id, SERVER_TO_CLIENT, buffer.unparsed(),
-                              buffer.messageSize() );
+                _println( conn->log_fs,
+                          "C{:03d}:{}: waiting on incomplete message, "
+                          "received {:04d} of expected {:04d}B",
+                          conn->id, SERVER_TO_CLIENT, buffer.unparsed(),
+                          buffer.messageSize() );
             }
             break;
         }
         assert( conn->status != Connection::AUTHENTICATION );
         size_t bytes_parsed {};
+        uint16_t sequence {};
+        _message_logged = false;
         switch ( conn->status ) {
         case Connection::UNESTABLISHED:
             bytes_parsed = _logConnectionSetup<
                 protocol::connection_setup::InitResponse >(
                     conn, data, buffer.messageSize() );
             assert( conn->status == Connection::OPEN );
+            _message_logged = true;
             break;
         case Connection::OPEN: {
+            if ( settings.replycache && _mapServerSequence( conn, data ) ) {
+                // reply to sync request of proxy's own
+                buffer.dropMessage();
+                _flushLocalReplies( conn );
+                data = buffer.data() + buffer.parsed();
+                continue;
+            }
             const protocol::Response::Header* resp_header {
                 reinterpret_cast< const protocol::Response::Header* >( data ) };
+            // KeymapNotify does not encode a sequence number
+            sequence = ( ( _ordered( resp_header->prefix, conn->byteswap ) &
+                           protocol::requests::SendEvent::EVENT_CODE_MASK ) ==
+                         protocol::events::codes::KEYMAPNOTIFY ) ?
+                conn->sequence :
+                _ordered( resp_header->sequence_num, conn->byteswap );
             switch ( _ordered( resp_header->prefix, conn->byteswap ) ) {
             case protocol::Response::ERROR_PREFIX:
                 bytes_parsed = _logError(
@@ -530,6 +1150,8 @@ X11ProtocolParser::logServerMessages( Connection* conn ) {
             default: // event codes
                 bytes_parsed = _logEvent(
                     conn, data, buffer.messageSize() );
+                if ( settings.motioncompress && _compressMotion( conn, data ) )
+                    data = buffer.data() + buffer.parsed();
                 break;
             }
         }   break;
@@ -537,14 +1159,25 @@ X11ProtocolParser::logServerMessages( Connection* conn ) {
             break;
         }
         assert( bytes_parsed == buffer.messageSize() );
-        buffer.markMessageParsed();
+        if ( _recordsForwarding() )
+            buffer.markMessageParsed( sequence, _message_logged );
+        else
+            buffer.markMessageParsed();
+        Metrics::add( Metrics::MESSAGES_SERVER_TO_CLIENT );
         if ( settings.readwritedebug ) {
-            fmt::println( settings.log_fs,
-                          "C{:03d}:{:04d}B:{}: parsed message in buffer",
-                          conn->id, bytes_parsed, SERVER_TO_CLIENT );
+            _println( conn->log_fs,
+                      "C{:03d}:{:04d}B:{}: parsed message in buffer",
+                      conn->id, bytes_parsed, SERVER_TO_CLIENT );
         }
-        data += bytes_parsed;
         tl_bytes_parsed += bytes_parsed;
+        if ( settings.replycache && conn->status == Connection::OPEN ) {
+            _cacheReply( conn, data, bytes_parsed );
+            // local replies are inserted after this message
+            _flushLocalReplies( conn );
+            data = buffer.data() + buffer.parsed();
+            continue;
+        }
+        data += bytes_parsed;
     }
     return { tl_bytes_parsed, std::nullopt };
 }
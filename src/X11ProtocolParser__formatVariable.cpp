@@ -9,6 +9,7 @@
 
 #include "X11ProtocolParser.hpp"
 
+#include "protocol/atoms.hpp"
 #include "protocol/common_types.hpp"
 #include "protocol/connection_setup.hpp"
 #include "protocol/enum_names.hpp"
@@ -21,7 +22,8 @@ X11ProtocolParser::_formatVariable(
     const bool byteswap,
     const X11ProtocolParser::_EnumNameRange name_range/* = {}*/ ) {
     // defaulting to treating like WINDOW
-    assert( ( drawable.window.data & protocol::WINDOW::ZERO_BITS ) == 0 );
+    assert( ( _ordered( drawable.window.data, byteswap ) &
+              protocol::WINDOW::ZERO_BITS ) == 0 );
     return _formatVariable( drawable.window.data, byteswap, name_range );
 }
 
@@ -31,7 +33,8 @@ X11ProtocolParser::_formatVariable(
     const bool byteswap,
     const X11ProtocolParser::_EnumNameRange name_range/* = {}*/ ) {
     // defaulting to treating like FONT
-    assert( ( fontable.font.data & protocol::FONT::ZERO_BITS ) == 0 );
+    assert( ( _ordered( fontable.font.data, byteswap ) &
+              protocol::FONT::ZERO_BITS ) == 0 );
     return _formatVariable( fontable.font.data, byteswap, name_range );
 }
 
@@ -40,7 +43,8 @@ X11ProtocolParser::_formatVariable(
     const protocol::ATOM atom,
     const bool byteswap,
     const X11ProtocolParser::_EnumNameRange name_range/* = {}*/ ) {
-    assert( ( atom.data & protocol::ATOM::ZERO_BITS ) == 0 );
+    assert( ( _ordered( atom.data, byteswap ) &
+              protocol::ATOM::ZERO_BITS ) == 0 );
     if ( !name_range.empty() ) {
         assert( name_range.names == protocol::enum_names::zero_none ||
                   name_range.names == protocol::requests::GetProperty::type_names );
@@ -48,10 +52,22 @@ X11ProtocolParser::_formatVariable(
     if ( name_range.in( atom.data ) ) {
         return _formatVariable( atom.data, byteswap, name_range );
     }
-    const auto it { _interned_atoms.find( atom.data ) };
-    return fmt::format( "{}({})", _formatVariable( atom.data, byteswap ),
-                        it == _interned_atoms.end() ? "unrecognized atom" :
-                        fmt::format( "{:?}", it->second ) );
+    const uint32_t atom_value { _ordered( atom.data, byteswap ) };
+    if ( const std::string_view* name { _interned_atoms.find( atom_value ) };
+         name != nullptr ) {
+        return fmt::format( "{}({:?})", _formatVariable( atom.data, byteswap ),
+                            *name );
+    }
+    if ( !settings.resolveatoms || atom_value == protocol::atoms::NONE ||
+         _unresolvable_atoms.count( atom_value ) != 0 ) {
+        return fmt::format( "{}(unrecognized atom)",
+                            _formatVariable( atom.data, byteswap ) );
+    }
+    // name filled in when log line is printed, see _println
+    if ( _pending_atoms.insert( atom_value ).second )
+        _unresolved_atoms.push_back( atom_value );
+    return fmt::format( "{}({}{}{})", _formatVariable( atom.data, byteswap ),
+                        _ATOM_MARK, atom_value, _ATOM_MARK );
 }
 
 template<>
@@ -120,7 +136,8 @@ X11ProtocolParser::_formatVariable(
     const protocol::SETofEVENT setofevent,
     const bool byteswap,
     const X11ProtocolParser::_EnumNameRange/* name_range = {}*/ ) {
-    assert( ( setofevent.data & protocol::SETofEVENT::ZERO_BITS ) == 0 );
+    assert( ( _ordered( setofevent.data, byteswap ) &
+              protocol::SETofEVENT::ZERO_BITS ) == 0 );
     return _formatVariable( setofevent.data, byteswap,
                             { protocol::SETofEVENT::flag_names },
                             _ValueTraits::BITMASK );
@@ -132,7 +149,7 @@ X11ProtocolParser::_formatVariable(
     const protocol::SETofPOINTEREVENT setofpointerevent,
     const bool byteswap,
     const X11ProtocolParser::_EnumNameRange/* name_range = {}*/ ) {
-    assert( ( setofpointerevent.data &
+    assert( ( _ordered( setofpointerevent.data, byteswap ) &
                 protocol::SETofPOINTEREVENT::ZERO_BITS ) == 0 );
     // no need to denote a max flag index for the enum if zero bits validated
     return _formatVariable( setofpointerevent.data, byteswap,
@@ -146,7 +163,7 @@ X11ProtocolParser::_formatVariable(
     const protocol::SETofDEVICEEVENT setofdeviceevent,
     const bool byteswap,
     const X11ProtocolParser::_EnumNameRange/* name_range = {}*/ ) {
-    assert( ( setofdeviceevent.data &
+    assert( ( _ordered( setofdeviceevent.data, byteswap ) &
                 protocol::SETofDEVICEEVENT::ZERO_BITS ) == 0 );
     // no need to denote a max flag index for the enum if zero bits validated
     return _formatVariable( setofdeviceevent.data, byteswap,
@@ -196,7 +213,8 @@ X11ProtocolParser::_formatVariable(
     const protocol::SETofKEYBUTMASK setofkeybutmask,
     const bool byteswap,
     const X11ProtocolParser::_EnumNameRange/* name_range = {}*/ ) {
-    assert( ( setofkeybutmask.data & protocol::SETofKEYBUTMASK::ZERO_BITS ) == 0 );
+    assert( ( _ordered( setofkeybutmask.data, byteswap ) &
+              protocol::SETofKEYBUTMASK::ZERO_BITS ) == 0 );
     return _formatVariable( setofkeybutmask.data, byteswap,
                             { protocol::SETofKEYBUTMASK::flag_names },
                             _ValueTraits::BITMASK );
@@ -208,7 +226,8 @@ X11ProtocolParser::_formatVariable(
     const protocol::SETofKEYMASK setofkeymask,
     const bool byteswap,
     const X11ProtocolParser::_EnumNameRange/* name_range = {}*/ ) {
-    if ( setofkeymask.data == protocol::SETofKEYMASK::ANYMODIFIER ) {
+    if ( _ordered( setofkeymask.data, byteswap ) ==
+         protocol::SETofKEYMASK::ANYMODIFIER ) {
         if ( settings.verbose ) {
             return fmt::format(
                 "{}({})", _formatVariable( setofkeymask.data, byteswap,
@@ -217,7 +236,8 @@ X11ProtocolParser::_formatVariable(
         }
         return std::string( protocol::SETofKEYMASK::anymodifier_flag_name );
     }
-    assert( ( setofkeymask.data & protocol::SETofKEYMASK::ZERO_BITS ) == 0 );
+    assert( ( _ordered( setofkeymask.data, byteswap ) &
+              protocol::SETofKEYMASK::ZERO_BITS ) == 0 );
     return _formatVariable( setofkeymask.data, byteswap,
                             { protocol::SETofKEYMASK::flag_names },
                             _ValueTraits::BITMASK );
@@ -449,7 +469,8 @@ X11ProtocolParser::_formatVariable(
     const protocol::requests::StoreColors::COLORITEM coloritem,
     const bool byteswap, const _Whitespace& ws ) {
     using COLORITEM = protocol::requests::StoreColors::COLORITEM;
-    assert( ( coloritem.do_rgb_mask & COLORITEM::DO_RGB_ZERO_BITS ) == 0 );
+    assert( ( _ordered( coloritem.do_rgb_mask, byteswap ) &
+              COLORITEM::DO_RGB_ZERO_BITS ) == 0 );
     const uint32_t memb_name_w (
         !ws.multiline ? 0 : sizeof( "(do rgb mask)" ) - 1 );
     return fmt::format(
@@ -53,16 +53,18 @@ size_t X11ProtocolParser::_logConnectionSetup<
         !ws.multiline ? 0 : ( settings.verbose ?
                               sizeof( "(authorization-protocol-name length)" ) :
                               sizeof( "authorization-protocol-name" ) ) - 1 );
-    fmt::println(
-        settings.log_fs,
-        "C{:03d}:{:04d}B:{}: client {:?} attempting connection: "
+    _println(
+        conn->log_fs,
+        "C{:03d}:{:04d}B:{}{}: client {:?} attempting connection: "
         "{{{}"
         "{}{: <{}}{}{}{}{}{: <{}}{}{}{}{}{: <{}}{}{}{}"
         "{}{}"                       // name_len, data_len
         "{}{: <{}}{}{:?}{}"          // authorization-protocol-name
         "{}{: <{}}{}({:d} bytes){}"  // authorization-protocol-data (hidden)
         "{}}}",
-        conn->id, bytes_parsed, CLIENT_TO_SERVER, conn->client_desc,
+        conn->id, bytes_parsed, CLIENT_TO_SERVER,
+        _formatTimestamps( conn, conn->client_buffer.readTime() ),
+        conn->client_desc,
         ws.separator,
         ws.memb_indent, "byte-order", memb_name_w, ws.equals,
         _formatVariable( uint8_t( header->byte_order ==
@@ -121,9 +123,9 @@ size_t X11ProtocolParser::_logConnectionSetup<
         !ws.multiline ? 0 : ( settings.verbose ?
                               sizeof( "(post-header aligned units)" ) :
                               sizeof( "protocol-major-version" ) ) - 1 );
-    fmt::println(
-        settings.log_fs,
-        "C{:03d}:{:04d}B:{}: server refused connection: "
+    _println(
+        conn->log_fs,
+        "C{:03d}:{:04d}B:{}{}: server refused connection: "
         "{{{}"
         "{}{}"               // success, reason_len
         "{}{: <{}}{}{}{}{}{: <{}}{}{}{}"
@@ -131,6 +133,7 @@ size_t X11ProtocolParser::_logConnectionSetup<
         "{}{: <{}}{}{:?}{}"  // reason
         "{}}}",
         conn->id, bytes_parsed, SERVER_TO_CLIENT,
+        _formatTimestamps( conn, conn->server_buffer.readTime() ),
         ws.separator,
         !settings.verbose ? "" : fmt::format(
             "{}{: <{}}{}{}{}",
@@ -194,14 +197,15 @@ size_t X11ProtocolParser::_logConnectionSetup<
         !ws.multiline ? 0 : ( settings.verbose ?
                               sizeof( "(post-header aligned units)" ) :
                               sizeof( "success" ) ) - 1 );
-    fmt::println(
-        settings.log_fs,
-        "C{:03d}:{:04d}B:{}: server requested further authentication: "
+    _println(
+        conn->log_fs,
+        "C{:03d}:{:04d}B:{}{}: server requested further authentication: "
         "{{{}"
         "{}{}"               // success, total_aligned_units
         "{}{: <{}}{}{:?}{}"  // reason
         "{}}}",
         conn->id, bytes_parsed, SERVER_TO_CLIENT,
+        _formatTimestamps( conn, conn->server_buffer.readTime() ),
         ws.separator,
         !settings.verbose ? "" : fmt::format(
             "{}{: <{}}{}{}{}",
@@ -282,9 +286,9 @@ size_t X11ProtocolParser::_logConnectionSetup<
         !ws.multiline ? 0 : ( settings.verbose ?
                               sizeof( "(post-header aligned units)" ) :
                               sizeof( "bitmap-format-scanline-unit" ) ) - 1 );
-    fmt::println(
-        settings.log_fs,
-        "C{:03d}:{:04d}B:{}: server accepted connection: "
+    _println(
+        conn->log_fs,
+        "C{:03d}:{:04d}B:{}{}: server accepted connection: "
         "{{{}"
         "{}"                 // success
         "{}{: <{}}{}{}{}{}{: <{}}{}{}{}"
@@ -299,6 +303,7 @@ size_t X11ProtocolParser::_logConnectionSetup<
         "{}{: <{}}{}{}{}{}{: <{}}{}{}{}"
         "{}}}",
         conn->id, bytes_parsed, SERVER_TO_CLIENT,
+        _formatTimestamps( conn, conn->server_buffer.readTime() ),
         ws.separator,
         !settings.verbose ? "" : fmt::format(
             "{}{: <{}}{}{}{}",
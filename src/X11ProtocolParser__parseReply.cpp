@@ -314,14 +314,14 @@ X11ProtocolParser::_parseReply<
 
     // Intern own copy of atom if not stored already, to reduce incidence of
     //   "(unknown atom)" in log
+    const std::string_view atom_str {
+        _unstashString(
+            conn, _ordered( encoding->header.sequence_num, byteswap ) ) };
     if ( const auto atom { _ordered( encoding->atom.data, byteswap ) };
          atom != protocol::atoms::NONE ) {
-        const std::string_view atom_str {
-            _unstashString(
-                conn->id, _ordered( encoding->header.sequence_num, byteswap ) ) };
         // not sure if server will reuse ATOMs, so we allow for it in our
         //   mirroring of internments
-        _interned_atoms[ atom ] = atom_str;
+        _interned_atoms.set( atom, atom_str );
     }
 
     const uint32_t memb_name_w (
@@ -382,6 +382,15 @@ X11ProtocolParser::_parseReply<
             Alignment::units( reply.bytes_parsed -
                              protocol::requests::Reply::DEFAULT_ENCODING_SZ ) );
 
+    // Intern own copy of atom, as with InternAtom, to reduce incidence of
+    //   "(unknown atom)" in log
+    if ( const auto sa_it { _stashed_atoms.find(
+             { conn->id, _ordered( encoding->header.sequence_num, byteswap ) } ) };
+         sa_it != _stashed_atoms.end() ) {
+        resolveAtom( sa_it->second, std::string( name ) );
+        _stashed_atoms.erase( sa_it );
+    }
+
     const uint32_t memb_name_w (
         !ws.multiline ? 0 : ( settings.verbose ?
                               sizeof( "(extra aligned units)" ) :
@@ -522,7 +531,8 @@ X11ProtocolParser::_parseReply<
     // followed by LISTofATOM atoms
     const _ParsingOutputs atoms {
         _parseLISTof< protocol::ATOM >(
-            data + reply.bytes_parsed, sz - reply.bytes_parsed, encoding->atoms_ct,
+            data + reply.bytes_parsed, sz - reply.bytes_parsed,
+            _ordered( encoding->atoms_ct, byteswap ),
             byteswap, ws.nested() ) };
     reply.bytes_parsed += Alignment::pad( atoms.bytes_parsed );
     assert( _ordered( encoding->header.extra_aligned_units, byteswap ) ==
@@ -810,7 +820,8 @@ X11ProtocolParser::_parseReply<
     // followed by LISTofTIMECOORD events
     const _ParsingOutputs events {
         _parseLISTof< GetMotionEvents::Reply::TIMECOORD >(
-            data + reply.bytes_parsed, sz - reply.bytes_parsed, encoding->events_ct,
+            data + reply.bytes_parsed, sz - reply.bytes_parsed,
+            _ordered( encoding->events_ct, byteswap ),
             byteswap, ws.nested(), _Whitespace::FORCE_SINGLELINE ) };
     reply.bytes_parsed += events.bytes_parsed;
     assert( _ordered( encoding->header.extra_aligned_units, byteswap ) ==
@@ -2060,7 +2071,7 @@ X11ProtocolParser::_parseReply<
                              protocol::requests::Reply::DEFAULT_ENCODING_SZ ) );
     const std::string_view ext_name {
         _unstashString(
-            conn->id, _ordered( encoding->header.sequence_num, byteswap ) ) };
+            conn, _ordered( encoding->header.sequence_num, byteswap ) ) };
     // control use of extensions by spoofing `present` in reply
     if ( settings.extensionDenied( ext_name ) ) {
         // setting to false/0 should not need byte ordering
@@ -2588,7 +2599,7 @@ X11ProtocolParser::_parseReply<
             _ordered( encoding->header.map_len, byteswap ),
             byteswap, ws.nested( _Whitespace::FORCE_SINGLELINE ) ) };
     reply.bytes_parsed += Alignment::pad( map.bytes_parsed );
-    assert( encoding->header.extra_aligned_units ==
+    assert( _ordered( encoding->header.extra_aligned_units, byteswap ) ==
             Alignment::units( reply.bytes_parsed -
                              protocol::requests::Reply::DEFAULT_ENCODING_SZ ) );
 
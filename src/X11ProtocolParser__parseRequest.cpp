@@ -1069,7 +1069,7 @@ X11ProtocolParser::_parseRequest<
 
     // Stash copy of atom until reply comes in - at that time we will include it
     //   in our own internment if it isn't already
-    _stashString( conn->id, conn->sequence, name );
+    _stashString( conn, conn->sequence, name );
 
     const uint32_t memb_name_w (
         !ws.multiline     ? 0 :
@@ -1134,6 +1134,10 @@ X11ProtocolParser::_parseRequest<
             _ordered( fe.big_length->tl_aligned_units, byteswap ) :
             _ordered( fe.length->tl_aligned_units, byteswap ) ==
             Alignment::units( request.bytes_parsed ) );
+    // learn interned string from reply
+    _stashed_atoms.insert_or_assign(
+        _StashedStringID{ conn->id, conn->sequence },
+        _ordered( fe.encoding->atom.data, byteswap ) );
 
     const uint32_t memb_name_w (
         !ws.multiline     ? 0 :
@@ -4078,8 +4082,9 @@ X11ProtocolParser::_parseRequest<
         fe.big_request ? _ordered( fe.big_length->tl_aligned_units, byteswap ) :
                          _ordered( fe.length->tl_aligned_units, byteswap ) };
     const size_t arcs_sz {
-        tl_aligned_units - ( fe.big_request ? PolyArc::BASE_BIG_ENCODING_SZ :
-                                              PolyArc::BASE_ENCODING_SZ ) };
+        Alignment::size( tl_aligned_units ) -
+        ( fe.big_request ? PolyArc::BASE_BIG_ENCODING_SZ :
+                           PolyArc::BASE_ENCODING_SZ ) };
     const size_t arcs_ct { arcs_sz / sizeof( protocol::ARC ) };
     const _ParsingOutputs arcs {
         _parseLISTof< protocol::ARC >(
@@ -4226,7 +4231,9 @@ X11ProtocolParser::_parseRequest<
         fe.big_request ? _ordered( fe.big_length->tl_aligned_units, byteswap ) :
                          _ordered( fe.length->tl_aligned_units, byteswap ) };
     const size_t rectangles_sz {
-        Alignment::size( tl_aligned_units ) - sizeof( PolyFillRectangle::Encoding ) };
+        Alignment::size( tl_aligned_units ) -
+        ( fe.big_request ? PolyFillRectangle::BASE_BIG_ENCODING_SZ :
+                           PolyFillRectangle::BASE_ENCODING_SZ ) };
     const uint16_t rectangles_ct ( rectangles_sz / sizeof( protocol::RECTANGLE ) );
     const _ParsingOutputs rectangles {
         _parseLISTof< protocol::RECTANGLE >(
@@ -4295,7 +4302,9 @@ X11ProtocolParser::_parseRequest<
         fe.big_request ? _ordered( fe.big_length->tl_aligned_units, byteswap ) :
                          _ordered( fe.length->tl_aligned_units, byteswap ) };
     const size_t arcs_sz {
-        Alignment::size( tl_aligned_units ) - sizeof( PolyFillArc::Encoding ) };
+        Alignment::size( tl_aligned_units ) -
+        ( fe.big_request ? PolyFillArc::BASE_BIG_ENCODING_SZ :
+                           PolyFillArc::BASE_ENCODING_SZ ) };
     const uint16_t arcs_ct ( arcs_sz  / sizeof( protocol::ARC ) );
     const _ParsingOutputs arcs {
         _parseLISTof< protocol::ARC >(
@@ -6000,7 +6009,7 @@ X11ProtocolParser::_parseRequest<
 
     // Stash copy of extension name until reply comes in - at that time we will
     //   use it in the activation of the extension
-    _stashString( conn->id, conn->sequence, name );
+    _stashString( conn, conn->sequence, name );
 
     const uint32_t memb_name_w (
         !ws.multiline     ? 0 :
@@ -6247,7 +6256,7 @@ X11ProtocolParser::_parseRequest<
     request.str = fmt::format(
         "{{{}"
         "{}{}{}"
-        "{}{: <{}}{}{}{}{}{: <{}}{}{}{}"
+        "{}{}{: <{}}{}{}{}"
         "{}}}",
         ws.separator,
         !settings.verbose ? "" : fmt::format(
@@ -0,0 +1,183 @@
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>        // move
+#include <vector>
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>        // memcpy
+
+#include <fmt/format.h>
+
+#include "Connection.hpp"
+#include "Metrics.hpp"
+#include "X11ProtocolParser.hpp"
+
+#include "protocol/Response.hpp"
+#include "protocol/atoms.hpp"
+#include "protocol/events.hpp"
+#include "protocol/requests.hpp"
+
+
+std::optional< std::string > X11ProtocolParser::_replyCacheKey(
+    Connection* conn, const uint8_t* data, const size_t sz ) {
+    assert( conn != nullptr );
+    assert( data != nullptr );
+    namespace rq = protocol::requests;
+    const uint8_t opcode { data[ 0 ] };
+    // replies are cached in byte order of client
+    std::string key { char( conn->byteswap ), char( opcode ) };
+    switch ( opcode ) {
+    case rq::opcodes::INTERNATOM: {
+        // only-if-exists ignored, as only replies with ATOM are cached
+        const _RequestFixedEncoding< rq::InternAtom > fe { conn, data, sz };
+        key.append( reinterpret_cast< const char* >( data + fe.bytes_parsed ),
+                    _ordered( fe.encoding->name_len, conn->byteswap ) );
+    }   break;
+    case rq::opcodes::GETATOMNAME: {
+        const _RequestFixedEncoding< rq::GetAtomName > fe { conn, data, sz };
+        key.append( reinterpret_cast< const char* >( &fe.encoding->atom ),
+                    sizeof( fe.encoding->atom ) );
+    }   break;
+    case rq::opcodes::QUERYEXTENSION: {
+        const _RequestFixedEncoding< rq::QueryExtension > fe { conn, data, sz };
+        key.append( reinterpret_cast< const char* >( data + fe.bytes_parsed ),
+                    _ordered( fe.encoding->name_len, conn->byteswap ) );
+    }   break;
+    case rq::opcodes::LISTEXTENSIONS:
+        break;
+    default:
+        return std::nullopt;
+    }
+    return key;
+}
+
+bool X11ProtocolParser::_answerFromCache(
+    Connection* conn, const uint8_t* data, const size_t sz ) {
+    assert( conn != nullptr );
+    assert( data != nullptr );
+    namespace ext = protocol::extensions;
+    const ext::requests::Request::Prefix* prefix {
+        reinterpret_cast< const ext::requests::Request::Prefix* >( data ) };
+    const uint8_t major_opcode { _ordered( prefix->major_opcode, conn->byteswap ) };
+    const uint8_t minor_opcode { _ordered( prefix->minor_opcode, conn->byteswap ) };
+    std::optional< std::string > key { _replyCacheKey( conn, data, sz ) };
+    if ( !key ) {
+        conn->sequence_map.forward( _hasReply( major_opcode, minor_opcode ) );
+        return false;
+    }
+    const auto reply_it { _cached_replies.find( *key ) };
+    if ( reply_it == _cached_replies.end() ) {
+        Metrics::add( Metrics::REPLY_CACHE_MISSES );
+        _reply_cache_misses.insert_or_assign(
+            _StashedStringID{ conn->id, conn->sequence }, std::move( *key ) );
+        conn->sequence_map.forward( true );
+        return false;
+    }
+    Metrics::add( Metrics::REPLY_CACHE_HITS );
+    std::vector< uint8_t > reply { reply_it->second };
+    reinterpret_cast< protocol::Response::Header* >(
+        reply.data() )->sequence_num = _ordered( conn->sequence, conn->byteswap );
+    conn->sequence_map.answerLocally( conn->sequence, std::move( reply ) );
+    SocketBuffer& buffer { conn->client_buffer };
+    buffer.dropMessage();
+    if ( conn->sequence_map.syncNeeded() ) {
+        // GetInputFocus, whose reply is withheld from client, ensures local
+        //   reply follows any errors for requests forwarded before it
+        using protocol::requests::GetInputFocus;
+        uint8_t sync[ GetInputFocus::BASE_ENCODING_SZ ] {
+            protocol::requests::opcodes::GETINPUTFOCUS };
+        const uint16_t tl_aligned_units {
+            _ordered( uint16_t( Alignment::units( sizeof( sync ) ) ),
+                      conn->byteswap ) };
+        ::memcpy( sync + sizeof( GetInputFocus::Prefix ), &tl_aligned_units,
+                  sizeof( tl_aligned_units ) );
+        buffer.insertParsed( sync, sizeof( sync ) );
+        conn->sequence_map.forwardSync();
+    }
+    if ( settings.readwritedebug ) {
+        _println( conn->log_fs,
+                  "C{:03d}:{}:S{:05d}: answered request from reply cache",
+                  conn->id, CLIENT_TO_SERVER, conn->sequence );
+    }
+    _flushLocalReplies( conn );
+    return true;
+}
+
+bool X11ProtocolParser::_mapServerSequence( Connection* conn, uint8_t* data ) {
+    assert( conn != nullptr );
+    assert( data != nullptr );
+    using protocol::Response;
+    const bool byteswap { conn->byteswap };
+    Response::Header* header { reinterpret_cast< Response::Header* >( data ) };
+    const uint8_t prefix { _ordered( header->prefix, byteswap ) };
+    // KeymapNotify does not encode a sequence number
+    if ( ( prefix & protocol::requests::SendEvent::EVENT_CODE_MASK ) ==
+         protocol::events::codes::KEYMAPNOTIFY ) {
+        return false;
+    }
+    header->sequence_num = _ordered(
+        conn->sequence_map.toClient( _ordered( header->sequence_num, byteswap ) ),
+        byteswap );
+    return prefix == Response::REPLY_PREFIX &&
+        conn->sequence_map.takeSyncReply();
+}
+
+void X11ProtocolParser::_cacheReply(
+    Connection* conn, const uint8_t* data, const size_t sz ) {
+    assert( conn != nullptr );
+    assert( data != nullptr );
+    using protocol::Response;
+    const bool byteswap { conn->byteswap };
+    const Response::Header* header {
+        reinterpret_cast< const Response::Header* >( data ) };
+    const uint8_t prefix { _ordered( header->prefix, byteswap ) };
+    if ( prefix != Response::REPLY_PREFIX && prefix != Response::ERROR_PREFIX )
+        return;
+    const uint16_t sequence { _ordered( header->sequence_num, byteswap ) };
+    // ListFontsWithInfo request stays open until its last reply
+    if ( conn->findRequest( sequence ) != nullptr )
+        return;
+    conn->sequence_map.answered();
+    if ( prefix != Response::REPLY_PREFIX )
+        return;
+    const auto miss_it { _reply_cache_misses.find( { conn->id, sequence } ) };
+    if ( miss_it == _reply_cache_misses.end() )
+        return;
+    using protocol::requests::InternAtom;
+    // ATOM may yet be interned, so only-if-exists None is not cached
+    if ( miss_it->second[ 1 ] != char( protocol::requests::opcodes::INTERNATOM ) ||
+         _ordered( reinterpret_cast< const InternAtom::Reply::Encoding* >(
+                       data )->atom.data, byteswap ) != protocol::atoms::NONE ) {
+        _cached_replies.emplace( std::move( miss_it->second ),
+                                 std::vector< uint8_t >( data, data + sz ) );
+    }
+    _reply_cache_misses.erase( miss_it );
+}
+
+void X11ProtocolParser::_flushLocalReplies( Connection* conn ) {
+    assert( conn != nullptr );
+    while ( std::optional< std::vector< uint8_t > > reply {
+            conn->sequence_map.takeLocalReply() } ) {
+        _logReply( conn, reply->data(), reply->size() );
+        conn->server_buffer.insertParsed( reply->data(), reply->size() );
+    }
+}
+
+void X11ProtocolParser::closeReplyCache( const Connection* conn,
+                                         const bool last_connection ) {
+    assert( conn != nullptr );
+    if ( !settings.replycache )
+        return;
+    for ( auto miss_it { _reply_cache_misses.begin() };
+          miss_it != _reply_cache_misses.end(); ) {
+        if ( miss_it->first.conn_id == conn->id )
+            miss_it = _reply_cache_misses.erase( miss_it );
+        else
+            ++miss_it;
+    }
+    // without -noreset, X server resets as its last client disconnects
+    if ( last_connection )
+        _cached_replies.clear();
+}
@@ -0,0 +1,106 @@
+#ifndef ATOMCACHE_HPP
+#define ATOMCACHE_HPP
+
+/**
+ * @file AtomCache.hpp
+ */
+
+#include <optional>
+#include <string>
+#include <utility>      // pair
+#include <vector>
+
+#include <cstdint>
+
+
+/**
+ * @brief On-disk cache of the atom table fetched with `--prefetchatoms`,
+ *   written with `--atomcache`, so that later runs against the same X server
+ *   can begin tracing without waiting to fetch it again.
+ *
+ *   A cache file begins with a #FileHeader identifying the server by its
+ *   #ServerKey, followed by the vendor string, then #FileHeader::atom_ct + 1
+ *   offsets into a string arena (the name of atom `i` spans offsets `i` to
+ *   `i + 1`), then the arena itself. Header fields and offsets are in host
+ *   byte order.
+ */
+class AtomCache {
+public:
+    /**
+     * @brief Identifies an X server instance; atoms are stable for the life
+     *   of a server, so a cache is only used by a server with the same key.
+     */
+    struct ServerKey {
+        /** @brief `vendor` from connection setup acceptance. */
+        std::string vendor;
+        /** @brief `release-number` from connection setup acceptance. */
+        uint32_t    release_number {};
+        /** @brief `root` of first screen from connection setup acceptance. */
+        uint32_t    root {};
+        /**
+         * @brief Server start time (seconds since Unix epoch), taken from
+         *   modification time of its Unix socket, or 0 if not known (eg TCP.)
+         */
+        uint64_t    start_time {};
+
+        bool operator==( const ServerKey& other ) const {
+            return vendor == other.vendor &&
+                release_number == other.release_number &&
+                root == other.root && start_time == other.start_time;
+        }
+    };
+    /**
+     * @brief Identifies cache file layout.
+     */
+    static constexpr uint64_t MAGIC   { 0x4548434d4f544158 };  // "XATOMCHE"
+    /**
+     * @brief Version of cache file layout.
+     */
+    static constexpr uint32_t VERSION { 1 };
+    /**
+     * @brief Cache file header, at offset 0.
+     */
+    struct FileHeader {
+        /** @brief Always #MAGIC. */
+        uint64_t magic;
+        /** @brief Always #VERSION. */
+        uint32_t version;
+        /** @brief Size of this header, at which vendor string begins. */
+        uint32_t header_sz;
+        /** @brief See [ServerKey::start_time](#ServerKey::start_time). */
+        uint64_t start_time;
+        /** @brief See [ServerKey::release_number](#ServerKey::release_number). */
+        uint32_t release_number;
+        /** @brief See [ServerKey::root](#ServerKey::root). */
+        uint32_t root;
+        /** @brief Length of vendor string, which is followed by offsets. */
+        uint32_t vendor_len;
+        /** @brief Count of atoms, including unused atom 0. */
+        uint32_t atom_ct;
+    };
+    static_assert( sizeof( FileHeader ) == 40 );
+
+    /**
+     * @brief Maps cache file and copies its atom names, if it was written
+     *   for server identified by `key`.
+     * @param path file path
+     * @param key identity of server being traced
+     * @return atom names indexed by atom (empty if file does not exist or is
+     *   for another server), and error message if file could not be read
+     */
+    static std::pair< std::vector< std::string >, std::optional< std::string > >
+    load( const std::string& path, const ServerKey& key );
+    /**
+     * @brief Writes cache file, replacing any existing file atomically.
+     * @param path file path
+     * @param key identity of server atoms were fetched from
+     * @param atoms atom names indexed by atom, as returned by #load
+     * @return error message, or `std::nullopt` on success
+     */
+    static std::optional< std::string >
+    save( const std::string& path, const ServerKey& key,
+          const std::vector< std::string >& atoms );
+};
+
+
+#endif  // ATOMCACHE_HPP
@@ -0,0 +1,136 @@
+#ifndef ATOMRESOLVER_HPP
+#define ATOMRESOLVER_HPP
+
+/**
+ * @file AtomResolver.hpp
+ */
+
+#include <deque>
+#include <optional>
+#include <string>
+#include <utility>      // pair
+#include <vector>
+
+#include <cstdint>
+
+#include "SocketBuffer.hpp"
+
+
+/**
+ * @brief Side connection to X server used with `--resolveatoms` to look up
+ *   names of [ATOM](#protocol::ATOM)s seen in traffic that are not yet known.
+ *
+ *   Atoms are queued with #request, then sent by #write as a batch of
+ *   pipelined `GetAtomName` requests, with up to #WINDOW in flight at once.
+ *   As the connection sends no other requests, replies arrive in request
+ *   order and are matched to atoms by sequence number in #read. The socket is
+ *   polled alongside proxied connections by the main queue, so that no
+ *   lookup blocks traffic.
+ */
+class AtomResolver {
+public:
+    /**
+     * @brief Outcome of looking up an atom.
+     */
+    struct Resolution {
+        /** @brief Atom requested. */
+        uint32_t                     atom {};
+        /** @brief Interned string, or `std::nullopt` if server sent error. */
+        std::optional< std::string > name;
+    };
+    /**
+     * @brief Maximum `GetAtomName` requests sent ahead of their replies; at 8B
+     *   per request, a full window fits in a socket send buffer, so writes
+     *   made when polled write-ready never block.
+     */
+    static constexpr size_t WINDOW { 512 };
+
+private:
+    /**
+     * @brief Sentinel value indicating closed connection.
+     */
+    static constexpr int _UNINIT_FD { -1 };
+    /**
+     * @brief Socket connected to X server, after connection setup.
+     */
+    int _fd { _UNINIT_FD };
+    /**
+     * @brief Sequence number of last request sent.
+     */
+    uint16_t _sequence {};
+    /**
+     * @brief Atoms awaiting request, in order of #request.
+     */
+    std::deque< uint32_t > _queued;
+    /**
+     * @brief Sequence numbers and atoms of requests awaiting reply, in
+     *   request order.
+     */
+    std::deque< std::pair< uint16_t, uint32_t > > _in_flight;
+    /**
+     * @brief Buffers partially received replies between reads.
+     */
+    SocketBuffer _buffer;
+
+public:
+    AtomResolver() = default;
+    AtomResolver( const AtomResolver& ) = delete;
+    AtomResolver& operator=( const AtomResolver& ) = delete;
+    /**
+     * @brief Closes connection, if open.
+     */
+    ~AtomResolver();
+    /**
+     * @brief Takes ownership of socket.
+     * @param fd socket connected to X server, after successful connection
+     *   setup using host byte order
+     */
+    void open( const int fd );
+    /**
+     * @brief Closes connection.
+     * @return atoms requested but not yet answered
+     */
+    std::vector< uint32_t > close();
+    /**
+     * @brief Socket file descriptor, to poll.
+     * @return socket file descriptor, or -1 if closed
+     */
+    inline int fd() const {
+        return _fd;
+    }
+    /**
+     * @brief Whether connection is open.
+     */
+    inline bool isOpen() const {
+        return _fd != _UNINIT_FD;
+    }
+    /**
+     * @brief Whether any queued atoms can be requested, so socket should be
+     *   polled for `POLLOUT`.
+     */
+    inline bool writeReady() const {
+        return !_queued.empty() && _in_flight.size() < WINDOW;
+    }
+    /**
+     * @brief Queues lookup of atom name.
+     * @param atom atom to look up
+     */
+    inline void request( const uint32_t atom ) {
+        _queued.push_back( atom );
+    }
+    /**
+     * @brief Sends `GetAtomName` for queued atoms, up to window size.
+     * @return error message, or `std::nullopt` on success
+     */
+    std::optional< std::string > write();
+    /**
+     * @brief Reads available replies and errors.
+     * @param[out] resolved appended with outcome of each request answered
+     * @return error message (including server closing connection), or
+     *   `std::nullopt` on success
+     */
+    std::optional< std::string > read( std::vector< Resolution >& resolved );
+};
+
+
+#endif  // ATOMRESOLVER_HPP
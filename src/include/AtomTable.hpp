@@ -0,0 +1,101 @@
+#ifndef ATOMTABLE_HPP
+#define ATOMTABLE_HPP
+
+/**
+ * @file AtomTable.hpp
+ */
+
+#include <memory>         // unique_ptr
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <cstdint>
+
+
+/**
+ * @brief Names of interned [ATOM](#protocol::ATOM)s, indexed by ATOM.
+ *
+ *   As servers assign ATOMs densely from 1, names of ATOMs below
+ *   #DENSE_LIMIT are views held in a vector indexed by ATOM, so lookup is a
+ *   bounds check and an index; any higher ATOMs are kept in an overflow map.
+ *   Names are copied into an append-only arena of blocks, so views stay
+ *   valid as the table grows, and interning many names at once (eg with
+ *   `--prefetchatoms`) costs one block allocation when preceded by #reserve.
+ */
+class AtomTable {
+public:
+    /**
+     * @brief ATOMs below this are indexed directly.
+     */
+    static constexpr uint32_t DENSE_LIMIT { 1 << 16 };
+
+private:
+    /**
+     * @brief Default size of arena blocks; larger names get their own block.
+     */
+    static constexpr size_t _BLOCK_SZ { 16 * 1024 };
+    /**
+     * @brief Arena blocks, most recent last.
+     */
+    std::vector< std::unique_ptr< char[] > > _blocks;
+    /**
+     * @brief Bytes used in most recent block.
+     */
+    size_t _block_used {};
+    /**
+     * @brief Size of most recent block.
+     */
+    size_t _block_sz {};
+    /**
+     * @brief Names of ATOMs below #DENSE_LIMIT, indexed by ATOM; view with
+     *   `nullptr` data if not interned.
+     */
+    std::vector< std::string_view > _dense;
+    /**
+     * @brief Names of ATOMs at or above #DENSE_LIMIT.
+     */
+    std::unordered_map< uint32_t, std::string_view > _overflow;
+
+    /**
+     * @brief Copies name into arena.
+     * @param name string to copy
+     * @return view of copy
+     */
+    std::string_view _store( const std::string_view name );
+
+public:
+    /**
+     * @brief Looks up name of ATOM.
+     * @param atom ATOM to look up
+     * @return pointer to name, or `nullptr` if not interned
+     * @note Pointer is invalidated by next [set](#set).
+     */
+    inline const std::string_view* find( const uint32_t atom ) const {
+        if ( atom < _dense.size() ) {
+            const std::string_view& name { _dense[ atom ] };
+            return name.data() == nullptr ? nullptr : &name;
+        }
+        if ( atom < DENSE_LIMIT || _overflow.empty() )
+            return nullptr;
+        const auto it { _overflow.find( atom ) };
+        return it == _overflow.end() ? nullptr : &it->second;
+    }
+    /**
+     * @brief Interns name at ATOM, replacing any previous name.
+     * @param atom ATOM to intern
+     * @param name interned string
+     * @return whether name was not already interned at ATOM
+     */
+    bool set( const uint32_t atom, const std::string_view name );
+    /**
+     * @brief Ensures that names of up to `bytes` total size can be set
+     *   without further allocation.
+     * @param atom_ct count of ATOMs to be set, from 0
+     * @param bytes total size of names to be set
+     */
+    void reserve( const uint32_t atom_ct, const size_t bytes );
+};
+
+
+#endif  // ATOMTABLE_HPP
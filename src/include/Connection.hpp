@@ -9,8 +9,16 @@
 #include <unordered_map>
 
 #include <cstdint>
+#include <cstdio>       // FILE
 
+#include "LogRateLimiter.hpp"
+#include "MessageFilter.hpp"
+#include "MessageStats.hpp"
+#include "NetworkEmulator.hpp"
+#include "RoundTripStalls.hpp"
+#include "SequenceMap.hpp"
 #include "SocketBuffer.hpp"
+#include "StashArena.hpp"
 
 #include "protocol/extensions/big_requests.hpp"
 
@@ -29,11 +37,17 @@ public:
         uint8_t major {};
         /** @brief Request minor opcode. */
         uint8_t minor {};
+        /**
+         * @brief Monotonic time request was written to server, if using
+         *   `--latency`, or 0 if not (yet) written.
+         */
+        uint64_t sent_ns {};
         /**
          * @brief Default ctor.
          */
-        RequestOpcodes( const uint8_t major_, const uint8_t minor_ = {} ) :
-            major( major_ ), minor( minor_ ) {}
+        RequestOpcodes( const uint8_t major_, const uint8_t minor_ = {},
+                        const uint64_t sent_ns_ = {} ) :
+            major( major_ ), minor( minor_ ), sent_ns( sent_ns_ ) {}
     };
 
 private:
@@ -69,6 +83,10 @@ public:
      * @brief Timestamp of connection creation (seconds since Unix Epoch).
      */
     const uint64_t start_time;
+    /**
+     * @brief Monotonic time of connection creation (nanoseconds.)
+     */
+    const uint64_t start_ns;
     /**
      * @brief Client address string.
      * @note Format for:
@@ -94,6 +112,25 @@ public:
      * @brief Temporarily stores data read from [server_fd](#server_fd).
      */
     SocketBuffer   server_buffer;
+    /**
+     * @brief Emulated link holding messages parsed in
+     *   [client_buffer](#client_buffer), if using `--netem`.
+     */
+    NetworkEmulator::Link client_netem;
+    /**
+     * @brief Emulated link holding messages parsed in
+     *   [server_buffer](#server_buffer), if using `--netem`.
+     */
+    NetworkEmulator::Link server_netem;
+    /**
+     * @brief Request data needed to parse replies, copied out of
+     *   [client_buffer](#client_buffer) as it does not outlive the request.
+     */
+    StashArena     request_stash;
+    /**
+     * @brief Client and server sequence numbers, if using `--replycache`.
+     */
+    SequenceMap    sequence_map;
     /**
      * @brief Serial number of last request processed.
      * @note Requests should be 1-indexed and index should match actual X server.
@@ -104,6 +141,65 @@ public:
      *   of the logging host.
      */
     bool           byteswap {};
+    /**
+     * @brief Log file stream for messages on this connection, either shared
+     *   [Settings::log_fs](#Settings::log_fs) or a per-connection file when
+     *   using `--outdir`.
+     */
+    ::FILE*        log_fs {};
+    /**
+     * @brief Connection's own log file stream, set aside while `capture`
+     *   control command redirects #log_fs, otherwise `nullptr`.
+     */
+    ::FILE*        precapture_log_fs {};
+    /**
+     * @brief Raw traffic recording file stream for this connection when using
+     *   `--record`, see [TrafficRecording](#TrafficRecording).
+     */
+    ::FILE*        record_fs {};
+    /**
+     * @brief Selects which messages on this connection are formatted and
+     *   logged, see [MessageFilter](#MessageFilter).
+     */
+    MessageFilter::Compiled log_filter;
+    /**
+     * @brief Whether messages on this connection are logged at all; toggled at
+     *   runtime by `--control` commands.
+     */
+    bool logging { true };
+    /**
+     * @brief Rate limits and sampling of messages on this connection that pass
+     *   #log_filter, see [LogRateLimiter](#LogRateLimiter).
+     */
+    LogRateLimiter::Compiled log_limiter;
+    /**
+     * @brief Blocking round trips on this connection, if using `--stalls`.
+     */
+    RoundTripStalls stalls;
+    /**
+     * @brief Message counters on this connection, if using `--stats`.
+     */
+    MessageStats stats;
+    /**
+     * @brief Count of `MotionNotify` events received from server, if using
+     *   `--motioncompress`.
+     */
+    uint64_t motion_events {};
+    /**
+     * @brief Count of `MotionNotify` events dropped as superseded before
+     *   sent to client, if using `--motioncompress`.
+     */
+    uint64_t motion_events_dropped {};
+    /**
+     * @brief Whether parsed messages in #client_buffer are waiting for full
+     *   server socket, so each backpressure stall is counted once.
+     */
+    bool client_buffer_stalled {};
+    /**
+     * @brief Whether parsed messages in #server_buffer are waiting for full
+     *   client socket, so each backpressure stall is counted once.
+     */
+    bool server_buffer_stalled {};
     /**
      * @brief Connection state constants.
      * - `UNESTABLISHED` before initial handshake is completed
@@ -132,7 +228,8 @@ public:
      */
     Status status { UNESTABLISHED };
     /**
-     * @brief Default ctor; assigns [id](#id) and [start_time](#start_time).
+     * @brief Default ctor; assigns [id](#id), [start_time](#start_time) and
+     *   [start_ns](#start_ns).
      */
     Connection();
     /**
@@ -184,14 +281,26 @@ public:
      * @param minor request minor opcode
      * @return request sequence (serial) number
      * @note A request is considered open until a corresponding error or reply
-     *   is received from server.
+     *   is received from server. Requests without replies are replaced when
+     *   sequence numbers wrap.
      */
     inline uint16_t
     registerRequest( const uint8_t major, const uint8_t minor = {} ) {
-        _request_opcodes_by_seq_num.emplace(
+        _request_opcodes_by_seq_num.insert_or_assign(
             ++sequence, RequestOpcodes( major, minor ) );
         return sequence;
     }
+    /**
+     * @brief Records time open request was written to server.
+     * @param seq_num request sequence (serial) number
+     * @param sent_ns monotonic time request was written to server
+     */
+    inline void
+    requestSent( const uint16_t seq_num, const uint64_t sent_ns ) {
+        const auto it { _request_opcodes_by_seq_num.find( seq_num ) };
+        if ( it != _request_opcodes_by_seq_num.end() )
+            it->second.sent_ns = sent_ns;
+    }
     /**
      * @brief Retrieve open request major opcode by sequence number.
      * @param seq_num request sequence (serial) number
@@ -201,6 +310,16 @@ public:
     lookupRequest( const uint16_t seq_num ) {
         return _request_opcodes_by_seq_num.at( seq_num );
     }
+    /**
+     * @brief Retrieve open request opcodes by sequence number, if any.
+     * @param seq_num request sequence (serial) number
+     * @return pointer to request opcodes, or `nullptr` if not open
+     */
+    inline const RequestOpcodes*
+    findRequest( const uint16_t seq_num ) const {
+        const auto it { _request_opcodes_by_seq_num.find( seq_num ) };
+        return it == _request_opcodes_by_seq_num.end() ? nullptr : &it->second;
+    }
     /**
      * @brief Remove major opcode from set of open requests.
      * @param seq_num request sequence (serial) number
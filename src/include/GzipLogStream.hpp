@@ -0,0 +1,114 @@
+#ifndef GZIPLOGSTREAM_HPP
+#define GZIPLOGSTREAM_HPP
+
+/**
+ * @file GzipLogStream.hpp
+ */
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <cstdio>       // FILE
+
+#include <sys/types.h>  // ssize_t
+
+
+/**
+ * @brief Log file stream compressed to gzip format on a separate thread, used
+ *   for `--outfile` with `--compress`.
+ *
+ *   Each flush of the stream buffer is compressed as an independent gzip
+ *   member (block), and concatenated gzip members are themselves a valid gzip
+ *   file; so a file truncated by a crash can still be decompressed up to its
+ *   last complete block, eg with `zcat`. Blocks are compressed for speed
+ *   rather than ratio, and writes to the stream block only if compression
+ *   falls more than #MAX_QUEUED_BLOCKS behind.
+ * @note Only available when built with `XTRACEPP_WITH_ZLIB`.
+ */
+class GzipLogStream {
+private:
+    /**
+     * @brief File descriptor of open log file.
+     */
+    int                     _fd { -1 };
+    /**
+     * @brief Guards #_blocks and #_stopping.
+     */
+    std::mutex              _mutex;
+    /**
+     * @brief Signals new blocks or stopping.
+     */
+    std::condition_variable _cv;
+    /**
+     * @brief Uncompressed blocks waiting for compression thread.
+     */
+    std::deque< std::string > _blocks;
+    /**
+     * @brief Whether compression thread should exit once #_blocks is empty.
+     */
+    bool                    _stopping {};
+    /**
+     * @brief First `errno` encountered by compression thread, or -1 for zlib
+     *   errors.
+     */
+    int                     _error {};
+    /**
+     * @brief Compression thread.
+     */
+    std::thread             _thread;
+
+    GzipLogStream() = default;
+    /**
+     * @brief Compression thread loop, compresses and writes blocks until
+     *   stopped.
+     */
+    void _compress();
+    /**
+     * @brief Compresses a single block as a gzip member and writes it to file.
+     * @param block uncompressed bytes
+     * @return 0 on success, or `errno` value on write error, or -1 on zlib error
+     */
+    int _writeBlock( const std::string& block );
+    /**
+     * @brief `fopencookie(3)` write function, hands off stream buffer to
+     *   compression thread.
+     * @param cookie stream state
+     * @param buf bytes to write
+     * @param size count of bytes to write
+     * @return bytes written, or -1 on error
+     */
+    static ::ssize_t _cookieWrite( void* cookie, const char* buf, size_t size );
+    /**
+     * @brief `fopencookie(3)` close function, joins compression thread after
+     *   it has written all blocks, then fsyncs and closes file.
+     * @param cookie stream state
+     * @return 0 on success, or -1 with `errno` set on error
+     */
+    static int _cookieClose( void* cookie );
+
+public:
+    /**
+     * @brief Size of stream buffer, and so of each compressed block (before
+     *   compression.)
+     */
+    static constexpr size_t BLOCK_SZ { 256 * 1024 };
+    /**
+     * @brief Maximum blocks waiting for compression before writes to stream
+     *   block.
+     */
+    static constexpr size_t MAX_QUEUED_BLOCKS { 16 };
+
+    /**
+     * @brief Opens file for compressed writing.
+     * @param path path of file to create (or truncate)
+     * @return stream to be closed with `fclose(3)`, or `nullptr` with `errno`
+     *   set on failure
+     */
+    static ::FILE* open( const char* path );
+};
+
+
+#endif  // GZIPLOGSTREAM_HPP
@@ -0,0 +1,106 @@
+#ifndef IMAGECACHE_HPP
+#define IMAGECACHE_HPP
+
+/**
+ * @file ImageCache.hpp
+ */
+
+#include <list>
+#include <string>
+#include <unordered_map>
+
+#include <cstdint>
+
+
+/**
+ * @brief Least recently used cache of image data (eg `PutImage` request or
+ *   `GetImage` reply suffix), keyed by 64-bit hash of its content, with a
+ *   budget in bytes.
+ *
+ *   Used in pairs by [Tunnel](#Tunnel): the sending end keeps only hashes and
+ *   sizes to learn which images the receiving end already holds, and the
+ *   receiving end keeps the data itself. As both ends apply the same
+ *   sequence of #find and #insert with the same budget, they evict the same
+ *   entries, and a hash found by the sender is always found by the receiver.
+ */
+class ImageCache {
+private:
+    /**
+     * @brief Single cached image.
+     */
+    struct _Entry {
+        /** @brief Hash of #data. */
+        uint64_t    hash {};
+        /** @brief Size of image, counted against budget even if #data is
+         *    not kept. */
+        size_t      sz {};
+        /** @brief Image data, if kept. */
+        std::string data;
+    };
+    /**
+     * @brief Entries, most recently used first.
+     */
+    std::list< _Entry > _entries;
+    /**
+     * @brief Entries by hash.
+     */
+    std::unordered_map< uint64_t, std::list< _Entry >::iterator > _entries_by_hash;
+    /**
+     * @brief Total size of #_entries.
+     */
+    size_t _sz {};
+    /**
+     * @brief Largest total size of #_entries.
+     */
+    size_t _budget {};
+
+    /**
+     * @brief Evicts least recently used entries until total size is at most
+     *   `sz`.
+     * @param sz largest total size to keep
+     */
+    void _evictAbove( const size_t sz );
+
+public:
+    /**
+     * @brief Fast non-cryptographic 64-bit hash (MurmurHash64A), reading 8B
+     *   at a time.
+     * @param data bytes to hash
+     * @param sz count of bytes to hash
+     * @return hash value
+     */
+    static uint64_t hash( const uint8_t* data, const size_t sz );
+
+    /**
+     * @brief Sets budget, evicting least recently used entries above it.
+     * @param budget largest total size of cached images in bytes, 0 to cache
+     *   none
+     */
+    void setBudget( const size_t budget );
+    /**
+     * @brief Budget in bytes.
+     */
+    inline size_t budget() const {
+        return _budget;
+    }
+    /**
+     * @brief Finds image, marking it most recently used.
+     * @param hash hash of image
+     * @return cached entry data (empty if data is not kept), or `nullptr` if
+     *   not cached
+     */
+    const std::string* find( const uint64_t hash );
+    /**
+     * @brief Caches image as most recently used, evicting least recently used
+     *   entries until within budget.
+     * @param hash hash of image
+     * @param sz size of image
+     * @param data image data to keep, or `nullptr` to keep only size
+     * @return whether image fits in budget and was cached
+     */
+    bool insert( const uint64_t hash, const size_t sz,
+                 const uint8_t* data = nullptr );
+};
+
+
+#endif  // IMAGECACHE_HPP
@@ -0,0 +1,167 @@
+#ifndef LATENCYHISTOGRAM_HPP
+#define LATENCYHISTOGRAM_HPP
+
+/**
+ * @file LatencyHistogram.hpp
+ */
+
+#include <array>
+#include <algorithm>  // max
+
+#include <cstdint>
+
+
+/**
+ * @brief HDR-style log-linear histogram of durations in nanoseconds.
+ *
+ *   Values are bucketed by power of 2, with each power of 2 range divided
+ *   into #SUB_BUCKET_CT linear sub-buckets, giving constant relative precision
+ *   (~1/#SUB_BUCKET_CT) over the full range of `uint64_t` with fixed storage
+ *   and O(1) recording.
+ */
+class LatencyHistogram {
+private:
+    /**
+     * @brief Bits of linear precision within each power of 2.
+     */
+    static constexpr uint32_t _SUB_BUCKET_BITS { 4 };
+
+public:
+    /**
+     * @brief Linear sub-buckets per power of 2.
+     */
+    static constexpr uint32_t SUB_BUCKET_CT { 1 << _SUB_BUCKET_BITS };
+
+private:
+    /**
+     * @brief Total buckets: values below #SUB_BUCKET_CT are recorded exactly,
+     *   then one set of sub-buckets per remaining power of 2.
+     */
+    static constexpr uint32_t _BUCKET_CT {
+        SUB_BUCKET_CT * ( 64 - _SUB_BUCKET_BITS + 1 ) };
+    /**
+     * @brief Counts per bucket.
+     */
+    std::array< uint64_t, _BUCKET_CT > _counts {};
+    /**
+     * @brief Total values recorded.
+     */
+    uint64_t _total_ct {};
+    /**
+     * @brief Largest value recorded.
+     */
+    uint64_t _max {};
+    /**
+     * @brief Sum of values recorded.
+     */
+    uint64_t _sum {};
+
+    /**
+     * @brief Maps value to bucket index.
+     * @param val value
+     * @return bucket index
+     */
+    static inline uint32_t _bucketIndex( const uint64_t val ) {
+        if ( val < SUB_BUCKET_CT )
+            return uint32_t( val );
+        const uint32_t msb ( 63 - __builtin_clzll( val ) );
+        const uint32_t shift { msb - _SUB_BUCKET_BITS };
+        // sub-bucket includes implicit leading 1 bit, so in range
+        //   SUB_BUCKET_CT..2*SUB_BUCKET_CT-1
+        return ( shift + 1 ) * SUB_BUCKET_CT +
+            uint32_t( ( val >> shift ) - SUB_BUCKET_CT );
+    }
+    /**
+     * @brief Maps bucket index to highest value it holds.
+     * @param index bucket index
+     * @return highest value in bucket
+     */
+    static inline uint64_t _bucketMax( const uint32_t index ) {
+        if ( index < SUB_BUCKET_CT )
+            return index;
+        const uint32_t shift { index / SUB_BUCKET_CT - 1 };
+        const uint64_t sub { index % SUB_BUCKET_CT + SUB_BUCKET_CT };
+        return ( ( sub + 1 ) << shift ) - 1;
+    }
+
+public:
+    /**
+     * @brief Records a value.
+     * @param val value to record
+     */
+    inline void record( const uint64_t val ) {
+        ++_counts[ _bucketIndex( val ) ];
+        ++_total_ct;
+        _max = std::max( _max, val );
+        _sum += val;
+    }
+    /**
+     * @brief Merges values recorded in another histogram.
+     * @param other histogram to merge
+     * @return this histogram
+     */
+    LatencyHistogram& operator+=( const LatencyHistogram& other ) {
+        for ( uint32_t i {}; i < _BUCKET_CT; ++i )
+            _counts[ i ] += other._counts[ i ];
+        _total_ct += other._total_ct;
+        _max = std::max( _max, other._max );
+        _sum += other._sum;
+        return *this;
+    }
+    /**
+     * @brief Returns total values recorded.
+     * @return total values recorded
+     */
+    inline uint64_t count() const {
+        return _total_ct;
+    }
+    /**
+     * @brief Returns largest value recorded.
+     * @return largest value recorded
+     */
+    inline uint64_t max() const {
+        return _max;
+    }
+    /**
+     * @brief Returns sum of values recorded.
+     * @return sum of values recorded
+     */
+    inline uint64_t sum() const {
+        return _sum;
+    }
+    /**
+     * @brief Estimates count of values recorded no greater than a bound, eg
+     *   for cumulative histogram buckets.
+     * @param bound upper bound of values to count
+     * @return count of values in buckets whose highest value is within bound
+     */
+    uint64_t countAtMost( const uint64_t bound ) const {
+        uint64_t cumulative {};
+        for ( uint32_t i {}; i < _BUCKET_CT && _bucketMax( i ) <= bound; ++i )
+            cumulative += _counts[ i ];
+        return cumulative;
+    }
+    /**
+     * @brief Estimates value at percentile.
+     * @param percentile percentile in range 0-100
+     * @return upper bound of bucket containing percentile, or 0 if empty
+     */
+    uint64_t percentile( const double percentile ) const {
+        if ( _total_ct == 0 )
+            return 0;
+        const uint64_t target {
+            std::max( uint64_t( 1 ),
+                      uint64_t( percentile / 100.0 * double( _total_ct ) +
+                                0.5 ) ) };
+        uint64_t cumulative {};
+        for ( uint32_t i {}; i < _BUCKET_CT; ++i ) {
+            cumulative += _counts[ i ];
+            if ( cumulative >= target )
+                return std::min( _bucketMax( i ), _max );
+        }
+        return _max;
+    }
+};
+
+
+#endif  // LATENCYHISTOGRAM_HPP
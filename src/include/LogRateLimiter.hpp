@@ -0,0 +1,174 @@
+#ifndef LOGRATELIMITER_HPP
+#define LOGRATELIMITER_HPP
+
+/**
+ * @file LogRateLimiter.hpp
+ */
+
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>      // pair
+#include <vector>
+
+#include <cstdint>
+#include <cstdio>       // FILE
+
+#include "MessageFilter.hpp"
+
+
+/**
+ * @brief Compiles `--ratelimit` expressions into per-[Connection](#Connection)
+ *   token buckets and 1-in-N samplers, which decide whether messages that pass
+ *   `--filter` are formatted and logged.
+ *
+ *   Each expression is a rule of comma-separated `key=value` terms, using any
+ *   [MessageFilter](#MessageFilter) terms to select messages, plus:
+ *   - `rate=N` maximum messages logged per second
+ *   - `burst=N` maximum messages logged in a burst (defaults to `rate`)
+ *   - `sample=N` log only every Nth message
+ *
+ *   A message is governed by the first rule that selects it. Suppressed
+ *   messages are counted by name and summarized periodically.
+ */
+class LogRateLimiter {
+private:
+    /**
+     * @brief Single parsed `--ratelimit` expression.
+     */
+    struct _Rule {
+        /** @brief Messages to which rule applies. */
+        MessageFilter selection;
+        /** @brief Messages logged per second, or 0 for no rate limit. */
+        uint32_t      rate {};
+        /** @brief Token bucket capacity. */
+        uint32_t      burst {};
+        /** @brief Log only every Nth message (1 logs all.) */
+        uint32_t      sample { 1 };
+    };
+    /**
+     * @brief All rules parsed from `--ratelimit` expressions.
+     */
+    std::vector< _Rule > _rules;
+
+public:
+    /**
+     * @brief Interval between summaries of suppressed messages.
+     */
+    static constexpr uint64_t SUMMARY_INTERVAL_NS { 1'000'000'000 };
+
+    /**
+     * @brief Parses a single `--ratelimit` expression into a rule.
+     * @param expr rate limit expression
+     * @return error message, or `std::nullopt` on success
+     */
+    std::optional< std::string >
+    addRule( const std::string_view expr );
+    /**
+     * @brief Indicates whether any rules have been added.
+     * @return whether any rules have been added
+     */
+    inline bool empty() const {
+        return _rules.empty();
+    }
+
+    /**
+     * @brief Rules of #LogRateLimiter with state for a single
+     *   [Connection](#Connection).
+     */
+    class Compiled {
+    private:
+        friend class LogRateLimiter;
+        /**
+         * @brief Token bucket and sampler state for a single rule.
+         */
+        struct _Bucket {
+            /** @brief Messages to which bucket applies. */
+            MessageFilter::Compiled selection;
+            /** @brief Tokens added per second, or 0 for no rate limit. */
+            uint32_t rate {};
+            /** @brief Maximum tokens held. */
+            uint32_t burst {};
+            /** @brief Log only every Nth message. */
+            uint32_t sample { 1 };
+            /** @brief Messages selected since last one logged by sampling. */
+            uint32_t sample_count {};
+            /** @brief Tokens currently held. */
+            double   tokens {};
+            /** @brief Time of last token refill. */
+            uint64_t refill_ns {};
+            /**
+             * @brief Takes a sample and a token, if available.
+             * @param now_ns current monotonic time
+             * @return whether message should be logged
+             */
+            bool admit( const uint64_t now_ns );
+        };
+        /**
+         * @brief Buckets for rules applying to connection.
+         */
+        std::vector< _Bucket > _buckets;
+        /**
+         * @brief Suppressed message counts in current summary interval, by
+         *   message kind and name.
+         */
+        std::map< std::pair< std::string_view, std::string_view >,
+                  uint64_t > _suppressed;
+        /**
+         * @brief Start of current summary interval.
+         */
+        uint64_t _interval_start_ns {};
+        /**
+         * @brief Reads coarse monotonic clock, which is cheap enough to be
+         *   read for every message.
+         * @return current monotonic time in nanoseconds
+         */
+        static uint64_t _now();
+
+    public:
+        /**
+         * @brief Whether a message that passed `--filter` should be logged.
+         * @tparam SelectedFuncT callable taking `const MessageFilter::Compiled&`
+         *   and returning whether the message is selected
+         * @param selected tests message against a rule's selection
+         * @param kind message kind for summaries (eg "Event")
+         * @param name message name for summaries (eg "MotionNotify")
+         * @return whether message should be logged
+         * @note `kind` and `name` must have static storage duration.
+         */
+        template< typename SelectedFuncT >
+        bool admit( SelectedFuncT&& selected,
+                    const std::string_view kind, const std::string_view name ) {
+            for ( _Bucket& bucket : _buckets ) {
+                if ( !selected( bucket.selection ) )
+                    continue;
+                if ( bucket.admit( _now() ) )
+                    return true;
+                ++_suppressed[ { kind, name } ];
+                return false;
+            }
+            return true;
+        }
+        /**
+         * @brief Formats counts of suppressed messages, if summary interval
+         *   has elapsed, to be logged in order with other lines (see
+         *   X11ProtocolParser::println.)
+         * @param conn_id [Connection](#Connection) unique serial number
+         * @param force summarize regardless of interval (eg on connection
+         *   close)
+         * @return summary lines, without newlines, or empty if none due
+         */
+        std::vector< std::string > summary( const uint32_t conn_id,
+                                            const bool force = false );
+    };
+    /**
+     * @brief Creates rule state for a given connection.
+     * @param conn_id [Connection](#Connection) unique serial number
+     * @return rate limiter to be checked for every logged message on connection
+     */
+    Compiled compile( const uint32_t conn_id ) const;
+};
+
+
+#endif  // LOGRATELIMITER_HPP
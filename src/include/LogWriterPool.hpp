@@ -0,0 +1,160 @@
+#ifndef LOGWRITERPOOL_HPP
+#define LOGWRITERPOOL_HPP
+
+/**
+ * @file LogWriterPool.hpp
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>       // unique_ptr
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cstdio>       // FILE
+
+#include <sys/types.h>  // ssize_t
+
+
+/**
+ * @brief Pool of threads writing log files, so that disk I/O for many
+ *   per-[Connection](#Connection) log files happens off of the main thread.
+ *
+ *   Each file is assigned to a single worker thread (shard), preserving write
+ *   order per file. Files are presented as ordinary `FILE*` streams (via
+ *   `fopencookie(3)`), so they can be used interchangeably with
+ *   [Settings::log_fs](#Settings::log_fs); each stream buffer is handed off to
+ *   its worker whenever it is flushed.
+ *
+ *   Each worker queue is bounded by #QUEUE_LIMIT_SZ, beyond which flushing a
+ *   stream waits for its worker to catch up, as with
+ *   [GzipLogStream](#GzipLogStream); closing a stream only queues the final
+ *   fsync and close of its file.
+ */
+class LogWriterPool {
+private:
+    struct _Shard;
+    /**
+     * @brief Unit of work for a worker thread.
+     */
+    struct _Task {
+        /** @brief File to which task applies. */
+        _Shard*              shard {};
+        /** @brief Bytes to write. */
+        std::string          data;
+        /** @brief Whether to fsync and close file after writing #data. */
+        bool                 close {};
+    };
+    /**
+     * @brief Worker thread and its task queue.
+     */
+    struct _Worker {
+        /** @brief Guards #tasks, #queued_sz and #stopping. */
+        std::mutex              mutex;
+        /** @brief Signals new tasks or stopping. */
+        std::condition_variable cv;
+        /** @brief Signals tasks taken from queue, freeing space. */
+        std::condition_variable space_cv;
+        /** @brief Pending tasks, in order of submission. */
+        std::deque< _Task >     tasks;
+        /** @brief Total size of #tasks data. */
+        size_t                  queued_sz {};
+        /** @brief Whether worker should exit once #tasks is empty. */
+        bool                    stopping {};
+        /** @brief Worker thread. */
+        std::thread             thread;
+    };
+    /**
+     * @brief Single file written by pool.
+     */
+    struct _Shard {
+        /** @brief Path of log file, for error messages. */
+        std::string         path;
+        /** @brief File descriptor of open log file. */
+        int                 fd { -1 };
+        /** @brief Worker assigned to file. */
+        _Worker*            worker {};
+        /** @brief First `errno` encountered by worker when writing file. */
+        std::atomic< int >  error {};
+    };
+    /**
+     * @brief Worker threads.
+     */
+    std::vector< std::unique_ptr< _Worker > > _workers;
+    /**
+     * @brief Index of worker to assign to next opened file.
+     */
+    size_t _next_worker_i {};
+
+    /**
+     * @brief Adds task to worker queue, first waiting for room if its data
+     *   would exceed #QUEUE_LIMIT_SZ.
+     * @param worker worker to perform task
+     * @param task task to perform
+     */
+    static void _submit( _Worker* worker, _Task&& task );
+    /**
+     * @brief Fsyncs and closes file, reports any error encountered while
+     *   writing it, and frees shard.
+     * @param shard file to close
+     */
+    static void _close( _Shard* shard );
+    /**
+     * @brief Worker thread loop, performs tasks until stopped.
+     * @param worker worker owning thread
+     */
+    static void _work( _Worker* worker );
+    /**
+     * @brief `fopencookie(3)` write function, hands off stream buffer to worker.
+     * @param cookie shard of stream
+     * @param buf bytes to write
+     * @param size count of bytes to write
+     * @return bytes written, or -1 on error
+     */
+    static ::ssize_t _cookieWrite( void* cookie, const char* buf, size_t size );
+    /**
+     * @brief `fopencookie(3)` close function, queues fsync and close of file
+     *   after all previous data without waiting for it.
+     * @param cookie shard of stream
+     * @return 0 on success, or -1 with `errno` set if an earlier write failed
+     * @note Errors from final write, fsync or close are reported by worker.
+     */
+    static int _cookieClose( void* cookie );
+
+public:
+    /**
+     * @brief Size of buffer used for each stream.
+     */
+    static constexpr size_t STREAM_BUFFER_SZ { 64 * 1024 };
+    /**
+     * @brief Most bytes queued for each worker before further writes wait.
+     */
+    static constexpr size_t QUEUE_LIMIT_SZ { 256 * STREAM_BUFFER_SZ };
+
+    LogWriterPool() = delete;
+    /**
+     * @brief Starts worker threads.
+     * @param thread_ct count of worker threads
+     */
+    explicit LogWriterPool( const size_t thread_ct );
+    /**
+     * @brief Stops and joins worker threads after they complete queued tasks.
+     */
+    ~LogWriterPool();
+    /**
+     * @brief Opens file for writing by pool.
+     * @param path path of file to create (or truncate)
+     * @param unbuffered disable stream buffering, so that every write is
+     *   handed off to worker immediately
+     * @return stream to be closed with `fclose(3)`, or `nullptr` with `errno`
+     *   set on failure
+     * @note `fclose(3)` returns once final fsync and close are queued.
+     */
+    ::FILE* open( const std::string& path, const bool unbuffered );
+};
+
+
+#endif  // LOGWRITERPOOL_HPP
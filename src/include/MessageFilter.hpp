@@ -0,0 +1,220 @@
+#ifndef MESSAGEFILTER_HPP
+#define MESSAGEFILTER_HPP
+
+/**
+ * @file MessageFilter.hpp
+ */
+
+#include <bitset>
+#include <limits>       // numeric_limits
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <cstdint>
+
+#include "optionTerms.hpp"
+
+
+/**
+ * @brief Compiles `--filter` expressions into bitsets that decide, per
+ *   [Connection](#Connection), which messages are formatted and logged.
+ *
+ *   Each expression is a clause of comma-separated `key=value` terms:
+ *   - `conn=N[-M]` connection id (range)
+ *   - `dir=s<c|c2s|s>c|s2c` message direction
+ *   - `request=OPCODE|NAME[:MINOR]` core or extension request (and its replies
+ *     and errors)
+ *   - `event=CODE|NAME` event code
+ *   - `error=CODE|NAME` error code
+ *   - `seq=N[-M]` sequence number (range)
+ *
+ *   Message selection terms (`request`, `event`, `error`) may be repeated and
+ *   are OR'd; all other terms are AND'd. A clause without any message selection
+ *   terms selects all messages. A message is logged if it matches any clause,
+ *   or if no clauses were given.
+ */
+class MessageFilter {
+private:
+    /**
+     * @brief Set of 8-bit codes (opcodes, event codes, error codes).
+     */
+    using _CodeSet = std::bitset< std::numeric_limits< uint8_t >::max() + 1 >;
+    /**
+     * @brief Single parsed `--filter` expression.
+     */
+    struct _Clause {
+        /** @brief Connection ids to which clause applies. */
+        option_terms::Range      conns;
+        /** @brief Sequence numbers selected. */
+        option_terms::Range      seqs;
+        /** @brief Message directions selected. */
+        option_terms::Directions dirs;
+        /** @brief Whether any `request`/`event`/`error` terms were used. */
+        bool     selective { false };
+        /** @brief Request major opcodes selected. */
+        _CodeSet requests;
+        /** @brief Minor opcodes selected per extension major opcode; major
+         *    opcodes not present select all minor opcodes. */
+        std::unordered_map< uint8_t, _CodeSet > minor_opcodes;
+        /** @brief Event codes selected. */
+        _CodeSet events;
+        /** @brief Error codes selected. */
+        _CodeSet errors;
+    };
+    /**
+     * @brief All clauses parsed from `--filter` expressions.
+     */
+    std::vector< _Clause > _clauses;
+    /**
+     * @brief Parses an 8-bit code given either as a decimal integer or a name.
+     * @param str code string
+     * @param names names indexed by code
+     * @return parsed code, or `std::nullopt` on failure
+     */
+    template< typename NamesT >
+    static std::optional< uint8_t >
+    _parseCode( const std::string_view str, const NamesT& names );
+
+public:
+    /**
+     * @brief Parses a single `--filter` expression into a clause.
+     * @param expr filter expression
+     * @return error message, or `std::nullopt` on success
+     */
+    std::optional< std::string >
+    addClause( const std::string_view expr );
+    /**
+     * @brief Indicates whether any clauses have been added.
+     * @return whether any clauses have been added
+     */
+    inline bool empty() const {
+        return _clauses.empty();
+    }
+
+    /**
+     * @brief Clauses of #MessageFilter relevant to a single
+     *   [Connection](#Connection), checked before any message formatting.
+     */
+    class Compiled {
+    private:
+        friend class MessageFilter;
+        /**
+         * @brief Clauses applying to connection.
+         */
+        std::vector< _Clause > _clauses;
+        /**
+         * @brief Whether no filtering is in effect.
+         */
+        bool _pass_all { true };
+
+    public:
+        /**
+         * @brief Whether a request should be logged.
+         * @param major request major opcode
+         * @param minor request minor opcode
+         * @param seq_num request sequence number
+         * @return whether request should be logged
+         */
+        inline bool
+        request( const uint8_t major, const uint8_t minor,
+                 const uint32_t seq_num ) const {
+            if ( _pass_all )
+                return true;
+            for ( const _Clause& clause : _clauses ) {
+                if ( clause.dirs.client_to_server && clause.seqs.in( seq_num ) &&
+                     _opcodeSelected( clause, major, minor ) )
+                    return true;
+            }
+            return false;
+        }
+        /**
+         * @brief Whether a reply should be logged.
+         * @param major major opcode of request replied to
+         * @param minor minor opcode of request replied to
+         * @param seq_num reply sequence number
+         * @return whether reply should be logged
+         */
+        inline bool
+        reply( const uint8_t major, const uint8_t minor,
+               const uint32_t seq_num ) const {
+            if ( _pass_all )
+                return true;
+            for ( const _Clause& clause : _clauses ) {
+                if ( clause.dirs.server_to_client && clause.seqs.in( seq_num ) &&
+                     _opcodeSelected( clause, major, minor ) )
+                    return true;
+            }
+            return false;
+        }
+        /**
+         * @brief Whether an event should be logged.
+         * @param code event code (without generated flag)
+         * @param seq_num event sequence number
+         * @return whether event should be logged
+         */
+        inline bool
+        event( const uint8_t code, const uint32_t seq_num ) const {
+            if ( _pass_all )
+                return true;
+            for ( const _Clause& clause : _clauses ) {
+                if ( clause.dirs.server_to_client && clause.seqs.in( seq_num ) &&
+                     ( !clause.selective || clause.events.test( code ) ) )
+                    return true;
+            }
+            return false;
+        }
+        /**
+         * @brief Whether an error should be logged, selected either by its
+         *   code or like a reply by the request it answers.
+         * @param code error code
+         * @param major major opcode of request in error
+         * @param minor minor opcode of request in error
+         * @param seq_num error sequence number
+         * @return whether error should be logged
+         */
+        inline bool
+        error( const uint8_t code, const uint8_t major, const uint8_t minor,
+               const uint32_t seq_num ) const {
+            if ( _pass_all )
+                return true;
+            for ( const _Clause& clause : _clauses ) {
+                if ( clause.dirs.server_to_client && clause.seqs.in( seq_num ) &&
+                     ( clause.errors.test( code ) ||
+                       _opcodeSelected( clause, major, minor ) ) )
+                    return true;
+            }
+            return false;
+        }
+
+    private:
+        /**
+         * @brief Tests request opcodes against a clause.
+         * @param clause clause to test
+         * @param major request major opcode
+         * @param minor request minor opcode
+         * @return whether opcodes are selected by clause
+         */
+        static inline bool
+        _opcodeSelected( const _Clause& clause,
+                         const uint8_t major, const uint8_t minor ) {
+            if ( !clause.selective )
+                return true;
+            if ( !clause.requests.test( major ) )
+                return false;
+            const auto it { clause.minor_opcodes.find( major ) };
+            return it == clause.minor_opcodes.end() || it->second.test( minor );
+        }
+    };
+    /**
+     * @brief Selects clauses applying to a given connection.
+     * @param conn_id [Connection](#Connection) unique serial number
+     * @return filter to be checked for every message on connection
+     */
+    Compiled compile( const uint32_t conn_id ) const;
+};
+
+
+#endif  // MESSAGEFILTER_HPP
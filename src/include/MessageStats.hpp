@@ -0,0 +1,115 @@
+#ifndef MESSAGESTATS_HPP
+#define MESSAGESTATS_HPP
+
+/**
+ * @file MessageStats.hpp
+ */
+
+#include <algorithm>    // min max
+#include <limits>
+#include <unordered_map>
+#include <utility>      // pair
+#include <vector>
+
+#include <cstddef>      // size_t
+#include <cstdint>
+
+
+/**
+ * @brief Message counters by message type, kept instead of per-message log
+ *   text when using `--stats`.
+ */
+class MessageStats {
+public:
+    /**
+     * @brief Message kinds counted separately.
+     */
+    enum Kind : uint8_t {
+        REQUEST, REPLY, EVENT, GENERATED_EVENT, ERROR, KIND_CT
+    };
+    /**
+     * @brief Identifies message type.
+     */
+    struct Key {
+        /** @brief See #Kind. */
+        Kind    kind;
+        /** @brief Request major opcode, or event or error code. */
+        uint8_t code;
+        /** @brief Extension request minor opcode, otherwise 0. */
+        uint8_t minor_opcode;
+    };
+    /**
+     * @brief Counters for a single message type.
+     */
+    struct Counter {
+        /** @brief Messages. */
+        uint64_t count {};
+        /** @brief Total size of messages in bytes. */
+        uint64_t bytes {};
+        /** @brief Smallest message size. */
+        uint32_t min_sz { std::numeric_limits< uint32_t >::max() };
+        /** @brief Largest message size. */
+        uint32_t max_sz {};
+        /** @brief Requests which received a (final) reply or error. */
+        uint64_t answered {};
+    };
+
+private:
+    /**
+     * @brief Counters indexed by packed #Key.
+     */
+    std::unordered_map< uint32_t, Counter > _counters;
+
+    /**
+     * @brief Packs #Key for indexing.
+     * @param kind see #Kind
+     * @param code request major opcode, or event or error code
+     * @param minor_opcode extension request minor opcode, otherwise 0
+     * @return packed key
+     */
+    static inline uint32_t
+    _pack( const Kind kind, const uint8_t code, const uint8_t minor_opcode ) {
+        return uint32_t( kind ) << 16 | uint32_t( code ) << 8 | minor_opcode;
+    }
+
+public:
+    /**
+     * @brief Counts message.
+     * @param kind see #Kind
+     * @param code request major opcode, or event or error code
+     * @param minor_opcode extension request minor opcode, otherwise 0
+     * @param sz message size in bytes
+     */
+    inline void record( const Kind kind, const uint8_t code,
+                        const uint8_t minor_opcode, const size_t sz ) {
+        Counter& counter { _counters[ _pack( kind, code, minor_opcode ) ] };
+        ++counter.count;
+        counter.bytes += sz;
+        counter.min_sz = std::min( counter.min_sz, uint32_t( sz ) );
+        counter.max_sz = std::max( counter.max_sz, uint32_t( sz ) );
+    }
+    /**
+     * @brief Counts request as answered by reply or error.
+     * @param major_opcode request major opcode
+     * @param minor_opcode extension request minor opcode, otherwise 0
+     */
+    inline void answered( const uint8_t major_opcode,
+                          const uint8_t minor_opcode ) {
+        ++_counters[ _pack( REQUEST, major_opcode, minor_opcode ) ].answered;
+    }
+    /**
+     * @brief Adds counters of another instance, eg for totals across
+     *   connections.
+     * @param other counters to add
+     * @return this instance
+     */
+    MessageStats& operator+=( const MessageStats& other );
+    /**
+     * @brief Lists counters in order of kind and code.
+     * @return message types and their counters
+     */
+    std::vector< std::pair< Key, Counter > > sorted() const;
+};
+
+
+#endif  // MESSAGESTATS_HPP
@@ -0,0 +1,113 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+/**
+ * @file Metrics.hpp
+ */
+
+#include <array>
+#include <atomic>
+#include <memory>       // unique_ptr
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include <cstdint>
+
+
+/**
+ * @brief Process-wide monotonic counters, served by `--metrics`.
+ *
+ *   Each thread increments its own shard of counters, which only it writes,
+ *   so incrementing takes no lock and no atomic read-modify-write; shards are
+ *   only summed when a snapshot is taken.
+ */
+class Metrics {
+public:
+    /**
+     * @brief Counter identifiers.
+     */
+    enum Counter : uint8_t {
+        BYTES_CLIENT_TO_SERVER,
+        BYTES_SERVER_TO_CLIENT,
+        MESSAGES_CLIENT_TO_SERVER,
+        MESSAGES_SERVER_TO_CLIENT,
+        PARSE_ERRORS,
+        BACKPRESSURE_STALLS,
+        REPLY_CACHE_HITS,
+        REPLY_CACHE_MISSES,
+        LOG_WRITER_BYTES_QUEUED,
+        LOG_WRITER_BYTES_WRITTEN,
+        LOG_WRITER_STALLS,
+        GZIP_BYTES_QUEUED,
+        GZIP_BYTES_COMPRESSED,
+        TUNNEL_CHANNEL_BYTES,
+        TUNNEL_FRAME_BYTES,
+        TUNNEL_LINK_BYTES,
+        IMAGE_CACHE_HITS,
+        IMAGE_CACHE_MISSES,
+        IMAGE_CACHE_BYTES_SAVED,
+        MOTION_EVENTS,
+        MOTION_EVENTS_DROPPED,
+        COUNTER_CT
+    };
+    /**
+     * @brief Summed values of all counters, indexed by #Counter.
+     */
+    using SnapshotT = std::array< uint64_t, COUNTER_CT >;
+
+private:
+    /**
+     * @brief Counters of a single thread.
+     */
+    struct _Shard {
+        /** @brief Counter values, indexed by #Counter. */
+        std::array< std::atomic< uint64_t >, COUNTER_CT > values {};
+    };
+    static_assert( std::atomic< uint64_t >::is_always_lock_free );
+    /**
+     * @brief Guards #_shards.
+     */
+    inline static std::mutex _shards_mutex;
+    /**
+     * @brief Shards of all threads that have incremented a counter; kept after
+     *   threads exit so that their counts are not lost.
+     */
+    inline static std::vector< std::unique_ptr< _Shard > > _shards;
+
+    /**
+     * @brief Creates and registers shard for calling thread.
+     * @return new shard
+     */
+    static _Shard* _registerShard();
+    /**
+     * @brief Gets shard of calling thread, registering it on first use.
+     * @return shard of calling thread
+     */
+    static inline _Shard& _localShard() {
+        thread_local _Shard* shard { _registerShard() };
+        return *shard;
+    }
+
+public:
+    /**
+     * @brief Increments counter in calling thread's shard.
+     * @param counter counter to increment
+     * @param n amount to add
+     */
+    static inline void add( const Counter counter, const uint64_t n = 1 ) {
+        std::atomic< uint64_t >& value { _localShard().values[ counter ] };
+        // single writer per shard, so no read-modify-write needed; atomic only
+        //   so that snapshots read whole values
+        value.store( value.load( std::memory_order_relaxed ) + n,
+                     std::memory_order_relaxed );
+    }
+    /**
+     * @brief Sums counters over all shards.
+     * @return counter values
+     */
+    static SnapshotT snapshot();
+};
+
+
+#endif  // METRICS_HPP
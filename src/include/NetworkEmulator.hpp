@@ -0,0 +1,128 @@
+#ifndef NETWORKEMULATOR_HPP
+#define NETWORKEMULATOR_HPP
+
+/**
+ * @file NetworkEmulator.hpp
+ */
+
+#include <optional>
+#include <random>       // minstd_rand
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cstdint>
+
+#include "optionTerms.hpp"
+
+
+/**
+ * @brief Compiles `--netem` expressions into per-[Connection](#Connection),
+ *   per-direction emulated links, which decide when parsed messages may be
+ *   forwarded to emulate a remote display.
+ *
+ *   Each expression is a rule of comma-separated `key=value` terms:
+ *   - `conn=N[-M]` connection id (range) to which rule applies
+ *   - `dir=s<c|c2s|s>c|s2c` direction to which rule applies
+ *   - `delay=N` one-way latency in milliseconds
+ *   - `jitter=N` latency varies uniformly by up to +/-N milliseconds
+ *   - `bw=N` bandwidth cap in kbit/s
+ *
+ *   Each direction of a connection is governed by the first rule that applies
+ *   to it. Messages are never reordered, so jitter only delays messages
+ *   after a previous one with more added latency.
+ */
+class NetworkEmulator {
+private:
+    /**
+     * @brief Single parsed `--netem` expression.
+     */
+    struct _Rule {
+        /** @brief Connection ids to which rule applies. */
+        option_terms::Range      conns;
+        /** @brief Directions to which rule applies. */
+        option_terms::Directions dirs;
+        /** @brief Added latency in nanoseconds. */
+        uint64_t                 delay_ns {};
+        /** @brief Largest variation of added latency in nanoseconds. */
+        uint64_t                 jitter_ns {};
+        /** @brief Bandwidth in bytes per second, or 0 for unlimited. */
+        uint64_t                 bytes_per_sec {};
+    };
+    /**
+     * @brief All rules parsed from `--netem` expressions.
+     */
+    std::vector< _Rule > _rules;
+
+public:
+    /**
+     * @brief Parses a single `--netem` expression into a rule.
+     * @param expr network emulation expression
+     * @return error message, or `std::nullopt` on success
+     */
+    std::optional< std::string >
+    addRule( const std::string_view expr );
+    /**
+     * @brief Removes all rules.
+     */
+    inline void clear() {
+        _rules.clear();
+    }
+    /**
+     * @brief Indicates whether any rules have been added.
+     * @return whether any rules have been added
+     */
+    inline bool empty() const {
+        return _rules.empty();
+    }
+
+    /**
+     * @brief Rule of #NetworkEmulator with state for a single direction of a
+     *   single [Connection](#Connection).
+     */
+    class Link {
+    private:
+        friend class NetworkEmulator;
+        /** @brief Added latency in nanoseconds. */
+        uint64_t _delay_ns {};
+        /** @brief Largest variation of added latency in nanoseconds. */
+        uint64_t _jitter_ns {};
+        /** @brief Bandwidth in bytes per second, or 0 for unlimited. */
+        uint64_t _bytes_per_sec {};
+        /** @brief Monotonic time at which link finishes sending bytes
+         *    already submitted. */
+        uint64_t _free_ns {};
+        /** @brief Last release time returned, so none is earlier. */
+        uint64_t _last_release_ns {};
+        /** @brief Source of jitter, seeded per link for repeatable runs. */
+        std::minstd_rand _rng;
+
+    public:
+        /**
+         * @brief Indicates whether link adds any latency or bandwidth cap.
+         * @return whether link adds any latency or bandwidth cap
+         */
+        inline bool enabled() const {
+            return _delay_ns != 0 || _jitter_ns != 0 || _bytes_per_sec != 0;
+        }
+        /**
+         * @brief Submits bytes to link, returning time of their arrival at
+         *   far end.
+         * @param now_ns current monotonic time
+         * @param bytes count of bytes submitted
+         * @return monotonic time after which bytes may be forwarded, not
+         *   earlier than that of bytes submitted before
+         */
+        uint64_t releaseTime( const uint64_t now_ns, const size_t bytes );
+    };
+    /**
+     * @brief Creates link state for one direction of a given connection.
+     * @param conn_id [Connection](#Connection) unique serial number
+     * @param client_to_server whether link carries client to server messages
+     * @return link to be given every parsed message in that direction
+     */
+    Link compile( const uint32_t conn_id, const bool client_to_server ) const;
+};
+
+
+#endif  // NETWORKEMULATOR_HPP
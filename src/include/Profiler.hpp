@@ -0,0 +1,183 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+/**
+ * @file Profiler.hpp
+ */
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <cstdint>
+#include <cstdio>       // FILE
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>  // __rdtsc
+#endif
+
+#include "monotonic.hpp"
+
+
+/**
+ * @brief Built-in instrumentation of time spent by the main loop in each
+ *   stage of proxying, by message type, enabled with `--profile`.
+ *
+ *   [Scope](#Scope) timers nest into a call tree, whose nodes are named by
+ *   stage (eg "read", "parse") or message type (eg "GetProperty".) Times are
+ *   read from the CPU timestamp counter where available, and converted to
+ *   nanoseconds by calibrating against the monotonic clock when reporting.
+ * @note Only the thread that called #enable (the main loop thread) records
+ *   scopes; on other threads, eg `--atomcache` revalidation, scopes are
+ *   inactive, so that the unsynchronized call tree is never shared.
+ */
+class Profiler {
+private:
+    /**
+     * @brief Node of call tree, for a single stack of scope names.
+     */
+    struct _Node {
+        /** @brief Scope name, must have static storage duration. */
+        std::string_view name;
+        /** @brief Index of parent node. */
+        uint32_t         parent {};
+        /** @brief Times scope was entered. */
+        uint64_t         calls {};
+        /** @brief Ticks spent in scope, including nested scopes. */
+        uint64_t         ticks {};
+        /** @brief Ticks spent in nested scopes. */
+        uint64_t         child_ticks {};
+        /** @brief Indices of child nodes, by name. */
+        std::unordered_map< std::string_view, uint32_t > children;
+    };
+    /**
+     * @brief Whether profiling is enabled on this thread.
+     */
+    inline static thread_local bool _enabled {};
+    /**
+     * @brief Call tree, root at index 0.
+     */
+    inline static std::vector< _Node > _nodes;
+    /**
+     * @brief Index of node of innermost active scope.
+     */
+    inline static uint32_t _current {};
+    /**
+     * @brief Ticks and monotonic time when profiling was enabled, for
+     *   calibration.
+     */
+    inline static uint64_t _start_ticks {};
+    /** @copydoc _start_ticks */
+    inline static uint64_t _start_ns {};
+
+    /**
+     * @brief Reads timestamp counter.
+     * @return ticks
+     */
+    static inline uint64_t _ticks() {
+#if defined( __x86_64__ ) || defined( __i386__ )
+        return __rdtsc();
+#else
+        return monotonic::now();
+#endif
+    }
+    /**
+     * @brief Enters child of current node, creating it if needed.
+     * @param name scope name
+     * @return index of child node
+     */
+    static uint32_t _enter( const std::string_view name );
+    /**
+     * @brief Exits node, adding time spent to it and its parent.
+     * @param node index of node
+     * @param ticks ticks spent in node
+     */
+    static void _exit( const uint32_t node, const uint64_t ticks );
+    /**
+     * @brief Estimates nanoseconds per tick since profiling was enabled.
+     * @return nanoseconds per tick
+     */
+    static double _nsPerTick();
+    /**
+     * @brief Formats stack of scope names from root to node.
+     * @param node index of node
+     * @param separator string between names
+     * @return stack of names
+     */
+    static std::string _stack( uint32_t node, const std::string_view separator );
+
+public:
+    /**
+     * @brief Times block from construction to destruction as a nested scope of
+     *   any enclosing [Scope](#Scope).
+     */
+    class Scope {
+    private:
+        /** @brief Index of node of scope. */
+        uint32_t _node {};
+        /** @brief Ticks at scope entry. */
+        uint64_t _start {};
+        /** @brief Whether profiling was enabled at scope entry. */
+        bool     _active {};
+
+    public:
+        Scope() = delete;
+        Scope( const Scope& ) = delete;
+        Scope& operator=( const Scope& ) = delete;
+        /**
+         * @brief Enters scope.
+         * @param name scope name, must have static storage duration
+         */
+        explicit inline Scope( const std::string_view name ) :
+            _active( _enabled ) {
+            if ( !_active )
+                return;
+            _node = _enter( name );
+            _start = _ticks();
+        }
+        /**
+         * @brief Exits scope.
+         */
+        inline ~Scope() {
+            if ( _active )
+                _exit( _node, _ticks() - _start );
+        }
+    };
+
+    /**
+     * @brief Times function call as a [Scope](#Scope).
+     * @tparam FuncT callable taking no parameters
+     * @param name scope name, must have static storage duration
+     * @param func function to call
+     * @return return value of `func`
+     */
+    template< typename FuncT >
+    static inline auto timed( const std::string_view name, FuncT&& func ) {
+        Scope scope { name };
+        return func();
+    }
+    /**
+     * @brief Enables profiling on calling thread.
+     * @param root_name name of root of call tree
+     */
+    static void enable( const std::string_view root_name );
+    /**
+     * @brief Prints table of scopes, by descending time spent exclusive of
+     *   nested scopes.
+     * @param log_fs log file stream
+     */
+    static void report( ::FILE* log_fs );
+    /**
+     * @brief Writes folded stacks file for flame graph tools (eg
+     *   `flamegraph.pl`), one line per scope stack with its exclusive time in
+     *   nanoseconds.
+     * @param path file path
+     * @return error message, or `std::nullopt` on success
+     */
+    static std::optional< std::string > writeFolded( const char* path );
+};
+
+
+#endif  // PROFILER_HPP
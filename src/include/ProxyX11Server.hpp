@@ -5,6 +5,7 @@
  * @file ProxyX11Server.hpp
  */
 
+#include <future>
 #include <map>
 #include <optional>
 #include <string>
@@ -15,11 +16,18 @@
 #include <cstdint>
 
 #include <poll.h>                 // pollfd
+#include <signal.h>               // sigset_t
 #include <sys/types.h>            // pid_t
 
+#include "AtomCache.hpp"
+#include "AtomResolver.hpp"
 #include "Connection.hpp"
 #include "DisplayInfo.hpp"
+#include "LogWriterPool.hpp"
 #include "Settings.hpp"
+#include "TimerWheel.hpp"
+#include "TrafficRecording.hpp"
+#include "Tunnel.hpp"
 #include "X11ProtocolParser.hpp"
 
 
@@ -94,6 +102,18 @@ private:
      * @ingroup parsing_display_names
      */
     void _parseDisplayNames();
+    /**
+     * @brief Populates [_out_display](#_out_display), unless using
+     *   `--tunnelconnect`.
+     * @ingroup parsing_display_names
+     */
+    void _parseOutDisplayName();
+    /**
+     * @brief Populates [_in_display](#_in_display), unless using
+     *   `--tunnellisten`.
+     * @ingroup parsing_display_names
+     */
+    void _parseInDisplayName();
     /**
      * @brief Name of only supported [X authentication protocol].
      * [X authentication protocol]: https://www.x.org/releases/current/doc/man/man7/Xsecurity.7.xhtml
@@ -138,12 +158,15 @@ private:
      *   [WINDOW](#protocol::WINDOW) pointed to set to `root` field of
      *   first [SCREEN](#protocol::connection_setup::Acceptance::SCREEN) in
      *   LISTofSCREEN `roots` at end of server's [acceptance] of initial handshake
+     * @param[out] server_key if not default `nullptr`, set to identify server
+     *   from its [acceptance], less `start_time`
      * @return `true` if successful, `false` if not
      * [acceptance]: https://www.x.org/releases/X11R7.7/doc/xproto/x11protocol.html#Encoding::Connection_Setup
      * @ingroup pre_queue_setup_clients
      */
     bool _authenticateServerConnection(
-        const int server_fd, protocol::WINDOW* screen0_root = nullptr );
+        const int server_fd, protocol::WINDOW* screen0_root = nullptr,
+        AtomCache::ServerKey* server_key = nullptr );
     /**
      * @brief Optional setup client run before main queue begins; sets
      *   [ref_TIMESTAMP](#Settings::ref_TIMESTAMP) and
@@ -156,19 +179,91 @@ private:
      * @brief Optional setup client run before main queue begins; duplicates
      *   real X server's string interments for contiguous range of
      *   [ATOM](#protocol::ATOM)s 1 to n to support `--prefetchatoms` user option.
+     *   Up to [_ATOM_PREFETCH_WINDOW](#_ATOM_PREFETCH_WINDOW) `GetAtomName`
+     *   requests are kept in flight, with replies matched by sequence number,
+     *   so that fetching is bound by bandwidth rather than round trip time.
+     * @param background if `true`, run on a thread alongside main queue:
+     *   progress is not shown, and failure returns no atoms rather than
+     *   exiting
      * @return vector of interned atom strings, indexed by
      *   [ATOM](#protocol::ATOM) value
      * @note Uses [ANSI escape] sequences.
      * [ANSI escape]: https://gist.github.com/ConnerWill/d4b6c776b509add763e17f9f113fd25b
      * @ingroup pre_queue_setup_clients
      */
-    std::vector< std::string > _fetchInternedAtoms();
+    std::vector< std::string > _fetchInternedAtoms( const bool background = false );
+    /**
+     * @brief Maximum `GetAtomName` requests sent ahead of their replies by
+     *   [_fetchInternedAtoms](#_fetchInternedAtoms); at 8B per request, a
+     *   full window fits in a socket send buffer, so writes never wait on
+     *   replies being read.
+     * @ingroup pre_queue_setup_clients
+     */
+    static constexpr uint32_t _ATOM_PREFETCH_WINDOW { 512 };
+    /**
+     * @brief Supports `--prefetchatoms`: imports atoms from `--atomcache`
+     *   file if it matches X server, and starts their
+     *   [revalidation](#_atom_revalidation), otherwise fetches atoms with
+     *   [_fetchInternedAtoms](#_fetchInternedAtoms) (and writes cache.)
+     * @ingroup pre_queue_setup_clients
+     */
+    void _prefetchAtoms();
+    /**
+     * @brief Optional setup client run before main queue begins; identifies
+     *   X server to select `--atomcache` file contents.
+     * @return server identity
+     * @ingroup pre_queue_setup_clients
+     */
+    AtomCache::ServerKey _fetchServerKey();
+    /**
+     * @brief Atoms fetched in background after importing `--atomcache`
+     *   file, which are then written back to cache file.
+     * @ingroup pre_queue_setup_clients
+     */
+    std::future< std::vector< std::string > > _atom_revalidation;
+    /**
+     * @brief Imports atoms from [_atom_revalidation](#_atom_revalidation) once
+     *   fetched, checked once per main queue iteration.
+     * @ingroup pre_queue_setup_clients
+     */
+    void _importRevalidatedAtoms();
+    /**
+     * @brief Side connection looking up ATOM names for `--resolveatoms`.
+     * @ingroup pre_queue_setup_clients
+     */
+    AtomResolver _atom_resolver;
+    /**
+     * @brief Supports `--resolveatoms`: opens
+     *   [_atom_resolver](#_atom_resolver) connection before main queue
+     *   begins, to be polled alongside client connections.
+     * @ingroup pre_queue_setup_clients
+     */
+    void _openAtomResolver();
+    /**
+     * @brief Queues lookup of ATOMs logged without known names since last
+     *   call, or fails them if [_atom_resolver](#_atom_resolver) is closed.
+     * @ingroup pre_queue_setup_clients
+     */
+    void _requestUnresolvedAtoms();
+    /**
+     * @brief Reads ATOM names answered and sends queued lookups on
+     *   [_atom_resolver](#_atom_resolver) connection as polled, closing it
+     *   on any error (after which ATOMs are no longer resolved.)
+     * @ingroup pre_queue_setup_clients
+     */
+    void _processAtomResolver();
     /**
      * @brief Whether CLI subcommand was provided and launched as
      *   child process.
      * @ingroup cli_subcommand
      */
     bool  _child_used { false };
+    /**
+     * @brief Signal mask of main thread while waiting in `ppoll(2)`, and of
+     *   child process: mask at startup without `SIGUSR1`, which is otherwise
+     *   blocked so that only the wait is interrupted by it.
+     */
+    ::sigset_t _poll_sigmask {};
     /**
      * @brief Sentinel value indicating uninitialized process id.
      * @ingroup cli_subcommand
@@ -226,6 +321,12 @@ private:
      * @ingroup socket_polling
      */
     void _addSocketToPoll( const int fd, const short events = _POLLNONE );
+    /**
+     * @brief Rebuilds [_pfds](#_pfds) after file descriptors were erased from
+     *   [_pfds_i_by_fd](#_pfds_i_by_fd), preserving polling results.
+     * @ingroup socket_polling
+     */
+    void _compactPoll();
     /**
      * @brief First stage of client queue loop; updates which events to poll
      *   for based on [Connection](#Connection) socket buffer status.
@@ -259,6 +360,17 @@ private:
      * @ingroup socket_polling
      */
     void _processPolledSockets();
+    /**
+     * @brief Appends bytes just read into buffer to connection's `--record`
+     *   file; on failure, stops recording that connection.
+     * @param conn connection with open [record_fs](#Connection::record_fs)
+     * @param direction direction bytes were read
+     * @param buffer buffer read into
+     * @param bytes_read count of bytes just read
+     */
+    void _recordTraffic( Connection* conn,
+                         const TrafficRecording::Direction direction,
+                         SocketBuffer& buffer, const size_t bytes_read );
     /**
      * @brief Constant to set `backlog` param for `listen(2)`.
      * @ingroup main_client_queue
@@ -275,16 +387,147 @@ private:
      * @ingroup main_client_queue
      */
     int _listener_fd  { _UNINIT_FD };
+    /**
+     * @brief File descriptor of Unix socket used to `listen(2)` for and
+     *   `accept(2)` metrics scrapers when using `--metrics`.
+     * @ingroup main_client_queue
+     */
+    int _metrics_fd   { _UNINIT_FD };
+    /**
+     * @brief File descriptor of Unix socket used to `listen(2)` for and
+     *   `accept(2)` control clients when using `--control`.
+     * @ingroup runtime_control
+     */
+    int _control_fd   { _UNINIT_FD };
+    /**
+     * @brief Unprocessed input of connected control clients, indexed by
+     *   file descriptor.
+     * @ingroup runtime_control
+     */
+    std::unordered_map< int, std::string > _control_clients;
+    /**
+     * @brief Log file stream replaced by `capture` control command, if
+     *   capture is in progress.
+     * @ingroup runtime_control
+     */
+    ::FILE* _precapture_log_fs {};
+    /**
+     * @brief Maximum unprocessed input buffered per control client.
+     * @ingroup runtime_control
+     */
+    static constexpr size_t _MAX_CONTROL_LINE_SZ { 4096 };
     /**
      * @brief Active connections indexed by ID number.
      * @ingroup main_client_queue
      */
     std::unordered_map< int, Connection > _connections;
     /**
-     * @brief Set up server by creating valid `listen(2)`ing socket.
+     * @brief Count of threads writing per-connection log files when using
+     *   `--outdir`.
+     * @ingroup main_client_queue
+     */
+    static constexpr size_t _LOG_WRITER_THREAD_CT { 4 };
+    /**
+     * @brief Writes per-connection log files when using `--outdir`.
+     * @ingroup main_client_queue
+     */
+    std::optional< LogWriterPool > _log_writers;
+    /**
+     * @brief Link to peer xtracepp when using `--tunnelconnect` or
+     *   `--tunnellisten`.
+     * @ingroup main_client_queue
+     */
+    Tunnel _tunnel;
+    /**
+     * @brief Connects to, or listens for, tunnel peer and starts
+     *   [_tunnel](#_tunnel), if using `--tunnelconnect` or `--tunnellisten`.
+     * @ingroup main_client_queue
+     */
+    void _openTunnel();
+    /**
+     * @brief Release times of messages held by `--netem`, tagged with
+     *   connection id.
+     * @ingroup main_client_queue
+     */
+    TimerWheel _netem_timers;
+    /**
+     * @brief Holds messages newly parsed in either buffer of a connection
+     *   until their release time on its emulated link, if using `--netem`.
+     * @param conn connection just parsed
+     * @ingroup main_client_queue
+     */
+    void _holdParsed( Connection* conn );
+    /**
+     * @brief Releases held messages of connections whose release times have
+     *   passed, for writing on next poll.
+     * @ingroup main_client_queue
+     */
+    void _releaseHeld();
+    /**
+     * @brief Set up server by creating valid `listen(2)`ing socket, or with
+     *   `--tunnellisten`, by polling [_tunnel](#_tunnel) for channels.
      * @ingroup main_client_queue
      */
     void _listenForClients();
+    /**
+     * @brief Creates `listen(2)`ing Unix socket for metrics scrapers, if using
+     *   `--metrics`.
+     * @ingroup main_client_queue
+     */
+    void _listenForMetrics();
+    /**
+     * @brief Creates `listen(2)`ing Unix socket, accessible only by owner.
+     *   Stale socket at path is replaced, but any other file is an error.
+     * @param path socket file path
+     * @return file descriptor of socket
+     * @ingroup main_client_queue
+     */
+    int  _listenOnUnixSocket( const char* path );
+    /**
+     * @brief Creates `listen(2)`ing Unix socket for control clients, if using
+     *   `--control`.
+     * @ingroup runtime_control
+     */
+    void _listenForControl();
+    /**
+     * @brief Handles polled events of control socket and clients: accepts new
+     *   clients, and runs each complete command line received.
+     * @ingroup runtime_control
+     */
+    void _processControlSockets();
+    /**
+     * @brief Runs single control command, between processing of messages.
+     * @param line command line, without newline
+     * @return response text, ending with "ok" or "error: " line
+     * @ingroup runtime_control
+     */
+    std::string _runControlCommand( const std::string_view line );
+    /**
+     * @brief Redirects main log and all connection logs to file.
+     * @param path file path relative to `--outdir` (not absolute, without
+     *   `..`, and not named as a connection log), or empty to end capture and
+     *   restore previous logs
+     * @return error message, or `std::nullopt` on success
+     * @ingroup runtime_control
+     */
+    std::optional< std::string > _capture( const std::string_view path );
+    /**
+     * @brief Formats snapshot of metrics in Prometheus text exposition format.
+     * @return metrics text
+     * @ingroup main_client_queue
+     */
+    std::string _formatMetrics();
+    /**
+     * @brief `accept(2)`s metrics scraper and sends it a snapshot, without
+     *   blocking the client queue.
+     * @ingroup main_client_queue
+     */
+    void _serveMetrics();
+    /**
+     * @brief Prints `--profile` table to log and writes folded stacks file.
+     * @ingroup main_client_queue
+     */
+    void _logProfile();
     /**
      * @brief `accept(2)` client on `listen(2)`ing socket.
      * @param[out] conn connection in which to populate `client_fd` and
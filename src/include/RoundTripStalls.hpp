@@ -0,0 +1,138 @@
+#ifndef ROUNDTRIPSTALLS_HPP
+#define ROUNDTRIPSTALLS_HPP
+
+/**
+ * @file RoundTripStalls.hpp
+ */
+
+#include <array>
+#include <map>
+#include <utility>      // pair
+#include <vector>
+
+#include <cstddef>      // size_t
+#include <cstdint>
+
+
+/**
+ * @brief Detects blocking round trips on a single [Connection](#Connection):
+ *   requests after which the client sent nothing more until their reply was
+ *   received, as when Xlib waits in `XInternAtom` or `XGetWindowProperty`.
+ *
+ *   Stalls are aggregated by call site, approximated by the opcodes of the
+ *   #CONTEXT_DEPTH requests preceding the stalling request, so that repeated
+ *   patterns (eg a series of `InternAtom` each waiting on its reply) can be
+ *   found and batched.
+ */
+class RoundTripStalls {
+public:
+    /**
+     * @brief Preceding requests used to identify call site of a stall.
+     */
+    static constexpr size_t CONTEXT_DEPTH { 2 };
+    /**
+     * @brief Request opcodes packed as `major << 8 | minor`; 0 for none, as 0
+     *   is not a valid major opcode.
+     */
+    using OpcodesT = uint16_t;
+    /**
+     * @brief Call site: opcodes of preceding requests, oldest first, followed
+     *   by opcodes of stalling request.
+     */
+    using SiteT = std::array< OpcodesT, CONTEXT_DEPTH + 1 >;
+    /**
+     * @brief Statistics for a single call site.
+     */
+    struct SiteStats {
+        /** @brief Blocking round trips. */
+        uint64_t count {};
+        /** @brief Time from request receipt to reply receipt, summed. */
+        uint64_t blocked_ns {};
+        /** @brief Time from reply receipt to next request receipt, summed. */
+        uint64_t resume_ns {};
+        /** @brief Round trips followed by another request. */
+        uint64_t resume_ct {};
+        /** @brief Sequence number of first stalling request. */
+        uint16_t first_sequence {};
+    };
+
+private:
+    /**
+     * @brief Opcodes of most recent requests, oldest first.
+     */
+    SiteT      _recent {};
+    /**
+     * @brief Sequence number of most recent request.
+     */
+    uint16_t   _last_sequence {};
+    /**
+     * @brief Monotonic time most recent request was received.
+     */
+    uint64_t   _last_sent_ns {};
+    /**
+     * @brief Whether most recent request may still receive a reply.
+     */
+    bool       _awaiting_reply {};
+    /**
+     * @brief Site of last stall, if client has not yet sent another request.
+     */
+    SiteStats* _resuming_site {};
+    /**
+     * @brief Monotonic time reply ending last stall was received.
+     */
+    uint64_t   _resuming_since_ns {};
+    /**
+     * @brief Statistics by call site.
+     */
+    std::map< SiteT, SiteStats > _sites;
+    /**
+     * @brief Blocking round trips on connection.
+     */
+    uint64_t   _stall_ct {};
+    /**
+     * @brief Total time client was blocked on round trips.
+     */
+    uint64_t   _blocked_ns {};
+
+public:
+    /**
+     * @brief Notes request received from client.
+     * @param major_opcode request major opcode
+     * @param minor_opcode request minor opcode, or 0 for core requests
+     * @param sequence request sequence number
+     * @param recv_ns monotonic time request was received
+     */
+    void request( const uint8_t major_opcode, const uint8_t minor_opcode,
+                  const uint16_t sequence, const uint64_t recv_ns );
+    /**
+     * @brief Notes (final) reply received from server; counts stall if no
+     *   request was sent after the one replied to.
+     * @param sequence reply sequence number
+     * @param recv_ns monotonic time reply was received
+     */
+    void reply( const uint16_t sequence, const uint64_t recv_ns );
+    /**
+     * @brief Returns blocking round trips on connection.
+     * @return blocking round trips on connection
+     */
+    inline uint64_t count() const {
+        return _stall_ct;
+    }
+    /**
+     * @brief Returns total time client was blocked on round trips.
+     * @return total blocked time in nanoseconds
+     */
+    inline uint64_t blockedTime() const {
+        return _blocked_ns;
+    }
+    /**
+     * @brief Ranks call sites by total blocked time.
+     * @param max_ct maximum call sites returned
+     * @return call sites and their statistics, most blocked time first
+     */
+    std::vector< std::pair< SiteT, SiteStats > >
+    topSites( const size_t max_ct ) const;
+};
+
+
+#endif  // ROUNDTRIPSTALLS_HPP
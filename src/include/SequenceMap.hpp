@@ -0,0 +1,136 @@
+#ifndef SEQUENCEMAP_HPP
+#define SEQUENCEMAP_HPP
+
+/**
+ * @file SequenceMap.hpp
+ */
+
+#include <deque>
+#include <optional>
+#include <vector>
+
+#include <cstdint>
+
+
+/**
+ * @brief Maps sequence numbers between client and server sides of a
+ *   [Connection](#Connection) when using `--replycache`, where the proxy
+ *   answers some requests itself without forwarding them.
+ *
+ *   Each locally answered request advances the client-visible sequence
+ *   without the server-visible one, and each hidden sync request (see
+ *   #syncNeeded) the reverse, so every reply, error and event from the server
+ *   is rewritten by the offset in effect for its request. Local replies are
+ *   held until all server messages for earlier requests have been delivered,
+ *   so the client sees sequence numbers in order as if all requests had been
+ *   forwarded.
+ */
+class SequenceMap {
+private:
+    /**
+     * @brief Client minus server sequence number, for server requests from
+     *   #server_seq onward.
+     */
+    struct _Offset {
+        /** @brief Widened server sequence number of first request. */
+        uint64_t server_seq {};
+        /** @brief Client minus server sequence number. */
+        uint16_t offset {};
+    };
+    /**
+     * @brief Reply to locally answered request, awaiting delivery.
+     */
+    struct _LocalReply {
+        /** @brief Widened server sequence number of last request forwarded
+         *    before it. */
+        uint64_t after {};
+        /** @brief Client sequence number of request. */
+        uint16_t client_seq {};
+        /** @brief Reply encoding, with sequence number already set. */
+        std::vector< uint8_t > reply;
+    };
+    /**
+     * @brief Widened server sequence number of last request forwarded.
+     */
+    uint64_t _forwarded {};
+    /**
+     * @brief Widened server sequence number of latest server message.
+     */
+    uint64_t _seen {};
+    /**
+     * @brief Offset for next request forwarded.
+     */
+    uint16_t _offset {};
+    /**
+     * @brief Client sequence number of last message delivered to client,
+     *   which later messages may not precede.
+     */
+    uint16_t _last_client_seq {};
+    /**
+     * @brief Offsets in order of server sequence; front applies to #_seen.
+     */
+    std::deque< _Offset > _offsets { _Offset{} };
+    /**
+     * @brief Widened server sequence numbers of forwarded requests with reply
+     *   not yet received.
+     */
+    std::deque< uint64_t > _replies_due;
+    /**
+     * @brief Widened server sequence numbers of hidden sync requests.
+     */
+    std::deque< uint64_t > _syncs;
+    /**
+     * @brief Replies to locally answered requests, in request order.
+     */
+    std::deque< _LocalReply > _local_replies;
+
+public:
+    /**
+     * @brief Notes request forwarded to server.
+     * @param reply_expected whether request has a reply
+     */
+    void forward( const bool reply_expected );
+    /**
+     * @brief Notes request answered by proxy, queueing its reply.
+     * @param client_seq client sequence number of request
+     * @param reply reply encoding, with sequence number already set
+     */
+    void answerLocally( const uint16_t client_seq,
+                        std::vector< uint8_t >&& reply );
+    /**
+     * @brief Whether latest local reply must wait for requests forwarded
+     *   before it, but no server message is certain to follow them, as they
+     *   have no replies.
+     * @return whether a sync request should be forwarded with #forwardSync
+     */
+    bool syncNeeded() const;
+    /**
+     * @brief Notes request forwarded to server without a client request,
+     *   whose reply marks all earlier requests processed; latest local reply
+     *   waits on it.
+     */
+    void forwardSync();
+    /**
+     * @brief Maps server sequence number of message to client.
+     * @param server_seq sequence number of message from server
+     * @return client sequence number
+     */
+    uint16_t toClient( const uint16_t server_seq );
+    /**
+     * @brief After #toClient, consumes reply if it answers a sync request.
+     * @return whether reply is to sync request, to be withheld from client
+     */
+    bool takeSyncReply();
+    /**
+     * @brief After #toClient, notes final reply or error to forwarded request.
+     */
+    void answered();
+    /**
+     * @brief Takes next local reply, if now deliverable.
+     * @return reply encoding, or `std::nullopt` if none deliverable
+     */
+    std::optional< std::vector< uint8_t > > takeLocalReply();
+};
+
+
+#endif  // SEQUENCEMAP_HPP
@@ -15,6 +15,11 @@
 
 #include <fmt/format.h>
 
+#include "LogRateLimiter.hpp"
+#include "MessageFilter.hpp"
+#include "NetworkEmulator.hpp"
+#include "ShmRing.hpp"
+
 #include "protocol/extensions/big_requests.hpp"
 
 
@@ -154,10 +159,97 @@ public:
      *   "unknown ATOM" in logs.
      */
     bool prefetchatoms    { false };
+    /**
+     * @brief Path of file caching atoms fetched with
+     *   [prefetchatoms](#prefetchatoms), see [AtomCache](#AtomCache).
+     */
+    const char* atom_cache_path { nullptr };
+    /**
+     * @brief Toggles looking up names of ATOMs seen in traffic that are not
+     *   yet known, over a side connection to real X server, see
+     *   [AtomResolver](#AtomResolver); log lines awaiting names are held
+     *   briefly.
+     */
+    bool resolveatoms     { false };
     /**
      * @brief Disables buffering on [log_fs](#log_fs).
      */
     bool unbuffered       { false };
+    /**
+     * @brief Toggles gzip compression of [log_fs](#log_fs) when logging to
+     *   file, see [GzipLogStream](#GzipLogStream).
+     */
+    bool compress         { false };
+    /**
+     * @brief Toggles log prefix field with wall clock time of message receipt.
+     */
+    bool timestamp_absolute { false };
+    /**
+     * @brief Toggles log prefix field with time of message receipt relative to
+     *   connection start.
+     */
+    bool timestamp_relative { false };
+    /**
+     * @brief Toggles log prefix field with time message waited in proxy from
+     *   receipt until it was parsed and logged (not until it was forwarded).
+     */
+    bool timestamp_parse    { false };
+    /**
+     * @brief Toggles line logged as each logged message is forwarded, with
+     *   time of forwarding relative to connection start.
+     */
+    bool timestamp_forward  { false };
+    /**
+     * @brief Toggles line logged as each logged message is forwarded, with
+     *   time message spent in proxy from receipt until forwarded.
+     */
+    bool timestamp_inproxy  { false };
+    /**
+     * @brief Toggles recording of request to reply latency histograms, printed
+     *   on exit or `SIGUSR1`.
+     */
+    bool latency            { false };
+    /**
+     * @brief Toggles detection of blocking round trips, reported per
+     *   connection on close.
+     */
+    bool stalls             { false };
+    /**
+     * @brief Toggles counting messages by type instead of logging them,
+     *   reported per connection on close and in total on exit.
+     */
+    bool stats              { false };
+    /**
+     * @brief Toggles answering requests with immutable replies (eg InternAtom)
+     *   from replies cached across connections, without forwarding them, see
+     *   [SequenceMap](#SequenceMap).
+     */
+    bool replycache         { false };
+    /**
+     * @brief Toggles dropping `MotionNotify` events still queued for client
+     *   when superseded by the next event, for the same window.
+     */
+    bool motioncompress     { false };
+    /**
+     * @brief Whether messages of newly opened connections are logged; only
+     *   changed at runtime by `--control` commands.
+     */
+    bool logging            { true };
+    /**
+     * @brief Selects which messages are formatted and logged, compiled from
+     *   any `--filter` expressions.
+     */
+    MessageFilter filter;
+    /**
+     * @brief Rate limits and sampling of logged messages, compiled from any
+     *   `--ratelimit` expressions.
+     */
+    LogRateLimiter ratelimiter;
+    /**
+     * @brief Emulated latency, jitter and bandwidth per connection and
+     *   direction, compiled from any `--netem` expressions.
+     */
+    NetworkEmulator netem;
     /**
      * @brief Full path to log file, if not using `::stdout` or `::stderr`.
      */
@@ -166,6 +258,53 @@ public:
      * @brief Log file stream.
      */
     ::FILE* log_fs { ::stdout };
+    /**
+     * @brief Directory in which to write one log file per connection, instead
+     *   of logging connection messages to [log_fs](#log_fs).
+     */
+    const char* log_dir { nullptr };
+    /**
+     * @brief Directory in which to write one raw traffic recording per
+     *   connection, see [TrafficRecording](#TrafficRecording).
+     */
+    const char* record_dir { nullptr };
+    /**
+     * @brief Path of Unix socket on which to serve metrics snapshots.
+     */
+    const char* metrics_path { nullptr };
+    /**
+     * @brief Path of Unix socket on which to accept runtime control commands.
+     */
+    const char* control_path { nullptr };
+    /**
+     * @brief Path of folded stacks file written by `--profile`, see
+     *   [Profiler](#Profiler).
+     */
+    const char* profile_path { nullptr };
+    /**
+     * @brief `<host>:<port>` of peer xtracepp to carry all connections to,
+     *   see [Tunnel](#Tunnel).
+     */
+    const char* tunnel_connect { nullptr };
+    /**
+     * @brief `[<host>:]<port>` on which to accept tunnel from peer xtracepp,
+     *   see [Tunnel](#Tunnel).
+     */
+    const char* tunnel_listen { nullptr };
+    /**
+     * @brief Per-connection budget of images cached on tunnel, in bytes; 0
+     *   disables image caching, see [ImageCache](#ImageCache).
+     */
+    size_t image_cache_sz {};
+    /**
+     * @brief Name of POSIX shared memory object to which logged messages are
+     *   also published, see [ShmRing](#ShmRing).
+     */
+    std::string shm_ring_name;
+    /**
+     * @brief Size of `--shmring` data region in bytes.
+     */
+    size_t shm_ring_capacity { ShmRing::DEFAULT_CAPACITY };
     /**
      * @brief X display name string for real X server.
      * @see [DisplayInfo](#DisplayInfo)
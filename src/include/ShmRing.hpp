@@ -0,0 +1,169 @@
+#ifndef SHMRING_HPP
+#define SHMRING_HPP
+
+/**
+ * @file ShmRing.hpp
+ */
+
+#include <atomic>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <cstdint>
+
+
+/**
+ * @brief POSIX shared memory ring buffer to which logged messages are
+ *   published as fixed-header records, for live consumption by other
+ *   processes on the same host.
+ *
+ *   The shared memory object (eg `/dev/shm/NAME`) begins with a #Header,
+ *   followed by a data region of `Header::capacity` bytes (a power of 2.)
+ *   Records are 8-byte aligned, never span the end of the data region (a
+ *   #PADDING record fills the remainder instead), and consist of a
+ *   #RecordHeader followed by `text_sz` bytes of formatted message text.
+ *
+ *   The proxy is the single producer, and never waits for consumers; old
+ *   records are overwritten. Positions are byte counts since creation, so the
+ *   offset of a position in the data region is `pos & ( capacity - 1 )`.
+ *   Consumers should follow this seqlock-style protocol:
+ *   1. `write_pos` = `Header::write_pos` (acquire); if `write_pos` ==
+ *      `read_pos`, no new records
+ *   2. if `write_pos - read_pos > capacity`, records were lost; resume from
+ *      `read_pos = write_pos`
+ *   3. copy record at `read_pos`
+ *   4. acquire fence, then if `Header::reserve_pos - read_pos > capacity`,
+ *      copy may be torn by producer; discard it and resume from
+ *      `read_pos = write_pos`
+ *   5. `read_pos += RecordHeader::size`
+ */
+class ShmRing {
+public:
+    /**
+     * @brief Identifies shared memory object layout.
+     */
+    static constexpr uint64_t MAGIC   { 0x474e495250525458 };  // "XTRPRING"
+    /**
+     * @brief Version of shared memory object layout.
+     */
+    static constexpr uint32_t VERSION { 1 };
+    /**
+     * @brief Default data region size.
+     */
+    static constexpr size_t DEFAULT_CAPACITY { 16 * 1024 * 1024 };
+    /**
+     * @brief Shared memory object header, at offset 0.
+     */
+    struct Header {
+        /** @brief Always #MAGIC. */
+        uint64_t magic;
+        /** @brief Always #VERSION. */
+        uint32_t version;
+        /** @brief Size of this header, at which data region begins. */
+        uint32_t header_sz;
+        /** @brief Size of data region, a power of 2. */
+        uint64_t capacity;
+        /** @brief End of last completely written record. */
+        alignas( 64 ) std::atomic< uint64_t > write_pos;
+        /** @brief End of record currently being written. */
+        alignas( 64 ) std::atomic< uint64_t > reserve_pos;
+    };
+    static_assert( std::atomic< uint64_t >::is_always_lock_free );
+    /**
+     * @brief Record types.
+     */
+    enum RecordType : uint16_t {
+        PADDING, REQUEST, REPLY, EVENT, ERROR
+    };
+    /**
+     * @brief Record directions.
+     */
+    enum Direction : uint8_t {
+        CLIENT_TO_SERVER, SERVER_TO_CLIENT
+    };
+    /**
+     * @brief Fixed header at start of each record; #PADDING records only set
+     *   #size and #type.
+     */
+    struct RecordHeader {
+        /** @brief Total record size, including header and padding. */
+        uint32_t size;
+        /** @brief See #RecordType. */
+        uint16_t type;
+        /** @brief See #Direction. */
+        uint8_t  direction;
+        /** @brief Request major opcode, or event or error code. */
+        uint8_t  code;
+        /** @brief Request minor opcode, if any. */
+        uint8_t  minor_opcode;
+        /** @brief Unused. */
+        uint8_t  pad;
+        /** @brief Message sequence number. */
+        uint16_t sequence;
+        /** @brief [Connection](#Connection) id. */
+        uint32_t conn_id;
+        /** @brief Bytes of formatted message text following header. */
+        uint32_t text_sz;
+        /** @brief Time of message receipt, from `CLOCK_MONOTONIC`. */
+        uint64_t time_ns;
+    };
+
+    ShmRing() = default;
+    ShmRing( const ShmRing& ) = delete;
+    ShmRing& operator=( const ShmRing& ) = delete;
+    /**
+     * @brief Unmaps and unlinks shared memory object (consumers with it
+     *   already mapped may continue reading.)
+     */
+    ~ShmRing();
+    /**
+     * @brief Creates and maps shared memory object.
+     * @param name object name for `shm_open(3)`, eg "/xtracepp"
+     * @param capacity data region size, rounded up to a power of 2
+     * @return error message, or `std::nullopt` on success
+     */
+    std::optional< std::string >
+    open( const std::string_view name, const size_t capacity );
+    /**
+     * @brief Publishes record, overwriting oldest records as needed.
+     * @param type see #RecordType
+     * @param direction see #Direction
+     * @param code request major opcode, or event or error code
+     * @param minor_opcode request minor opcode, if any
+     * @param sequence message sequence number
+     * @param conn_id [Connection](#Connection) id
+     * @param recv_ns monotonic time of message receipt
+     * @param text formatted message text, truncated if record would exceed a
+     *   quarter of ring capacity
+     */
+    void publish( const RecordType type, const Direction direction,
+                  const uint8_t code, const uint8_t minor_opcode,
+                  const uint16_t sequence, const uint32_t conn_id,
+                  const uint64_t recv_ns, const std::string_view text );
+
+private:
+    /**
+     * @brief Name of shared memory object.
+     */
+    std::string _name;
+    /**
+     * @brief Mapped shared memory object.
+     */
+    Header*     _header {};
+    /**
+     * @brief Start of data region.
+     */
+    uint8_t*    _data {};
+    /**
+     * @brief Size of mapping.
+     */
+    size_t      _map_sz {};
+    /**
+     * @brief Producer position, mirrors `Header::write_pos`.
+     */
+    uint64_t    _pos {};
+};
+
+
+#endif  // SHMRING_HPP
@@ -5,6 +5,7 @@
  * @file SocketBuffer.hpp
  */
 
+#include <deque>
 #include <limits>       // numeric_limits
 #include <optional>
 #include <string>
@@ -27,6 +28,10 @@
  *   - measuring (#_next_message_sz (`nms`) is set with #setMessageSize)
  *   - parsing (#markMessageParsed adds #_next_message_sz to #_bytes_parsed (`bp`))
  *   - writing/unloading from buffer (advances #_bytes_written (`bw`)
+ *
+ *   With `--netem`, parsed bytes are also held (#holdParsed) until their
+ *   release time (#release) before they may be written, and reading continues
+ *   meanwhile so that held bytes are pipelined as on a real link.
  *   ```
  *          <------------size()-----------><--capacity()-->
  *          data()
@@ -43,6 +48,23 @@
  * [Another example]: https://stackoverflow.com/a/8116698
  */
 class SocketBuffer {
+public:
+    /**
+     * @brief Parsed message recorded for #takeWritten, to time its forwarding.
+     */
+    struct ParsedMessage {
+        /** @brief Sequence number of request, or of reply, event or error. */
+        uint16_t sequence {};
+        /** @brief Whether message was logged. */
+        bool     logged {};
+        /** @brief Count of bytes. */
+        size_t   sz {};
+        /** @brief Monotonic time of [read](#read) completing message. */
+        uint64_t read_ns {};
+        /** @brief Monotonic time of [write](#write) completing message. */
+        uint64_t write_ns {};
+    };
+
 private:
     /**
      * @brief Buffer allocation block size in bytes.
@@ -79,6 +101,103 @@ private:
      * @brief Size of next message to be parsed.
      */
     size_t _next_message_sz { _UNKNOWN_SZ };
+    /**
+     * @brief Size of last message marked parsed, or 0 if unknown (eg after
+     *   #insertParsed.)
+     */
+    size_t _last_parsed_sz {};
+    /**
+     * @brief Monotonic time of last [read](#read) or [load](#load).
+     */
+    uint64_t _read_ns         {};
+    /**
+     * @brief Bytes of one [read](#read) or [load](#load) (or #insertParsed)
+     *   not yet written/unloaded.
+     */
+    struct _Read {
+        /** @brief Offset in #_buffer after last byte. */
+        size_t   end {};
+        /** @brief Monotonic time bytes were read. */
+        uint64_t read_ns {};
+    };
+    /**
+     * @brief Reads not yet fully written/unloaded, oldest first.
+     */
+    std::deque< _Read > _reads;
+    /**
+     * @brief Shifts ends of reads after offset, as bytes are inserted or
+     *   removed there.
+     * @param offset offset in #_buffer of inserted or removed bytes
+     * @param sz n bytes inserted, or removed if `!inserted`
+     * @param inserted whether bytes were inserted
+     */
+    void _shiftReads( const size_t offset, const size_t sz,
+                      const bool inserted );
+    /**
+     * @brief Forgets reads and recorded messages fully written/unloaded.
+     */
+    void _popWritten();
+    /**
+     * @brief Ensures #capacity is at least `sz`, first moving unwritten bytes
+     *   to front of buffer if written bytes are at least half of it, else
+     *   growing buffer by whole blocks.
+     * @param sz n bytes needed after #_bytes_read
+     * @note Invalidates pointers into buffer.
+     */
+    void _reserve( const size_t sz );
+    /**
+     * @brief Monotonic time of last [write](#write).
+     */
+    uint64_t _write_ns        {};
+    /**
+     * @brief Parsed message recorded by #markMessageParsed, awaiting write.
+     */
+    struct _Mark {
+        /** @brief Offset in #_buffer after last byte. */
+        size_t          end {};
+        /** @brief Message, completed by #write. */
+        ParsedMessage   message;
+    };
+    /**
+     * @brief Recorded parsed messages not yet written, oldest first.
+     */
+    std::deque< _Mark > _marks;
+    /**
+     * @brief Recorded parsed messages written, oldest first, see #takeWritten.
+     */
+    std::deque< ParsedMessage > _written;
+    /**
+     * @brief Largest size of buffer while holding parsed bytes, past which
+     *   reading pauses as if the emulated link were full.
+     */
+    static constexpr size_t _MAX_HELD_SZ { 1024 * 1024 };
+    /**
+     * @brief Parsed bytes held until a release time, in order after
+     *   #_bytes_released.
+     */
+    struct _Hold {
+        /** @brief Count of bytes. */
+        size_t   sz {};
+        /** @brief Monotonic time after which bytes may be written. */
+        uint64_t release_ns {};
+    };
+    /**
+     * @brief Whether parsed bytes are held, set by first #holdParsed; once
+     *   set, only #_bytes_released may be written.
+     */
+    bool _holding {};
+    /**
+     * @brief Parsed bytes awaiting release, oldest first.
+     */
+    std::deque< _Hold > _holds;
+    /**
+     * @brief Total size of #_holds.
+     */
+    size_t _bytes_held        {};
+    /**
+     * @brief Parsed bytes released and awaiting write, when #_holding.
+     */
+    size_t _bytes_released    {};
 
 public:
     /**
@@ -139,8 +258,58 @@ public:
         assert( messageSizeSet() );
         assert( ( _bytes_parsed + _next_message_sz ) <= size() );
         _bytes_parsed += _next_message_sz;
+        _last_parsed_sz = _next_message_sz;
         _next_message_sz = _UNKNOWN_SZ;
     }
+    /**
+     * @brief Marks current message as with #markMessageParsed, also recording
+     *   it to be returned by #takeWritten once written.
+     * @param sequence sequence number of message
+     * @param logged whether message was logged
+     */
+    void markMessageParsed( const uint16_t sequence, const bool logged );
+    /**
+     * @brief Takes oldest message recorded by #markMessageParsed and since
+     *   written, if any.
+     * @return written message, or `std::nullopt` if none
+     */
+    std::optional< ParsedMessage > takeWritten();
+    /**
+     * @brief Gets last message marked parsed, if not yet written.
+     * @return pointer to last parsed message, or `nullptr` if it is written,
+     *   or unknown (eg bytes were inserted after it)
+     */
+    inline uint8_t* lastParsed() {
+        return ( _last_parsed_sz == 0 || _bytes_parsed < _last_parsed_sz ) ?
+            nullptr : data() + _bytes_parsed - _last_parsed_sz;
+    }
+    /**
+     * @brief Gets size of message returned by #lastParsed.
+     * @return size of last parsed message
+     */
+    inline size_t lastParsedSize() {
+        return _last_parsed_sz;
+    }
+    /**
+     * @brief Removes last message marked parsed, if not yet written, so it is
+     *   never written, whether held, released or neither; any unparsed bytes
+     *   after it move to its place.
+     * @note Message parsed before it becomes unknown to #lastParsed.
+     */
+    void dropLastParsed();
+    /**
+     * @brief Removes current message from buffer instead of marking it
+     *   parsed, so it is never written; any bytes after it move to its place.
+     */
+    void dropMessage();
+    /**
+     * @brief Inserts bytes after those marked parsed, themselves marked parsed
+     *   and ready for #write/#unload ahead of any unparsed bytes.
+     * @param input source buffer
+     * @param bytes_to_insert n bytes to insert
+     * @note Invalidates pointers into buffer.
+     */
+    void insertParsed( const void* input, const size_t bytes_to_insert );
     /**
      * @brief Detects whether buffer is empty or is still building incomplete
      *   message.
@@ -148,15 +317,65 @@ public:
      *   message
      */
     inline bool readReady() {
+        if ( _holding ) {
+            // released bytes are written before reading more
+            return _bytes_released == 0 &&
+                ( empty() || incompleteMessage() ||
+                  ( unparsed() == 0 && size() < _MAX_HELD_SZ ) );
+        }
         return empty() || incompleteMessage();
     }
     /**
-     * @brief Detects if complete message(s) are stored in buffer.
+     * @brief Detects if complete message(s) are stored in buffer, and
+     *   released if held.
      * @return whether complete message(s) are stored in buffer
      */
     inline bool writeReady() {
-        return !empty() && _bytes_parsed > 0;
+        return !empty() && writable() > 0;
+    }
+    /**
+     * @brief Returns n bytes that may be written now: all parsed bytes, or
+     *   when holding, those released.
+     * @return n bytes that may be written now
+     */
+    inline size_t writable() {
+        return _holding ? _bytes_released : _bytes_parsed;
+    }
+    /**
+     * @brief Detects whether any parsed bytes await release.
+     * @return whether any parsed bytes await release
+     */
+    inline bool held() {
+        return _bytes_held > 0;
+    }
+    /**
+     * @brief Detects whether parsed bytes are held, ie #holdParsed was used.
+     * @return whether parsed bytes are held
+     */
+    inline bool holding() {
+        return _holding;
+    }
+    /**
+     * @brief Returns n bytes parsed but not yet held or released.
+     * @return n bytes parsed but not yet held or released
+     */
+    inline size_t unheld() {
+        return _holding ? _bytes_parsed - _bytes_released - _bytes_held :
+                          _bytes_parsed;
     }
+    /**
+     * @brief Holds parsed bytes not yet held or released until release time.
+     * @param release_ns monotonic time after which bytes may be written; raised
+     *   to that of bytes already held, so bytes are released in order
+     * @return n bytes newly held
+     */
+    size_t holdParsed( const uint64_t release_ns );
+    /**
+     * @brief Releases held bytes whose release time has passed.
+     * @param now_ns current monotonic time
+     * @return n bytes released
+     */
+    size_t release( const uint64_t now_ns );
     /**
      * @brief Read bytes from `sockfd` into buffer.
      * @param sockfd fd from which to `recv(2)` bytes
@@ -192,7 +411,7 @@ public:
     write( const int sockfd,
            const size_t bytes_to_write );
     /**
-     * @brief Writes all bytes from buffer to `sockfd`.
+     * @brief Writes all #writable bytes from buffer to `sockfd`.
      * @param sockfd fd to `send(2)` bytes
      * @return bytes written
      */
@@ -240,11 +459,40 @@ public:
      */
     inline void clear() {
         assert( parsed() == size() );
+        assert( _holds.empty() );
+        assert( _marks.empty() );
+        _reads.clear();
         _bytes_read      = 0;
+        _bytes_released  = 0;
         _next_message_sz = _UNKNOWN_SZ;
+        _last_parsed_sz  = 0;
         _bytes_parsed    = 0;
         _bytes_written   = 0;
     }
+    /**
+     * @brief Returns monotonic time of last [read](#read) or [load](#load),
+     *   taken to be receipt time of any messages it completed.
+     * @return monotonic time in nanoseconds
+     */
+    inline uint64_t readTime() {
+        return _read_ns;
+    }
+    /**
+     * @brief Returns monotonic time of [read](#read) or [load](#load) of oldest
+     *   bytes not yet written/unloaded.
+     * @return monotonic time in nanoseconds, or of last read if buffer is empty
+     */
+    inline uint64_t heldSince() {
+        return _reads.empty() ? _read_ns : _reads.front().read_ns;
+    }
+    /**
+     * @brief Returns monotonic time of last [write](#write), taken to be
+     *   forwarding time of any messages it completed.
+     * @return monotonic time in nanoseconds
+     */
+    inline uint64_t writeTime() {
+        return _write_ns;
+    }
     /**
      * @brief Returns amount of bytes available for read/load.
      * @return bytes available for read/load
@@ -0,0 +1,111 @@
+#ifndef STASHARENA_HPP
+#define STASHARENA_HPP
+
+/**
+ * @file StashArena.hpp
+ */
+
+#include <deque>
+#include <memory>         // unique_ptr
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include <cstdint>
+
+
+/**
+ * @brief Per-[Connection](#Connection) storage for request data needed again
+ *   when parsing the reply (eg `InternAtom` name), indexed by request sequence
+ *   number.
+ *
+ *   Stashed data is copied out of the client [SocketBuffer](#SocketBuffer),
+ *   which may be written, cleared or resized before the reply arrives, into
+ *   fixed size blocks by bump allocation. Each block counts its live
+ *   stashes, and is reused once all are released; as replies arrive in
+ *   request order, a connection needs only enough blocks for its window of
+ *   outstanding requests, and stashing rarely allocates.
+ */
+class StashArena {
+public:
+    /**
+     * @brief Default size of blocks; larger data gets its own block.
+     */
+    static constexpr size_t BLOCK_SZ { 4 * 1024 };
+
+private:
+    /**
+     * @brief Bump allocated storage.
+     */
+    struct _Block {
+        /** @brief Storage. */
+        std::unique_ptr< char[] > data;
+        /** @brief Size of storage. */
+        size_t sz {};
+        /** @brief Bytes allocated since block was last empty. */
+        size_t used {};
+        /** @brief Count of stashes not yet released. */
+        size_t live {};
+    };
+    /**
+     * @brief Single stash.
+     */
+    struct _Entry {
+        /** @brief Sequence number of request. */
+        uint16_t         seq_num {};
+        /** @brief Stashed data. */
+        std::string_view str;
+        /** @brief Block holding #str. */
+        _Block*          block {};
+        /** @brief Whether stash was released out of order. */
+        bool             released {};
+    };
+    /**
+     * @brief All blocks, in order allocated.
+     */
+    std::vector< std::unique_ptr< _Block > > _blocks;
+    /**
+     * @brief Blocks with no live stashes, other than #_current.
+     */
+    std::vector< _Block* > _free_blocks;
+    /**
+     * @brief Block from which next stash is allocated.
+     */
+    _Block* _current {};
+    /**
+     * @brief Stashes in request order; released stashes are removed from
+     *   front, so usually reply order finds its stash at front.
+     */
+    std::deque< _Entry > _entries;
+
+    /**
+     * @brief Releases stash storage, reusing block if now empty.
+     * @param entry stash to release
+     */
+    void _release( _Entry& entry );
+
+public:
+    /**
+     * @brief Copies data to arena until released by #unstash or #discard.
+     * @param seq_num sequence number of request
+     * @param str data to copy
+     */
+    void stash( const uint16_t seq_num, const std::string_view str );
+    /**
+     * @brief Releases and returns stash of request.
+     * @param seq_num sequence number of request
+     * @return stashed data, valid until next #stash, or `std::nullopt` if
+     *   none stashed for request
+     */
+    std::optional< std::string_view > unstash( const uint16_t seq_num );
+    /**
+     * @brief Releases stash of request, if any, eg on error in place of reply.
+     * @param seq_num sequence number of request
+     */
+    inline void discard( const uint16_t seq_num ) {
+        unstash( seq_num );
+    }
+};
+
+
+#endif  // STASHARENA_HPP
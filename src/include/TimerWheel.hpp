@@ -0,0 +1,111 @@
+#ifndef TIMERWHEEL_HPP
+#define TIMERWHEEL_HPP
+
+/**
+ * @file TimerWheel.hpp
+ */
+
+#include <algorithm>  // min, max
+#include <array>
+#include <vector>
+
+#include <cstdint>
+
+
+/**
+ * @brief Hashed timing wheel of deadlines tagged with ids, giving the event
+ *   loop its `poll(2)` timeout and the ids due after it wakes.
+ *
+ *   Deadlines hash by millisecond tick into one of #_SLOT_CT slots, so
+ *   scheduling is O(1) and expiry visits only slots of elapsed ticks.
+ *   Deadlines more than one rotation away share a slot with nearer ones and
+ *   are kept until their own tick comes around.
+ */
+class TimerWheel {
+private:
+    /**
+     * @brief Resolution of wheel in nanoseconds.
+     */
+    static constexpr uint64_t _TICK_NS { 1'000'000 };
+    /**
+     * @brief Count of slots, covering one rotation of ticks.
+     */
+    static constexpr uint64_t _SLOT_CT { 512 };
+    /**
+     * @brief Single scheduled deadline.
+     */
+    struct _Timer {
+        /** @brief Monotonic time at which timer is due. */
+        uint64_t deadline_ns {};
+        /** @brief Caller-defined tag passed to expiry callback. */
+        uint32_t id {};
+    };
+    /**
+     * @brief Timers by tick modulo #_SLOT_CT.
+     */
+    std::array< std::vector< _Timer >, _SLOT_CT > _slots;
+    /**
+     * @brief Earliest tick not yet fully expired.
+     */
+    uint64_t _tick {};
+    /**
+     * @brief Count of timers in all slots.
+     */
+    size_t _size {};
+
+public:
+    /**
+     * @brief Indicates whether any timers are scheduled.
+     * @return whether any timers are scheduled
+     */
+    inline bool empty() const {
+        return _size == 0;
+    }
+    /**
+     * @brief Schedules a timer.
+     * @param deadline_ns monotonic time at which timer is due
+     * @param id tag passed to expiry callback
+     */
+    void schedule( const uint64_t deadline_ns, const uint32_t id );
+    /**
+     * @brief Gets time until next timer is due, rounded up to whole ticks.
+     * @param now_ns current monotonic time
+     * @return milliseconds until next timer is due, or -1 if none scheduled
+     */
+    int timeoutMs( const uint64_t now_ns ) const;
+    /**
+     * @brief Removes timers that are due, calling `callback` for each.
+     * @tparam CallbackT callable taking `uint32_t` timer id
+     * @param now_ns current monotonic time
+     * @param callback called with id of each timer due, in no particular
+     *   order; must not call #schedule
+     */
+    template< typename CallbackT >
+    void expire( const uint64_t now_ns, CallbackT&& callback ) {
+        const uint64_t now_tick { now_ns / _TICK_NS };
+        if ( _size == 0 || now_tick < _tick ) {
+            _tick = std::max( _tick, now_tick );
+            return;
+        }
+        // each slot needs visiting at most once, however many ticks elapsed
+        const uint64_t last_tick {
+            std::min( now_tick, _tick + _SLOT_CT - 1 ) };
+        for ( uint64_t tick { _tick }; tick <= last_tick; ++tick ) {
+            std::vector< _Timer >& slot { _slots[ tick % _SLOT_CT ] };
+            size_t kept_ct {};
+            for ( const _Timer& timer : slot ) {
+                if ( timer.deadline_ns <= now_ns )
+                    callback( timer.id );
+                else
+                    slot[ kept_ct++ ] = timer;
+            }
+            _size -= slot.size() - kept_ct;
+            slot.resize( kept_ct );
+        }
+        // timers later in current tick are revisited on next expiry
+        _tick = now_tick;
+    }
+};
+
+
+#endif  // TIMERWHEEL_HPP
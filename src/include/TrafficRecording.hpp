@@ -0,0 +1,104 @@
+#ifndef TRAFFICRECORDING_HPP
+#define TRAFFICRECORDING_HPP
+
+/**
+ * @file TrafficRecording.hpp
+ */
+
+#include <optional>
+#include <string>
+
+#include <cstdint>
+#include <cstdio>       // FILE
+
+
+/**
+ * @brief Raw per-connection traffic capture written with `--record`, for
+ *   replay by `bench/x11_replay`.
+ *
+ *   A recording file begins with a #FileHeader, followed by records
+ *   consisting of a #RecordHeader and `size` bytes exactly as read from a
+ *   socket. All bytes read from the client are recorded, but bytes read from
+ *   the server only until the connection is open, so that the recording
+ *   holds the connection setup reply (with the `resource-id-base` and
+ *   `resource-id-mask` the client allocated IDs from) but not the replies,
+ *   events and errors that follow. Header fields are in host byte order;
+ *   recorded bytes are in the byte order chosen by the client.
+ */
+class TrafficRecording {
+public:
+    /**
+     * @brief Identifies recording file layout.
+     */
+    static constexpr uint64_t MAGIC   { 0x4443455250525458 };  // "XTRPRECD"
+    /**
+     * @brief Version of recording file layout.
+     */
+    static constexpr uint32_t VERSION { 1 };
+    /**
+     * @brief Recording file header, at offset 0.
+     */
+    struct FileHeader {
+        /** @brief Always #MAGIC. */
+        uint64_t magic;
+        /** @brief Always #VERSION. */
+        uint32_t version;
+        /** @brief Size of this header, at which records begin. */
+        uint32_t header_sz;
+        /** @brief Time connection was opened (seconds since Unix epoch.) */
+        uint64_t start_time;
+    };
+    /**
+     * @brief Record directions.
+     */
+    enum Direction : uint8_t {
+        CLIENT_TO_SERVER, SERVER_TO_CLIENT
+    };
+    /**
+     * @brief Precedes each record's bytes.
+     */
+    struct RecordHeader {
+        /**
+         * @brief Monotonic time bytes were read, relative to connection start
+         *   (nanoseconds.)
+         */
+        uint64_t offset_ns;
+        /** @brief Count of bytes following. */
+        uint32_t size;
+        /** @brief One of #Direction. */
+        uint8_t  direction;
+        /** @brief Unused, always 0. */
+        uint8_t  unused[ 3 ];
+    };
+    static_assert( sizeof( RecordHeader ) == 16 );
+
+    /**
+     * @brief Creates recording file and writes #FileHeader.
+     * @param path file path
+     * @param start_time time connection was opened (seconds since Unix epoch)
+     * @return file stream, or `nullptr` on failure (with `errno` set)
+     */
+    static ::FILE* open( const std::string& path, const uint64_t start_time );
+    /**
+     * @brief Appends record.
+     * @param fs file stream returned by #open
+     * @param direction one of #Direction
+     * @param offset_ns monotonic time bytes were read, relative to
+     *   connection start
+     * @param data bytes read
+     * @param sz count of bytes read
+     * @return error message, or `std::nullopt` on success
+     */
+    static std::optional< std::string >
+    append( ::FILE* fs, const Direction direction, const uint64_t offset_ns,
+            const uint8_t* data, const size_t sz );
+    /**
+     * @brief Flushes and closes recording file.
+     * @param fs file stream returned by #open
+     * @return error message, or `std::nullopt` on success
+     */
+    static std::optional< std::string > close( ::FILE* fs );
+};
+
+
+#endif  // TRAFFICRECORDING_HPP
@@ -0,0 +1,505 @@
+#ifndef TUNNEL_HPP
+#define TUNNEL_HPP
+
+/**
+ * @file Tunnel.hpp
+ */
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <memory>       // unique_ptr
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>      // pair
+#include <vector>
+
+#include <cstdint>
+
+#include "ImageCache.hpp"
+
+/**
+ * @brief Link between two xtracepp instances carrying all proxied connections
+ *   over one TCP stream, used with `--tunnelconnect` and `--tunnellisten`.
+ *
+ *   The instance near the clients accepts them as usual, but instead of
+ *   connecting to an X server, gives each [Connection](#Connection) one end
+ *   of a socket pair (a channel) as its server socket, with #openChannel. For
+ *   each channel the instance near the X server is handed the other end of a
+ *   matching socket pair with #acceptChannel, which it treats as a client
+ *   socket, connecting it to the X server as usual.
+ *
+ *   Channels are multiplexed over the link in frames. Each X11 message is
+ *   framed separately, and messages of up to #MAX_DELTA_SZ are sent as their
+ *   difference (XOR) from the last message of the same type (request opcode
+ *   or response code) in the same channel and direction, so that repetitive
+ *   traffic (eg 32B events differing only in sequence number and timestamp)
+ *   reduces to runs of zero bytes. When built with `XTRACEPP_WITH_ZLIB`,
+ *   frames in each direction are then compressed as one deflate stream,
+ *   flushed once per poll.
+ *
+ *   With `--imagecache`, image data of `PutImage` requests and `GetImage`
+ *   replies is also cached per channel by each end, see
+ *   [ImageCache](#ImageCache), so that images already sent cross the link
+ *   again as only their hash and the message header.
+ *
+ *   The link and channels are served on a separate thread, so that a slow
+ *   link never blocks the main queue; the proxied connections see only
+ *   ordinary sockets.
+ */
+class Tunnel {
+public:
+    /**
+     * @brief Which end of link this instance is.
+     */
+    enum class Role {
+        /** @brief Near clients, connects to peer. */
+        CONNECT,
+        /** @brief Near X server, listens for peer. */
+        LISTEN
+    };
+    /**
+     * @brief Largest message sent as difference from previous message of its
+     *   type; larger messages are sent as is.
+     */
+    static constexpr size_t MAX_DELTA_SZ { 256 };
+    /**
+     * @brief Smallest image data cached with `--imagecache`; smaller images
+     *   save little over their reference.
+     */
+    static constexpr size_t MIN_CACHED_IMAGE_SZ { 64 };
+
+private:
+    /**
+     * @brief Frame types, first byte of frame header.
+     */
+    enum _FrameType : uint8_t {
+        /** @brief Channel opened by client side; no payload. */
+        _OPEN = 1,
+        /** @brief Channel closed by either side; no payload. */
+        _CLOSE,
+        /** @brief Channel bytes of unknown message boundaries, sent as is. */
+        _DATA,
+        /** @brief Single message, sent as is. */
+        _MESSAGE,
+        /** @brief Single message, with bytes after the first XORed with last
+         *    message of same first byte. */
+        _DELTA,
+        /** @brief Single message with image data to cache: hash of image
+         *    data, offset of image data, then message. */
+        _IMAGE,
+        /** @brief Single message with image data already cached: hash of
+         *    image data, then message up to image data. */
+        _IMAGE_REF
+    };
+    /**
+     * @brief Size of frame header: type, channel id, and payload size.
+     */
+    static constexpr size_t _FRAME_HEADER_SZ { 1 + 4 + 4 };
+    /**
+     * @brief Largest payload in one frame, as a corrupt stream should not
+     *   cause unbounded buffering.
+     */
+    static constexpr size_t _MAX_PAYLOAD_SZ { 1 << 28 };
+    /**
+     * @brief Sent uncompressed by both ends when link opens, followed by one
+     *   byte of #_FLAG_DEFLATE flags and 4B image cache budget.
+     */
+    static constexpr std::string_view _MAGIC { "xtpptun" };
+    /**
+     * @brief Size of link handshake.
+     */
+    static constexpr size_t _HANDSHAKE_SZ { _MAGIC.size() + 1 + 4 };
+    /**
+     * @brief Size of image hash in frames.
+     */
+    static constexpr size_t _HASH_SZ { sizeof( uint64_t ) };
+    /**
+     * @brief Handshake flag set when frames are deflate compressed.
+     */
+    static constexpr uint8_t _FLAG_DEFLATE { 1 };
+    /**
+     * @brief Largest read from any socket at once.
+     */
+    static constexpr size_t _READ_SZ { 64 * 1024 };
+    /**
+     * @brief Outgoing link bytes above which channels are not read, so that
+     *   a slow link pushes back on clients (or server) as a socket would.
+     */
+    static constexpr size_t _MAX_LINK_BACKLOG { 4 * 1024 * 1024 };
+    /**
+     * @brief Bytes awaiting write to any one channel above which link is not
+     *   read, so that a stalled client (or server) pushes back on peer instead
+     *   of its stream being buffered in memory.
+     */
+    static constexpr size_t _MAX_CHANNEL_BACKLOG { 4 * 1024 * 1024 };
+    /**
+     * @brief Sentinel value indicating closed socket.
+     */
+    static constexpr int _UNINIT_FD { -1 };
+
+    /**
+     * @brief Byte order of X11 connection, as set by client in connection
+     *   setup.
+     */
+    enum class _ByteOrder : uint8_t { UNKNOWN, MSB_FIRST, LSB_FIRST };
+    /**
+     * @brief Parsing stage of one direction of X11 connection bytes.
+     */
+    enum class _Stage : uint8_t {
+        /** @brief Connection setup message comes next. */
+        SETUP,
+        /** @brief Requests, or replies, events and errors, come next. */
+        MESSAGES,
+        /** @brief Message boundaries unknown, eg during authentication
+         *    negotiation; bytes are sent as is. */
+        UNFRAMED
+    };
+    /**
+     * @brief One proxied connection, as seen from tunnel thread.
+     */
+    struct _Channel {
+        /** @brief Tunnel end of socket pair. */
+        int         fd { _UNINIT_FD };
+        /** @brief Byte order of connection. */
+        _ByteOrder  byte_order {};
+        /** @brief Stage of client to server bytes. */
+        _Stage      client_stage {};
+        /** @brief Stage of server to client bytes. */
+        _Stage      server_stage {};
+        /** @brief Bytes read from #fd not yet forming a whole message. */
+        std::string in;
+        /** @brief Bytes received from link not yet written to #fd. */
+        std::string out;
+        /** @brief Whether peer has closed channel, after which #fd is closed
+         *    once #out is written. */
+        bool        closing {};
+        /** @brief Last message read from #fd, by first byte. */
+        std::array< std::string, 256 > sent;
+        /** @brief Last message received from link, by first byte. */
+        std::array< std::string, 256 > received;
+        /** @brief Images sent to peer, by hash; sizes only. */
+        ImageCache  sent_images;
+        /** @brief Images received from peer, by hash. */
+        ImageCache  received_images;
+        /** @brief Count of requests from client, as last 16 bits of sequence
+         *    number. */
+        uint16_t    request_seq {};
+        /** @brief Sequence numbers of `GetImage` requests awaiting reply,
+         *    with Role::LISTEN and `--imagecache`. */
+        std::deque< uint16_t > image_reply_seqs;
+        /** @brief Images sent as reference to #sent_images. */
+        size_t      image_hits {};
+        /** @brief Images sent in full. */
+        size_t      image_misses {};
+        /** @brief Image bytes not sent thanks to #sent_images. */
+        size_t      image_bytes_saved {};
+    };
+    struct _Codec;
+
+    /**
+     * @brief Which end of link this instance is.
+     */
+    Role _role { Role::CONNECT };
+    /**
+     * @brief Per-channel budget of images sent, in bytes; 0 disables image
+     *   caching.
+     */
+    size_t _image_budget {};
+    /**
+     * @brief Per-channel budget of images received, as sent by peer in
+     *   handshake.
+     */
+    size_t _peer_image_budget {};
+    /**
+     * @brief Socket listening for peer, with Role::LISTEN.
+     */
+    int _listen_fd { _UNINIT_FD };
+    /**
+     * @brief Socket connected to peer.
+     */
+    int _link_fd { _UNINIT_FD };
+    /**
+     * @brief Socket pair waking tunnel thread from `poll(2)`: main thread
+     *   writes to first, tunnel thread polls second.
+     */
+    int _wake_fds[ 2 ] { _UNINIT_FD, _UNINIT_FD };
+    /**
+     * @brief Socket pair notifying main queue of channels to accept: tunnel
+     *   thread writes a byte to first per channel, main queue polls second.
+     */
+    int _accept_fds[ 2 ] { _UNINIT_FD, _UNINIT_FD };
+    /**
+     * @brief Whether link to peer is open, or with Role::LISTEN, whether
+     *   tunnel is still listening.
+     */
+    std::atomic_bool _open {};
+    /**
+     * @brief Guards #_stopping, #_opened and #_accepted.
+     */
+    std::mutex _mutex;
+    /**
+     * @brief Whether tunnel thread should exit.
+     */
+    bool _stopping {};
+    /**
+     * @brief Channels opened by main queue, awaiting tunnel thread: ids and
+     *   tunnel ends of socket pairs.
+     */
+    std::vector< std::pair< uint32_t, int > > _opened;
+    /**
+     * @brief Channels opened by peer, awaiting main queue: ids and proxy ends
+     *   of socket pairs.
+     */
+    std::deque< std::pair< uint32_t, int > > _accepted;
+    /**
+     * @brief Id of next channel opened, with Role::CONNECT.
+     */
+    uint32_t _next_channel_id {};
+    /**
+     * @brief Open channels by id; only used by tunnel thread.
+     */
+    std::unordered_map< uint32_t, _Channel > _channels;
+    /**
+     * @brief Frames encoded since last flush of #_codec.
+     */
+    std::string _frames;
+    /**
+     * @brief Link bytes received, not yet decoded.
+     */
+    std::string _link_in;
+    /**
+     * @brief Decoded link bytes, not yet forming a whole frame.
+     */
+    std::string _link_frames;
+    /**
+     * @brief Whether handshake of peer has been received.
+     */
+    bool _handshake_received {};
+    /**
+     * @brief Compressed (or not) link bytes awaiting `send(2)`, in order.
+     */
+    std::deque< std::string > _link_out;
+    /**
+     * @brief Bytes of front of #_link_out already sent.
+     */
+    size_t _link_out_sent {};
+    /**
+     * @brief Total size of #_link_out.
+     */
+    size_t _link_backlog {};
+    /**
+     * @brief Compression state of link, if built with `XTRACEPP_WITH_ZLIB`.
+     */
+    std::unique_ptr< _Codec > _codec;
+    /**
+     * @brief Tunnel thread.
+     */
+    std::thread _thread;
+
+    /**
+     * @brief Tunnel thread loop, polls link and channels until stopped.
+     */
+    void _serve();
+    /**
+     * @brief Begins link on newly connected socket: resets codec and sends
+     *   handshake.
+     * @param fd socket connected to peer
+     */
+    void _openLink( const int fd );
+    /**
+     * @brief Ends link and all channels, as if each were closed by peer.
+     * @param reason error message for `stderr`
+     */
+    void _closeLink( const std::string_view reason );
+    /**
+     * @brief Adds channels opened by main queue since last call, sending
+     *   #_OPEN for each.
+     */
+    void _takeOpenedChannels();
+    /**
+     * @brief Closes tunnel end of channel and forgets it.
+     * @param id channel id
+     * @param notify_peer whether to send #_CLOSE
+     */
+    void _closeChannel( const uint32_t id, const bool notify_peer );
+    /**
+     * @brief Reads available bytes from channel, and encodes each whole
+     *   message as a frame.
+     * @param id channel id
+     * @param channel channel to read
+     * @return whether channel is still open
+     */
+    bool _readChannel( const uint32_t id, _Channel& channel );
+    /**
+     * @brief Writes decoded bytes to channel as far as socket allows.
+     * @param id channel id
+     * @param channel channel to write
+     * @return whether channel is still open
+     */
+    bool _writeChannel( const uint32_t id, _Channel& channel );
+    /**
+     * @brief Finds size of next X11 message read from channel.
+     * @param channel channel read
+     * @param data bytes read
+     * @param sz count of bytes read
+     * @return size of message, 0 if more bytes are needed to tell, or
+     *   `std::nullopt` if message boundaries are unknown
+     */
+    std::optional< size_t > _nextMessageSize(
+        const _Channel& channel, const uint8_t* data, const size_t sz ) const;
+    /**
+     * @brief Advances connection setup stages of channel past message, in
+     *   either direction.
+     * @param channel channel of message
+     * @param client_to_server direction of message
+     * @param data message bytes
+     * @param sz message size
+     */
+    void _noteMessage( _Channel& channel, const bool client_to_server,
+                       const uint8_t* data, const size_t sz ) const;
+    /**
+     * @brief Starts channel with image caches set to budgets.
+     * @param id channel id
+     * @param fd tunnel end of socket pair
+     */
+    void _addChannel( const uint32_t id, const int fd );
+    /**
+     * @brief Finds image data in message read from channel, if any, to be
+     *   cached with `--imagecache`: suffix of `PutImage` request, or with
+     *   Role::LISTEN, of `GetImage` reply.
+     * @param channel channel read
+     * @param data message bytes
+     * @param sz message size
+     * @return offset of image data in message, or `std::nullopt` if message
+     *   has no image data of at least #MIN_CACHED_IMAGE_SZ
+     */
+    std::optional< size_t > _imageOffset(
+        _Channel& channel, const uint8_t* data, const size_t sz );
+    /**
+     * @brief Appends frame header to #_frames.
+     * @param type frame type
+     * @param id channel id
+     * @param sz payload size
+     */
+    void _appendFrameHeader( const _FrameType type, const uint32_t id,
+                             const size_t sz );
+    /**
+     * @brief Appends frame to #_frames.
+     * @param type frame type
+     * @param id channel id
+     * @param payload frame payload
+     * @param sz payload size
+     */
+    void _appendFrame( const _FrameType type, const uint32_t id,
+                       const uint8_t* payload = nullptr, const size_t sz = 0 );
+    /**
+     * @brief Appends single message read from channel to #_frames, as
+     *   difference from previous message of its type where possible.
+     * @param id channel id
+     * @param channel channel read
+     * @param data message bytes
+     * @param sz message size
+     */
+    void _encodeMessage( const uint32_t id, _Channel& channel,
+                         const uint8_t* data, const size_t sz );
+    /**
+     * @brief Appends single message with image data read from channel to
+     *   #_frames, as reference to image already sent where possible.
+     * @param id channel id
+     * @param channel channel read
+     * @param data message bytes
+     * @param sz message size
+     * @param image_offset offset of image data in message
+     * @return whether message was appended; `false` if image exceeds budget
+     */
+    bool _encodeImage( const uint32_t id, _Channel& channel,
+                       const uint8_t* data, const size_t sz,
+                       const size_t image_offset );
+    /**
+     * @brief Compresses #_frames, if any, and queues result for link.
+     * @return error message, or `std::nullopt` on success
+     */
+    std::optional< std::string > _flushFrames();
+    /**
+     * @brief Reads available link bytes, decompresses them and dispatches
+     *   whole frames.
+     * @return error message (including peer closing link), or
+     *   `std::nullopt` on success
+     */
+    std::optional< std::string > _readLink();
+    /**
+     * @brief Acts on single frame received from peer.
+     * @param type frame type
+     * @param id channel id
+     * @param payload frame payload
+     * @param sz payload size
+     * @return error message, or `std::nullopt` on success
+     */
+    std::optional< std::string > _dispatchFrame(
+        const uint8_t type, const uint32_t id,
+        const uint8_t* payload, const size_t sz );
+    /**
+     * @brief Sends queued link chunks as far as socket allows.
+     * @return error message, or `std::nullopt` on success
+     */
+    std::optional< std::string > _writeLink();
+
+public:
+    // defined with _Codec in Tunnel.cpp
+    Tunnel();
+    Tunnel( const Tunnel& ) = delete;
+    Tunnel& operator=( const Tunnel& ) = delete;
+    /**
+     * @brief Stops tunnel thread, closing link and all channels.
+     */
+    ~Tunnel();
+    /**
+     * @brief Starts tunnel thread.
+     * @param role which end of link this instance is
+     * @param fd with Role::CONNECT socket connected to peer, with
+     *   Role::LISTEN socket listening for peer; tunnel takes ownership
+     * @param image_budget per-channel budget of images sent, in bytes; 0
+     *   disables image caching
+     * @return error message, or `std::nullopt` on success
+     */
+    std::optional< std::string > start(
+        const Role role, const int fd, const size_t image_budget );
+    /**
+     * @brief Stops tunnel thread, closing link and all channels.
+     */
+    void stop();
+    /**
+     * @brief Whether link can carry new channels; with Role::LISTEN, whether
+     *   tunnel is still listening for peer.
+     */
+    inline bool isOpen() const {
+        return _open.load();
+    }
+    /**
+     * @brief Opens channel to X server through peer, with Role::CONNECT.
+     * @return proxy end of channel, to use as server socket, or -1 if link is
+     *   closed
+     */
+    int openChannel();
+    /**
+     * @brief File descriptor polling read-ready when channels opened by peer
+     *   await #acceptChannel, with Role::LISTEN.
+     */
+    inline int acceptFd() const {
+        return _accept_fds[ 1 ];
+    }
+    /**
+     * @brief Takes next channel opened by peer, with Role::LISTEN.
+     * @return channel id and proxy end of channel, to use as client socket,
+     *   or `std::nullopt` if none is waiting
+     */
+    std::optional< std::pair< uint32_t, int > > acceptChannel();
+};
+
+
+#endif  // TUNNEL_HPP
@@ -6,14 +6,17 @@
  */
 
 #include <algorithm>                             // max
+#include <deque>
 #include <limits>                                // numeric_limits
+#include <map>
 #include <optional>
 #include <string>
 #include <string_view>
 #include <tuple>                                 // tuple_size
 #include <type_traits>                           // enable_if_t, remove_refer...
 #include <unordered_map>
-#include <utility>                               // pair
+#include <unordered_set>
+#include <utility>                               // pair, forward, move
 #include <vector>
 
 #include <cassert>
@@ -22,8 +25,13 @@
 
 #include <fmt/format.h>
 
+#include "AtomTable.hpp"
 #include "Connection.hpp"
+#include "LatencyHistogram.hpp"
+#include "MessageStats.hpp"
 #include "Settings.hpp"
+#include "ShmRing.hpp"
+#include "monotonic.hpp"
 
 #include "protocol/Message.hpp"
 #include "protocol/common_types.hpp"
@@ -116,6 +124,11 @@ public:
     };
 
 private:
+    /**
+     * @brief Times individual parsing functions in isolation, see
+     *   `bench/parser_benchmark.cpp`.
+     */
+    friend class ParserBenchmark;
     /**
      * @brief Bundles [connection](#Connection) ID and request sequence number
      *   to create unique server-wide ID for any request made.
@@ -157,47 +170,233 @@ private:
         };
     };
     /**
-     * @brief Temporary storage for strings defined in requests that are then
-     *  later needed for when parsing the corresponding reply (eg InternAtom
-     *   and QueryExtension).
-     * @ingroup string_stashing
-     */
-    std::unordered_map< _StashedStringID, std::string_view,
-                        _StashedStringID::Hash >
-    _stashed_strings;
-    /**
-     * @brief Temporarily store a string encoded in a request that will be
-     *   needed when parsing its reply.
-     * @param conn_id [Connection](#Connection) unique serial number.
+     * @brief Temporarily store a copy of a string encoded in a request (eg
+     *   InternAtom and QueryExtension) that will be needed when parsing its
+     *   reply, in [Connection::request_stash](#Connection::request_stash).
+     * @param conn pointer to connection making request
      * @param seq_num Request serial number, unique for a on a given
      *   [connection](#Connection).
      * @param str string to be stored
      * @ingroup string_stashing
      */
     void
-    _stashString( const uint32_t conn_id, const uint16_t seq_num,
+    _stashString( Connection* conn, const uint16_t seq_num,
                   const std::string_view str );
     /**
-     * @brief Retrieves strings stashed with #_stashString.
-     * @param conn_id [Connection](#Connection) unique serial number.
+     * @brief Retrieves and releases strings stashed with #_stashString.
+     * @param conn pointer to connection making request
      * @param seq_num Request serial number, unique for a on a given
      *   [connection](#Connection).
-     * @return stored string
+     * @return stored string, valid until next #_stashString on connection
      * @ingroup string_stashing
      */
     std::string_view
-    _unstashString( const uint32_t conn_id, const uint16_t seq_num );
+    _unstashString( Connection* conn, const uint16_t seq_num );
     /**
      * @brief Internment of strings at least partially mirroring that of actual
      *   X server, indexed by ATOM.
      * Should contain:
      *   - all protocol predefined atoms (1 "PRIMARY" - 68 "WM_TRANSIENT_FOR")
-     *   - any atoms in InternAtom requests made by any client during main queue
+     *   - any atoms in InternAtom requests or GetAtomName replies made by any
+     *     client during main queue
+     *   - optionally with --resolveatoms, any other atoms looked up as seen
      *   - optionally with --prefetchatoms, all server interned strings in the
      *     first contiguous range of ATOMs starting with 1
      * @ingroup string_stashing
      */
-    std::unordered_map< uint32_t, std::string > _interned_atoms;
+    AtomTable _interned_atoms;
+    /**
+     * @brief ATOMs in GetAtomName requests, for interning name from reply.
+     * @ingroup string_stashing
+     */
+    std::unordered_map< _StashedStringID, uint32_t,
+                        _StashedStringID::Hash >
+    _stashed_atoms;
+    /**
+     * @brief With `--replycache`, replies to requests whose answers are fixed
+     *   until the X server resets, indexed by #_replyCacheKey; cleared by
+     *   #closeReplyCache as last connection closes.
+     * @ingroup reply_caching
+     */
+    std::unordered_map< std::string, std::vector< uint8_t > > _cached_replies;
+    /**
+     * @brief With `--replycache`, keys of forwarded cacheable requests, for
+     *   caching their replies.
+     * @ingroup reply_caching
+     */
+    std::unordered_map< _StashedStringID, std::string,
+                        _StashedStringID::Hash >
+    _reply_cache_misses;
+    /**
+     * @brief With `--resolveatoms`, ATOMs formatted before their names were
+     *   known, awaiting lookup, see #takeUnresolvedAtoms.
+     * @ingroup string_stashing
+     */
+    std::vector< uint32_t > _unresolved_atoms;
+    /**
+     * @brief With `--resolveatoms`, ATOMs looked up but not yet answered.
+     * @ingroup string_stashing
+     */
+    std::unordered_set< uint32_t > _pending_atoms;
+    /**
+     * @brief With `--resolveatoms`, ATOMs for which lookup failed.
+     * @ingroup string_stashing
+     */
+    std::unordered_set< uint32_t > _unresolvable_atoms;
+    /**
+     * @brief Delimits decimal ATOM in formatted text whose name is pending,
+     *   to be replaced once known; unit separator is always escaped when
+     *   formatting strings, so can not otherwise appear in log lines.
+     * @ingroup logging
+     */
+    static constexpr char _ATOM_MARK { '\x1f' };
+    /**
+     * @brief Log line held until ATOM names it contains are known.
+     * @ingroup logging
+     */
+    struct _HeldLine {
+        /** @brief Stream to which line is printed. */
+        ::FILE*     log_fs {};
+        /** @brief Line text, which may contain marked ATOMs. */
+        std::string text;
+        /** @brief Monotonic time line was held. */
+        uint64_t    held_ns {};
+    };
+    /**
+     * @brief Lines held for pending ATOM names, along with any lines logged
+     *   after them, in order logged.
+     * @ingroup logging
+     */
+    std::deque< _HeldLine > _held_lines;
+    /**
+     * @brief Replaces marked ATOMs with names, if known.
+     * @param text formatted text
+     * @return text with each marked ATOM replaced by its quoted name or
+     *   "unrecognized atom"
+     * @ingroup logging
+     */
+    std::string _resolveAtomMarks( const std::string_view text ) const;
+    /**
+     * @brief Whether text contains marked ATOMs still pending lookup.
+     * @param text formatted text
+     * @ingroup logging
+     */
+    bool _awaitsAtoms( const std::string_view text ) const;
+    /**
+     * @brief Prints log line, or holds it (see #flushHeldLines) if it contains
+     *   marked ATOMs or other lines are already held.
+     * @param log_fs stream to print to
+     * @param fmt_str format string
+     * @param args format args
+     * @ingroup logging
+     */
+    template< typename... Args >
+    void _println( ::FILE* log_fs, fmt::format_string< Args... > fmt_str,
+                   Args&&... args ) {
+        // no ATOM pending, so no line can contain marks
+        if ( _pending_atoms.empty() && _held_lines.empty() ) {
+            fmt::println( log_fs, fmt_str, std::forward< Args >( args )... );
+            return;
+        }
+        std::string text { fmt::format( fmt_str, std::forward< Args >( args )... ) };
+        if ( _held_lines.empty() && !_awaitsAtoms( text ) ) {
+            fmt::println( log_fs, "{}", _resolveAtomMarks( text ) );
+            return;
+        }
+        _held_lines.push_back( { log_fs, std::move( text ), monotonic::now() } );
+    }
+    /**
+     * @brief Publishes log message to [_shm_ring](#_shm_ring), with any
+     *   marked ATOMs named as currently known, as ring records are not held.
+     * @param type see [ShmRing::RecordType](#ShmRing::RecordType)
+     * @param direction see [ShmRing::Direction](#ShmRing::Direction)
+     * @param code request major opcode, or event or error code
+     * @param minor_opcode request minor opcode, if any
+     * @param sequence message sequence number
+     * @param conn_id [Connection](#Connection) id
+     * @param recv_ns monotonic time of message receipt
+     * @param text formatted message text
+     * @ingroup logging
+     */
+    void _publish( const ShmRing::RecordType type,
+                   const ShmRing::Direction direction,
+                   const uint8_t code, const uint8_t minor_opcode,
+                   const uint16_t sequence, const uint32_t conn_id,
+                   const uint64_t recv_ns, const std::string_view text );
+    /**
+     * @brief Shared memory ring to which logged messages are also published,
+     *   if using `--shmring`.
+     * @ingroup logging
+     */
+    ShmRing _shm_ring;
+    /**
+     * @brief Request to reply/error latencies, indexed by major opcode and
+     *   extension minor opcode, if using `--latency`.
+     * @ingroup logging
+     */
+    std::map< std::pair< uint8_t, uint8_t >, LatencyHistogram > _reply_latencies;
+    /**
+     * @brief Records latency of request receiving reply or error, from
+     *   request being written to server; requests answered by proxy (see
+     *   `--replycache`) are not recorded.
+     * @param request opcodes and time of request
+     * @param recv_ns monotonic time of reply or error receipt
+     * @ingroup logging
+     */
+    inline void _recordLatency( const Connection::RequestOpcodes& request,
+                                const uint64_t recv_ns ) {
+        if ( request.sent_ns == 0 )
+            return;
+        _reply_latencies[ { request.major, _minorOpcode( request.major,
+                                                         request.minor ) } ]
+            .record( recv_ns - request.sent_ns );
+    }
+    /**
+     * @brief Normalizes minor opcode for indexing request statistics, as core
+     *   requests may use minor opcode byte for data.
+     * @param major_opcode request major opcode
+     * @param minor_opcode request minor opcode byte
+     * @return minor opcode for extension requests, or 0 for core requests
+     * @ingroup logging
+     */
+    static inline uint8_t _minorOpcode( const uint8_t major_opcode,
+                                        const uint8_t minor_opcode ) {
+        return major_opcode > protocol::requests::opcodes::MAX ?
+            minor_opcode : 0;
+    }
+    /**
+     * @brief Formats request name for statistics tables.
+     * @param major_opcode request major opcode
+     * @param minor_opcode request minor opcode, if extension request
+     * @return eg "GetProperty(20)" or "BIG-REQUESTS(133)-BigReqEnable(0)"
+     * @ingroup logging
+     */
+    std::string _requestName( const uint8_t major_opcode,
+                              const uint8_t minor_opcode ) const;
+    /**
+     * @brief Whether request type is answered by reply.
+     * @param major_opcode request major opcode
+     * @param minor_opcode request minor opcode, if extension request
+     * @return whether request has reply (false if unknown opcode)
+     * @ingroup logging
+     */
+    bool _hasReply( const uint8_t major_opcode,
+                    const uint8_t minor_opcode ) const;
+    /**
+     * @brief Message counters summed over closed connections, if using
+     *   `--stats`.
+     * @ingroup logging
+     */
+    MessageStats _total_stats;
+    /**
+     * @brief Print table of message counters.
+     * @param log_fs stream to print to
+     * @param prefix log line prefix, eg connection id
+     * @param stats counters to print
+     * @ingroup logging
+     */
+    void _logStats( ::FILE* log_fs, const std::string_view prefix,
+                    const MessageStats& stats ) const;
 
 public:
     // CLIENT_TO_SERVER and SERVER_TO_CLIENT need to be accessible to
@@ -586,7 +785,8 @@ private:
     std::string _formatVariable( const ResourceIdT var,
                                  const bool byteswap,
                                  const _EnumNameRange name_range = {} ) {
-        assert( ( var.data & ResourceIdT::ZERO_BITS ) == 0 );
+        assert( ( _ordered( var.data, byteswap ) &
+                  ResourceIdT::ZERO_BITS ) == 0 );
         return _formatVariable( var.data, byteswap, name_range );
     }
     /**
@@ -1109,6 +1309,79 @@ private:
      */
     size_t _logRequest(
         Connection* conn, const uint8_t* data, const size_t sz );
+    /**
+     * @brief Identifies cacheable request by byte order, opcode and contents.
+     * @param conn status of current connection, see [Connection](#Connection)
+     * @param data request bytes
+     * @param sz request size
+     * @return cache key, or `std::nullopt` if request is not cacheable
+     * @ingroup reply_caching
+     */
+    std::optional< std::string > _replyCacheKey(
+        Connection* conn, const uint8_t* data, const size_t sz );
+    /**
+     * @brief With `--replycache`, after request is logged either answers it
+     *   from cache, removing it from client buffer, or notes it forwarded.
+     * @param[in,out] conn status of current connection, see [Connection](#Connection)
+     * @param data request bytes, at parsed end of client buffer
+     * @param sz request size
+     * @return whether request was answered and removed
+     * @ingroup reply_caching
+     */
+    bool _answerFromCache(
+        Connection* conn, const uint8_t* data, const size_t sz );
+    /**
+     * @brief With `--replycache`, rewrites sequence number of server message
+     *   from server to client numbering before it is logged.
+     * @param[in,out] conn status of current connection, see [Connection](#Connection)
+     * @param[in,out] data message bytes
+     * @return whether message is reply to sync request, to be withheld from
+     *   client
+     * @ingroup reply_caching
+     */
+    bool _mapServerSequence( Connection* conn, uint8_t* data );
+    /**
+     * @brief With `--replycache`, after server message is logged, notes any
+     *   final reply or error, and caches reply to forwarded cacheable request.
+     * @param[in,out] conn status of current connection, see [Connection](#Connection)
+     * @param data message bytes
+     * @param sz message size
+     * @ingroup reply_caching
+     */
+    void _cacheReply(
+        Connection* conn, const uint8_t* data, const size_t sz );
+    /**
+     * @brief With `--replycache`, logs any local replies now deliverable and
+     *   inserts them at parsed end of server buffer.
+     * @param[in,out] conn status of current connection, see [Connection](#Connection)
+     * @ingroup reply_caching
+     */
+    void _flushLocalReplies( Connection* conn );
+    /**
+     * @brief With `--motioncompress`, after event is logged, drops the message
+     *   before it in server buffer if both are `MotionNotify` for the same
+     *   window and it is not yet written, so only the latest is written.
+     *   Only directly adjacent events are compared, so no other message is
+     *   ever reordered or dropped.
+     * @param[in,out] conn status of current connection, see [Connection](#Connection)
+     * @param data event bytes, at parsed end of server buffer
+     * @return whether previous event was dropped, moving this one to its place
+     * @note Events carry the sequence number of the last request processed,
+     *   but do not consume one, so clients see no gap.
+     */
+    bool _compressMotion( Connection* conn, const uint8_t* data );
+    /**
+     * @brief Whether parsing a request or its reply updates parser or
+     *   connection state, and so must be done even if not logged.
+     * @param major_opcode request major opcode
+     * @param minor_opcode request minor opcode, if extension request
+     * @return whether parsing has side effects
+     * @note Of extension requests, only BIG-REQUESTS BigReqEnable is
+     *   stateful, as its reply enables extended length parsing.
+     * @ingroup logging
+     */
+    bool _statefulParsing( const uint8_t major_opcode,
+                           const uint8_t minor_opcode ) const;
     /**
      * @brief Parse X11 reply from raw bytes.
      * @tparam RequestT type of request encoding (eg protocol::requests::InternAtom)
@@ -1192,6 +1465,31 @@ private:
      */
     size_t _logError(
         Connection* conn, const uint8_t* data, const size_t sz );
+    /**
+     * @brief Whether parsed messages are recorded in their buffers to be
+     *   timed as they are written, see #logForwarded.
+     * @ingroup logging
+     */
+    inline bool _recordsForwarding() const {
+        return settings.timestamp_forward || settings.timestamp_inproxy ||
+            settings.latency;
+    }
+    /**
+     * @brief Whether last message parsed by #logClientMessages or
+     *   #logServerMessages was logged, for #logForwarded.
+     * @ingroup logging
+     */
+    bool _message_logged {};
+    /**
+     * @brief Formats optional `--timestamps` log prefix fields.
+     * @param conn status of current connection, see [Connection](#Connection)
+     * @param recv_ns monotonic time of message receipt
+     * @return formatted fields, each preceded by ':', or empty string if
+     *   `--timestamps` not used
+     * @ingroup logging
+     */
+    std::string _formatTimestamps(
+        const Connection* conn, const uint64_t recv_ns ) const;
     /**
      * @brief Base interface for classes that store parsing function pointers.
      * @ingroup dispatch
@@ -1660,10 +1958,115 @@ public:
     /**
      * @brief Import fetched atom strings from #ProxyX11Server if
      *   `--prefetchatoms` option is on.
-     * @param fetched_atoms reference atom strings fetched from actual X server,
-     *   representing contiguous interned ATOMs from 1 to n
+     * @param fetched_atoms reference atom strings fetched from actual X server
+     *   (or `--atomcache` file), representing contiguous interned ATOMs from
+     *   1 to n
+     * @return count of atoms not already interned with same string
+     */
+    size_t importFetchedAtoms( const std::vector< std::string >& fetched_atoms );
+    /**
+     * @brief Longest time a log line is held awaiting ATOM names with
+     *   `--resolveatoms`, after which it is printed with any still unknown
+     *   as "unrecognized atom".
+     */
+    static constexpr uint64_t ATOM_HOLD_NS { 50'000'000 };
+    /**
+     * @brief Takes ATOMs formatted without known names since last call, to
+     *   be looked up with `--resolveatoms`.
+     * @return ATOMs to look up, each returned once until resolved
+     */
+    std::vector< uint32_t > takeUnresolvedAtoms();
+    /**
+     * @brief Records outcome of ATOM lookup with `--resolveatoms`.
+     * @param atom ATOM looked up
+     * @param name interned string, or `std::nullopt` if lookup failed
+     */
+    void resolveAtom( const uint32_t atom,
+                      const std::optional< std::string >& name );
+    /**
+     * @brief Prints held log lines, in order, up to first line still awaiting
+     *   ATOM names for less than [ATOM_HOLD_NS](#ATOM_HOLD_NS).
+     * @param force print all held lines, eg before closing their streams
+     */
+    void flushHeldLines( const bool force = false );
+    /**
+     * @brief Prints log line in order with parsed message lines, holding it
+     *   behind any lines held for ATOM names (see #flushHeldLines.)
+     * @param log_fs stream to print to
+     * @param fmt_str format string
+     * @param args format args
+     */
+    template< typename... Args >
+    void println( ::FILE* log_fs, fmt::format_string< Args... > fmt_str,
+                  Args&&... args ) {
+        _println( log_fs, fmt_str, std::forward< Args >( args )... );
+    }
+    /**
+     * @brief Logs line for each logged message written since last call, with
+     *   `--timestamps` fields fwd and inproxy, and notes time requests were
+     *   written for `--latency`.
+     * @param conn pointer to connection
+     * @param buffer buffer of connection just written from
+     */
+    void logForwarded( Connection* conn, SocketBuffer* buffer );
+    /**
+     * @brief Whether any log lines are held, so that
+     *   [flushHeldLines](#flushHeldLines) should be called again within
+     *   [ATOM_HOLD_NS](#ATOM_HOLD_NS).
+     */
+    inline bool holdingLines() const {
+        return !_held_lines.empty();
+    }
+    /**
+     * @brief Print table of request to reply/error latency percentiles per
+     *   opcode, if `--latency` option is on.
+     */
+    void logLatencies() const;
+    /**
+     * @brief Updates state derived from [settings](#settings) after it is
+     *   changed at runtime.
+     */
+    void applySettings();
+    /**
+     * @brief Appends request to reply/error latency histograms in Prometheus
+     *   text exposition format, if `--latency` option is on.
+     * @param[out] out string to which metrics are appended
+     */
+    void formatLatencyMetrics( std::string* out ) const;
+    /**
+     * @brief Print blocking round trips of a connection, by call site, if
+     *   `--stalls` option is on.
+     * @param conn pointer to connection
+     */
+    void logStalls( const Connection* conn ) const;
+    /**
+     * @brief Adds message counters of a connection to totals, if `--stats`
+     *   option is on; to be called once per connection as it closes.
+     * @param conn pointer to closing connection
+     */
+    void mergeStats( const Connection* conn );
+    /**
+     * @brief With `--replycache`, forgets replies awaited by a connection as it
+     *   closes, and as the last connection closes all cached replies, as X
+     *   server may then reset and free any atoms not predefined.
+     * @param conn pointer to closing connection
+     * @param last_connection whether no other connections remain open
+     */
+    void closeReplyCache( const Connection* conn, const bool last_connection );
+    /**
+     * @brief Print table of message counters of a connection, if `--stats`
+     *   option is on.
+     * @param conn pointer to connection
+     */
+    void logStats( const Connection* conn ) const;
+    /**
+     * @brief Print table of message counters summed over all connections, if
+     *   `--stats` option is on.
+     * @param open_connections connections not yet closed (and so not yet
+     *   merged into totals)
      */
-    void importFetchedAtoms( const std::vector< std::string >& fetched_atoms );
+    void logTotalStats(
+        const std::unordered_map< int, Connection >& open_connections ) const;
 };
 
 // dtor names are explcitly qualified here to satisfy clang's questionable
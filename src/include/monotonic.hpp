@@ -0,0 +1,75 @@
+#ifndef MONOTONIC_HPP
+#define MONOTONIC_HPP
+
+/**
+ * @file monotonic.hpp
+ */
+
+#include <cstdint>
+
+#include <time.h>  // clock_gettime, CLOCK_MONOTONIC, CLOCK_MONOTONIC_COARSE...
+
+
+/**
+ * @brief Cheap monotonic timestamps in nanoseconds, for timing messages.
+ */
+namespace monotonic {
+
+/**
+ * @brief Nanoseconds per second.
+ */
+inline constexpr uint64_t NS_PER_SEC { 1'000'000'000 };
+
+namespace detail {
+
+/**
+ * @brief Reads clock.
+ * @param clock_id clock to read
+ * @return clock time in nanoseconds
+ */
+inline uint64_t
+read( const ::clockid_t clock_id ) {
+    ::timespec ts {};
+    ::clock_gettime( clock_id, &ts );
+    return uint64_t( ts.tv_sec ) * NS_PER_SEC + uint64_t( ts.tv_nsec );
+}
+
+}  // namespace monotonic::detail
+
+/**
+ * @brief Reads monotonic clock; served by vDSO without a syscall, at
+ *   nanosecond resolution.
+ * @return monotonic time in nanoseconds
+ */
+inline uint64_t
+now() {
+    return detail::read( CLOCK_MONOTONIC );
+}
+
+/**
+ * @brief Reads coarse monotonic clock; cheaper than [now](#now) but only at
+ *   scheduler tick resolution (typically 1-4ms.)
+ * @return monotonic time in nanoseconds
+ */
+inline uint64_t
+coarseNow() {
+    return detail::read( CLOCK_MONOTONIC_COARSE );
+}
+
+/**
+ * @brief Converts monotonic time to wall clock time, using offset between the
+ *   two clocks measured on first use.
+ * @param mono_ns monotonic time in nanoseconds
+ * @return nanoseconds since Unix epoch
+ */
+inline uint64_t
+toRealtime( const uint64_t mono_ns ) {
+    static const uint64_t offset_ns {
+        detail::read( CLOCK_REALTIME ) - detail::read( CLOCK_MONOTONIC ) };
+    return mono_ns + offset_ns;
+}
+
+}  // namespace monotonic
+
+
+#endif  // MONOTONIC_HPP
@@ -0,0 +1,125 @@
+#ifndef OPTIONTERMS_HPP
+#define OPTIONTERMS_HPP
+
+/**
+ * @file optionTerms.hpp
+ */
+
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <cstdint>
+
+#include <fmt/format.h>
+
+
+/**
+ * @brief Parsing of `key=value[,key=value...]` option expressions shared by
+ *   `--filter`, `--ratelimit` and `--netem`.
+ */
+namespace option_terms {
+
+/**
+ * @brief Single `key=value` term of an expression.
+ */
+struct Term {
+    /** @brief Text before `=`. */
+    std::string_view key;
+    /** @brief Text after `=`. */
+    std::string_view value;
+    /** @brief Whole term, eg to pass on to another parser. */
+    std::string_view str;
+};
+
+/**
+ * @brief Inclusive range of integers, eg connection ids and sequence numbers.
+ */
+struct Range {
+    /** @brief Lower bound. */
+    uint32_t min { 0 };
+    /** @brief Upper bound. */
+    uint32_t max { std::numeric_limits< uint32_t >::max() };
+    /**
+     * @brief Determines if a value is in the range.
+     * @param val value to test
+     * @return whether value is in range
+     */
+    inline bool in( const uint32_t val ) const {
+        return val >= min && val <= max;
+    }
+};
+
+/**
+ * @brief Message directions selected by `dir=` terms.
+ */
+struct Directions {
+    /** @brief Whether client to server messages are selected. */
+    bool client_to_server { true };
+    /** @brief Whether server to client messages are selected. */
+    bool server_to_client { true };
+    /**
+     * @brief Narrows selection to a single direction.
+     * @param value `dir=` value, one of `s<c`, `c2s`, `s>c`, `s2c` (glyphs
+     *   match X11ProtocolParser::CLIENT_TO_SERVER/SERVER_TO_CLIENT)
+     * @return error message, eg for direction conflicting with one already
+     *   selected, or `std::nullopt` on success
+     */
+    std::optional< std::string > select( const std::string_view value );
+};
+
+/**
+ * @brief Parses a decimal unsigned integer, requiring the entire string be used.
+ * @param str integer string
+ * @return parsed integer, or `std::nullopt` on failure
+ */
+std::optional< uint32_t >
+parseUnsigned( const std::string_view str );
+
+/**
+ * @brief Parses a decimal integer range `N[-M]`.
+ * @param str range string
+ * @return parsed range, or `std::nullopt` on failure
+ */
+std::optional< Range >
+parseRange( const std::string_view str );
+
+/**
+ * @brief Splits comma-separated expression into `key=value` terms.
+ * @tparam TermFuncT callable taking `const Term&` and returning
+ *   `std::optional< std::string >` error message
+ * @param expr option expression
+ * @param func called for each term in order, until it returns an error
+ * @return error message, or `std::nullopt` on success
+ */
+template< typename TermFuncT >
+std::optional< std::string >
+forEachTerm( const std::string_view expr, TermFuncT&& func ) {
+    for ( size_t term_start {}; term_start <= expr.size(); ) {
+        size_t term_end { expr.find( ',', term_start ) };
+        if ( term_end == std::string_view::npos )
+            term_end = expr.size();
+        const std::string_view term {
+            expr.substr( term_start, term_end - term_start ) };
+        term_start = term_end + 1;
+
+        const size_t eq_i { term.find( '=' ) };
+        if ( eq_i == std::string_view::npos || eq_i == 0 ||
+             eq_i == term.size() - 1 ) {
+            return fmt::format( "expected term in format key=value, got {:?}",
+                                term );
+        }
+        if ( auto error { func( Term{ term.substr( 0, eq_i ),
+                                      term.substr( eq_i + 1 ), term } ) };
+             error ) {
+            return error;
+        }
+    }
+    return std::nullopt;
+}
+
+}  // namespace option_terms
+
+
+#endif  // OPTIONTERMS_HPP
@@ -5343,11 +5343,11 @@ struct RotateProperties : public Request {
     };
     /** @brief Total encoding size in bytes (before suffix). */
     static constexpr size_t BASE_ENCODING_SZ {
-        sizeof( Prefix ) + sizeof( Length ) };
+        sizeof( Prefix ) + sizeof( Length ) + sizeof( Encoding ) };
     /** @brief Total encoding size in bytes (before suffix) when using
      *    BIG-REQUESTS encoding. */
     static constexpr size_t BASE_BIG_ENCODING_SZ {
-        sizeof( Prefix ) + sizeof( BigLength ) };
+        sizeof( Prefix ) + sizeof( BigLength ) + sizeof( Encoding ) };
 };
 /**
  * @brief Represents X11 %ForceScreenSaver request [encoding].
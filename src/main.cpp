@@ -2,6 +2,8 @@
  * @file main.cpp
  */
 
+#include <signal.h>  // pthread_sigmask, sigemptyset, sigaddset, SIGUSR1
+
 #include "ProxyX11Server.hpp"
 
 
@@ -18,6 +20,12 @@
  *     signal value + [SIGNAL_RETVAL_OFFSET](#ProxyX11Server::SIGNAL_RETVAL_OFFSET)
  */
 int main( const int argc, const char* argv[] ) {
+    // SIGUSR1 is only to be received by main thread while it waits in
+    //   ppoll(2), so block it before any worker threads inherit signal mask
+    ::sigset_t report_signals;
+    ::sigemptyset( &report_signals );
+    ::sigaddset( &report_signals, SIGUSR1 );
+    ::pthread_sigmask( SIG_BLOCK, &report_signals, nullptr );
     ProxyX11Server server { argc, argv };
     return server.run();
 }
@@ -0,0 +1,58 @@
+#include <charconv>       // from_chars
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <cstdint>
+
+#include <fmt/format.h>
+
+#include "optionTerms.hpp"
+
+
+namespace option_terms {
+
+std::optional< std::string >
+Directions::select( const std::string_view value ) {
+    bool c2s {};
+    if ( value == "s<c" || value == "c2s" ) {
+        c2s = true;
+    } else if ( value == "s>c" || value == "s2c" ) {
+        c2s = false;
+    } else {
+        return fmt::format( "invalid direction {:?}, expected one of: "
+                            "\"s<c\",\"c2s\",\"s>c\",\"s2c\"", value );
+    }
+    if ( !( c2s ? client_to_server : server_to_client ) ) {
+        return fmt::format( "direction {:?} conflicts with earlier \"dir\" "
+                            "term", value );
+    }
+    ( c2s ? server_to_client : client_to_server ) = false;
+    return std::nullopt;
+}
+
+std::optional< uint32_t >
+parseUnsigned( const std::string_view str ) {
+    uint32_t val {};
+    const char* end { str.data() + str.size() };
+    const auto [ ptr, ec ] { std::from_chars( str.data(), end, val ) };
+    if ( str.empty() || ec != std::errc{} || ptr != end )
+        return std::nullopt;
+    return val;
+}
+
+std::optional< Range >
+parseRange( const std::string_view str ) {
+    const size_t dash_i { str.find( '-' ) };
+    const auto min { parseUnsigned( str.substr( 0, dash_i ) ) };
+    if ( !min )
+        return std::nullopt;
+    if ( dash_i == std::string_view::npos )
+        return Range{ *min, *min };
+    const auto max { parseUnsigned( str.substr( dash_i + 1 ) ) };
+    if ( !max || *max < *min )
+        return std::nullopt;
+    return Range{ *min, *max };
+}
+
+}  // namespace option_terms
@@ -0,0 +1,117 @@
+#include <string_view>
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>              // stderr
+#include <cstdlib>             // free, EXIT_FAILURE
+
+#include <fmt/format.h>
+
+#include <xcb/xcb.h>
+
+
+// Run as `xtracepp --filter request=GetGeometry -- filter_test`: sends
+//   requests answered by replies, errors and events, and prints the sequence
+//   numbers of those the filter should log, to compare with the log. A
+//   `request=` term selects replies and errors answering that request, as
+//   well as the request itself.
+
+int main( [[maybe_unused]] const int argc, const char* const* argv ) {
+    assert( argc >= 1 );
+    const char* process_name { argv[ 0 ] };
+
+    // Open the connection to the X server
+    xcb_connection_t* conn {
+        xcb_connect( nullptr, nullptr ) };
+    assert( conn != nullptr );
+    // Get the first screen in `roots`
+    const xcb_setup_t*  setup  { xcb_get_setup( conn ) };
+    assert( setup  != nullptr );
+    const xcb_screen_t* screen { xcb_setup_roots_iterator( setup ).data };
+    assert( screen != nullptr );
+
+    // unmapped window to report PropertyNotify on
+    const xcb_window_t window { xcb_generate_id( conn ) };
+    const uint32_t     value_list[1] {
+        XCB_EVENT_MASK_PROPERTY_CHANGE
+    };
+    xcb_create_window( conn, XCB_COPY_FROM_PARENT, window, screen->root,
+                       0, 0, 1, 1, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                       screen->root_visual, XCB_CW_EVENT_MASK, value_list );
+
+    // selected by request=GetGeometry: request and Reply
+    const xcb_get_geometry_cookie_t geometry_cookie {
+        xcb_get_geometry( conn, screen->root ) };
+    // selected by request=GetGeometry: request and Drawable error
+    const xcb_get_geometry_cookie_t bad_geometry_cookie {
+        xcb_get_geometry( conn, XCB_WINDOW_NONE ) };
+    // not selected: request and reply
+    static constexpr std::string_view ATOM_NAME { "XTRACEPP_FILTER_TEST" };
+    const xcb_intern_atom_cookie_t intern_cookie {
+        xcb_intern_atom( conn, 0/*only_if_exists*/,
+                         uint16_t( ATOM_NAME.size() ), ATOM_NAME.data() ) };
+    // not selected: request and PropertyNotify
+    const xcb_void_cookie_t change_cookie {
+        xcb_change_property( conn, XCB_PROP_MODE_REPLACE, window,
+                             XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8, 4, "test" ) };
+    // not selected: request and Window error (selected by error=Window)
+    const xcb_void_cookie_t destroy_cookie {
+        xcb_destroy_window_checked( conn, XCB_WINDOW_NONE ) };
+    xcb_flush( conn );
+
+    xcb_generic_error_t* error {};
+    xcb_get_geometry_reply_t* geometry_reply {
+        xcb_get_geometry_reply( conn, geometry_cookie, &error ) };
+    if ( error != nullptr || geometry_reply == nullptr ) {
+        fmt::println( ::stderr, "{}: GetGeometry failure", process_name );
+        return EXIT_FAILURE;
+    }
+    ::free( geometry_reply );
+    geometry_reply = xcb_get_geometry_reply( conn, bad_geometry_cookie, &error );
+    if ( geometry_reply != nullptr || error == nullptr ||
+         error->error_code != XCB_DRAWABLE ||
+         error->major_code != XCB_GET_GEOMETRY ) {
+        fmt::println( ::stderr, "{}: expected Drawable error from GetGeometry",
+                      process_name );
+        return EXIT_FAILURE;
+    }
+    ::free( error );
+    xcb_intern_atom_reply_t* intern_reply {
+        xcb_intern_atom_reply( conn, intern_cookie, &error ) };
+    if ( error != nullptr || intern_reply == nullptr ) {
+        fmt::println( ::stderr, "{}: InternAtom failure", process_name );
+        return EXIT_FAILURE;
+    }
+    ::free( intern_reply );
+    error = xcb_request_check( conn, destroy_cookie );
+    if ( error == nullptr || error->error_code != XCB_WINDOW ) {
+        fmt::println( ::stderr, "{}: expected Window error from DestroyWindow",
+                      process_name );
+        return EXIT_FAILURE;
+    }
+    ::free( error );
+    for ( xcb_generic_event_t* event { xcb_wait_for_event( conn ) };
+          event != nullptr; event = xcb_wait_for_event( conn ) ) {
+        const bool property_notify {
+            ( event->response_type & 0x7f ) == XCB_PROPERTY_NOTIFY };
+        ::free( event );
+        if ( property_notify )
+            break;
+    }
+
+    fmt::println( ::stderr, "{}: with --filter request=GetGeometry, expect "
+                  "logged: S{:05d} GetGeometry request and reply, S{:05d} "
+                  "GetGeometry request and Drawable error", process_name,
+                  uint16_t( geometry_cookie.sequence ),
+                  uint16_t( bad_geometry_cookie.sequence ) );
+    fmt::println( ::stderr, "{}: expect not logged: S{:05d} InternAtom, "
+                  "S{:05d} ChangeProperty and PropertyNotify, S{:05d} "
+                  "DestroyWindow and Window error", process_name,
+                  uint16_t( intern_cookie.sequence ),
+                  uint16_t( change_cookie.sequence ),
+                  uint16_t( destroy_cookie.sequence ) );
+
+    xcb_destroy_window( conn, window );
+    xcb_flush( conn );
+    xcb_disconnect( conn );
+}
@@ -0,0 +1,147 @@
+#include <chrono>
+#include <thread>        // sleep_for
+#include <vector>
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>        // stderr
+#include <cstdlib>       // free, EXIT_FAILURE
+
+#include <fmt/format.h>
+
+#include <xcb/xcb.h>
+
+
+// Run as `xtracepp --motioncompress --netem dir=s2c,delay=200 --
+//   motioncompress_test`: delaying server messages keeps a run of
+//   MotionNotify events unsent in the proxy, so most are dropped as
+//   superseded. Events do not consume sequence numbers, so every event that
+//   reaches the client must still carry the sequence number of the request
+//   that caused it, whether or not the events before it were dropped.
+
+int main( [[maybe_unused]] const int argc, const char* const* argv ) {
+    assert( argc >= 1 );
+    const char* process_name { argv[ 0 ] };
+
+    // Open the connection to the X server
+    xcb_connection_t* conn {
+        xcb_connect( nullptr, nullptr ) };
+    assert( conn != nullptr );
+    // Get the first screen in `roots`
+    const xcb_setup_t*  setup  { xcb_get_setup( conn ) };
+    assert( setup  != nullptr );
+    const xcb_screen_t* screen { xcb_setup_roots_iterator( setup ).data };
+    assert( screen != nullptr );
+
+    // every pointer position in window maps to a distinct warp
+    static constexpr uint16_t WINDOW_SZ { 256 };
+    static constexpr size_t   WARP_CT { WINDOW_SZ * 200 };
+    const xcb_window_t window { xcb_generate_id( conn ) };
+    // override-redirect so that window is mapped where asked without a
+    //   window manager
+    const uint32_t value_mask { XCB_CW_OVERRIDE_REDIRECT | XCB_CW_EVENT_MASK };
+    const uint32_t value_list[2] {
+        1,
+        XCB_EVENT_MASK_POINTER_MOTION | XCB_EVENT_MASK_STRUCTURE_NOTIFY |
+        XCB_EVENT_MASK_PROPERTY_CHANGE
+    };
+    xcb_create_window( conn, XCB_COPY_FROM_PARENT, window, screen->root,
+                       0, 0, WINDOW_SZ, WINDOW_SZ, 0,
+                       XCB_WINDOW_CLASS_INPUT_OUTPUT, screen->root_visual,
+                       value_mask, value_list );
+    xcb_map_window( conn, window );
+    xcb_flush( conn );
+    for ( xcb_generic_event_t* event { xcb_wait_for_event( conn ) };
+          event != nullptr; event = xcb_wait_for_event( conn ) ) {
+        const bool mapped {
+            ( event->response_type & 0x7f ) == XCB_MAP_NOTIFY };
+        ::free( event );
+        if ( mapped )
+            break;
+    }
+    // start from a known position, discarding any motion into window
+    xcb_warp_pointer( conn, XCB_WINDOW_NONE, window, 0, 0, 0, 0, 0, 0 );
+    ::free( xcb_get_input_focus_reply(
+                conn, xcb_get_input_focus( conn ), nullptr ) );
+    while ( xcb_generic_event_t* event { xcb_poll_for_event( conn ) } )
+        ::free( event );
+
+    // sequence number of each warp, by index of position warped to
+    std::vector< uint16_t > warp_sequences( WARP_CT );
+    for ( size_t i { 1 }; i < WARP_CT; ++i ) {
+        const int16_t x { int16_t( i % WINDOW_SZ ) };
+        const int16_t y { int16_t( i / WINDOW_SZ ) };
+        warp_sequences[ i ] = uint16_t(
+            xcb_warp_pointer( conn, XCB_WINDOW_NONE, window,
+                              0, 0, 0, 0, x, y ).sequence );
+    }
+    const xcb_void_cookie_t change_cookie {
+        xcb_change_property( conn, XCB_PROP_MODE_REPLACE, window,
+                             XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8, 4, "test" ) };
+    const xcb_get_input_focus_cookie_t focus_cookie {
+        xcb_get_input_focus( conn ) };
+    xcb_flush( conn );
+    // let events pile up unread
+    using namespace std::chrono_literals; // ns, us, ms, s, h, etc.
+    std::this_thread::sleep_for( 500ms );
+
+    xcb_generic_error_t* error {};
+    xcb_get_input_focus_reply_t* focus_reply {
+        xcb_get_input_focus_reply( conn, focus_cookie, &error ) };
+    if ( error != nullptr || focus_reply == nullptr ||
+         focus_reply->sequence != uint16_t( focus_cookie.sequence ) ) {
+        fmt::println( ::stderr, "{}: GetInputFocus reply mismatch",
+                      process_name );
+        return EXIT_FAILURE;
+    }
+    ::free( focus_reply );
+
+    size_t motion_ct {};
+    size_t last_i {};
+    for ( xcb_generic_event_t* event { xcb_wait_for_event( conn ) };
+          event != nullptr; event = xcb_wait_for_event( conn ) ) {
+        const uint8_t code ( event->response_type & 0x7f );
+        if ( code == XCB_PROPERTY_NOTIFY ) {
+            const bool matches {
+                event->sequence == uint16_t( change_cookie.sequence ) };
+            ::free( event );
+            if ( !matches ) {
+                fmt::println( ::stderr, "{}: PropertyNotify sequence mismatch",
+                              process_name );
+                return EXIT_FAILURE;
+            }
+            break;
+        }
+        if ( code != XCB_MOTION_NOTIFY ) {
+            ::free( event );
+            continue;
+        }
+        const xcb_motion_notify_event_t* motion {
+            reinterpret_cast< xcb_motion_notify_event_t* >( event ) };
+        const size_t i {
+            size_t( motion->event_y ) * WINDOW_SZ + size_t( motion->event_x ) };
+        // surviving events stay in order, each with sequence of its own warp
+        const bool matches {
+            i > last_i && i < WARP_CT &&
+            motion->sequence == warp_sequences[ i ] };
+        ::free( event );
+        if ( !matches ) {
+            fmt::println( ::stderr, "{}: MotionNotify for position {} out of "
+                          "order or with sequence mismatch", process_name, i );
+            return EXIT_FAILURE;
+        }
+        last_i = i;
+        ++motion_ct;
+    }
+    if ( last_i != WARP_CT - 1 ) {
+        fmt::println( ::stderr, "{}: last MotionNotify (position {}) was "
+                      "dropped", process_name, last_i );
+        return EXIT_FAILURE;
+    }
+    fmt::println( ::stderr, "{}: received {} of {} MotionNotify events",
+                  process_name, motion_ct, WARP_CT - 1 );
+
+    xcb_destroy_window( conn, window );
+    xcb_flush( conn );
+    xcb_disconnect( conn );
+}
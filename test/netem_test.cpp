@@ -0,0 +1,111 @@
+#include <fstream>
+#include <string>
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>              // stderr
+#include <cstdlib>             // free, EXIT_FAILURE
+
+#include <unistd.h>            // getppid
+
+#include <fmt/format.h>
+
+#include <xcb/xcb.h>
+
+
+// Run as `xtracepp --netem delay=20 --outfile /dev/null -- netem_test`:
+//   pipelining many small requests keeps some bytes held in the proxy's
+//   client buffer at all times, so the buffer never empties to be cleared. Its
+//   written bytes must still be reclaimed, so the proxy (the parent of this
+//   process) should grow by no more than a few times the 1MiB it may hold,
+//   however much traffic passes through it.
+
+/**
+ * @brief Gets resident set size of a process.
+ * @param pid process id
+ * @return resident set size in KiB, or 0 if unknown
+ */
+static size_t residentKiB( const pid_t pid ) {
+    std::ifstream ifs { fmt::format( "/proc/{}/status", pid ) };
+    for ( std::string line; std::getline( ifs, line ); ) {
+        if ( line.rfind( "VmRSS:", 0 ) == 0 )
+            return std::stoul( line.substr( sizeof( "VmRSS:" ) - 1 ) );
+    }
+    return 0;
+}
+
+int main( [[maybe_unused]] const int argc, const char* const* argv ) {
+    assert( argc >= 1 );
+    const char* process_name { argv[ 0 ] };
+
+    const pid_t proxy_pid { ::getppid() };
+    std::string proxy_name;
+    std::getline( std::ifstream { fmt::format( "/proc/{}/comm", proxy_pid ) },
+                  proxy_name );
+    if ( proxy_name.rfind( "xtracepp", 0 ) != 0 ) {
+        fmt::println( stderr, "{}: expected to be run by xtracepp, not {}",
+                      process_name, proxy_name );
+        return EXIT_FAILURE;
+    }
+
+    // Open the connection to the X server
+    xcb_connection_t* conn {
+        xcb_connect( nullptr, nullptr ) };
+    assert( conn != nullptr );
+    // Get the first screen in `roots`
+    const xcb_setup_t*  setup  { xcb_get_setup( conn ) };
+    assert( setup  != nullptr );
+    const xcb_screen_t* screen { xcb_setup_roots_iterator( setup ).data };
+    assert( screen != nullptr );
+
+    const xcb_window_t window { xcb_generate_id( conn ) };
+    xcb_create_window( conn, XCB_COPY_FROM_PARENT, window, screen->root,
+                       0, 0, 1, 1, 0,
+                       XCB_WINDOW_CLASS_INPUT_OUTPUT, screen->root_visual,
+                       0, nullptr );
+
+    // 24-byte ChangeProperty header + 8 bytes of data
+    static constexpr size_t REQUEST_SZ { 32 };
+    static constexpr size_t REQUEST_CT { 16 * 1024 * 1024 / REQUEST_SZ };
+    static constexpr size_t MAX_GROWTH_KIB { 6 * 1024 };
+    const auto sync { [ conn ]() {
+        ::free( xcb_get_input_focus_reply(
+                    conn, xcb_get_input_focus( conn ), nullptr ) );
+    } };
+    static constexpr char data[] { "01234567" };
+    static_assert( 24 + sizeof( data ) - 1 == REQUEST_SZ );
+    // first pass lets buffers reach their working size before measuring
+    sync();
+    for ( size_t i {}; i < REQUEST_CT / 16; ++i ) {
+        xcb_change_property( conn, XCB_PROP_MODE_REPLACE, window,
+                             XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8,
+                             sizeof( data ) - 1, data );
+    }
+    sync();
+    const size_t start_kib { residentKiB( proxy_pid ) };
+    for ( size_t i {}; i < REQUEST_CT; ++i ) {
+        xcb_change_property( conn, XCB_PROP_MODE_REPLACE, window,
+                             XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8,
+                             sizeof( data ) - 1, data );
+    }
+    sync();
+    const size_t end_kib { residentKiB( proxy_pid ) };
+    xcb_disconnect( conn );
+
+    if ( start_kib == 0 || end_kib == 0 ) {
+        fmt::println( stderr, "{}: could not read resident size of pid {}",
+                      process_name, proxy_pid );
+        return EXIT_FAILURE;
+    }
+    const size_t growth_kib { end_kib > start_kib ? end_kib - start_kib : 0 };
+    if ( growth_kib > MAX_GROWTH_KIB ) {
+        fmt::println( stderr, "{}: proxy grew by {}KiB forwarding {} {}-byte "
+                      "requests, more than {}KiB",
+                      process_name, growth_kib, REQUEST_CT, REQUEST_SZ,
+                      MAX_GROWTH_KIB );
+        return EXIT_FAILURE;
+    }
+    fmt::println( "{}: proxy grew by {}KiB forwarding {} {}-byte requests",
+                  process_name, growth_kib, REQUEST_CT, REQUEST_SZ );
+    return 0;
+}
@@ -0,0 +1,195 @@
+#include <string_view>
+#include <vector>
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>              // stderr
+#include <cstdlib>             // free, EXIT_FAILURE
+
+#include <fmt/format.h>
+
+#include <xcb/xcb.h>
+
+
+// Run as `xtracepp --replycache -- replycache_test`: cached InternAtom and
+//   QueryExtension replies are answered by the proxy, so that every later
+//   reply, event and error must have its sequence number rewritten to the one
+//   the client expects. xcb matches responses to requests by sequence number,
+//   so any mistake surfaces here as a mismatch or a hang.
+
+/**
+ * @brief Compares 16-bit wire sequence number of response to full sequence
+ *   number of request cookie.
+ */
+static bool sequenceMatches( const uint16_t wire_sequence,
+                             const unsigned int cookie_sequence ) {
+    return wire_sequence == uint16_t( cookie_sequence );
+}
+
+int main( [[maybe_unused]] const int argc, const char* const* argv ) {
+    assert( argc >= 1 );
+    const char* process_name { argv[ 0 ] };
+
+    // Open the connection to the X server
+    xcb_connection_t* conn {
+        xcb_connect( nullptr, nullptr ) };
+    assert( conn != nullptr );
+    // Get the first screen in `roots`
+    const xcb_setup_t*  setup  { xcb_get_setup( conn ) };
+    assert( setup  != nullptr );
+    const xcb_screen_t* screen { xcb_setup_roots_iterator( setup ).data };
+    assert( screen != nullptr );
+
+    // unmapped window to report PropertyNotify on
+    const xcb_window_t window { xcb_generate_id( conn ) };
+    const uint32_t     value_list[1] {
+        XCB_EVENT_MASK_PROPERTY_CHANGE
+    };
+    xcb_create_window( conn, XCB_COPY_FROM_PARENT, window, screen->root,
+                       0, 0, 1, 1, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                       screen->root_visual, XCB_CW_EVENT_MASK, value_list );
+
+    // first InternAtom is forwarded, and its reply cached
+    static constexpr std::string_view ATOM_NAME { "XTRACEPP_REPLYCACHE_TEST" };
+    const auto intern { [ conn ]() {
+        return xcb_intern_atom( conn, 0/*only_if_exists*/,
+                                uint16_t( ATOM_NAME.size() ), ATOM_NAME.data() );
+    } };
+    xcb_generic_error_t* error {};
+    xcb_intern_atom_reply_t* intern_reply {
+        xcb_intern_atom_reply( conn, intern(), &error ) };
+    if ( error != nullptr ) {
+        fmt::println( ::stderr, "{}: InternAtom failure", process_name );
+        return EXIT_FAILURE;
+    }
+    assert( intern_reply != nullptr );
+    const xcb_atom_t atom { intern_reply->atom };
+    ::free( intern_reply );
+
+    // Pipeline requests so that cached replies must wait on forwarded ones:
+    //   after NoOperation (no reply) the proxy forwards a GetInputFocus of its
+    //   own and withholds its reply, to know when to send the cached reply
+    xcb_no_operation( conn );
+    const xcb_intern_atom_cookie_t hit_after_void { intern() };
+    const xcb_void_cookie_t change_cookie {
+        xcb_change_property( conn, XCB_PROP_MODE_REPLACE, window, atom,
+                             XCB_ATOM_STRING, 8, 4, "test" ) };
+    const xcb_get_input_focus_cookie_t focus_cookie {
+        xcb_get_input_focus( conn ) };
+    const xcb_intern_atom_cookie_t hit_after_reply { intern() };
+    const xcb_void_cookie_t destroy_cookie {
+        xcb_destroy_window_checked( conn, XCB_WINDOW_NONE ) };
+    static constexpr std::string_view EXTENSION_NAME { "BIG-REQUESTS" };
+    const xcb_query_extension_cookie_t extension_cookies[2] {
+        xcb_query_extension( conn, uint16_t( EXTENSION_NAME.size() ),
+                             EXTENSION_NAME.data() ),
+        xcb_query_extension( conn, uint16_t( EXTENSION_NAME.size() ),
+                             EXTENSION_NAME.data() )
+    };
+    const xcb_get_input_focus_cookie_t last_focus_cookie {
+        xcb_get_input_focus( conn ) };
+    xcb_flush( conn );
+
+    for ( const xcb_intern_atom_cookie_t cookie :
+              { hit_after_void, hit_after_reply } ) {
+        intern_reply = xcb_intern_atom_reply( conn, cookie, &error );
+        if ( error != nullptr || intern_reply == nullptr ||
+             intern_reply->atom != atom ||
+             !sequenceMatches( intern_reply->sequence, cookie.sequence ) ) {
+            fmt::println( ::stderr, "{}: cached InternAtom reply mismatch",
+                          process_name );
+            return EXIT_FAILURE;
+        }
+        ::free( intern_reply );
+    }
+    for ( const xcb_get_input_focus_cookie_t cookie :
+              { focus_cookie, last_focus_cookie } ) {
+        xcb_get_input_focus_reply_t* focus_reply {
+            xcb_get_input_focus_reply( conn, cookie, &error ) };
+        if ( error != nullptr || focus_reply == nullptr ||
+             !sequenceMatches( focus_reply->sequence, cookie.sequence ) ) {
+            fmt::println( ::stderr, "{}: GetInputFocus reply mismatch",
+                          process_name );
+            return EXIT_FAILURE;
+        }
+        ::free( focus_reply );
+    }
+    for ( const xcb_query_extension_cookie_t cookie : extension_cookies ) {
+        xcb_query_extension_reply_t* extension_reply {
+            xcb_query_extension_reply( conn, cookie, &error ) };
+        if ( error != nullptr || extension_reply == nullptr ||
+             !sequenceMatches( extension_reply->sequence, cookie.sequence ) ) {
+            fmt::println( ::stderr, "{}: QueryExtension reply mismatch",
+                          process_name );
+            return EXIT_FAILURE;
+        }
+        ::free( extension_reply );
+    }
+    error = xcb_request_check( conn, destroy_cookie );
+    if ( error == nullptr || error->error_code != XCB_WINDOW ||
+         error->major_code != XCB_DESTROY_WINDOW ||
+         !sequenceMatches( error->sequence, destroy_cookie.sequence ) ) {
+        fmt::println( ::stderr, "{}: expected Window error from DestroyWindow",
+                      process_name );
+        return EXIT_FAILURE;
+    }
+    ::free( error );
+    // events carry sequence number of last request processed
+    for ( xcb_generic_event_t* event { xcb_wait_for_event( conn ) };
+          event != nullptr; event = xcb_wait_for_event( conn ) ) {
+        const bool property_notify {
+            ( event->response_type & 0x7f ) == XCB_PROPERTY_NOTIFY };
+        const bool matches {
+            property_notify &&
+            reinterpret_cast< xcb_property_notify_event_t* >( event )->atom == atom &&
+            sequenceMatches( event->sequence, change_cookie.sequence ) };
+        ::free( event );
+        if ( !property_notify )
+            continue;
+        if ( !matches ) {
+            fmt::println( ::stderr, "{}: PropertyNotify mismatch", process_name );
+            return EXIT_FAILURE;
+        }
+        break;
+    }
+
+    // Enough cache hits that the sequence numbers seen by the server and the
+    //   client differ by more than 16 bits can count
+    static constexpr size_t BATCH_SZ { 1000 };
+    static constexpr size_t BATCH_CT { 70 };
+    std::vector< xcb_intern_atom_cookie_t > cookies;
+    cookies.reserve( BATCH_SZ );
+    for ( size_t batch_i {}; batch_i < BATCH_CT; ++batch_i ) {
+        cookies.clear();
+        for ( size_t i {}; i < BATCH_SZ; ++i )
+            cookies.emplace_back( intern() );
+        for ( const xcb_intern_atom_cookie_t cookie : cookies ) {
+            intern_reply = xcb_intern_atom_reply( conn, cookie, &error );
+            if ( error != nullptr || intern_reply == nullptr ||
+                 intern_reply->atom != atom ||
+                 !sequenceMatches( intern_reply->sequence, cookie.sequence ) ) {
+                fmt::println( ::stderr, "{}: cached InternAtom reply mismatch "
+                              "in batch {}", process_name, batch_i );
+                return EXIT_FAILURE;
+            }
+            ::free( intern_reply );
+        }
+    }
+    // forwarded request after wraparound
+    const xcb_get_input_focus_cookie_t wrapped_focus_cookie {
+        xcb_get_input_focus( conn ) };
+    xcb_get_input_focus_reply_t* focus_reply {
+        xcb_get_input_focus_reply( conn, wrapped_focus_cookie, &error ) };
+    if ( error != nullptr || focus_reply == nullptr ||
+         !sequenceMatches( focus_reply->sequence,
+                           wrapped_focus_cookie.sequence ) ) {
+        fmt::println( ::stderr, "{}: GetInputFocus reply mismatch after "
+                      "sequence wraparound", process_name );
+        return EXIT_FAILURE;
+    }
+    ::free( focus_reply );
+
+    xcb_destroy_window( conn, window );
+    xcb_flush( conn );
+    xcb_disconnect( conn );
+}
@@ -0,0 +1,209 @@
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>              // stderr
+#include <cstdlib>             // free, EXIT_FAILURE
+
+#include <unistd.h>            // getpid
+
+#include <fmt/format.h>
+
+#include <xcb/xcb.h>
+
+
+// Run as `xtracepp --resolveatoms [--prefetchatoms] -- resolveatoms_test
+//   [server_display]`: atoms are interned after the proxy started, directly
+//   on `server_display` if given so that the proxy never sees their
+//   InternAtom replies, then used in a pipeline of property requests whose
+//   log lines are held while the proxy looks up their names. Holding lines
+//   must never hold back traffic, so the pipeline must complete well within
+//   the time it would take were each line held in turn; the log should show
+//   every atom below by name, in request order.
+
+/**
+ * @brief Compares 16-bit wire sequence number of response to full sequence
+ *   number of request cookie.
+ */
+static bool sequenceMatches( const uint16_t wire_sequence,
+                             const unsigned int cookie_sequence ) {
+    return wire_sequence == uint16_t( cookie_sequence );
+}
+
+int main( const int argc, const char* const* argv ) {
+    assert( argc >= 1 );
+    const char* process_name { argv[ 0 ] };
+
+    // Open the connection to the X server (through the proxy)
+    xcb_connection_t* conn {
+        xcb_connect( nullptr, nullptr ) };
+    assert( conn != nullptr );
+    // Get the first screen in `roots`
+    const xcb_setup_t*  setup  { xcb_get_setup( conn ) };
+    assert( setup  != nullptr );
+    const xcb_screen_t* screen { xcb_setup_roots_iterator( setup ).data };
+    assert( screen != nullptr );
+
+    // Intern atoms unique to this run, so that no atom table loaded or
+    //   prefetched on proxy startup can have them
+    static constexpr size_t ATOM_CT { 200 };
+    std::vector< std::string > atom_names;
+    atom_names.reserve( ATOM_CT );
+    for ( size_t i {}; i < ATOM_CT; ++i ) {
+        atom_names.emplace_back( fmt::format(
+            "XTRACEPP_RESOLVEATOMS_TEST_{}_{}", ::getpid(), i ) );
+    }
+    std::vector< xcb_atom_t > atoms;
+    atoms.reserve( ATOM_CT );
+    {
+        xcb_connection_t* intern_conn { conn };
+        if ( argc > 1 ) {
+            intern_conn = xcb_connect( argv[ 1 ], nullptr );
+            if ( xcb_connection_has_error( intern_conn ) ) {
+                fmt::println( ::stderr, "{}: could not connect to {:?}",
+                              process_name, argv[ 1 ] );
+                return EXIT_FAILURE;
+            }
+        }
+        std::vector< xcb_intern_atom_cookie_t > cookies;
+        cookies.reserve( ATOM_CT );
+        for ( const std::string& name : atom_names ) {
+            cookies.emplace_back( xcb_intern_atom(
+                intern_conn, 0/*only_if_exists*/,
+                uint16_t( name.size() ), name.data() ) );
+        }
+        for ( const xcb_intern_atom_cookie_t cookie : cookies ) {
+            xcb_generic_error_t* error {};
+            xcb_intern_atom_reply_t* intern_reply {
+                xcb_intern_atom_reply( intern_conn, cookie, &error ) };
+            if ( error != nullptr || intern_reply == nullptr ) {
+                fmt::println( ::stderr, "{}: InternAtom failure", process_name );
+                return EXIT_FAILURE;
+            }
+            atoms.emplace_back( intern_reply->atom );
+            ::free( intern_reply );
+        }
+        if ( intern_conn != conn )
+            xcb_disconnect( intern_conn );
+    }
+
+    // unmapped window to report PropertyNotify on
+    const xcb_window_t window { xcb_generate_id( conn ) };
+    const uint32_t     value_list[1] {
+        XCB_EVENT_MASK_PROPERTY_CHANGE
+    };
+    xcb_create_window( conn, XCB_COPY_FROM_PARENT, window, screen->root,
+                       0, 0, 1, 1, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                       screen->root_visual, XCB_CW_EVENT_MASK, value_list );
+
+    // Pipeline every request before reading any response: each ChangeProperty
+    //   request and PropertyNotify, and GetProperty request, logs an ATOM
+    //   unknown to the proxy; GetAtomName replies come last, so that names are
+    //   not learned from traffic before the lines needing them
+    const auto start { std::chrono::steady_clock::now() };
+    std::vector< xcb_void_cookie_t > change_cookies;
+    std::vector< xcb_get_property_cookie_t > property_cookies;
+    change_cookies.reserve( ATOM_CT );
+    property_cookies.reserve( ATOM_CT );
+    for ( size_t i {}; i < ATOM_CT; ++i ) {
+        const std::string_view value { atom_names[ i ] };
+        change_cookies.emplace_back( xcb_change_property(
+            conn, XCB_PROP_MODE_REPLACE, window, atoms[ i ], XCB_ATOM_STRING,
+            8, uint32_t( value.size() ), value.data() ) );
+        property_cookies.emplace_back( xcb_get_property(
+            conn, 0/*_delete*/, window, atoms[ i ], XCB_ATOM_STRING,
+            0, uint32_t( value.size() ) ) );
+    }
+    std::vector< xcb_get_atom_name_cookie_t > name_cookies;
+    name_cookies.reserve( ATOM_CT );
+    for ( const xcb_atom_t atom : atoms )
+        name_cookies.emplace_back( xcb_get_atom_name( conn, atom ) );
+    xcb_flush( conn );
+
+    xcb_generic_error_t* error {};
+    for ( size_t i {}; i < ATOM_CT; ++i ) {
+        xcb_get_property_reply_t* property_reply {
+            xcb_get_property_reply( conn, property_cookies[ i ], &error ) };
+        const bool matches {
+            error == nullptr && property_reply != nullptr &&
+            sequenceMatches( property_reply->sequence,
+                             property_cookies[ i ].sequence ) &&
+            property_reply->type == XCB_ATOM_STRING &&
+            std::string_view(
+                static_cast< const char* >(
+                    xcb_get_property_value( property_reply ) ),
+                size_t( xcb_get_property_value_length( property_reply ) ) ) ==
+            atom_names[ i ] };
+        ::free( property_reply );
+        if ( !matches ) {
+            fmt::println( ::stderr, "{}: GetProperty reply mismatch for {:?}",
+                          process_name, atom_names[ i ] );
+            return EXIT_FAILURE;
+        }
+    }
+    for ( size_t i {}; i < ATOM_CT; ++i ) {
+        xcb_get_atom_name_reply_t* name_reply {
+            xcb_get_atom_name_reply( conn, name_cookies[ i ], &error ) };
+        const bool matches {
+            error == nullptr && name_reply != nullptr &&
+            sequenceMatches( name_reply->sequence,
+                             name_cookies[ i ].sequence ) &&
+            std::string_view(
+                xcb_get_atom_name_name( name_reply ),
+                size_t( xcb_get_atom_name_name_length( name_reply ) ) ) ==
+            atom_names[ i ] };
+        ::free( name_reply );
+        if ( !matches ) {
+            fmt::println( ::stderr, "{}: GetAtomName reply mismatch for {:?}",
+                          process_name, atom_names[ i ] );
+            return EXIT_FAILURE;
+        }
+    }
+    const auto elapsed { std::chrono::steady_clock::now() - start };
+    // events carry sequence number of last request processed
+    size_t event_i {};
+    while ( event_i < ATOM_CT ) {
+        xcb_generic_event_t* event { xcb_wait_for_event( conn ) };
+        if ( event == nullptr ) {
+            fmt::println( ::stderr, "{}: connection closed", process_name );
+            return EXIT_FAILURE;
+        }
+        if ( ( event->response_type & 0x7f ) != XCB_PROPERTY_NOTIFY ) {
+            ::free( event );
+            continue;
+        }
+        const bool matches {
+            reinterpret_cast< xcb_property_notify_event_t* >( event )->atom ==
+            atoms[ event_i ] &&
+            sequenceMatches( event->sequence,
+                             change_cookies[ event_i ].sequence ) };
+        ::free( event );
+        if ( !matches ) {
+            fmt::println( ::stderr, "{}: PropertyNotify mismatch for {:?}",
+                          process_name, atom_names[ event_i ] );
+            return EXIT_FAILURE;
+        }
+        ++event_i;
+    }
+
+    // log lines are held for up to 50ms each
+    using namespace std::chrono_literals; // ns, us, ms, s, h, etc.
+    static constexpr auto MAX_ELAPSED { ATOM_CT * 50ms / 4 };
+    if ( elapsed > MAX_ELAPSED ) {
+        fmt::println( ::stderr, "{}: pipeline took {}ms, held back by atom "
+                      "lookups", process_name,
+                      std::chrono::duration_cast< std::chrono::milliseconds >(
+                          elapsed ).count() );
+        return EXIT_FAILURE;
+    }
+    fmt::println( ::stderr, "{}: expect atoms {}..{} logged by name, "
+                  "eg {}({:?})", process_name, atoms.front(), atoms.back(),
+                  atoms.front(), atom_names.front() );
+
+    xcb_destroy_window( conn, window );
+    xcb_flush( conn );
+    xcb_disconnect( conn );
+}
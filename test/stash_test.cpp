@@ -0,0 +1,153 @@
+#include <fstream>
+#include <iterator>            // istreambuf_iterator
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>              // stderr
+#include <cstdlib>             // free, EXIT_FAILURE
+
+#include <unistd.h>            // getpid
+
+#include <fmt/format.h>
+
+#include <xcb/xcb.h>
+
+
+// Run as `xtracepp --unbuffered --outfile log_path -- stash_test log_path`:
+//   InternAtom and QueryExtension names are stashed by the proxy when their
+//   requests are parsed, until their replies are. Pipelining many requests
+//   with long names before reading any replies makes the proxy's client
+//   buffer be written, compacted and grown in the meantime, so that a stash
+//   left pointing into it would be overwritten. Names are learned from
+//   InternAtom replies through their stashes, so the log must show every
+//   atom in its reply with the name that was sent.
+
+/**
+ * @brief Compares 16-bit wire sequence number of response to full sequence
+ *   number of request cookie.
+ */
+static bool sequenceMatches( const uint16_t wire_sequence,
+                             const unsigned int cookie_sequence ) {
+    return wire_sequence == uint16_t( cookie_sequence );
+}
+
+int main( const int argc, const char* const* argv ) {
+    assert( argc >= 1 );
+    const char* process_name { argv[ 0 ] };
+
+    // Open the connection to the X server
+    xcb_connection_t* conn {
+        xcb_connect( nullptr, nullptr ) };
+    assert( conn != nullptr );
+
+    // Names unique to this run, so that proxy can not already know them, and
+    //   long enough that the pipeline far exceeds socket and buffer sizes
+    static constexpr size_t ATOM_CT { 5000 };
+    static constexpr size_t NAME_SZ { 200 };
+    std::vector< std::string > atom_names;
+    atom_names.reserve( ATOM_CT );
+    for ( size_t i {}; i < ATOM_CT; ++i ) {
+        std::string name { fmt::format(
+            "XTRACEPP_STASH_TEST_{}_{}_", ::getpid(), i ) };
+        // pad with a pattern distinct per atom, so that any overwritten or
+        //   shifted stash yields a different name
+        for ( size_t j {}; name.size() < NAME_SZ; ++j )
+            name.push_back( char( 'A' + ( i + j ) % 26 ) );
+        atom_names.emplace_back( std::move( name ) );
+    }
+    // QueryExtension requests are stashed alongside, both for extensions the
+    //   server has and for those it does not
+    static constexpr std::string_view EXTENSION_NAMES[] {
+        "BIG-REQUESTS", "XTRACEPP-NO-SUCH-EXTENSION"
+    };
+    static constexpr size_t EXTENSION_PERIOD { 7 };
+
+    std::vector< xcb_intern_atom_cookie_t > intern_cookies;
+    std::vector< xcb_query_extension_cookie_t > extension_cookies;
+    intern_cookies.reserve( ATOM_CT );
+    extension_cookies.reserve( ATOM_CT / EXTENSION_PERIOD + 1 );
+    for ( size_t i {}; i < ATOM_CT; ++i ) {
+        intern_cookies.emplace_back( xcb_intern_atom(
+            conn, 0/*only_if_exists*/, uint16_t( atom_names[ i ].size() ),
+            atom_names[ i ].data() ) );
+        if ( i % EXTENSION_PERIOD == 0 ) {
+            const std::string_view extension_name {
+                EXTENSION_NAMES[ extension_cookies.size() %
+                                 std::size( EXTENSION_NAMES ) ] };
+            extension_cookies.emplace_back( xcb_query_extension(
+                conn, uint16_t( extension_name.size() ),
+                extension_name.data() ) );
+        }
+    }
+    xcb_flush( conn );
+
+    xcb_generic_error_t* error {};
+    std::vector< xcb_atom_t > atoms;
+    atoms.reserve( ATOM_CT );
+    for ( size_t i {}; i < ATOM_CT; ++i ) {
+        xcb_intern_atom_reply_t* intern_reply {
+            xcb_intern_atom_reply( conn, intern_cookies[ i ], &error ) };
+        if ( error != nullptr || intern_reply == nullptr ||
+             intern_reply->atom == XCB_ATOM_NONE ||
+             !sequenceMatches( intern_reply->sequence,
+                               intern_cookies[ i ].sequence ) ) {
+            fmt::println( ::stderr, "{}: InternAtom reply mismatch for {:?}",
+                          process_name, atom_names[ i ] );
+            return EXIT_FAILURE;
+        }
+        atoms.emplace_back( intern_reply->atom );
+        ::free( intern_reply );
+    }
+    for ( size_t i {}; i < extension_cookies.size(); ++i ) {
+        xcb_query_extension_reply_t* extension_reply {
+            xcb_query_extension_reply( conn, extension_cookies[ i ], &error ) };
+        const bool expect_present { i % std::size( EXTENSION_NAMES ) == 0 };
+        if ( error != nullptr || extension_reply == nullptr ||
+             bool( extension_reply->present ) != expect_present ||
+             !sequenceMatches( extension_reply->sequence,
+                               extension_cookies[ i ].sequence ) ) {
+            fmt::println( ::stderr, "{}: QueryExtension reply mismatch",
+                          process_name );
+            return EXIT_FAILURE;
+        }
+        ::free( extension_reply );
+    }
+    xcb_disconnect( conn );
+
+    if ( argc < 2 ) {
+        fmt::println( ::stderr, "{}: no log path given, expect atoms {}..{} "
+                      "logged by name in InternAtom replies", process_name,
+                      atoms.front(), atoms.back() );
+        return EXIT_SUCCESS;
+    }
+    // replies are logged before they are forwarded, so with --unbuffered all
+    //   are in log by now
+    std::ifstream log_ifs { argv[ 1 ] };
+    if ( !log_ifs ) {
+        fmt::println( ::stderr, "{}: could not open log {:?}", process_name,
+                      argv[ 1 ] );
+        return EXIT_FAILURE;
+    }
+    const std::string log { std::istreambuf_iterator< char >( log_ifs ),
+                            std::istreambuf_iterator< char >() };
+    size_t missing_ct {};
+    for ( size_t i {}; i < ATOM_CT; ++i ) {
+        const std::string expected {
+            fmt::format( "atom={}({:?})", atoms[ i ], atom_names[ i ] ) };
+        if ( log.find( expected ) != std::string::npos )
+            continue;
+        if ( missing_ct == 0 ) {
+            fmt::println( ::stderr, "{}: log has no {}", process_name,
+                          expected );
+        }
+        ++missing_ct;
+    }
+    if ( missing_ct > 0 ) {
+        fmt::println( ::stderr, "{}: {} of {} atoms not logged with their "
+                      "names", process_name, missing_ct, ATOM_CT );
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,207 @@
+#include <array>
+#include <vector>
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>              // stderr
+#include <cstdlib>             // free, EXIT_FAILURE
+#include <cstring>             // memcmp
+
+#include <fmt/format.h>
+
+#include <xcb/xcb.h>
+
+
+// Run through two instances joined by a tunnel with image caching, eg
+//   `xtracepp --display :0 --proxydisplay :8 --tunnellisten 6100
+//   --imagecache 1` and `xtracepp --display :8 --proxydisplay :9
+//   --tunnelconnect localhost:6100 --imagecache 1 -- tunnel_test`: repeated
+//   small requests, replies and events are sent as deltas from the last of
+//   their type, and repeated images as cache references, so that any mistake
+//   in rebuilding them at the far end surfaces here as a mismatch.
+
+/**
+ * @brief Compares 16-bit wire sequence number of response to full sequence
+ *   number of request cookie.
+ */
+static bool sequenceMatches( const uint16_t wire_sequence,
+                             const unsigned int cookie_sequence ) {
+    return wire_sequence == uint16_t( cookie_sequence );
+}
+
+int main( [[maybe_unused]] const int argc, const char* const* argv ) {
+    assert( argc >= 1 );
+    const char* process_name { argv[ 0 ] };
+
+    // Open the connection to the X server
+    xcb_connection_t* conn {
+        xcb_connect( nullptr, nullptr ) };
+    assert( conn != nullptr );
+    // Get the first screen in `roots`
+    const xcb_setup_t*  setup  { xcb_get_setup( conn ) };
+    assert( setup  != nullptr );
+    const xcb_screen_t* screen { xcb_setup_roots_iterator( setup ).data };
+    assert( screen != nullptr );
+
+    // unmapped window to report PropertyNotify on
+    const xcb_window_t window { xcb_generate_id( conn ) };
+    const uint32_t     value_list[1] {
+        XCB_EVENT_MASK_PROPERTY_CHANGE
+    };
+    xcb_create_window( conn, XCB_COPY_FROM_PARENT, window, screen->root,
+                       0, 0, 1, 1, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                       screen->root_visual, XCB_CW_EVENT_MASK, value_list );
+
+    // Delta encoding: ChangeProperty requests, PropertyNotify events and
+    //   GetGeometry replies each differ from the last of their type in only a
+    //   few bytes
+    static constexpr size_t DELTA_CT { 1000 };
+    std::vector< xcb_void_cookie_t > change_cookies;
+    std::vector< xcb_get_geometry_cookie_t > geometry_cookies;
+    change_cookies.reserve( DELTA_CT );
+    geometry_cookies.reserve( DELTA_CT );
+    for ( size_t i {}; i < DELTA_CT; ++i ) {
+        const uint32_t value { uint32_t( i ) };
+        change_cookies.emplace_back( xcb_change_property(
+            conn, XCB_PROP_MODE_REPLACE, window, XCB_ATOM_WM_NAME,
+            XCB_ATOM_CARDINAL, 32, 1, &value ) );
+        geometry_cookies.emplace_back( xcb_get_geometry( conn, window ) );
+    }
+    xcb_flush( conn );
+    xcb_generic_error_t* error {};
+    for ( const xcb_get_geometry_cookie_t cookie : geometry_cookies ) {
+        xcb_get_geometry_reply_t* geometry_reply {
+            xcb_get_geometry_reply( conn, cookie, &error ) };
+        const bool matches {
+            error == nullptr && geometry_reply != nullptr &&
+            sequenceMatches( geometry_reply->sequence, cookie.sequence ) &&
+            geometry_reply->root == screen->root &&
+            geometry_reply->width == 1 && geometry_reply->height == 1 };
+        ::free( geometry_reply );
+        if ( !matches ) {
+            fmt::println( ::stderr, "{}: GetGeometry reply mismatch",
+                          process_name );
+            return EXIT_FAILURE;
+        }
+    }
+    // events carry sequence number of last request processed
+    for ( size_t event_i {}; event_i < DELTA_CT; ) {
+        xcb_generic_event_t* event { xcb_wait_for_event( conn ) };
+        if ( event == nullptr ) {
+            fmt::println( ::stderr, "{}: connection closed", process_name );
+            return EXIT_FAILURE;
+        }
+        if ( ( event->response_type & 0x7f ) != XCB_PROPERTY_NOTIFY ) {
+            ::free( event );
+            continue;
+        }
+        const bool matches {
+            reinterpret_cast< xcb_property_notify_event_t* >( event )->atom ==
+            XCB_ATOM_WM_NAME &&
+            sequenceMatches( event->sequence,
+                             change_cookies[ event_i ].sequence ) };
+        ::free( event );
+        if ( !matches ) {
+            fmt::println( ::stderr, "{}: PropertyNotify mismatch for "
+                          "ChangeProperty {}", process_name, event_i );
+            return EXIT_FAILURE;
+        }
+        ++event_i;
+    }
+
+    // Image caching: rows of bitmaps 32 pixels wide need no padding, so that
+    //   their data round-trips exactly; at 256B they are large enough to be
+    //   cached, and as whole messages too large to be sent as deltas
+    static constexpr uint16_t IMAGE_W { 32 };
+    static constexpr uint16_t IMAGE_H { 64 };
+    static constexpr size_t   IMAGE_SZ { IMAGE_W / 8 * IMAGE_H };
+    using Image = std::array< uint8_t, IMAGE_SZ >;
+    // A and B differ throughout, C from A in a single bit, so that a hash
+    //   hit must only be taken for identical data
+    std::array< Image, 3 > images {};
+    for ( size_t i {}; i < IMAGE_SZ; ++i ) {
+        images[ 0 ][ i ] = uint8_t( i * 7 + 1 );
+        images[ 1 ][ i ] = uint8_t( i * 13 + 5 );
+    }
+    images[ 2 ] = images[ 0 ];
+    images[ 2 ][ IMAGE_SZ / 2 ] ^= 0x10;
+    const xcb_pixmap_t pixmap { xcb_generate_id( conn ) };
+    xcb_create_pixmap( conn, 1, pixmap, screen->root, IMAGE_W, IMAGE_H );
+    const xcb_gcontext_t gc { xcb_generate_id( conn ) };
+    xcb_create_gc( conn, gc, pixmap, 0, nullptr );
+
+    // Put then get each image in turn, so that after the first round every
+    //   PutImage request and GetImage reply is a cache hit; a GetImage
+    //   answered with an error partway must not throw off matching of later
+    //   replies to their requests
+    static constexpr size_t ROUND_CT { 50 };
+    static constexpr size_t ERROR_ROUND_I { ROUND_CT / 2 };
+    struct Get {
+        xcb_get_image_cookie_t cookie;
+        size_t image_i;
+    };
+    std::vector< Get > gets;
+    gets.reserve( ROUND_CT * images.size() );
+    xcb_get_image_cookie_t error_cookie {};
+    for ( size_t round_i {}; round_i < ROUND_CT; ++round_i ) {
+        for ( size_t image_i {}; image_i < images.size(); ++image_i ) {
+            xcb_put_image( conn, XCB_IMAGE_FORMAT_Z_PIXMAP, pixmap, gc,
+                           IMAGE_W, IMAGE_H, 0, 0, 0/*left_pad*/, 1,
+                           uint32_t( IMAGE_SZ ), images[ image_i ].data() );
+            gets.push_back( { xcb_get_image(
+                conn, XCB_IMAGE_FORMAT_Z_PIXMAP, pixmap, 0, 0,
+                IMAGE_W, IMAGE_H, ~uint32_t{} ), image_i } );
+        }
+        if ( round_i == ERROR_ROUND_I ) {
+            error_cookie = xcb_get_image(
+                conn, XCB_IMAGE_FORMAT_Z_PIXMAP, XCB_PIXMAP_NONE, 0, 0,
+                IMAGE_W, IMAGE_H, ~uint32_t{} );
+        }
+    }
+    xcb_flush( conn );
+    for ( size_t get_i {}; get_i < gets.size(); ++get_i ) {
+        const Get& get { gets[ get_i ] };
+        if ( get_i == ( ERROR_ROUND_I + 1 ) * images.size() ) {
+            xcb_get_image_reply_t* image_reply {
+                xcb_get_image_reply( conn, error_cookie, &error ) };
+            const bool matches {
+                image_reply == nullptr && error != nullptr &&
+                error->error_code == XCB_DRAWABLE &&
+                error->major_code == XCB_GET_IMAGE &&
+                sequenceMatches( error->sequence, error_cookie.sequence ) };
+            ::free( image_reply );
+            ::free( error );
+            error = nullptr;
+            if ( !matches ) {
+                fmt::println( ::stderr, "{}: expected Drawable error from "
+                              "GetImage", process_name );
+                return EXIT_FAILURE;
+            }
+        }
+        xcb_get_image_reply_t* image_reply {
+            xcb_get_image_reply( conn, get.cookie, &error ) };
+        const bool matches {
+            error == nullptr && image_reply != nullptr &&
+            sequenceMatches( image_reply->sequence, get.cookie.sequence ) &&
+            image_reply->depth == 1 &&
+            size_t( xcb_get_image_data_length( image_reply ) ) == IMAGE_SZ &&
+            std::memcmp( xcb_get_image_data( image_reply ),
+                         images[ get.image_i ].data(), IMAGE_SZ ) == 0 };
+        ::free( image_reply );
+        if ( !matches ) {
+            fmt::println( ::stderr, "{}: GetImage reply mismatch for image {} "
+                          "in round {}", process_name, get.image_i,
+                          get_i / images.size() );
+            return EXIT_FAILURE;
+        }
+    }
+    fmt::println( ::stderr, "{}: expect {} of {} PutImage requests and "
+                  "GetImage replies to be image cache hits", process_name,
+                  gets.size() - images.size(), gets.size() );
+
+    xcb_free_gc( conn, gc );
+    xcb_free_pixmap( conn, pixmap );
+    xcb_destroy_window( conn, window );
+    xcb_flush( conn );
+    xcb_disconnect( conn );
+}